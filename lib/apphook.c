@@ -26,8 +26,10 @@
 #include "messages.h"
 #include "children.h"
 #include "dnscache.h"
+#include "dnsresolver.h"
 #include "alarms.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-dynamic.h"
 #include "tags.h"
 #include "logmsg.h"
 #include "timeutils.h"
@@ -35,9 +37,12 @@
 #include "logwriter.h"
 #include "afinter.h"
 #include "template/templates.h"
+#include "logmatcher-prefilter.h"
+#include "logmatcher-pcre.h"
 #include "hostname.h"
 #include "scratch-buffers.h"
 #include "mainloop-call.h"
+#include "slab-alloc.h"
 
 #include <iv.h>
 #include <iv_work.h>
@@ -120,13 +125,14 @@ app_startup(void)
   g_thread_init(NULL);
   hostname_global_init();
   dns_cache_global_init();
-  dns_cache_thread_init();
   afinter_global_init();
   child_manager_init();
   alarm_init();
   stats_init();
   tzset();
+  slab_alloc_global_init();
   log_msg_global_init();
+  dns_resolver_global_init();
   log_tags_global_init();
   log_source_global_init();
   log_template_global_init();
@@ -155,15 +161,19 @@ void
 app_shutdown(void)
 {
   run_application_hook(AH_SHUTDOWN);
+  log_template_thread_deinit();
   log_template_global_deinit();
+  log_matcher_prefilter_thread_deinit();
+  log_matcher_pcre_thread_deinit();
   log_tags_global_deinit();
   log_msg_global_deinit();
+  slab_alloc_global_deinit();
+  dns_resolver_global_deinit();
 
   stats_destroy();
   child_manager_deinit();
   g_list_foreach(application_hooks, (GFunc) g_free, NULL);
   g_list_free(application_hooks);
-  dns_cache_thread_deinit();
   dns_cache_global_deinit();
   hostname_global_deinit();
   msg_deinit();
@@ -186,14 +196,17 @@ void
 app_thread_start(void)
 {
   scratch_buffers_init();
-  dns_cache_thread_init();
   main_loop_call_thread_init();
 }
 
 void
 app_thread_stop(void)
 {
-  dns_cache_thread_deinit();
+  stats_dynamic_counters_thread_deinit();
+  log_template_thread_deinit();
+  log_matcher_prefilter_thread_deinit();
+  log_matcher_pcre_thread_deinit();
   scratch_buffers_free();
+  slab_alloc_thread_deinit();
   main_loop_call_thread_deinit();
 }
@@ -60,6 +60,11 @@ extern struct _LogMatcherOptions *last_matcher_options;
 extern struct _HostResolveOptions *last_host_resolve_options;
 extern struct _StatsOptions *last_stats_options;
 
+void log_threaded_dest_driver_set_batch_lines(struct _LogDriver *s, gint batch_lines);
+void log_threaded_dest_driver_set_batch_timeout(struct _LogDriver *s, gint batch_timeout);
+void log_threaded_dest_driver_set_num_workers(struct _LogDriver *s, gint num_workers);
+void log_threaded_dest_driver_set_worker_partition_key(struct _LogDriver *s, struct _LogTemplate *key);
+
 }
 
 %name-prefix "main_"
@@ -220,6 +225,7 @@ extern struct _StatsOptions *last_stats_options;
 
 %token KW_DNS_CACHE                   10120
 %token KW_DNS_CACHE_SIZE              10121
+%token KW_DNS_WAIT                    10122
 
 %token KW_DNS_CACHE_EXPIRE            10130
 %token KW_DNS_CACHE_EXPIRE_FAILED     10131
@@ -227,6 +233,7 @@ extern struct _StatsOptions *last_stats_options;
 
 %token KW_PERSIST_ONLY                10140
 %token KW_USE_RCPTID                  10141
+%token KW_PCRE_JIT                    10142
 
 %token KW_TZ_CONVERT                  10150
 %token KW_TS_FORMAT                   10151
@@ -241,6 +248,14 @@ extern struct _StatsOptions *last_stats_options;
 
 %token KW_THROTTLE                    10170
 %token KW_THREADED                    10171
+%token KW_DISK_BUFFER                 10172
+%token KW_DISK_BUF_SIZE               10173
+%token KW_MEM_BUF_LENGTH              10174
+%token KW_BATCH_LINES                 10175
+%token KW_BATCH_TIMEOUT               10176
+%token KW_WORKERS                     10177
+%token KW_WORKER_PARTITION_KEY        10178
+%token KW_LOCKLESS_QUEUE              10179
 
 /* log statement options */
 %token KW_FLAGS                       10190
@@ -852,6 +867,7 @@ options_item
 	| KW_SUPPRESS '(' LL_NUMBER ')'		{ configuration->suppress = $3; }
 	| KW_THREADED '(' yesno ')'		{ configuration->threaded = $3; }
 	| KW_USE_RCPTID '(' yesno ')'		{ configuration->use_rcptid = $3; }
+	| KW_PCRE_JIT '(' yesno ')'		{ cfg_pcre_jit_set(configuration, $3); }
 	| KW_LOG_FIFO_SIZE '(' LL_NUMBER ')'	{ configuration->log_fifo_size = $3; }
 	| KW_LOG_IW_SIZE '(' LL_NUMBER ')'	{ msg_error("Using a global log-iw-size() option was removed, please use a per-source log-iw-size()", NULL); }
 	| KW_LOG_FETCH_LIMIT '(' LL_NUMBER ')'	{ msg_error("Using a global log-fetch-limit() option was removed, please use a per-source log-fetch-limit()", NULL); }
@@ -997,6 +1013,7 @@ host_resolve_option
         | KW_USE_DNS '(' dnsmode ')'            { last_host_resolve_options->use_dns = $3; }
 	| KW_DNS_CACHE '(' yesno ')' 		{ last_host_resolve_options->use_dns_cache = $3; }
 	| KW_NORMALIZE_HOSTNAMES '(' yesno ')'	{ last_host_resolve_options->normalize_hostnames = $3; }
+	| KW_DNS_WAIT '(' LL_NUMBER ')'		{ last_host_resolve_options->dns_wait = $3; }
 	;
 
 msg_format_option
@@ -1040,6 +1057,10 @@ dest_driver_option
 
 	: KW_LOG_FIFO_SIZE '(' LL_NUMBER ')'	{ ((LogDestDriver *) last_driver)->log_fifo_size = $3; }
 	| KW_THROTTLE '(' LL_NUMBER ')'         { ((LogDestDriver *) last_driver)->throttle = $3; }
+	| KW_DISK_BUFFER '(' yesno ')'          { ((LogDestDriver *) last_driver)->disk_buffer = $3; }
+	| KW_DISK_BUF_SIZE '(' LL_NUMBER ')'    { ((LogDestDriver *) last_driver)->disk_buf_size = $3; }
+	| KW_MEM_BUF_LENGTH '(' LL_NUMBER ')'   { ((LogDestDriver *) last_driver)->mem_buf_length = $3; }
+	| KW_LOCKLESS_QUEUE '(' yesno ')'       { ((LogDestDriver *) last_driver)->lockless_queue = $3; }
         | LL_IDENTIFIER
           {
             Plugin *p;
@@ -1060,6 +1081,16 @@ dest_driver_option
           }
         ;
 
+threaded_dest_driver_option
+        /* NOTE: plugins need to set "last_driver" to a LogThrDestDriver instance in order to incorporate this rule in their grammar */
+
+	: KW_BATCH_LINES '(' LL_NUMBER ')'      { log_threaded_dest_driver_set_batch_lines(last_driver, $3); }
+	| KW_BATCH_TIMEOUT '(' LL_NUMBER ')'    { log_threaded_dest_driver_set_batch_timeout(last_driver, $3); }
+	| KW_WORKERS '(' LL_NUMBER ')'          { log_threaded_dest_driver_set_num_workers(last_driver, $3); }
+	| KW_WORKER_PARTITION_KEY '(' template_content ')' { log_threaded_dest_driver_set_worker_partition_key(last_driver, $3); }
+	| dest_driver_option
+	;
+
 dest_writer_options
 	: dest_writer_option dest_writer_options
 	|
@@ -112,6 +112,7 @@ static CfgLexerKeyword main_keywords[] = {
   { "default_facility",   KW_DEFAULT_FACILITY, 0x0300 },
   { "threaded",           KW_THREADED, 0x0303 },
   { "use_rcptid",         KW_USE_RCPTID, 0x0306 },
+  { "pcre_jit",           KW_PCRE_JIT, 0x0306 },
 
   { "value",              KW_VALUE, 0x0300 },
 
@@ -123,6 +124,14 @@ static CfgLexerKeyword main_keywords[] = {
   { "program_override",   KW_PROGRAM_OVERRIDE, 0x0300 },
   { "host_override",      KW_HOST_OVERRIDE, 0x0300 },
   { "throttle",           KW_THROTTLE },
+  { "disk_buffer",        KW_DISK_BUFFER, 0x0306 },
+  { "disk_buf_size",      KW_DISK_BUF_SIZE, 0x0306 },
+  { "mem_buf_length",     KW_MEM_BUF_LENGTH, 0x0306 },
+  { "batch_lines",        KW_BATCH_LINES, 0x0306 },
+  { "batch_timeout",      KW_BATCH_TIMEOUT, 0x0306 },
+  { "workers",            KW_WORKERS, 0x0306 },
+  { "worker_partition_key", KW_WORKER_PARTITION_KEY, 0x0306 },
+  { "lockless_queue",     KW_LOCKLESS_QUEUE, 0x0306 },
 
   { "create_dirs",        KW_CREATE_DIRS },
   { "optional",           KW_OPTIONAL },
@@ -142,6 +151,7 @@ static CfgLexerKeyword main_keywords[] = {
   { "dns_cache_size",     KW_DNS_CACHE_SIZE },
   { "dns_cache_expire",   KW_DNS_CACHE_EXPIRE },
   { "dns_cache_expire_failed", KW_DNS_CACHE_EXPIRE_FAILED },
+  { "dns_wait",           KW_DNS_WAIT, 0x0306 },
 
   /* filter items */
   { "type",               KW_TYPE, 0x0300 },
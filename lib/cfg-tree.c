@@ -26,9 +26,15 @@
 #include "messages.h"
 #include "afinter.h"
 #include "logmpx.h"
+#include "filter/filter-pipe.h"
 
 #include <string.h>
 
+/* the minimum number of sibling branches filtering on the same value to index them */
+#define CFG_TREE_DISPATCH_MIN_BRANCHES 8
+/* the minimum number of matchers on the same value to scan it using a prefilter */
+#define CFG_TREE_PREFILTER_MIN_LITERALS 4
+
 /*
  * Return the textual representation of a node content type.
  */
@@ -402,6 +408,16 @@ cfg_tree_get_child_id(CfgTree *self, gint content, LogExprNode *node)
   return res;
 }
 
+static LogMultiplexer *
+cfg_tree_new_multiplexer(CfgTree *self)
+{
+  LogMultiplexer *mpx = log_multiplexer_new(0, self->cfg);
+
+  g_ptr_array_add(self->initialized_pipes, &mpx->super);
+  g_ptr_array_add(self->multiplexers, mpx);
+  return mpx;
+}
+
 /* hash foreach function to add all source objects to catch-all rules */
 static void
 cfg_tree_add_all_sources(gpointer key, gpointer value, gpointer user_data)
@@ -524,8 +540,7 @@ cfg_tree_compile_reference(CfgTree *self, LogExprNode *node,
 
             if (!sub_pipe_tail->pipe_next)
               {
-                mpx = log_multiplexer_new(0, self->cfg);
-                g_ptr_array_add(self->initialized_pipes, &mpx->super);
+                mpx = cfg_tree_new_multiplexer(self);
                 log_pipe_append(sub_pipe_tail, &mpx->super);
               }
             else
@@ -565,8 +580,7 @@ cfg_tree_compile_reference(CfgTree *self, LogExprNode *node,
            our next chain
         */
 
-        mpx = log_multiplexer_new(0, self->cfg);
-        g_ptr_array_add(self->initialized_pipes, &mpx->super);
+        mpx = cfg_tree_new_multiplexer(self);
 
         if (sub_pipe_head)
           {
@@ -831,8 +845,7 @@ cfg_tree_compile_junction(CfgTree *self,
             }
           if (!fork_mpx)
             {
-              fork_mpx = log_multiplexer_new(0, self->cfg);
-              g_ptr_array_add(self->initialized_pipes, &fork_mpx->super);
+              fork_mpx = cfg_tree_new_multiplexer(self);
             }
           log_multiplexer_add_next_hop(fork_mpx, sub_pipe_head);
         }
@@ -1011,6 +1024,41 @@ cfg_tree_lookup_template(CfgTree *self, const gchar *name)
   return NULL;
 }
 
+/*
+ * Returns the prefilter shared by the matchers looking at @value_handle,
+ * matchers register in it while the configuration is parsed, and it is
+ * compiled along with the rest of the configuration.
+ */
+LogMatcherPrefilter *
+cfg_tree_get_matcher_prefilter(CfgTree *self, NVHandle value_handle)
+{
+  LogMatcherPrefilter *prefilter;
+
+  prefilter = g_hash_table_lookup(self->matcher_prefilters, GUINT_TO_POINTER(value_handle));
+  if (!prefilter)
+    {
+      prefilter = log_matcher_prefilter_new();
+      g_hash_table_insert(self->matcher_prefilters, GUINT_TO_POINTER(value_handle), prefilter);
+    }
+  return prefilter;
+}
+
+static void
+cfg_tree_compile_matcher_prefilter(gpointer key, gpointer value, gpointer user_data)
+{
+  LogMatcherPrefilter *prefilter = (LogMatcherPrefilter *) value;
+
+  /* with only a few matchers, scanning the value costs more than it saves */
+  if (log_matcher_prefilter_get_literal_count(prefilter) >= CFG_TREE_PREFILTER_MIN_LITERALS)
+    {
+      log_matcher_prefilter_compile(prefilter);
+      msg_debug("Prefiltering regexp matches using the literals of the patterns",
+                evt_tag_str("value", log_msg_get_value_name(GPOINTER_TO_UINT(key), NULL)),
+                evt_tag_int("patterns", log_matcher_prefilter_get_literal_count(prefilter)),
+                NULL);
+    }
+}
+
 LogTemplate *
 cfg_tree_check_inline_template(CfgTree *self, const gchar *template_or_name, GError **error)
 {
@@ -1029,6 +1077,114 @@ cfg_tree_check_inline_template(CfgTree *self, const gchar *template_or_name, GEr
   return template;
 }
 
+/*
+ * Returns the filter expression of a branch, if the branch starts with a
+ * filter rule.  The do-nothing pipes at the attachment points are skipped.
+ */
+static FilterExprNode *
+cfg_tree_get_branch_filter(LogPipe *branch_head)
+{
+  LogPipe *p;
+
+  for (p = branch_head; p && !p->queue; p = p->pipe_next)
+    ;
+
+  if (!p || !p->expr_node || p->expr_node->layout != ENL_SINGLE ||
+      !p->expr_node->parent || p->expr_node->parent->content != ENC_FILTER)
+    return NULL;
+
+  return ((LogFilterPipe *) p)->expr;
+}
+
+/*
+ * cfg_tree_compile_dispatch:
+ *
+ * Large configurations often have a lot of log paths that only differ in
+ * a filter like host("^web01$") or program("^sshd$") at their beginning.
+ * Evaluating them one-by-one costs a filter evaluation per log path for
+ * every message, so if enough siblings filter on the equality of the same
+ * value, the multiplexer is told to look up the matching branches in a
+ * hash table instead.  The filters are still evaluated on the matching
+ * branches and the order of the branches does not change, thus
+ * flags(final) and flags(fallback) keep working the same way.
+ */
+static void
+cfg_tree_compile_dispatch(CfgTree *self, LogMultiplexer *mpx)
+{
+  GPtrArray *next_hop_values;
+  GArray *next_hop_handles;
+  NVHandle best_handle = 0;
+  gint best_count = 0;
+  gint i, j;
+
+  if (mpx->next_hops->len < CFG_TREE_DISPATCH_MIN_BRANCHES)
+    return;
+
+  next_hop_values = g_ptr_array_sized_new(mpx->next_hops->len);
+  next_hop_handles = g_array_sized_new(FALSE, TRUE, sizeof(NVHandle), mpx->next_hops->len);
+  for (i = 0; i < mpx->next_hops->len; i++)
+    {
+      FilterExprNode *expr = cfg_tree_get_branch_filter(g_ptr_array_index(mpx->next_hops, i));
+      GPtrArray *values = g_ptr_array_new();
+      NVHandle handle = 0;
+
+      if (!expr || !filter_expr_get_match_values(expr, &handle, values))
+        {
+          g_ptr_array_free(values, TRUE);
+          values = NULL;
+          handle = 0;
+        }
+      g_ptr_array_add(next_hop_values, values);
+      g_array_append_val(next_hop_handles, handle);
+    }
+
+  /* index by the value most of the branches filter on */
+  for (i = 0; i < next_hop_handles->len; i++)
+    {
+      NVHandle handle = g_array_index(next_hop_handles, NVHandle, i);
+      gint count = 0;
+
+      if (!handle || handle == best_handle)
+        continue;
+      for (j = i; j < next_hop_handles->len; j++)
+        {
+          if (g_array_index(next_hop_handles, NVHandle, j) == handle)
+            count++;
+        }
+      if (count > best_count)
+        {
+          best_handle = handle;
+          best_count = count;
+        }
+    }
+
+  if (best_count >= CFG_TREE_DISPATCH_MIN_BRANCHES)
+    {
+      for (i = 0; i < next_hop_values->len; i++)
+        {
+          if (g_array_index(next_hop_handles, NVHandle, i) != best_handle && g_ptr_array_index(next_hop_values, i))
+            {
+              g_ptr_array_free(g_ptr_array_index(next_hop_values, i), TRUE);
+              g_ptr_array_index(next_hop_values, i) = NULL;
+            }
+        }
+      log_multiplexer_set_dispatch(mpx, best_handle, next_hop_values);
+      msg_debug("Routing messages to log paths by hash lookup",
+                evt_tag_str("value", log_msg_get_value_name(best_handle, NULL)),
+                evt_tag_int("indexed_paths", best_count),
+                evt_tag_int("paths", mpx->next_hops->len),
+                NULL);
+    }
+
+  for (i = 0; i < next_hop_values->len; i++)
+    {
+      if (g_ptr_array_index(next_hop_values, i))
+        g_ptr_array_free(g_ptr_array_index(next_hop_values, i), TRUE);
+    }
+  g_ptr_array_free(next_hop_values, TRUE);
+  g_array_free(next_hop_handles, TRUE);
+}
+
 gboolean
 cfg_tree_compile(CfgTree *self)
 {
@@ -1053,6 +1209,10 @@ cfg_tree_compile(CfgTree *self)
           return FALSE;
         }
     }
+
+  for (i = 0; i < self->multiplexers->len; i++)
+    cfg_tree_compile_dispatch(self, g_ptr_array_index(self->multiplexers, i));
+  g_hash_table_foreach(self->matcher_prefilters, cfg_tree_compile_matcher_prefilter, NULL);
   return TRUE;
 }
 
@@ -1103,8 +1263,10 @@ void
 cfg_tree_init_instance(CfgTree *self, GlobalConfig *cfg)
 {
   self->initialized_pipes = g_ptr_array_new();
+  self->multiplexers = g_ptr_array_new();
   self->objects = g_hash_table_new_full(cfg_tree_objects_hash, cfg_tree_objects_equal, NULL, (GDestroyNotify) log_expr_node_free);
   self->templates = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) log_template_unref);
+  self->matcher_prefilters = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) log_matcher_prefilter_unref);
   self->rules = g_ptr_array_new();
   self->cfg = cfg;
 }
@@ -1114,11 +1276,13 @@ cfg_tree_free_instance(CfgTree *self)
 {
   g_ptr_array_foreach(self->initialized_pipes, (GFunc) log_pipe_unref, NULL);
   g_ptr_array_free(self->initialized_pipes, TRUE);
+  g_ptr_array_free(self->multiplexers, TRUE);
 
   g_ptr_array_foreach(self->rules, (GFunc) log_expr_node_free, NULL);
   g_ptr_array_free(self->rules, TRUE);
 
   g_hash_table_destroy(self->objects);
   g_hash_table_destroy(self->templates);
+  g_hash_table_destroy(self->matcher_prefilters);
   self->cfg = NULL;
 }
@@ -27,6 +27,7 @@
 
 #include "syslog-ng.h"
 #include "template/templates.h"
+#include "logmatcher-prefilter.h"
 #include "cfg-lexer.h"
 
 const gchar *log_expr_node_get_content_name(gint content);
@@ -149,12 +150,16 @@ typedef struct _CfgTree
 {
   GlobalConfig *cfg;
   GPtrArray *initialized_pipes;
+  /* LogMultiplexer instances among initialized_pipes, these hold no references */
+  GPtrArray *multiplexers;
   gint anon_counters[ENC_MAX];
   /* hash of predefined source/filter/rewrite/parser/destination objects */
   GHashTable *objects;
   /* list of top-level rules */
   GPtrArray *rules;
   GHashTable *templates;
+  /* value handle -> LogMatcherPrefilter shared by the matchers of the value */
+  GHashTable *matcher_prefilters;
 } CfgTree;
 
 gboolean cfg_tree_add_object(CfgTree *self, LogExprNode *rule);
@@ -162,6 +167,8 @@ LogExprNode *cfg_tree_get_object(CfgTree *self, gint type, const gchar *name);
 
 gboolean cfg_tree_add_template(CfgTree *self, LogTemplate *template);
 LogTemplate *cfg_tree_lookup_template(CfgTree *self, const gchar *name);
+LogMatcherPrefilter *cfg_tree_get_matcher_prefilter(CfgTree *self, NVHandle value_handle);
+
 LogTemplate *cfg_tree_check_inline_template(CfgTree *self, const gchar *template_or_name, GError **error);
 
 gchar *cfg_tree_get_rule_name(CfgTree *self, gint content, LogExprNode *node);
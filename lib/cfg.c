@@ -37,6 +37,7 @@
 #include "reloc.h"
 #include "hostname.h"
 #include "rcptid.h"
+#include "logmatcher-pcre.h"
 
 #include <sys/types.h>
 #include <signal.h>
@@ -160,6 +161,13 @@ cfg_bad_hostname_set(GlobalConfig *self, gchar *bad_hostname_re)
   self->bad_hostname_re = g_strdup(bad_hostname_re);  
 }
 
+/* expressions compiled before options{} get it from their init function */
+void
+cfg_pcre_jit_set(GlobalConfig *self, gboolean pcre_jit)
+{
+  self->pcre_jit = pcre_jit;
+}
+
 gint
 cfg_lookup_mark_mode(gchar *mark_mode)
 {
@@ -223,6 +231,7 @@ cfg_init(GlobalConfig *cfg)
   log_tags_reinit_stats(cfg);
 
   dns_cache_set_params(cfg->dns_cache_size, cfg->dns_cache_expire, cfg->dns_cache_expire_failed, cfg->dns_cache_hosts);
+  log_matcher_pcre_set_jit(cfg->pcre_jit);
   hostname_reinit(cfg->custom_domain);
   host_resolve_options_init(&cfg->host_resolve_options, cfg);
   log_proto_register_builtin_plugins(cfg);
@@ -323,6 +332,7 @@ cfg_new(gint version)
   self->dns_cache_expire = 3600;
   self->dns_cache_expire_failed = 60;
   self->threaded = FALSE;
+  self->pcre_jit = TRUE;
   
   log_template_options_defaults(&self->template_options);
   self->template_options.ts_format = TS_FMT_BSD;
@@ -334,6 +344,7 @@ cfg_new(gint version)
   self->host_resolve_options.use_dns = TRUE;
   self->host_resolve_options.use_dns_cache = TRUE;
   self->host_resolve_options.normalize_hostnames = FALSE;
+  self->host_resolve_options.dns_wait = 0;
 
   self->recv_time_zone = NULL;
   self->keep_timestamp = TRUE;
@@ -360,6 +371,7 @@ cfg_run_parser(GlobalConfig *self, CfgLexer *lexer, CfgParser *parser, gpointer
   cfg_args_set(self->lexer->globals, "module-path", module_path);
   cfg_args_set(self->lexer->globals, "include-path", get_installation_path_for(PATH_SYSCONFDIR));
   cfg_args_set(self->lexer->globals, "autoload-compiled-modules", "1");
+  log_matcher_pcre_set_jit(self->pcre_jit);
 
   res = cfg_parser_parse(parser, lexer, result, arg);
 
@@ -101,6 +101,7 @@ struct _GlobalConfig
   gint dir_perm;
 
   gboolean use_rcptid;
+  gboolean pcre_jit;
 
   gboolean keep_timestamp;  
 
@@ -127,6 +128,7 @@ void cfg_file_owner_set(GlobalConfig *self, gchar *owner);
 void cfg_file_group_set(GlobalConfig *self, gchar *group);
 void cfg_file_perm_set(GlobalConfig *self, gint perm);
 void cfg_bad_hostname_set(GlobalConfig *self, gchar *bad_hostname_re);
+void cfg_pcre_jit_set(GlobalConfig *self, gboolean pcre_jit);
 gint cfg_lookup_mark_mode(gchar *mark_mode);
 void cfg_set_mark_mode(GlobalConfig *self, gchar *mark_mode);
 
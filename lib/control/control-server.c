@@ -35,11 +35,23 @@ control_connection_free(ControlConnection *self)
     {
       self->free_fn(self);
     }
+  if (self->reply_stream)
+    self->reply_stream->free_fn(self->reply_stream);
   g_string_free(self->output_buffer, TRUE);
   g_string_free(self->input_buffer, TRUE);
   g_free(self);
 }
 
+static void
+control_connection_terminate_reply(ControlConnection *self)
+{
+  if (self->output_buffer->len == 0 || self->output_buffer->str[self->output_buffer->len - 1] != '\n')
+    {
+      g_string_append_c(self->output_buffer, '\n');
+    }
+  g_string_append(self->output_buffer, ".\n");
+}
+
 static void
 control_connection_send_reply(ControlConnection *self, GString *reply)
 {
@@ -48,12 +60,35 @@ control_connection_send_reply(ControlConnection *self, GString *reply)
 
   self->pos = 0;
 
-  if (self->output_buffer->str[self->output_buffer->len - 1] != '\n')
+  control_connection_terminate_reply(self);
+  control_connection_update_watches(self);
+}
+
+/* refills the output buffer from the reply stream once it was sent */
+static void
+control_connection_fill_reply_from_stream(ControlConnection *self)
+{
+  gboolean more;
+
+  g_string_truncate(self->output_buffer, 0);
+  self->pos = 0;
+  do
+    more = self->reply_stream->next(self->reply_stream, self->output_buffer);
+  while (more && self->output_buffer->len == 0);
+
+  if (!more)
     {
-      g_string_append_c(self->output_buffer, '\n');
+      self->reply_stream->free_fn(self->reply_stream);
+      self->reply_stream = NULL;
+      control_connection_terminate_reply(self);
     }
-  g_string_append(self->output_buffer, ".\n");
+}
 
+static void
+control_connection_send_reply_stream(ControlConnection *self, ControlReplyStream *stream)
+{
+  self->reply_stream = stream;
+  control_connection_fill_reply_from_stream(self);
   control_connection_update_watches(self);
 }
 
@@ -79,6 +114,8 @@ control_connection_io_output(gpointer s)
   else
     {
       self->pos += rc;
+      if (self->pos >= self->output_buffer->len && self->reply_stream)
+        control_connection_fill_reply_from_stream(self);
     }
   control_connection_update_watches(self);
 }
@@ -151,16 +188,23 @@ control_connection_io_input(void *s)
       control_connection_update_watches(self);
       return;
     }
-  for (cmd = 0; self->server->commands[cmd].func; cmd++)
+  for (cmd = 0; self->server->commands[cmd].command; cmd++)
     {
       if (strncmp(self->server->commands[cmd].command, command->str, strlen(self->server->commands[cmd].command)) == 0)
         {
-          reply = self->server->commands[cmd].func(command);
-          control_connection_send_reply(self, reply);
+          if (self->server->commands[cmd].stream_func)
+            {
+              control_connection_send_reply_stream(self, self->server->commands[cmd].stream_func(command));
+            }
+          else
+            {
+              reply = self->server->commands[cmd].func(command);
+              control_connection_send_reply(self, reply);
+            }
           break;
         }
     }
-  if (!self->server->commands[cmd].func)
+  if (!self->server->commands[cmd].command)
     {
       msg_error("Unknown command read on control channel, closing control channel",
                 evt_tag_str("command", command->str), NULL);
@@ -28,11 +28,23 @@
 
 #define MAX_CONTROL_LINE_LENGTH 4096
 
+/* a reply that is produced in parts, as the peer consumes it */
+typedef struct _ControlReplyStream ControlReplyStream;
+struct _ControlReplyStream
+{
+  /* appends the next part of the reply to @output, returns FALSE if
+   * there is nothing more to send */
+  gboolean (*next)(ControlReplyStream *self, GString *output);
+  void (*free_fn)(ControlReplyStream *self);
+};
+
 typedef struct _Commands
 {
   const gchar *command;
   const gchar *description;
   GString *(*func)(GString *command);
+  /* used instead of func for commands with large replies */
+  ControlReplyStream *(*stream_func)(GString *command);
 } Commands;
 
 typedef struct _ControlServer ControlServer;
@@ -43,6 +55,7 @@ struct _ControlConnection
   GString *input_buffer;
   GString *output_buffer;
   gsize pos;
+  ControlReplyStream *reply_stream;
   ControlServer *server;
   int (*read)(ControlConnection *self, gpointer buffer, gsize size);
   int (*write)(ControlConnection *self, gpointer buffer, gsize size);
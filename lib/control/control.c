@@ -27,6 +27,7 @@
 #include "gsocket.h"
 #include "messages.h"
 #include "stats/stats-csv.h"
+#include "stats/stats-openmetrics.h"
 #include "misc.h"
 #include "mainloop.h"
 
@@ -46,6 +47,43 @@ control_connection_send_stats(GString *command)
   return result;
 }
 
+/* the size of the parts the metrics are formatted in */
+#define CONTROL_METRICS_CHUNK_SIZE 16384
+
+typedef struct _ControlMetricsStream
+{
+  ControlReplyStream super;
+  StatsOpenMetricsExport *export;
+} ControlMetricsStream;
+
+static gboolean
+control_metrics_stream_next(ControlReplyStream *s, GString *output)
+{
+  ControlMetricsStream *self = (ControlMetricsStream *) s;
+
+  return stats_openmetrics_export_format_next(self->export, output, CONTROL_METRICS_CHUNK_SIZE);
+}
+
+static void
+control_metrics_stream_free(ControlReplyStream *s)
+{
+  ControlMetricsStream *self = (ControlMetricsStream *) s;
+
+  stats_openmetrics_export_free(self->export);
+  g_free(self);
+}
+
+static ControlReplyStream *
+control_connection_send_metrics(GString *command)
+{
+  ControlMetricsStream *self = g_new0(ControlMetricsStream, 1);
+
+  self->super.next = control_metrics_stream_next;
+  self->super.free_fn = control_metrics_stream_free;
+  self->export = stats_openmetrics_export_new();
+  return &self->super;
+}
+
 static GString *
 control_connection_message_log(GString *command)
 {
@@ -110,6 +148,7 @@ control_connection_reload(GString *command)
 
 Commands commands[] = {
   { "STATS", NULL, control_connection_send_stats },
+  { "METRICS", NULL, NULL, control_connection_send_metrics },
   { "LOG", NULL, control_connection_message_log },
   { "STOP", NULL, control_connection_stop_process },
   { "RELOAD", NULL, control_connection_reload },
@@ -86,12 +86,52 @@ test_stats()
   return;
 }
 
+void
+test_metrics()
+{
+  GString *command = g_string_new("METRICS");
+  GString *reply = g_string_sized_new(128);
+  ControlReplyStream *stream;
+  StatsCounterItem *counter = NULL;
+  gint parts = 0;
+
+  stats_lock();
+  stats_register_counter(0, SCS_CENTER, "id", "metrics", SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+  stats_counter_add(counter, 42);
+
+  stream = control_connection_send_metrics(command);
+  while (stream->next(stream, reply))
+    parts++;
+  stream->free_fn(stream);
+
+  assert_true(strstr(reply->str, "# TYPE syslogng_processed counter\n") != NULL, "Missing metric family: %s", reply->str);
+  assert_true(strstr(reply->str, "syslogng_processed_total{component=\"center\",id=\"id\",instance=\"metrics\"} 42\n") != NULL,
+              "Missing counter sample: %s", reply->str);
+  assert_true(g_str_has_suffix(reply->str, "# EOF\n"), "Missing EOF marker: %s", reply->str);
+
+  /* a finished stream doesn't produce more output */
+  g_string_truncate(reply, 0);
+  stream = control_connection_send_metrics(command);
+  while (stream->next(stream, reply))
+    ;
+  assert_false(stream->next(stream, reply), "Finished metrics stream produced more output");
+  stream->free_fn(stream);
+
+  stats_lock();
+  stats_unregister_counter(SCS_CENTER, "id", "metrics", SC_TYPE_PROCESSED, &counter);
+  stats_unlock();
+  g_string_free(reply, TRUE);
+  g_string_free(command, TRUE);
+}
+
 int
 main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
 {
   app_startup();
   test_log();
   test_stats();
+  test_metrics();
   app_shutdown();
   return 0;
 }
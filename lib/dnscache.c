@@ -22,10 +22,12 @@
  *
  */
 
+
 #include "dnscache.h"
 #include "messages.h"
 #include "timeutils.h"
 #include "tls-support.h"
+#include "serialize.h"
 
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -37,8 +39,20 @@
 #include <string.h>
 #include <time.h>
 
+/*
+ * The cache is shared by all threads.  It is split into shards by
+ * address, each with its own lock, hash table and expiration list, so
+ * that threads looking up different addresses don't contend.
+ */
+#define DNS_CACHE_SHARD_BITS 4
+#define DNS_CACHE_SHARDS     (1 << DNS_CACHE_SHARD_BITS)
+
+#define DNS_CACHE_PERSIST_NAME    "dns_cache"
+#define DNS_CACHE_PERSIST_VERSION 0
+
 typedef struct _DNSCacheEntry DNSCacheEntry;
 typedef struct _DNSCacheKey DNSCacheKey;
+typedef struct _DNSCacheShard DNSCacheShard;
 
 struct _DNSCacheKey
 {
@@ -63,32 +77,39 @@ struct _DNSCacheEntry
   gboolean positive;
 };
 
-
-TLS_BLOCK_START
+struct _DNSCacheShard
 {
+  GStaticMutex lock;
   GHashTable *cache;
   DNSCacheEntry cache_first;
   DNSCacheEntry cache_last;
   DNSCacheEntry persist_first;
   DNSCacheEntry persist_last;
-  time_t cache_hosts_mtime;
-  time_t cache_hosts_checktime;
+  gint persistent_count;
+};
+
+TLS_BLOCK_START
+{
+  /* the hostname returned by the last lookup, entries may be freed by
+   * other threads as soon as the shard is unlocked */
+  gchar lookup_result[256];
 }
 TLS_BLOCK_END;
 
-#define cache  __tls_deref(cache)
-#define cache_first __tls_deref(cache_first)
-#define cache_last __tls_deref(cache_last)
-#define persist_first __tls_deref(persist_first)
-#define persist_last __tls_deref(persist_last)
-#define cache_hosts_mtime __tls_deref(cache_hosts_mtime)
-#define cache_hosts_checktime __tls_deref(cache_hosts_checktime)
+#define lookup_result  __tls_deref(lookup_result)
+
+static DNSCacheShard dns_cache_shards[DNS_CACHE_SHARDS];
+
+/* protects reloading the hosts file */
+static GStaticMutex dns_cache_hosts_lock = G_STATIC_MUTEX_INIT;
+static time_t cache_hosts_mtime;
+static time_t cache_hosts_checktime;
 
 static gint dns_cache_size = 1007;
 static gint dns_cache_expire = 3600;
 static gint dns_cache_expire_failed = 60;
-static gint dns_cache_persistent_count = 0;
 static gchar *dns_cache_hosts = NULL;
+static gboolean dns_cache_restored;
 
 static gboolean 
 dns_cache_key_equal(DNSCacheKey *e1, DNSCacheKey *e2)
@@ -126,6 +147,13 @@ dns_cache_key_hash(DNSCacheKey *e)
     }
 }
 
+static inline DNSCacheShard *
+dns_cache_get_shard(DNSCacheKey *key)
+{
+  /* multiplicative hashing, so that the shard depends on all bits of the address */
+  return &dns_cache_shards[(dns_cache_key_hash(key) * 2654435761U) >> (32 - DNS_CACHE_SHARD_BITS)];
+}
+
 static inline void
 dns_cache_entry_insert_before(DNSCacheEntry *elem, DNSCacheEntry *new_elem)
 {
@@ -145,6 +173,15 @@ dns_cache_entry_free(DNSCacheEntry *e)
   g_free(e);
 }
 
+static gboolean
+dns_cache_entry_is_expired(DNSCacheEntry *entry, time_t now)
+{
+  /* persistent entries never expire */
+  return entry->resolved &&
+         ((entry->positive && entry->resolved < now - dns_cache_expire) ||
+          (!entry->positive && entry->resolved < now - dns_cache_expire_failed));
+}
+
 static inline void
 dns_cache_fill_key(DNSCacheKey *key, gint family, void *addr)
 {
@@ -168,23 +205,27 @@ dns_cache_fill_key(DNSCacheKey *key, gint family, void *addr)
 static void
 dns_cache_cleanup_persistent_hosts(void)
 {
-  while (persist_first.next != &persist_last)
+  gint i;
+
+  for (i = 0; i < DNS_CACHE_SHARDS; i++)
     {
-      g_hash_table_remove(cache, &persist_first.next->key);
-      dns_cache_persistent_count--;
+      DNSCacheShard *shard = &dns_cache_shards[i];
+
+      g_static_mutex_lock(&shard->lock);
+      while (shard->persist_first.next != &shard->persist_last)
+        {
+          g_hash_table_remove(shard->cache, &shard->persist_first.next->key);
+          shard->persistent_count--;
+        }
+      g_static_mutex_unlock(&shard->lock);
     }
 }
 
 static void
-dns_cache_check_hosts(glong t)
+dns_cache_load_hosts(void)
 {
   struct stat st;
 
-  if (G_LIKELY(cache_hosts_checktime == t))
-    return;
-
-  cache_hosts_checktime = t;
-  
   if (!dns_cache_hosts || stat(dns_cache_hosts, &st) < 0)
     {
       dns_cache_cleanup_persistent_hosts();
@@ -253,8 +294,25 @@ dns_cache_check_hosts(glong t)
     }
 }
 
+static void
+dns_cache_check_hosts(time_t t)
+{
+  /* racy read, a thread that misses an update checks again under the lock */
+  if (G_LIKELY(cache_hosts_checktime == t))
+    return;
+
+  g_static_mutex_lock(&dns_cache_hosts_lock);
+  if (cache_hosts_checktime != t)
+    {
+      dns_cache_load_hosts();
+      cache_hosts_checktime = t;
+    }
+  g_static_mutex_unlock(&dns_cache_hosts_lock);
+}
+
 /*
- * @hostname        is set to the stored hostname,
+ * @hostname        is set to the stored hostname, it remains valid until
+ *                  the next lookup in the same thread
  * @positive        is set whether the match was a DNS match or failure
  *
  * Returns TRUE if the cache was able to serve the request (e.g. had a
@@ -265,38 +323,41 @@ dns_cache_lookup(gint family, void *addr, const gchar **hostname, gsize *hostnam
 {
   DNSCacheKey key;
   DNSCacheEntry *entry;
+  DNSCacheShard *shard;
   time_t now;
+  gboolean result = FALSE;
   
   now = cached_g_current_time_sec();
   dns_cache_check_hosts(now);
   
   dns_cache_fill_key(&key, family, addr);
-  entry = g_hash_table_lookup(cache, &key);
-  if (entry)
+  shard = dns_cache_get_shard(&key);
+
+  g_static_mutex_lock(&shard->lock);
+  entry = g_hash_table_lookup(shard->cache, &key);
+  if (entry && !dns_cache_entry_is_expired(entry, now))
     {
-      if (entry->resolved && 
-          ((entry->positive && entry->resolved < now - dns_cache_expire) ||
-           (!entry->positive && entry->resolved < now - dns_cache_expire_failed)))
-        {
-          /* the entry is not persistent and is too old */
-        }
-      else
-        {
-          *hostname = entry->hostname;
-          *hostname_len = entry->hostname_len;
-          *positive = entry->positive;
-          return TRUE;
-        }
+      g_strlcpy(lookup_result, entry->hostname, sizeof(lookup_result));
+      *hostname = lookup_result;
+      *hostname_len = MIN(entry->hostname_len, sizeof(lookup_result) - 1);
+      *positive = entry->positive;
+      result = TRUE;
     }
-  *hostname = NULL;
-  *positive = FALSE;
-  return FALSE;
+  g_static_mutex_unlock(&shard->lock);
+
+  if (!result)
+    {
+      *hostname = NULL;
+      *positive = FALSE;
+    }
+  return result;
 }
 
 static void
-dns_cache_store(gboolean persistent, gint family, void *addr, const gchar *hostname, gboolean positive)
+dns_cache_store(gboolean persistent, gint family, void *addr, const gchar *hostname, gboolean positive, time_t resolved)
 {
   DNSCacheEntry *entry;
+  DNSCacheShard *shard;
   guint hash_size;
   
   entry = g_new(DNSCacheEntry, 1);
@@ -305,45 +366,189 @@ dns_cache_store(gboolean persistent, gint family, void *addr, const gchar *hostn
   entry->hostname = g_strdup(hostname);
   entry->hostname_len = strlen(hostname);
   entry->positive = positive;
+  entry->resolved = resolved;
+
+  shard = dns_cache_get_shard(&entry->key);
+  g_static_mutex_lock(&shard->lock);
   if (!persistent)
-    {
-      entry->resolved = cached_g_current_time_sec();
-      dns_cache_entry_insert_before(&cache_last, entry);
-    }
+    dns_cache_entry_insert_before(&shard->cache_last, entry);
   else
-    {
-      entry->resolved = 0;
-      dns_cache_entry_insert_before(&persist_last, entry);
-    }
-  hash_size = g_hash_table_size(cache);
-  g_hash_table_replace(cache, &entry->key, entry);
+    dns_cache_entry_insert_before(&shard->persist_last, entry);
+  hash_size = g_hash_table_size(shard->cache);
+  g_hash_table_replace(shard->cache, &entry->key, entry);
 
-  if (persistent && hash_size != g_hash_table_size(cache))
-    dns_cache_persistent_count++;
+  if (persistent && hash_size != g_hash_table_size(shard->cache))
+    shard->persistent_count++;
   
-  /* persistent elements are not counted */
-  if ((gint) (g_hash_table_size(cache) - dns_cache_persistent_count) > dns_cache_size)
+  /* persistent elements are not counted, the size limit is split evenly between the shards */
+  if ((gint) (g_hash_table_size(shard->cache) - shard->persistent_count) > (dns_cache_size + DNS_CACHE_SHARDS - 1) / DNS_CACHE_SHARDS)
     {
       /* remove oldest element */
-      g_hash_table_remove(cache, &cache_first.next->key);
+      g_hash_table_remove(shard->cache, &shard->cache_first.next->key);
     }
+  g_static_mutex_unlock(&shard->lock);
 }
 
 void
 dns_cache_store_persistent(gint family, void *addr, const gchar *hostname)
 {
-  dns_cache_store(TRUE, family, addr, hostname, TRUE);
+  dns_cache_store(TRUE, family, addr, hostname, TRUE, 0);
 }
 
 void
 dns_cache_store_dynamic(gint family, void *addr, const gchar *hostname, gboolean positive)
 {
-  dns_cache_store(FALSE, family, addr, hostname, positive);
+  dns_cache_store(FALSE, family, addr, hostname, positive, cached_g_current_time_sec());
+}
+
+/****************************************************************************
+ * Persisting the cache across restarts
+ ****************************************************************************/
+
+static gsize
+dns_cache_family_to_addr_len(gint family)
+{
+#if ENABLE_IPV6
+  if (family == AF_INET6)
+    return sizeof(struct in6_addr);
+#endif
+  return sizeof(struct in_addr);
+}
+
+static void
+dns_cache_save_entries(SerializeArchive *sa, DNSCacheShard *shard, time_t now)
+{
+  DNSCacheEntry *entry;
+  gsize addr_len;
+
+  /* oldest first, so that restoring keeps the order of expiration */
+  for (entry = shard->cache_first.next; entry != &shard->cache_last; entry = entry->next)
+    {
+      if (dns_cache_entry_is_expired(entry, now))
+        continue;
+
+      addr_len = dns_cache_family_to_addr_len(entry->key.family);
+      serialize_write_uint8(sa, addr_len);
+      serialize_write_blob(sa, &entry->key.addr, addr_len);
+      serialize_write_uint64(sa, entry->resolved);
+      serialize_write_uint8(sa, entry->positive);
+      serialize_write_cstring(sa, entry->hostname, entry->hostname_len);
+    }
+}
+
+/*
+ * Stores the dynamic entries of the cache into @state, so that a
+ * restarted syslog-ng doesn't have to resolve every sender again.
+ * Entries loaded from the hosts file are not saved, as that file is read
+ * anyway.
+ */
+void
+dns_cache_save(PersistState *state)
+{
+  SerializeArchive *sa;
+  GString *buf;
+  time_t now;
+  gint i;
+
+  now = cached_g_current_time_sec();
+  buf = g_string_sized_new(4096);
+  sa = serialize_string_archive_new(buf);
+
+  serialize_write_uint8(sa, DNS_CACHE_PERSIST_VERSION);
+  for (i = 0; i < DNS_CACHE_SHARDS; i++)
+    {
+      DNSCacheShard *shard = &dns_cache_shards[i];
+
+      g_static_mutex_lock(&shard->lock);
+      dns_cache_save_entries(sa, shard, now);
+      g_static_mutex_unlock(&shard->lock);
+    }
+  /* an address length of zero terminates the list */
+  serialize_write_uint8(sa, 0);
+  serialize_archive_free(sa);
+
+  persist_state_alloc_string(state, DNS_CACHE_PERSIST_NAME, buf->str, buf->len);
+  g_string_free(buf, TRUE);
+}
+
+static gboolean
+dns_cache_restore_entries(SerializeArchive *sa, time_t now)
+{
+  guint8 addr_len, positive;
+  guint64 resolved;
+  guchar addr[16];
+  gchar *hostname;
+  gsize hostname_len;
+  gint family;
+
+  while (serialize_read_uint8(sa, &addr_len) && addr_len != 0)
+    {
+      if (addr_len == sizeof(struct in_addr))
+        family = AF_INET;
+#if ENABLE_IPV6
+      else if (addr_len == sizeof(struct in6_addr))
+        family = AF_INET6;
+#endif
+      else
+        family = -1;
+
+      if (addr_len > sizeof(addr) ||
+          !serialize_read_blob(sa, addr, addr_len) ||
+          !serialize_read_uint64(sa, &resolved) ||
+          !serialize_read_uint8(sa, &positive) ||
+          !serialize_read_cstring(sa, &hostname, &hostname_len))
+        return FALSE;
+
+      if (family != -1 && resolved)
+        {
+          /* expiration is checked by lookups, which also see the current parameters */
+          dns_cache_store(FALSE, family, addr, hostname, positive, resolved);
+        }
+      g_free(hostname);
+    }
+  return addr_len == 0;
+}
+
+/*
+ * Loads the entries saved by dns_cache_save().  The cache lives as long
+ * as the process, so this is only done once, when syslog-ng starts up.
+ */
+void
+dns_cache_restore(PersistState *state)
+{
+  SerializeArchive *sa;
+  gchar *buf;
+  gsize buf_len;
+  guint8 version = 0;
+
+  if (dns_cache_restored)
+    return;
+  dns_cache_restored = TRUE;
+
+  buf = persist_state_lookup_string(state, DNS_CACHE_PERSIST_NAME, &buf_len, NULL);
+  if (!buf)
+    return;
+
+  sa = serialize_buffer_archive_new(buf, buf_len);
+  if (!serialize_read_uint8(sa, &version) || version > DNS_CACHE_PERSIST_VERSION)
+    {
+      msg_error("Internal error restoring the DNS cache, stored data is too new or corrupt",
+                evt_tag_int("version", version),
+                NULL);
+    }
+  else if (!dns_cache_restore_entries(sa, cached_g_current_time_sec()))
+    {
+      msg_error("Error restoring the DNS cache, persisted data is truncated",
+                NULL);
+    }
+  serialize_archive_free(sa);
+  g_free(buf);
 }
 
 void
 dns_cache_set_params(gint cache_size, gint expire, gint expire_failed, const gchar *hosts)
 {
+  g_static_mutex_lock(&dns_cache_hosts_lock);
   if (dns_cache_hosts)
     g_free(dns_cache_hosts);
 
@@ -351,46 +556,82 @@ dns_cache_set_params(gint cache_size, gint expire, gint expire_failed, const gch
   dns_cache_expire = expire;
   dns_cache_expire_failed = expire_failed;
   dns_cache_hosts = g_strdup(hosts);
-}
-
-void
-dns_cache_thread_init(void)
-{
-  g_assert(cache == NULL);
-  cache = g_hash_table_new_full((GHashFunc) dns_cache_key_hash, (GEqualFunc) dns_cache_key_equal, NULL, (GDestroyNotify) dns_cache_entry_free);
-  cache_first.next = &cache_last;
-  cache_first.prev = NULL;
-  cache_last.prev = &cache_first;
-  cache_last.next = NULL;
+  /* the hosts file is checked again by the next lookup */
   cache_hosts_mtime = -1;
   cache_hosts_checktime = 0;
-
-  persist_first.next = &persist_last;
-  persist_first.prev = NULL;
-  persist_last.prev = &persist_first;
-  persist_last.next = NULL;
+  g_static_mutex_unlock(&dns_cache_hosts_lock);
 }
 
+/*
+ * Drops every entry of the cache, including the ones loaded from the
+ * hosts file, which is read again by the next lookup.  Used by the unit
+ * tests, as the cache lives as long as the process.
+ */
 void
-dns_cache_thread_deinit(void)
+dns_cache_clear(void)
 {
-  g_assert(cache != NULL);
-  g_hash_table_destroy(cache);
-  cache = NULL;
+  gint i;
+
+  for (i = 0; i < DNS_CACHE_SHARDS; i++)
+    {
+      DNSCacheShard *shard = &dns_cache_shards[i];
+
+      g_static_mutex_lock(&shard->lock);
+      g_hash_table_remove_all(shard->cache);
+      shard->persistent_count = 0;
+      g_static_mutex_unlock(&shard->lock);
+    }
+
+  g_static_mutex_lock(&dns_cache_hosts_lock);
+  cache_hosts_mtime = -1;
+  cache_hosts_checktime = 0;
+  g_static_mutex_unlock(&dns_cache_hosts_lock);
 }
 
 void
 dns_cache_global_init(void)
 {
+  gint i;
+
   dns_cache_size = 1007;
   dns_cache_expire = 3600;
   dns_cache_expire_failed = 60;
-  dns_cache_persistent_count = 0;
+  dns_cache_restored = FALSE;
+  cache_hosts_mtime = -1;
+  cache_hosts_checktime = 0;
+
+  for (i = 0; i < DNS_CACHE_SHARDS; i++)
+    {
+      DNSCacheShard *shard = &dns_cache_shards[i];
+
+      g_static_mutex_init(&shard->lock);
+      shard->cache = g_hash_table_new_full((GHashFunc) dns_cache_key_hash, (GEqualFunc) dns_cache_key_equal, NULL, (GDestroyNotify) dns_cache_entry_free);
+      shard->cache_first.next = &shard->cache_last;
+      shard->cache_first.prev = NULL;
+      shard->cache_last.prev = &shard->cache_first;
+      shard->cache_last.next = NULL;
+
+      shard->persist_first.next = &shard->persist_last;
+      shard->persist_first.prev = NULL;
+      shard->persist_last.prev = &shard->persist_first;
+      shard->persist_last.next = NULL;
+      shard->persistent_count = 0;
+    }
 }
 
 void
 dns_cache_global_deinit(void)
 {
+  gint i;
+
+  for (i = 0; i < DNS_CACHE_SHARDS; i++)
+    {
+      DNSCacheShard *shard = &dns_cache_shards[i];
+
+      g_hash_table_destroy(shard->cache);
+      shard->cache = NULL;
+      g_static_mutex_free(&shard->lock);
+    }
   if (dns_cache_hosts)
     g_free(dns_cache_hosts);
   dns_cache_hosts = NULL;
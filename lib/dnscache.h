@@ -27,6 +27,7 @@
 #define DNSCACHE_H_INCLUDED
 
 #include "syslog-ng.h"
+#include "persist-state.h"
 
 gboolean dns_cache_lookup(gint family, void *addr, const gchar **hostname, gsize *hostname_len, gboolean *positive);
 
@@ -34,9 +35,11 @@ void dns_cache_store_persistent(gint family, void *addr, const gchar *hostname);
 void dns_cache_store_dynamic(gint family, void *addr, const gchar *hostname, gboolean positive);
 
 void dns_cache_set_params(gint cache_size, gint expire, gint expire_failed, const gchar *hosts);
+void dns_cache_clear(void);
+
+void dns_cache_save(PersistState *state);
+void dns_cache_restore(PersistState *state);
 
-void dns_cache_thread_init(void);
-void dns_cache_thread_deinit(void);
 void dns_cache_global_init(void);
 void dns_cache_global_deinit(void);
 
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "dnsresolver.h"
+#include "dnscache.h"
+#include "host-resolve.h"
+#include "stats/stats-registry.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <string.h>
+
+/* the number of lookups running in parallel */
+#define DNS_RESOLVER_THREADS 4
+/* the number of results kept for callers without a DNS cache */
+#define DNS_RESOLVER_MAX_KEPT_RESULTS 1024
+
+typedef struct _DNSResolverKey
+{
+  gint family;
+  union
+  {
+    struct in_addr ip;
+#if ENABLE_IPV6
+    struct in6_addr ip6;
+#endif
+  } addr;
+} DNSResolverKey;
+
+typedef struct _DNSResolverRequest
+{
+  /* references are taken by the request table and by waiting threads */
+  gint ref_cnt;
+  DNSResolverKey key;
+  GSockAddr *saddr;
+  gboolean done;
+  gboolean positive;
+  gchar *hostname;
+  /* whether any of the waiters has the DNS cache enabled */
+  gboolean store_result;
+  /* whether a caller gave up waiting for the result */
+  gboolean abandoned;
+  /* the result is kept in the request table until it's collected */
+  gboolean kept;
+  /* waits are bounded relative to the start of the lookup */
+  GTimeVal started;
+} DNSResolverRequest;
+
+/* protects the requests, including their reference counts */
+static GStaticMutex dns_resolver_lock = G_STATIC_MUTEX_INIT;
+static GCond *dns_resolver_done_cond;
+static GThreadPool *dns_resolver_pool;
+/* requests in progress and kept results, indexed by address */
+static GHashTable *dns_resolver_requests;
+static DNSResolverFunc dns_resolver_resolve_func;
+static gint dns_resolver_kept_results;
+
+static StatsCounterItem *dns_resolver_hits;
+static StatsCounterItem *dns_resolver_misses;
+static StatsCounterItem *dns_resolver_unresolved;
+static StatsHistogram *dns_resolver_latency;
+
+static gboolean
+dns_resolver_key_equal(DNSResolverKey *k1, DNSResolverKey *k2)
+{
+  return memcmp(k1, k2, sizeof(*k1)) == 0;
+}
+
+static guint
+dns_resolver_key_hash(DNSResolverKey *key)
+{
+  if (key->family == AF_INET)
+    return ntohl(key->addr.ip.s_addr);
+#if ENABLE_IPV6
+  else
+    {
+      guint32 *a32 = (guint32 *) &key->addr.ip6.s6_addr;
+      return (0x80000000 | (a32[0] ^ a32[1] ^ a32[2] ^ a32[3]));
+    }
+#endif
+  g_assert_not_reached();
+  return 0;
+}
+
+static void
+dns_resolver_fill_key(DNSResolverKey *key, GSockAddr *saddr)
+{
+  /* padding is zeroed too, as keys are compared using memcmp() */
+  memset(key, 0, sizeof(*key));
+  key->family = saddr->sa.sa_family;
+  switch (key->family)
+    {
+    case AF_INET:
+      key->addr.ip = ((struct sockaddr_in *) &saddr->sa)->sin_addr;
+      break;
+#if ENABLE_IPV6
+    case AF_INET6:
+      key->addr.ip6 = ((struct sockaddr_in6 *) &saddr->sa)->sin6_addr;
+      break;
+#endif
+    default:
+      g_assert_not_reached();
+      break;
+    }
+}
+
+static void
+dns_resolver_request_unref(DNSResolverRequest *req)
+{
+  if (--req->ref_cnt == 0)
+    {
+      g_sockaddr_unref(req->saddr);
+      g_free(req->hostname);
+      g_free(req);
+    }
+}
+
+static void
+dns_resolver_work(gpointer data, gpointer user_data)
+{
+  DNSResolverRequest *req = (DNSResolverRequest *) data;
+  gchar hostname[256];
+  gboolean positive;
+  guint64 start;
+
+  start = stats_histogram_now();
+  positive = dns_resolver_resolve_func(req->saddr, hostname, sizeof(hostname));
+  stats_histogram_record(dns_resolver_latency, stats_histogram_now() - start);
+
+  /* negative matches are cached with the IP address as their name */
+  if (!positive)
+    g_sockaddr_format(req->saddr, hostname, sizeof(hostname), GSA_ADDRESS_ONLY);
+
+  g_static_mutex_lock(&dns_resolver_lock);
+  /* stored while the request is still in the table, so that callers
+   * joining now can't miss the result */
+  if (req->store_result)
+    dns_cache_store_dynamic(req->key.family, &req->key.addr, hostname, positive);
+  req->positive = positive;
+  req->hostname = g_strdup(hostname);
+  req->done = TRUE;
+
+  /* later lookups find the result in the DNS cache, if it's enabled,
+   * otherwise it waits in the table for the callers that gave up */
+  if (!req->store_result && req->abandoned && dns_resolver_kept_results < DNS_RESOLVER_MAX_KEPT_RESULTS)
+    {
+      req->kept = TRUE;
+      dns_resolver_kept_results++;
+    }
+  else
+    g_hash_table_remove(dns_resolver_requests, &req->key);
+  g_cond_broadcast(dns_resolver_done_cond);
+  g_static_mutex_unlock(&dns_resolver_lock);
+}
+
+static gboolean
+dns_resolver_wait_for_request(DNSResolverRequest *req, gint wait_msec)
+{
+  GTimeVal deadline;
+
+  if (wait_msec == DNS_RESOLVER_WAIT_FOREVER)
+    {
+      while (!req->done)
+        g_cond_wait(dns_resolver_done_cond, g_static_mutex_get_mutex(&dns_resolver_lock));
+      return TRUE;
+    }
+
+  /* callers joining a slow lookup don't get a wait of their own, so
+   * that a burst of messages from the same address is not delayed
+   * wait_msec each */
+  deadline = req->started;
+  g_time_val_add(&deadline, (glong) wait_msec * 1000);
+
+  while (!req->done)
+    {
+      if (!g_cond_timed_wait(dns_resolver_done_cond, g_static_mutex_get_mutex(&dns_resolver_lock), &deadline))
+        break;
+    }
+  return req->done;
+}
+
+/*
+ * dns_resolver_lookup:
+ * @store_result: whether the result is to be stored into the DNS cache
+ * @wait_msec: the time to wait for the lookup to finish, measured from
+ * its start, 0 not to wait at all, DNS_RESOLVER_WAIT_FOREVER to block
+ * until it's done
+ * @buf: the resolved hostname is stored here in case of a positive match
+ * @positive: set whether the address has a name
+ *
+ * Resolves @saddr to a hostname using the resolver threads, it is called
+ * when the DNS cache has no entry for the address.  If the address is
+ * not being resolved already, a new lookup is started.
+ *
+ * Returns FALSE if the lookup is still in progress after @wait_msec.  In
+ * this case the result is stored into the DNS cache once it's done,
+ * provided @store_result was set by any of the callers of the same
+ * lookup, otherwise it is kept until the next lookup of the address.
+ */
+gboolean
+dns_resolver_lookup(GSockAddr *saddr, gboolean store_result, gint wait_msec, gchar *buf, gsize buf_len, gboolean *positive)
+{
+  DNSResolverKey key;
+  DNSResolverRequest *req;
+  gboolean result = FALSE;
+
+  dns_resolver_fill_key(&key, saddr);
+  stats_counter_inc(dns_resolver_misses);
+
+  g_static_mutex_lock(&dns_resolver_lock);
+  req = g_hash_table_lookup(dns_resolver_requests, &key);
+  if (!req)
+    {
+      req = g_new0(DNSResolverRequest, 1);
+      req->ref_cnt = 1;
+      req->key = key;
+      req->saddr = g_sockaddr_ref(saddr);
+      g_get_current_time(&req->started);
+      g_hash_table_insert(dns_resolver_requests, &req->key, req);
+      g_thread_pool_push(dns_resolver_pool, req, NULL);
+    }
+  req->store_result |= store_result;
+  req->ref_cnt++;
+
+  if (req->done || (wait_msec != 0 && dns_resolver_wait_for_request(req, wait_msec)))
+    {
+      *positive = req->positive;
+      if (*positive)
+        g_strlcpy(buf, req->hostname, buf_len);
+      result = TRUE;
+
+      if (req->kept)
+        {
+          /* collected, the next lookup of the address starts over */
+          if (store_result)
+            dns_cache_store_dynamic(req->key.family, &req->key.addr, req->hostname, req->positive);
+          req->kept = FALSE;
+          dns_resolver_kept_results--;
+          g_hash_table_remove(dns_resolver_requests, &req->key);
+        }
+    }
+  else
+    req->abandoned = TRUE;
+  dns_resolver_request_unref(req);
+  g_static_mutex_unlock(&dns_resolver_lock);
+
+  if (!result)
+    stats_counter_inc(dns_resolver_unresolved);
+  return result;
+}
+
+/* accounts a lookup served by the DNS cache */
+void
+dns_resolver_count_hit(void)
+{
+  stats_counter_inc(dns_resolver_hits);
+}
+
+/* replaces the function doing the DNS lookups, NULL restores the default */
+void
+dns_resolver_set_resolve_func(DNSResolverFunc resolve_func)
+{
+  dns_resolver_resolve_func = resolve_func ? : resolve_sockaddr_to_hostname_using_dns;
+}
+
+void
+dns_resolver_global_init(void)
+{
+  dns_resolver_resolve_func = resolve_sockaddr_to_hostname_using_dns;
+  dns_resolver_requests = g_hash_table_new_full((GHashFunc) dns_resolver_key_hash, (GEqualFunc) dns_resolver_key_equal,
+                                                NULL, (GDestroyNotify) dns_resolver_request_unref);
+  dns_resolver_done_cond = g_cond_new();
+  dns_resolver_pool = g_thread_pool_new(dns_resolver_work, NULL, DNS_RESOLVER_THREADS, FALSE, NULL);
+
+  stats_lock();
+  stats_register_counter(0, SCS_GLOBAL, "dns_cache_hits", NULL, SC_TYPE_PROCESSED, &dns_resolver_hits);
+  stats_register_counter(0, SCS_GLOBAL, "dns_cache_misses", NULL, SC_TYPE_PROCESSED, &dns_resolver_misses);
+  stats_register_counter(0, SCS_GLOBAL, "dns_unresolved", NULL, SC_TYPE_PROCESSED, &dns_resolver_unresolved);
+  stats_register_histogram(0, SCS_GLOBAL, "dns_resolver", NULL, SC_HISTOGRAM_LATENCY, &dns_resolver_latency);
+  stats_unlock();
+}
+
+void
+dns_resolver_global_deinit(void)
+{
+  /* pending requests are dropped, running ones are waited for */
+  g_thread_pool_free(dns_resolver_pool, TRUE, TRUE);
+  dns_resolver_pool = NULL;
+  g_hash_table_destroy(dns_resolver_requests);
+  dns_resolver_requests = NULL;
+  dns_resolver_kept_results = 0;
+  g_cond_free(dns_resolver_done_cond);
+  dns_resolver_done_cond = NULL;
+
+  stats_lock();
+  stats_unregister_counter(SCS_GLOBAL, "dns_cache_hits", NULL, SC_TYPE_PROCESSED, &dns_resolver_hits);
+  stats_unregister_counter(SCS_GLOBAL, "dns_cache_misses", NULL, SC_TYPE_PROCESSED, &dns_resolver_misses);
+  stats_unregister_counter(SCS_GLOBAL, "dns_unresolved", NULL, SC_TYPE_PROCESSED, &dns_resolver_unresolved);
+  stats_unregister_histogram(SCS_GLOBAL, "dns_resolver", NULL, SC_HISTOGRAM_LATENCY, &dns_resolver_latency);
+  stats_unlock();
+}
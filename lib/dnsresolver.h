@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef DNSRESOLVER_H_INCLUDED
+#define DNSRESOLVER_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "gsockaddr.h"
+
+/*
+ * Reverse DNS lookups done by a pool of resolver threads, so that a slow
+ * DNS server doesn't block the I/O worker threads.  Concurrent lookups of
+ * the same address are coalesced into a single request.
+ */
+
+/* wait_msec value of dns_resolver_lookup() to wait until the lookup is done */
+#define DNS_RESOLVER_WAIT_FOREVER -1
+
+/* blocking address to hostname resolution, returns FALSE if @saddr has no name */
+typedef gboolean (*DNSResolverFunc)(GSockAddr *saddr, gchar *buf, gsize buf_len);
+
+gboolean dns_resolver_lookup(GSockAddr *saddr, gboolean store_result, gint wait_msec, gchar *buf, gsize buf_len, gboolean *positive);
+
+void dns_resolver_count_hit(void);
+
+void dns_resolver_set_resolve_func(DNSResolverFunc resolve_func);
+
+void dns_resolver_global_init(void);
+void dns_resolver_global_deinit(void);
+
+#endif
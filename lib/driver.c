@@ -24,6 +24,8 @@
   
 #include "driver.h"
 #include "logqueue-fifo.h"
+#include "logqueue-disk.h"
+#include "logqueue-ring.h"
 #include "afinter.h"
 #include "cfg-tree.h"
 
@@ -194,6 +196,7 @@ log_dest_driver_acquire_queue_method(LogDestDriver *self, gchar *persist_name, g
 {
   GlobalConfig *cfg = log_pipe_get_config(&self->super.super);
   LogQueue *queue = NULL;
+  gint log_fifo_size = self->log_fifo_size < 0 ? cfg->log_fifo_size : self->log_fifo_size;
 
   g_assert(user_data == NULL);
 
@@ -202,7 +205,19 @@ log_dest_driver_acquire_queue_method(LogDestDriver *self, gchar *persist_name, g
 
   if (!queue)
     {
-      queue = log_queue_fifo_new(self->log_fifo_size < 0 ? cfg->log_fifo_size : self->log_fifo_size, persist_name);
+      if (self->disk_buffer && persist_name)
+        queue = log_queue_disk_new(self->disk_buf_size,
+                                   self->mem_buf_length < 0 ? log_fifo_size : self->mem_buf_length,
+                                   persist_name, cfg->state);
+      else if (self->disk_buffer)
+        msg_warning("WARNING: this destination does not support disk-buffer(), using an in-memory queue instead",
+                    evt_tag_str("group", self->super.group),
+                    NULL);
+
+      if (!queue && self->lockless_queue)
+        queue = log_queue_ring_new(log_fifo_size, persist_name);
+      else if (!queue)
+        queue = log_queue_fifo_new(log_fifo_size, persist_name);
       log_queue_set_throttle(queue, self->throttle);
     }
   return queue;
@@ -294,6 +309,10 @@ log_dest_driver_init_instance(LogDestDriver *self, GlobalConfig *cfg)
   self->release_queue = log_dest_driver_release_queue_method;
   self->log_fifo_size = -1;
   self->throttle = 0;
+  self->disk_buffer = FALSE;
+  self->disk_buf_size = 100 * 1024 * 1024;
+  self->mem_buf_length = -1;
+  self->lockless_queue = FALSE;
 }
 
 void
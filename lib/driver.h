@@ -160,6 +160,15 @@ struct _LogDestDriver
 
   gint log_fifo_size;
   gint throttle;
+
+  /* disk-buffer options, see logqueue-disk.c */
+  gboolean disk_buffer;
+  gint64 disk_buf_size;
+  gint mem_buf_length;
+
+  /* use the lock-free LogQueueRing instead of LogQueueFifo */
+  gboolean lockless_queue;
+
   StatsCounterItem *queued_global_messages;
 };
 
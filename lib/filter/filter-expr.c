@@ -75,6 +75,25 @@ filter_expr_eval_root(FilterExprNode *self, LogMessage **msg, const LogPathOptio
   return filter_expr_eval_root_with_context(self, msg, 1, path_options);
 }
 
+/*
+ * Returns TRUE if the filter matches exactly when the value of a single
+ * name-value pair is equal to one of a set of literal strings.  The handle
+ * is returned in @value_handle, the strings are appended to @values, they
+ * are owned by the filter.  The contents of @values is undefined if FALSE
+ * is returned.
+ *
+ * This is used to route messages using a hash lookup instead of
+ * evaluating the filters one-by-one.
+ */
+gboolean
+filter_expr_get_match_values(FilterExprNode *self, NVHandle *value_handle, GPtrArray *values)
+{
+  if (self->comp || !self->get_match_values)
+    return FALSE;
+
+  return self->get_match_values(self, value_handle, values);
+}
+
 FilterExprNode *
 filter_expr_ref(FilterExprNode *self)
 {
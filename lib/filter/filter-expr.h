@@ -39,6 +39,8 @@ struct _FilterExprNode
   const gchar *type;
   void (*init)(FilterExprNode *self, GlobalConfig *cfg);
   gboolean (*eval)(FilterExprNode *self, LogMessage **msg, gint num_msg);
+  /* optional, see filter_expr_get_match_values() */
+  gboolean (*get_match_values)(FilterExprNode *self, NVHandle *value_handle, GPtrArray *values);
   void (*free_fn)(FilterExprNode *self);
 };
 
@@ -52,6 +54,7 @@ filter_expr_init(FilterExprNode *self, GlobalConfig *cfg)
 gboolean filter_expr_eval(FilterExprNode *self, LogMessage *msg);
 gboolean filter_expr_eval_with_context(FilterExprNode *self, LogMessage **msgs, gint num_msg);
 gboolean filter_expr_eval_root(FilterExprNode *self, LogMessage **msg, const LogPathOptions *path_options);
+gboolean filter_expr_get_match_values(FilterExprNode *self, NVHandle *value_handle, GPtrArray *values);
 gboolean filter_expr_eval_root_with_context(FilterExprNode *self, LogMessage **msgs, gint num_msg, const LogPathOptions *path_options);
 void filter_expr_node_init_instance(FilterExprNode *self);
 FilterExprNode *filter_expr_ref(FilterExprNode *self);
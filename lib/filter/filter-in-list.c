@@ -51,6 +51,25 @@ filter_in_list_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg)
   return (g_tree_lookup(self->tree, value) != NULL) ^ s->comp;
 }
 
+static gboolean
+filter_in_list_collect_value(gpointer key, gpointer value, gpointer user_data)
+{
+  GPtrArray *values = (GPtrArray *) user_data;
+
+  g_ptr_array_add(values, key);
+  return FALSE;
+}
+
+static gboolean
+filter_in_list_get_match_values(FilterExprNode *s, NVHandle *value_handle, GPtrArray *values)
+{
+  FilterInList *self = (FilterInList *)s;
+
+  *value_handle = self->value_handle;
+  g_tree_foreach(self->tree, filter_in_list_collect_value, values);
+  return TRUE;
+}
+
 static void
 filter_in_list_free(FilterExprNode *s)
 {
@@ -92,6 +111,7 @@ filter_in_list_new(const gchar *list_file, const gchar *property)
   fclose(stream);
 
   self->super.eval = filter_in_list_eval;
+  self->super.get_match_values = filter_in_list_get_match_values;
   self->super.free_fn = filter_in_list_free;
   return &self->super;
 }
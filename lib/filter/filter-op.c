@@ -66,6 +66,17 @@ fop_or_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg)
   return (filter_expr_eval_with_context(self->left, msgs, num_msg) || filter_expr_eval_with_context(self->right, msgs, num_msg)) ^ s->comp;
 }
 
+static gboolean
+fop_or_get_match_values(FilterExprNode *s, NVHandle *value_handle, GPtrArray *values)
+{
+  FilterOp *self = (FilterOp *) s;
+  NVHandle right_value_handle;
+
+  return filter_expr_get_match_values(self->left, value_handle, values) &&
+         filter_expr_get_match_values(self->right, &right_value_handle, values) &&
+         *value_handle == right_value_handle;
+}
+
 FilterExprNode *
 fop_or_new(FilterExprNode *e1, FilterExprNode *e2)
 {
@@ -73,6 +84,7 @@ fop_or_new(FilterExprNode *e1, FilterExprNode *e2)
 
   fop_init_instance(self);
   self->super.eval = fop_or_eval;
+  self->super.get_match_values = fop_or_get_match_values;
   self->left = e1;
   self->right = e2;
   self->super.type = "OR";
@@ -24,6 +24,8 @@
 
 #include "filter-re.h"
 #include "misc.h"
+#include "cfg.h"
+#include "stats/stats.h"
 
 #include <string.h>
 
@@ -52,11 +54,25 @@ filter_re_eval(FilterExprNode *s, LogMessage **msgs, gint num_msg)
   return filter_re_eval_string(s, msg, self->value_handle, value, len);
 }
 
+static gboolean
+filter_re_get_match_values(FilterExprNode *s, NVHandle *value_handle, GPtrArray *values)
+{
+  FilterRE *self = (FilterRE *) s;
+
+  if (!self->match_value || !self->value_handle)
+    return FALSE;
+
+  *value_handle = self->value_handle;
+  g_ptr_array_add(values, self->match_value);
+  return TRUE;
+}
+
 static void
 filter_re_free(FilterExprNode *s)
 {
   FilterRE *self = (FilterRE *) s;
 
+  g_free(self->match_value);
   log_matcher_unref(self->matcher);
   log_matcher_options_destroy(&self->matcher_options);
 }
@@ -69,6 +85,42 @@ filter_re_init(FilterExprNode *s, GlobalConfig *cfg)
 
   if (self->matcher_options.flags & LMF_STORE_MATCHES)
     self->super.modify = TRUE;
+  if (self->matcher)
+    {
+      log_matcher_set_jit(self->matcher, cfg->pcre_jit);
+      log_matcher_register_stats(self->matcher, STATS_LEVEL3, "filter");
+    }
+}
+
+/*
+ * Returns the value matched by @re if it can only match a single literal
+ * string, e.g. type("string") patterns without flags or regexps like
+ * "^foo$".
+ */
+static gchar *
+filter_re_get_literal_pattern(FilterRE *self, const gchar *re)
+{
+  const gchar *type = self->matcher_options.type;
+  gsize re_len = strlen(re);
+
+  if (self->matcher_options.flags & (LMF_ICASE | LMF_NEWLINE | LMF_STORE_MATCHES | LMF_SUBSTRING | LMF_PREFIX))
+    return NULL;
+
+  if (strcmp(type, "string") == 0)
+    return g_strdup(re);
+
+  if (strcmp(type, "glob") == 0)
+    return strpbrk(re, "*?[") ? NULL : g_strdup(re);
+
+  if (strcmp(type, "pcre") == 0 || strcmp(type, "posix") == 0)
+    {
+      if (re_len < 2 || re[0] != '^' || re[re_len - 1] != '$')
+        return NULL;
+      if (strcspn(re + 1, "\\^$.|?*+()[]{}") != re_len - 2)
+        return NULL;
+      return g_strndup(re + 1, re_len - 2);
+    }
+  return NULL;
 }
 
 gboolean
@@ -76,7 +128,14 @@ filter_re_compile_pattern(FilterRE *self, GlobalConfig *cfg, gchar *re, GError *
 {
   log_matcher_options_init(&self->matcher_options, cfg);
   self->matcher = log_matcher_new(&self->matcher_options);
-  return log_matcher_compile(self->matcher, re, error);
+  g_free(self->match_value);
+  self->match_value = filter_re_get_literal_pattern(self, re);
+  if (!log_matcher_compile(self->matcher, re, error))
+    return FALSE;
+
+  if (self->value_handle)
+    log_matcher_attach_prefilter(self->matcher, cfg_tree_get_matcher_prefilter(&cfg->tree, self->value_handle));
+  return TRUE;
 }
 
 FilterRE *
@@ -88,6 +147,7 @@ filter_re_new(NVHandle value_handle)
   self->value_handle = value_handle;
   self->super.init = filter_re_init;
   self->super.eval = filter_re_eval;
+  self->super.get_match_values = filter_re_get_match_values;
   self->super.free_fn = filter_re_free;
   log_matcher_options_defaults(&self->matcher_options);
   self->matcher_options.flags |= LMF_MATCH_ONLY;
@@ -147,5 +207,6 @@ filter_match_new()
   filter_expr_node_init_instance(&self->super);
   self->super.free_fn = filter_re_free;
   self->super.eval = filter_match_eval;
+  self->super.get_match_values = filter_re_get_match_values;
   return self;
 }
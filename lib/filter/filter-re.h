@@ -34,6 +34,8 @@ typedef struct _FilterRE
   NVHandle value_handle;
   LogMatcherOptions matcher_options;
   LogMatcher *matcher;
+  /* set if the pattern can only match this single literal value */
+  gchar *match_value;
 } FilterRE;
 
 typedef struct _FilterMatch FilterMatch;
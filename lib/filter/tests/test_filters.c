@@ -200,6 +200,47 @@ testcase_with_backref_chk(gchar *msg,
   filter_expr_unref(f);
 }
 
+static void
+testcase_match_values(FilterExprNode *f, NVHandle expected_handle, const gchar *expected_values)
+{
+  GPtrArray *values = g_ptr_array_new();
+  NVHandle handle = 0;
+  gboolean res;
+  static gint testno = 0;
+
+  testno++;
+  res = filter_expr_get_match_values(f, &handle, values);
+  if (!expected_values)
+    {
+      if (res)
+        {
+          fprintf(stderr, "Filter match values test failed, filter is not expected to have match values; num='%d'\n", testno);
+          exit(1);
+        }
+    }
+  else
+    {
+      gchar *joined_values;
+
+      g_ptr_array_add(values, NULL);
+      joined_values = g_strjoinv(",", (gchar **) values->pdata);
+      if (!res || handle != expected_handle || strcmp(joined_values, expected_values) != 0)
+        {
+          fprintf(stderr, "Filter match values test failed; num='%d', expected_values='%s', values='%s'\n", testno, expected_values, res ? joined_values : "");
+          exit(1);
+        }
+      g_free(joined_values);
+    }
+  g_ptr_array_free(values, TRUE);
+  filter_expr_unref(f);
+}
+
+static FilterExprNode *
+create_negated_filter(FilterExprNode *f)
+{
+  f->comp = !f->comp;
+  return f;
+}
 
 #define TEST_ASSERT(cond)                                       \
   if (!(cond))                                                  \
@@ -392,6 +433,23 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   testcase_with_backref_chk("<15>Oct 15 16:17:01 host openvpn[2499]: al fa", create_pcre_regexp_filter(LM_V_MESSAGE, "(a)(l) (fa)", LMF_STORE_MATCHES), 1, "0","al fa");
   testcase_with_backref_chk("<15>Oct 15 16:17:01 host openvpn[2499]: al fa", create_pcre_regexp_filter(LM_V_MESSAGE, "(a)(l) (fa)", LMF_STORE_MATCHES), 1, "233",NULL);
 
+  testcase_match_values(create_pcre_regexp_filter(LM_V_HOST, "^web01$", 0), LM_V_HOST, "web01");
+  testcase_match_values(create_posix_regexp_filter(LM_V_PROGRAM, "^sshd$", 0), LM_V_PROGRAM, "sshd");
+  testcase_match_values(compile_pattern(filter_re_new(LM_V_HOST), "web01", "string", 0), LM_V_HOST, "web01");
+  testcase_match_values(compile_pattern(filter_re_new(LM_V_HOST), "web01", "glob", 0), LM_V_HOST, "web01");
+  testcase_match_values(create_pcre_regexp_filter(LM_V_HOST, "web01", 0), 0, NULL);
+  testcase_match_values(create_pcre_regexp_filter(LM_V_HOST, "^web.1$", 0), 0, NULL);
+  testcase_match_values(create_pcre_regexp_filter(LM_V_HOST, "^web01$", LMF_ICASE), 0, NULL);
+  testcase_match_values(compile_pattern(filter_re_new(LM_V_HOST), "web", "string", LMF_PREFIX), 0, NULL);
+  testcase_match_values(compile_pattern(filter_re_new(LM_V_HOST), "web*", "glob", 0), 0, NULL);
+  testcase_match_values(create_negated_filter(create_pcre_regexp_filter(LM_V_HOST, "^web01$", 0)), 0, NULL);
+  testcase_match_values(fop_or_new(create_pcre_regexp_filter(LM_V_HOST, "^web01$", 0),
+                                   create_pcre_regexp_filter(LM_V_HOST, "^web02$", 0)), LM_V_HOST, "web01,web02");
+  testcase_match_values(fop_or_new(create_pcre_regexp_filter(LM_V_HOST, "^web01$", 0),
+                                   create_pcre_regexp_filter(LM_V_PROGRAM, "^sshd$", 0)), 0, NULL);
+  testcase_match_values(fop_and_new(create_pcre_regexp_filter(LM_V_HOST, "^web01$", 0),
+                                    create_pcre_regexp_filter(LM_V_HOST, "^web02$", 0)), 0, NULL);
+
   app_shutdown();
   return 0;
 }
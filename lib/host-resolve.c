@@ -23,6 +23,7 @@
 #include "host-resolve.h"
 #include "hostname.h"
 #include "dnscache.h"
+#include "dnsresolver.h"
 #include "messages.h"
 #include "cfg.h"
 #include "tls-support.h"
@@ -283,6 +284,17 @@ resolve_address_using_gethostbyaddr(GSockAddr *saddr, gchar *buf, gsize buf_len)
 
 #endif
 
+/* does a blocking DNS lookup, it's called from the resolver threads */
+gboolean
+resolve_sockaddr_to_hostname_using_dns(GSockAddr *saddr, gchar *buf, gsize buf_len)
+{
+#ifdef HAVE_GETNAMEINFO
+  return resolve_address_using_getnameinfo(saddr, buf, buf_len) != NULL;
+#else
+  return resolve_address_using_gethostbyaddr(saddr, buf, buf_len) != NULL;
+#endif
+}
+
 static void *
 sockaddr_to_dnscache_key(GSockAddr *saddr)
 {
@@ -310,28 +322,33 @@ resolve_sockaddr_to_inet_or_inet6_hostname(gsize *result_len, GSockAddr *saddr,
   if (host_resolve_options->use_dns_cache)
     {
       if (dns_cache_lookup(saddr->sa.sa_family, dnscache_key, (const gchar **) &hname, &hname_len, &positive))
-        return hostname_apply_options_fqdn(hname_len, result_len, hname, positive, host_resolve_options);
+        {
+          dns_resolver_count_hit();
+          return hostname_apply_options_fqdn(hname_len, result_len, hname, positive, host_resolve_options);
+        }
     }
 
-  if (!hname && host_resolve_options->use_dns && host_resolve_options->use_dns != 2)
+  if (host_resolve_options->use_dns && host_resolve_options->use_dns != 2)
     {
-#ifdef HAVE_GETNAMEINFO
-      hname = resolve_address_using_getnameinfo(saddr, hostname_buffer, sizeof(hostname_buffer));
-#else
-      hname = resolve_address_using_gethostbyaddr(saddr, hostname_buffer, sizeof(hostname_buffer));
-#endif
-      positive = (hname != NULL);
-    }
+      /* the resolver threads store the result into the cache, if it's
+       * enabled, dns-wait(0) blocks until the lookup is done */
+      gint wait_msec = host_resolve_options->dns_wait ? : DNS_RESOLVER_WAIT_FOREVER;
 
-  if (!hname)
-    {
+      if (dns_resolver_lookup(saddr, host_resolve_options->use_dns_cache, wait_msec, hostname_buffer, sizeof(hostname_buffer), &positive) && positive)
+        return hostname_apply_options_fqdn(-1, result_len, hostname_buffer, TRUE, host_resolve_options);
+
+      /* either the address has no name or the lookup is still running,
+       * in which case the IP address is used until the result gets into
+       * the cache or is collected by the next lookup */
       hname = g_sockaddr_format(saddr, hostname_buffer, sizeof(hostname_buffer), GSA_ADDRESS_ONLY);
-      positive = FALSE;
+      return hostname_apply_options_fqdn(-1, result_len, hname, FALSE, host_resolve_options);
     }
+
+  hname = g_sockaddr_format(saddr, hostname_buffer, sizeof(hostname_buffer), GSA_ADDRESS_ONLY);
   if (host_resolve_options->use_dns_cache)
-    dns_cache_store_dynamic(saddr->sa.sa_family, dnscache_key, hname, positive);
+    dns_cache_store_dynamic(saddr->sa.sa_family, dnscache_key, hname, FALSE);
 
-  return hostname_apply_options_fqdn(-1, result_len, hname, positive, host_resolve_options);
+  return hostname_apply_options_fqdn(-1, result_len, hname, FALSE, host_resolve_options);
 }
 
 const gchar *
@@ -371,6 +388,7 @@ host_resolve_options_defaults(HostResolveOptions *options)
   options->use_fqdn = -1;
   options->use_dns_cache = -1;
   options->normalize_hostnames = -1;
+  options->dns_wait = -1;
 }
 
 void
@@ -384,6 +402,8 @@ host_resolve_options_init(HostResolveOptions *options, GlobalConfig *cfg)
     options->use_dns_cache = cfg->host_resolve_options.use_dns_cache;
   if (options->normalize_hostnames == -1)
     options->normalize_hostnames = cfg->host_resolve_options.normalize_hostnames;
+  if (options->dns_wait == -1)
+    options->dns_wait = cfg->host_resolve_options.dns_wait;
 }
 
 void
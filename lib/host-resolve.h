@@ -32,12 +32,16 @@ typedef struct _HostResolveOptions
   gboolean use_fqdn;
   gboolean use_dns_cache;
   gboolean normalize_hostnames;
+  /* msecs to wait for a DNS lookup before using the IP address, 0 to
+   * wait until it finishes */
+  gint dns_wait;
 } HostResolveOptions;
 
 /* name resolution */
 const gchar *resolve_sockaddr_to_hostname(gsize *result_len, GSockAddr *saddr, const HostResolveOptions *host_resolve_options);
 gboolean resolve_hostname_to_sockaddr(GSockAddr **addr, gint family, const gchar *name);
 const gchar *resolve_hostname_to_hostname(gsize *result_len, const gchar *hostname, HostResolveOptions *options);
+gboolean resolve_sockaddr_to_hostname_using_dns(GSockAddr *saddr, gchar *buf, gsize buf_len);
 
 void host_resolve_options_defaults(HostResolveOptions *options);
 void host_resolve_options_init(HostResolveOptions *options, GlobalConfig *cfg);
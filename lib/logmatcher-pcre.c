@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2002-2010 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2010 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logmatcher-pcre.h"
+#include "tls-support.h"
+
+/* the JIT stack of a thread starts at the minimum and is grown on demand */
+#define LOG_MATCHER_PCRE_JIT_STACK_MIN  (32 * 1024)
+#define LOG_MATCHER_PCRE_JIT_STACK_MAX  (1024 * 1024)
+
+static gboolean pcre_jit_enabled = TRUE;
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+
+TLS_BLOCK_START
+{
+  pcre_jit_stack *jit_stack;
+}
+TLS_BLOCK_END;
+
+#define jit_stack  __tls_deref(jit_stack)
+
+/* called by pcre_exec() in the matching thread */
+static pcre_jit_stack *
+log_matcher_pcre_get_jit_stack(void *user_data)
+{
+  if (G_UNLIKELY(!jit_stack))
+    jit_stack = pcre_jit_stack_alloc(LOG_MATCHER_PCRE_JIT_STACK_MIN, LOG_MATCHER_PCRE_JIT_STACK_MAX);
+  return jit_stack;
+}
+
+#endif
+
+void
+log_matcher_pcre_set_jit(gboolean enable)
+{
+  pcre_jit_enabled = enable;
+}
+
+gboolean
+log_matcher_pcre_is_jit_enabled(void)
+{
+#ifdef PCRE_STUDY_JIT_COMPILE
+  return pcre_jit_enabled;
+#else
+  return FALSE;
+#endif
+}
+
+/*
+ * Same as pcre_study(), the result must be freed using
+ * log_matcher_pcre_free_study().
+ */
+pcre_extra *
+log_matcher_pcre_study(pcre *pattern, gboolean jit, const gchar **errptr)
+{
+  pcre_extra *extra;
+  gint options = 0;
+
+  if (jit)
+    {
+#ifdef PCRE_STUDY_JIT_COMPILE
+      options |= PCRE_STUDY_JIT_COMPILE;
+#endif
+    }
+
+  extra = pcre_study(pattern, options, errptr);
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+  /* a no-op if the expression could not be JIT compiled, pcre_exec()
+   * interprets it then */
+  if (extra && (options & PCRE_STUDY_JIT_COMPILE))
+    pcre_assign_jit_stack(extra, log_matcher_pcre_get_jit_stack, NULL);
+#endif
+  return extra;
+}
+
+void
+log_matcher_pcre_free_study(pcre_extra *extra)
+{
+  if (!extra)
+    return;
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+  pcre_free_study(extra);
+#else
+  pcre_free(extra);
+#endif
+}
+
+void
+log_matcher_pcre_thread_deinit(void)
+{
+#ifdef PCRE_STUDY_JIT_COMPILE
+  if (jit_stack)
+    {
+      pcre_jit_stack_free(jit_stack);
+      jit_stack = NULL;
+    }
+#endif
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2002-2010 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2010 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGMATCHER_PCRE_H_INCLUDED
+#define LOGMATCHER_PCRE_H_INCLUDED
+
+#include "syslog-ng.h"
+
+#include <pcre.h>
+
+/*
+ * Shared helpers for everything that runs PCRE expressions (filters,
+ * rewrite rules, patterndb @PCRE@ parsers, multi-line prefixes).
+ *
+ * log_matcher_pcre_study() JIT compiles the expression if @jit is set and
+ * assigns the JIT stack of the matching thread to it, so the stack is
+ * allocated once per thread instead of falling back to the 32k on the
+ * machine stack.
+ *
+ * log_matcher_pcre_is_jit_enabled() returns the pcre-jit() option of the
+ * configuration being parsed or started, it is meant for expressions
+ * compiled while the configuration is initialized (patterndb, multi-line
+ * prefixes).  Expressions compiled by the parser get the final value
+ * using log_matcher_set_jit().
+ */
+void log_matcher_pcre_set_jit(gboolean enable);
+gboolean log_matcher_pcre_is_jit_enabled(void);
+
+pcre_extra *log_matcher_pcre_study(pcre *pattern, gboolean jit, const gchar **errptr);
+void log_matcher_pcre_free_study(pcre_extra *extra);
+
+void log_matcher_pcre_thread_deinit(void);
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2002-2010 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2010 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logmatcher-prefilter.h"
+#include "tls-support.h"
+
+#include <string.h>
+
+#define LOG_MATCHER_PREFILTER_ROOT 0
+
+typedef struct _LogMatcherPrefilterState
+{
+  /* the first child and the next sibling of the state in the trie */
+  gint child, sibling;
+  /* the state of the longest proper suffix that is also in the trie */
+  gint fail;
+  /* the nearest state along the fail links where a literal ends */
+  gint output;
+  /* the first literal ending in this state, further ones are chained in literal_next */
+  gint literal;
+  guchar byte;
+} LogMatcherPrefilterState;
+
+struct _LogMatcherPrefilter
+{
+  gint ref_cnt;
+  /* identifies the prefilter in the per-thread caches, pointers may be reused */
+  gint id;
+  gboolean compiled;
+  GArray *states;
+  GArray *literal_next;
+  /* transitions of the root state, -1 if there's none */
+  gint root_next[256];
+};
+
+typedef struct _LogMatcherPrefilterCache
+{
+  gint id;
+  gchar *value;
+  gsize value_len, value_size;
+  guint32 *found;
+  gsize found_size;
+} LogMatcherPrefilterCache;
+
+TLS_BLOCK_START
+{
+  LogMatcherPrefilterCache prefilter_cache;
+}
+TLS_BLOCK_END;
+
+#define prefilter_cache  __tls_deref(prefilter_cache)
+
+static gint prefilter_id;
+
+#define STATE(self, i) (&g_array_index((self)->states, LogMatcherPrefilterState, i))
+
+static gint
+log_matcher_prefilter_find_child(LogMatcherPrefilter *self, LogMatcherPrefilterState *states, gint state, guchar c)
+{
+  gint child;
+
+  if (state == LOG_MATCHER_PREFILTER_ROOT)
+    return self->root_next[c];
+
+  for (child = states[state].child; child >= 0; child = states[child].sibling)
+    {
+      if (states[child].byte == c)
+        return child;
+    }
+  return -1;
+}
+
+static gint
+log_matcher_prefilter_add_state(LogMatcherPrefilter *self, gint parent, guchar c)
+{
+  LogMatcherPrefilterState state = { -1, -1, LOG_MATCHER_PREFILTER_ROOT, -1, -1, c };
+  gint index = self->states->len;
+
+  state.sibling = STATE(self, parent)->child;
+  g_array_append_val(self->states, state);
+  STATE(self, parent)->child = index;
+  if (parent == LOG_MATCHER_PREFILTER_ROOT)
+    self->root_next[c] = index;
+  return index;
+}
+
+/*
+ * Adds a literal to the prefilter, returns its index to be passed to
+ * log_matcher_prefilter_may_match() or -1 if the literal cannot be
+ * added (it is empty or the prefilter is already compiled).
+ */
+gint
+log_matcher_prefilter_add_literal(LogMatcherPrefilter *self, const gchar *literal)
+{
+  gint state = LOG_MATCHER_PREFILTER_ROOT;
+  gint index;
+  const gchar *p;
+
+  if (self->compiled || !literal[0])
+    return -1;
+
+  for (p = literal; *p; p++)
+    {
+      guchar c = g_ascii_tolower(*p);
+      gint next;
+
+      next = log_matcher_prefilter_find_child(self, (LogMatcherPrefilterState *) self->states->data, state, c);
+      if (next < 0)
+        next = log_matcher_prefilter_add_state(self, state, c);
+      state = next;
+    }
+
+  index = self->literal_next->len;
+  g_array_append_val(self->literal_next, STATE(self, state)->literal);
+  STATE(self, state)->literal = index;
+  return index;
+}
+
+gint
+log_matcher_prefilter_get_literal_count(LogMatcherPrefilter *self)
+{
+  return self->literal_next->len;
+}
+
+/* calculates the fail and output links in breadth-first order */
+void
+log_matcher_prefilter_compile(LogMatcherPrefilter *self)
+{
+  LogMatcherPrefilterState *states = (LogMatcherPrefilterState *) self->states->data;
+  GArray *queue = g_array_sized_new(FALSE, FALSE, sizeof(gint), self->states->len);
+  gint head, child;
+
+  for (child = states[LOG_MATCHER_PREFILTER_ROOT].child; child >= 0; child = states[child].sibling)
+    g_array_append_val(queue, child);
+
+  for (head = 0; head < queue->len; head++)
+    {
+      gint state = g_array_index(queue, gint, head);
+
+      for (child = states[state].child; child >= 0; child = states[child].sibling)
+        {
+          gint fail = states[state].fail;
+          gint next;
+
+          while ((next = log_matcher_prefilter_find_child(self, states, fail, states[child].byte)) < 0 &&
+                 fail != LOG_MATCHER_PREFILTER_ROOT)
+            fail = states[fail].fail;
+
+          states[child].fail = next >= 0 ? next : LOG_MATCHER_PREFILTER_ROOT;
+          fail = states[child].fail;
+          states[child].output = states[fail].literal >= 0 ? fail : states[fail].output;
+          g_array_append_val(queue, child);
+        }
+    }
+  g_array_free(queue, TRUE);
+  self->compiled = TRUE;
+}
+
+/*
+ * Sets the bits of the literals found in @value in @found, which has to
+ * have room for log_matcher_prefilter_get_literal_count() bits.
+ */
+void
+log_matcher_prefilter_scan(LogMatcherPrefilter *self, const gchar *value, gsize value_len, guint32 *found)
+{
+  LogMatcherPrefilterState *states = (LogMatcherPrefilterState *) self->states->data;
+  gint *literal_next = (gint *) self->literal_next->data;
+  gint state = LOG_MATCHER_PREFILTER_ROOT;
+  gsize i;
+
+  for (i = 0; i < value_len; i++)
+    {
+      guchar c = g_ascii_tolower(value[i]);
+      gint next, out, literal;
+
+      while ((next = log_matcher_prefilter_find_child(self, states, state, c)) < 0 &&
+             state != LOG_MATCHER_PREFILTER_ROOT)
+        state = states[state].fail;
+      state = next >= 0 ? next : LOG_MATCHER_PREFILTER_ROOT;
+
+      for (out = states[state].literal >= 0 ? state : states[state].output; out >= 0; out = states[out].output)
+        {
+          for (literal = states[out].literal; literal >= 0; literal = literal_next[literal])
+            found[literal / 32] |= 1U << (literal % 32);
+        }
+    }
+}
+
+static void
+log_matcher_prefilter_cache_fill(LogMatcherPrefilterCache *cache, LogMatcherPrefilter *self, const gchar *value, gsize value_len)
+{
+  gsize found_size = (log_matcher_prefilter_get_literal_count(self) + 31) / 32;
+
+  if (cache->value_size < value_len)
+    {
+      cache->value_size = value_len;
+      cache->value = g_realloc(cache->value, cache->value_size);
+    }
+  memcpy(cache->value, value, value_len);
+  cache->value_len = value_len;
+
+  if (cache->found_size < found_size)
+    {
+      cache->found_size = found_size;
+      cache->found = g_realloc(cache->found, cache->found_size * sizeof(guint32));
+    }
+  memset(cache->found, 0, found_size * sizeof(guint32));
+  log_matcher_prefilter_scan(self, value, value_len, cache->found);
+  cache->id = self->id;
+}
+
+/*
+ * Returns FALSE if @value does not contain the literal with index
+ * @literal, thus the matcher that registered it cannot match either.
+ * Returns TRUE if the literal is present or the prefilter is not
+ * compiled.
+ */
+gboolean
+log_matcher_prefilter_may_match(LogMatcherPrefilter *self, gint literal, const gchar *value, gssize value_len)
+{
+  LogMatcherPrefilterCache *cache = &prefilter_cache;
+
+  if (!self->compiled)
+    return TRUE;
+
+  if (value_len < 0)
+    value_len = strlen(value);
+
+  if (cache->id != self->id || cache->value_len != value_len || memcmp(cache->value, value, value_len) != 0)
+    log_matcher_prefilter_cache_fill(cache, self, value, value_len);
+
+  return (cache->found[literal / 32] & (1U << (literal % 32))) != 0;
+}
+
+void
+log_matcher_prefilter_thread_deinit(void)
+{
+  LogMatcherPrefilterCache *cache = &prefilter_cache;
+
+  g_free(cache->value);
+  g_free(cache->found);
+  memset(cache, 0, sizeof(*cache));
+}
+
+LogMatcherPrefilter *
+log_matcher_prefilter_new(void)
+{
+  LogMatcherPrefilter *self = g_new0(LogMatcherPrefilter, 1);
+  LogMatcherPrefilterState root = { -1, -1, LOG_MATCHER_PREFILTER_ROOT, -1, -1, 0 };
+
+  self->ref_cnt = 1;
+  self->id = __sync_fetch_and_add(&prefilter_id, 1) + 1;
+  self->states = g_array_new(FALSE, FALSE, sizeof(LogMatcherPrefilterState));
+  self->literal_next = g_array_new(FALSE, FALSE, sizeof(gint));
+  g_array_append_val(self->states, root);
+  memset(self->root_next, -1, sizeof(self->root_next));
+  return self;
+}
+
+LogMatcherPrefilter *
+log_matcher_prefilter_ref(LogMatcherPrefilter *self)
+{
+  g_atomic_int_inc(&self->ref_cnt);
+  return self;
+}
+
+void
+log_matcher_prefilter_unref(LogMatcherPrefilter *self)
+{
+  if (self && g_atomic_int_dec_and_test(&self->ref_cnt))
+    {
+      g_array_free(self->states, TRUE);
+      g_array_free(self->literal_next, TRUE);
+      g_free(self);
+    }
+}
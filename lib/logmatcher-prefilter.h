@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2002-2010 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2010 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGMATCHER_PREFILTER_H_INCLUDED
+#define LOGMATCHER_PREFILTER_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * LogMatcherPrefilter finds all occurrences of a set of literal strings in
+ * a value in a single pass (using the Aho-Corasick algorithm).  Matchers
+ * looking at the same value register a string that all of their matches
+ * contain, and the value is only passed to the matcher itself if the
+ * string is present.  The result of the scan is cached per thread, so the
+ * value is scanned only once even if hundreds of matchers check it.
+ *
+ * Literals are matched case insensitively for ASCII letters, which can
+ * only make the prefilter less selective, never wrong.
+ */
+typedef struct _LogMatcherPrefilter LogMatcherPrefilter;
+
+LogMatcherPrefilter *log_matcher_prefilter_new(void);
+LogMatcherPrefilter *log_matcher_prefilter_ref(LogMatcherPrefilter *self);
+void log_matcher_prefilter_unref(LogMatcherPrefilter *self);
+
+gint log_matcher_prefilter_add_literal(LogMatcherPrefilter *self, const gchar *literal);
+gint log_matcher_prefilter_get_literal_count(LogMatcherPrefilter *self);
+void log_matcher_prefilter_compile(LogMatcherPrefilter *self);
+
+void log_matcher_prefilter_scan(LogMatcherPrefilter *self, const gchar *value, gsize value_len, guint32 *found);
+gboolean log_matcher_prefilter_may_match(LogMatcherPrefilter *self, gint literal, const gchar *value, gssize value_len);
+
+void log_matcher_prefilter_thread_deinit(void);
+
+#endif
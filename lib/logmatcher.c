@@ -23,12 +23,14 @@
  */
 
 #include "logmatcher.h"
+#include "logmatcher-pcre.h"
 #include "messages.h"
 #include "cfg.h"
 #include "misc.h"
 #include "compat/string.h"
+#include "stats/stats-registry.h"
 
-#include <pcre.h>
+#include <time.h>
 
 static void
 log_matcher_init(LogMatcher *self, const LogMatcherOptions *options)
@@ -477,12 +479,256 @@ log_matcher_glob_new(const LogMatcherOptions *options)
 
 /* libpcre support */
 
+/* shorter literals are too common to make prefiltering worthwhile */
+#define LOG_MATCHER_PCRE_MIN_REQUIRED_LITERAL 3
+
+/* skips the arguments of an escape sequence like \x41 or \p{L}, @p points to the escape letter */
+static const gchar *
+log_matcher_pcre_re_skip_escape(const gchar *p)
+{
+  gchar escape = *p++;
+  const gchar *end;
+  gint i;
+
+  if (*p == '{' && strchr("xopPgkN", escape))
+    {
+      end = strchr(p, '}');
+      return end ? end + 1 : p;
+    }
+
+  switch (escape)
+    {
+    case 'x':
+      for (i = 0; i < 2 && g_ascii_isxdigit(*p); i++)
+        p++;
+      break;
+    case 'p':
+    case 'P':
+    case 'c':
+      if (*p)
+        p++;
+      break;
+    case 'g':
+    case 'k':
+      if (*p == '<' || *p == '\'')
+        {
+          end = strchr(p + 1, *p == '<' ? '>' : '\'');
+          return end ? end + 1 : p;
+        }
+      if (*p == '-' || *p == '+')
+        p++;
+      while (g_ascii_isdigit(*p))
+        p++;
+      break;
+    default:
+      if (g_ascii_isdigit(escape))
+        {
+          while (g_ascii_isdigit(*p))
+            p++;
+        }
+      break;
+    }
+  return p;
+}
+
+/* skips a character class, @p points to the opening bracket */
+static const gchar *
+log_matcher_pcre_re_skip_class(const gchar *p)
+{
+  p++;
+  if (*p == '^')
+    p++;
+  if (*p == ']')
+    p++;
+  while (*p && *p != ']')
+    {
+      if (*p == '\\' && p[1])
+        {
+          p += 2;
+        }
+      else if (*p == '[' && p[1] == ':')
+        {
+          const gchar *end = strstr(p + 2, ":]");
+
+          p = end ? end + 2 : p + 1;
+        }
+      else
+        {
+          p++;
+        }
+    }
+  return *p ? p + 1 : NULL;
+}
+
+/* skips a {n}, {n,} or {n,m} quantifier, returns NULL if @p is not one */
+static const gchar *
+log_matcher_pcre_re_skip_quantifier(const gchar *p)
+{
+  p++;
+  if (!g_ascii_isdigit(*p))
+    return NULL;
+  while (g_ascii_isdigit(*p))
+    p++;
+  if (*p == ',')
+    {
+      p++;
+      while (g_ascii_isdigit(*p))
+        p++;
+    }
+  return *p == '}' ? p + 1 : NULL;
+}
+
+static void
+log_matcher_pcre_re_drop_last_char(GString *literal)
+{
+  /* drop a whole UTF-8 sequence, a quantifier applies to the whole character in utf8 mode */
+  while (literal->len > 0 && (literal->str[literal->len - 1] & 0xC0) == 0x80)
+    g_string_truncate(literal, literal->len - 1);
+  if (literal->len > 0)
+    g_string_truncate(literal, literal->len - 1);
+}
+
+static void
+log_matcher_pcre_re_end_literal(GString *literal, GString *best)
+{
+  if (literal->len > best->len)
+    g_string_assign(best, literal->str);
+  g_string_truncate(literal, 0);
+}
+
+/*
+ * Returns the longest literal string that every match of @re contains,
+ * used to skip values that cannot match using a LogMatcherPrefilter.  It
+ * only looks at the top level of the pattern and gives up on anything
+ * that would need a real regexp parser (alternation at the top level,
+ * option settings, quoting), so it is conservative: it may miss a
+ * literal, but never returns one that a match could lack.
+ */
+static gchar *
+log_matcher_pcre_re_get_required_literal(const gchar *re, gint flags)
+{
+  GString *literal, *best;
+  const gchar *p = re;
+  gint depth = 0;
+
+  /* caseless matching of ASCII letters in utf8 mode includes non-ASCII characters like the Kelvin sign */
+  if ((flags & LMF_ICASE) && (flags & LMF_UTF8))
+    return NULL;
+  if (strstr(re, "\\Q"))
+    return NULL;
+
+  literal = g_string_sized_new(32);
+  best = g_string_sized_new(32);
+  while (*p)
+    {
+      const gchar *next;
+
+      switch (*p)
+        {
+        case '\\':
+          p++;
+          if (!*p)
+            goto give_up;
+          if (g_ascii_isalnum(*p))
+            {
+              /* character types, assertions and the like */
+              log_matcher_pcre_re_end_literal(literal, best);
+              p = log_matcher_pcre_re_skip_escape(p);
+              continue;
+            }
+          break;
+        case '[':
+          log_matcher_pcre_re_end_literal(literal, best);
+          p = log_matcher_pcre_re_skip_class(p);
+          if (!p)
+            goto give_up;
+          continue;
+        case '(':
+          /* option settings and verbs change how the rest of the pattern is matched */
+          if (p[1] == '*' ||
+              (p[1] == '?' && (p[2] == '-' || p[2] == '^' ||
+                               (g_ascii_isalpha(p[2]) && !(p[2] == 'P' && strchr("<=>", p[3]))))))
+            goto give_up;
+          log_matcher_pcre_re_end_literal(literal, best);
+          depth++;
+          p++;
+          continue;
+        case ')':
+          log_matcher_pcre_re_end_literal(literal, best);
+          depth--;
+          if (depth < 0)
+            goto give_up;
+          p++;
+          continue;
+        case '|':
+          if (depth == 0)
+            goto give_up;
+          p++;
+          continue;
+        case '?':
+        case '*':
+          if (depth == 0)
+            log_matcher_pcre_re_drop_last_char(literal);
+          log_matcher_pcre_re_end_literal(literal, best);
+          p++;
+          continue;
+        case '{':
+          next = log_matcher_pcre_re_skip_quantifier(p);
+          if (depth == 0)
+            log_matcher_pcre_re_drop_last_char(literal);
+          log_matcher_pcre_re_end_literal(literal, best);
+          p = next ? next : p + 1;
+          continue;
+        case '+':
+        case '.':
+        case '^':
+        case '$':
+          log_matcher_pcre_re_end_literal(literal, best);
+          p++;
+          continue;
+        default:
+          break;
+        }
+
+      /* a literal character, possibly escaped */
+      if (depth == 0)
+        {
+          if ((flags & LMF_ICASE) && (*p & 0x80))
+            log_matcher_pcre_re_end_literal(literal, best);
+          else
+            g_string_append_c(literal, *p);
+        }
+      p++;
+    }
+  log_matcher_pcre_re_end_literal(literal, best);
+  g_string_free(literal, TRUE);
+
+  if (best->len < LOG_MATCHER_PCRE_MIN_REQUIRED_LITERAL)
+    {
+      g_string_free(best, TRUE);
+      return NULL;
+    }
+  return g_string_free(best, FALSE);
+
+ give_up:
+  g_string_free(literal, TRUE);
+  g_string_free(best, TRUE);
+  return NULL;
+}
+
 typedef struct _LogMatcherPcreRe
 {
   LogMatcher super;
   pcre *pattern;
   pcre_extra *extra;
   gint match_options;
+  /* whether self->extra was requested to be JIT compiled */
+  gboolean jit;
+  /* queried at compile time, so that matching doesn't need to */
+  gint num_matches;
+  gint name_count;
+  gint name_entry_size;
+  gchar *name_table;
 } LogMatcherPcreRe;
 
 static gboolean
@@ -494,7 +740,6 @@ log_matcher_pcre_re_compile(LogMatcher *s, const gchar *re, GError **error)
   const gchar *errptr;
   gint erroffset;
   gint flags = 0;
-  gint optflags = 0;
  
   g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
 
@@ -536,18 +781,29 @@ log_matcher_pcre_re_compile(LogMatcher *s, const gchar *re, GError **error)
       return FALSE;
     }
 
-#ifdef PCRE_STUDY_JIT_COMPILE
-  optflags = PCRE_STUDY_JIT_COMPILE;
-#endif
-
-  /* optimize regexp */
-  self->extra = pcre_study(self->pattern, optflags, &errptr);
+  /* optimize regexp, the owner may change the JIT setting later */
+  self->jit = log_matcher_pcre_is_jit_enabled();
+  self->extra = log_matcher_pcre_study(self->pattern, self->jit, &errptr);
   if (errptr != NULL)
     {
       g_set_error(error, LOG_TEMPLATE_ERROR, 0, "Error while optimizing regular expression, error=%s", errptr);
       return FALSE;
     }
 
+  if (pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_CAPTURECOUNT, &self->num_matches) < 0)
+    g_assert_not_reached();
+  if (self->num_matches > RE_MAX_MATCHES)
+    self->num_matches = RE_MAX_MATCHES;
+
+  pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_NAMECOUNT, &self->name_count);
+  if (self->name_count > 0)
+    {
+      pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_NAMETABLE, &self->name_table);
+      pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_NAMEENTRYSIZE, &self->name_entry_size);
+    }
+
+  g_free(self->super.required_literal);
+  self->super.required_literal = log_matcher_pcre_re_get_required_literal(re_comp, self->super.flags);
   return TRUE;
 }
 
@@ -572,32 +828,17 @@ log_matcher_pcre_re_feed_backrefs(LogMatcher *s, LogMessage *msg, gint value_han
 static void
 log_matcher_pcre_re_feed_named_substrings(LogMatcher *s, LogMessage *msg, int *matches, const gchar *value)
 {
-   gchar *name_table = NULL;
-   gint i = 0;
-   gint namecount = 0;
-   gint name_entry_size = 0;
    LogMatcherPcreRe *self = (LogMatcherPcreRe *) s;
-
-   pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_NAMECOUNT, &namecount);  
-   if (namecount > 0) 
-     { 
-       gchar *tabptr;
-       /* Before we can access the substrings, we must extract the table for
-          translating names to numbers, and the size of each entry in the table. 
-        */
-       pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_NAMETABLE, &name_table);       
-       pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_NAMEENTRYSIZE, &name_entry_size);
-       /* Now we can scan the table and, for each entry, print the number, the name,
-          and the substring itself. 
-        */
-       tabptr = name_table;
-       for (i = 0; i < namecount; i++)
-         {
-           int n = (tabptr[0] << 8) | tabptr[1];
-           log_msg_set_value(msg, log_msg_get_value_handle(tabptr + 2), value + matches[2*n], matches[2*n+1] - matches[2*n]);
-           tabptr += name_entry_size;
-         }
-     }  
+   gchar *tabptr = self->name_table;
+   gint i;
+
+   /* each entry of the name table is the number of the substring and its name */
+   for (i = 0; i < self->name_count; i++)
+     {
+       int n = (tabptr[0] << 8) | tabptr[1];
+       log_msg_set_value(msg, log_msg_get_value_handle(tabptr + 2), value + matches[2*n], matches[2*n+1] - matches[2*n]);
+       tabptr += self->name_entry_size;
+     }
 }
 
 static gboolean
@@ -606,18 +847,16 @@ log_matcher_pcre_re_match(LogMatcher *s, LogMessage *msg, gint value_handle, con
   LogMatcherPcreRe *self = (LogMatcherPcreRe *) s; 
   gint *matches;
   gsize matches_size;
-  gint num_matches;
   gint rc;
 
   if (value_len == -1)
     value_len = strlen(value);
 
-  if (pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_CAPTURECOUNT, &num_matches) < 0)
-    g_assert_not_reached();
-  if (num_matches > RE_MAX_MATCHES)
-    num_matches = RE_MAX_MATCHES;
+  if (s->prefilter && !log_matcher_prefilter_may_match(s->prefilter, s->prefilter_index, value, value_len))
+    return FALSE;
 
-  matches_size = 3 * (num_matches + 1);
+  /* large enough for all substrings, so pcre_exec() never allocates one */
+  matches_size = 3 * (self->num_matches + 1);
   matches = g_alloca(matches_size * sizeof(gint));
 
   rc = pcre_exec(self->pattern, self->extra,
@@ -660,18 +899,12 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
   GString *new_value = NULL;
   gint *matches;
   gsize matches_size;
-  gint num_matches;
   gint rc;
   gint start_offset, last_offset;
   gint options;
   gboolean last_match_was_empty;
 
-  if (pcre_fullinfo(self->pattern, self->extra, PCRE_INFO_CAPTURECOUNT, &num_matches) < 0)
-    g_assert_not_reached();
-  if (num_matches > RE_MAX_MATCHES)
-    num_matches = RE_MAX_MATCHES;
-
-  matches_size = 3 * (num_matches + 1);
+  matches_size = 3 * (self->num_matches + 1);
   matches = g_alloca(matches_size * sizeof(gint));
 
   /* we need zero initialized offsets for the last match as the
@@ -682,6 +915,9 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
   if (value_len == -1)
     value_len = strlen(value);
 
+  if (s->prefilter && !log_matcher_prefilter_may_match(s->prefilter, s->prefilter_index, value, value_len))
+    return NULL;
+
   last_offset = start_offset = 0;
   last_match_was_empty = FALSE;
   do
@@ -784,11 +1020,36 @@ log_matcher_pcre_re_replace(LogMatcher *s, LogMessage *msg, gint value_handle, c
   return NULL;
 }
 
+/* called from the init function of the owner, no matching is running at that point */
+static void
+log_matcher_pcre_re_set_jit(LogMatcher *s, gboolean jit)
+{
+  LogMatcherPcreRe *self = (LogMatcherPcreRe *) s;
+  pcre_extra *extra;
+  const gchar *errptr;
+
+  if (!self->pattern || self->jit == jit)
+    return;
+
+  extra = log_matcher_pcre_study(self->pattern, jit, &errptr);
+  if (errptr != NULL)
+    {
+      msg_warning("Error while optimizing regular expression, keeping the previous one",
+                  evt_tag_str("regexp", s->pattern),
+                  evt_tag_str("error", errptr),
+                  NULL);
+      return;
+    }
+  log_matcher_pcre_free_study(self->extra);
+  self->extra = extra;
+  self->jit = jit;
+}
+
 static void
 log_matcher_pcre_re_free(LogMatcher *s)
 {
   LogMatcherPcreRe *self = (LogMatcherPcreRe *) s;
-  pcre_free(self->extra);
+  log_matcher_pcre_free_study(self->extra);
   pcre_free(self->pattern);
 }
 
@@ -801,6 +1062,7 @@ log_matcher_pcre_re_new(const LogMatcherOptions *options)
   self->super.compile = log_matcher_pcre_re_compile;
   self->super.match = log_matcher_pcre_re_match;
   self->super.replace = log_matcher_pcre_re_replace;
+  self->super.set_jit = log_matcher_pcre_re_set_jit;
   self->super.free_fn = log_matcher_pcre_re_free;
 
   if (configuration && cfg_is_config_version_older(configuration, 0x0300))
@@ -856,6 +1118,102 @@ log_matcher_new(const LogMatcherOptions *options)
   return construct(options);
 }
 
+/*
+ * Registers the literal every match of the matcher contains in
+ * @prefilter, which is shared by the matchers looking at the same value.
+ * Once the prefilter is compiled, values missing the literal are rejected
+ * without running the matcher.
+ */
+void
+log_matcher_attach_prefilter(LogMatcher *s, LogMatcherPrefilter *prefilter)
+{
+  gint index;
+
+  if (!s->required_literal || s->prefilter)
+    return;
+
+  index = log_matcher_prefilter_add_literal(prefilter, s->required_literal);
+  if (index < 0)
+    return;
+
+  s->prefilter = log_matcher_prefilter_ref(prefilter);
+  s->prefilter_index = index;
+}
+
+static guint64
+log_matcher_get_time_nsec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+log_matcher_account_time(LogMatcher *s, guint64 start)
+{
+  guint64 elapsed = log_matcher_get_time_nsec() - start;
+
+  stats_counter_add(s->match_time, MIN(elapsed, G_MAXINT));
+  stats_counter_inc(s->match_count);
+}
+
+gboolean
+log_matcher_match_timed(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len)
+{
+  guint64 start = log_matcher_get_time_nsec();
+  gboolean result;
+
+  result = s->match(s, msg, value_handle, value, value_len);
+  log_matcher_account_time(s, start);
+  return result;
+}
+
+gchar *
+log_matcher_replace_timed(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len, LogTemplate *replacement, gssize *new_length)
+{
+  guint64 start = log_matcher_get_time_nsec();
+  gchar *result;
+
+  result = s->replace(s, msg, value_handle, value, value_len, replacement, new_length);
+  log_matcher_account_time(s, start);
+  return result;
+}
+
+/*
+ * Registers the number of matches run by the matcher and the time spent
+ * in them (in nanoseconds) as regexp counters, identified by @id and the
+ * pattern.  Reading the clock twice for every match is not free, so
+ * callers register with a high @stats_level.  Matchers shared by several
+ * users are registered only once.
+ */
+void
+log_matcher_register_stats(LogMatcher *s, gint stats_level, const gchar *id)
+{
+  if (s->stats_id || !s->pattern)
+    return;
+
+  s->stats_id = g_strdup(id);
+  stats_lock();
+  stats_register_sharded_counter(stats_level, SCS_REGEXP, s->stats_id, s->pattern, SC_TYPE_PROCESSED, &s->match_count);
+  stats_register_sharded_counter(stats_level, SCS_REGEXP, s->stats_id, s->pattern, SC_TYPE_ELAPSED, &s->match_time);
+  stats_unlock();
+}
+
+static void
+log_matcher_unregister_stats(LogMatcher *s)
+{
+  if (!s->stats_id)
+    return;
+
+  stats_lock();
+  stats_unregister_counter(SCS_REGEXP, s->stats_id, s->pattern, SC_TYPE_PROCESSED, &s->match_count);
+  stats_unregister_counter(SCS_REGEXP, s->stats_id, s->pattern, SC_TYPE_ELAPSED, &s->match_time);
+  stats_unlock();
+  g_free(s->stats_id);
+  s->stats_id = NULL;
+}
+
 LogMatcher *
 log_matcher_ref(LogMatcher *s)
 {
@@ -870,6 +1228,10 @@ log_matcher_unref(LogMatcher *s)
     {
       if (s->free_fn)
         s->free_fn(s);
+      log_matcher_unregister_stats(s);
+      log_matcher_prefilter_unref(s->prefilter);
+      g_free(s->required_literal);
+      g_free(s->pattern);
       g_free(s);
     }
 }
@@ -26,6 +26,8 @@
 #define LOGMATCHER_H_INCLUDED
 
 #include "logmsg.h"
+#include "logmatcher-prefilter.h"
+#include "stats/stats-counter.h"
 #include "template/templates.h"
 
 #define LOG_MATCHER_ERROR log_template_error_quark()
@@ -64,32 +66,52 @@ struct _LogMatcher
 {
   gint ref_cnt;
   gint flags;
+  /* a string that every match contains, NULL if not known */
+  gchar *required_literal;
+  LogMatcherPrefilter *prefilter;
+  gint prefilter_index;
+  gchar *pattern;
+  /* set by log_matcher_register_stats(), matches are only timed if set */
+  gchar *stats_id;
+  StatsCounterItem *match_count;
+  StatsCounterItem *match_time;
   gboolean (*compile)(LogMatcher *s, const gchar *re, GError **error);
   /* value_len can be -1 to indicate unknown length */
   gboolean (*match)(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len);
   /* value_len can be -1 to indicate unknown length, new_length can be returned as -1 to indicate unknown length */
   gchar *(*replace)(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len, LogTemplate *replacement, gssize *new_length);
+  /* NULL if the matcher has no JIT compiler */
+  void (*set_jit)(LogMatcher *s, gboolean jit);
   void (*free_fn)(LogMatcher *s);
 };
 
+gboolean log_matcher_match_timed(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len);
+gchar *log_matcher_replace_timed(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len, LogTemplate *replacement, gssize *new_length);
+
 static inline gboolean 
 log_matcher_compile(LogMatcher *s, const gchar *re, GError **error)
 {
+  g_free(s->pattern);
+  s->pattern = g_strdup(re);
   return s->compile(s, re, error);
 }
 
 static inline gboolean
 log_matcher_match(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len)
 {
+  if (G_UNLIKELY(s->match_time))
+    return log_matcher_match_timed(s, msg, value_handle, value, value_len);
   return s->match(s, msg, value_handle, value, value_len);
 }
 
 static inline gchar *
 log_matcher_replace(LogMatcher *s, LogMessage *msg, gint value_handle, const gchar *value, gssize value_len, LogTemplate *replacement, gssize *new_length)
 {
-  if (s->replace)
-    return s->replace(s, msg, value_handle, value, value_len, replacement, new_length);
-  return NULL;
+  if (!s->replace)
+    return NULL;
+  if (G_UNLIKELY(s->match_time))
+    return log_matcher_replace_timed(s, msg, value_handle, value, value_len, replacement, new_length);
+  return s->replace(s, msg, value_handle, value, value_len, replacement, new_length);
 }
 
 static inline void
@@ -98,6 +120,19 @@ log_matcher_set_flags(LogMatcher *s, gint flags)
   s->flags = flags;
 }
 
+/*
+ * Expressions are compiled while the configuration is parsed, when its
+ * pcre-jit() option may not have been seen yet.  Owners of a matcher
+ * apply the final setting from their init function, the expression is
+ * only recompiled if it differs from the one used at compile time.
+ */
+static inline void
+log_matcher_set_jit(LogMatcher *s, gboolean jit)
+{
+  if (s->set_jit)
+    s->set_jit(s, jit);
+}
+
 static inline gboolean
 log_matcher_is_replace_supported(LogMatcher *s)
 {
@@ -110,6 +145,8 @@ LogMatcher *log_matcher_string_new(const LogMatcherOptions *options);
 LogMatcher *log_matcher_glob_new(const LogMatcherOptions *options);
 
 LogMatcher *log_matcher_new(const LogMatcherOptions *options);
+void log_matcher_attach_prefilter(LogMatcher *s, LogMatcherPrefilter *prefilter);
+void log_matcher_register_stats(LogMatcher *s, gint stats_level, const gchar *id);
 LogMatcher *log_matcher_ref(LogMatcher *s);
 void log_matcher_unref(LogMatcher *s);
 
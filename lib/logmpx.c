@@ -23,7 +23,120 @@
  */
 
 #include "logmpx.h"
+#include "misc.h"
 
+#include <string.h>
+
+/*
+ * Index of the next hops of a multiplexer by the value of a single
+ * name-value pair.  Next hops that start with a filter that matches
+ * exactly when the value is one of a set of strings are only tried if the
+ * value of the message is one of those, the rest of the next hops are
+ * tried for every message.
+ */
+struct _LogMultiplexerDispatch
+{
+  NVHandle value_handle;
+  /* value -> GArray of the indices of the next hops matching the value, in ascending order */
+  GHashTable *index;
+  /* indices of the next hops that are tried for every message, in ascending order */
+  GArray *unindexed;
+};
+
+static void
+log_multiplexer_dispatch_free_hops(GArray *hops)
+{
+  g_array_free(hops, TRUE);
+}
+
+static void
+log_multiplexer_dispatch_free(LogMultiplexerDispatch *self)
+{
+  if (!self)
+    return;
+
+  g_hash_table_destroy(self->index);
+  g_array_free(self->unindexed, TRUE);
+  g_free(self);
+}
+
+static LogMultiplexerDispatch *
+log_multiplexer_dispatch_new(NVHandle value_handle, GPtrArray *next_hop_values)
+{
+  LogMultiplexerDispatch *self = g_new0(LogMultiplexerDispatch, 1);
+  gint i, j;
+
+  self->value_handle = value_handle;
+  self->index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) log_multiplexer_dispatch_free_hops);
+  self->unindexed = g_array_new(FALSE, FALSE, sizeof(gint));
+
+  for (i = 0; i < next_hop_values->len; i++)
+    {
+      GPtrArray *values = g_ptr_array_index(next_hop_values, i);
+
+      if (!values)
+        {
+          g_array_append_val(self->unindexed, i);
+          continue;
+        }
+
+      for (j = 0; j < values->len; j++)
+        {
+          const gchar *value = g_ptr_array_index(values, j);
+          GArray *hops;
+
+          hops = g_hash_table_lookup(self->index, value);
+          if (!hops)
+            {
+              hops = g_array_new(FALSE, FALSE, sizeof(gint));
+              g_hash_table_insert(self->index, g_strdup(value), hops);
+            }
+
+          /* a value may be listed multiple times for the same next hop */
+          if (hops->len == 0 || g_array_index(hops, gint, hops->len - 1) != i)
+            g_array_append_val(hops, i);
+        }
+    }
+  return self;
+}
+
+/*
+ * Fills @candidates with the indices of the next hops that may match
+ * @msg, in the order they are listed in next_hops, returns the number of
+ * candidates.
+ */
+static gint
+log_multiplexer_dispatch_get_candidates(LogMultiplexerDispatch *self, LogMessage *msg, gint num_hops, gint *candidates)
+{
+  const gchar *value;
+  gssize value_len;
+  GArray *matching;
+  gint n = 0, u = 0, m = 0;
+
+  value = log_msg_get_value(msg, self->value_handle, &value_len);
+
+  /* a PCRE "$" also matches before a trailing newline, let the filters decide */
+  if (G_UNLIKELY(value_len > 0 && value[value_len - 1] == '\n'))
+    {
+      for (n = 0; n < num_hops; n++)
+        candidates[n] = n;
+      return num_hops;
+    }
+
+  APPEND_ZERO(value, value, value_len);
+  matching = g_hash_table_lookup(self->index, value);
+
+  /* merge the two sorted lists */
+  while (u < self->unindexed->len || (matching && m < matching->len))
+    {
+      if (!matching || m >= matching->len ||
+          (u < self->unindexed->len && g_array_index(self->unindexed, gint, u) < g_array_index(matching, gint, m)))
+        candidates[n++] = g_array_index(self->unindexed, gint, u++);
+      else
+        candidates[n++] = g_array_index(matching, gint, m++);
+    }
+  return n;
+}
 
 void
 log_multiplexer_add_next_hop(LogMultiplexer *self, LogPipe *next_hop)
@@ -31,6 +144,21 @@ log_multiplexer_add_next_hop(LogMultiplexer *self, LogPipe *next_hop)
   g_ptr_array_add(self->next_hops, next_hop);
 }
 
+/*
+ * Index the next hops by the value of @value_handle: @next_hop_values
+ * contains a GPtrArray of strings for every next hop which only matches
+ * messages where the value is one of the strings, or NULL for next hops
+ * that need to be tried for every message.
+ */
+void
+log_multiplexer_set_dispatch(LogMultiplexer *self, NVHandle value_handle, GPtrArray *next_hop_values)
+{
+  g_assert(next_hop_values->len == self->next_hops->len);
+
+  log_multiplexer_dispatch_free(self->dispatch);
+  self->dispatch = log_multiplexer_dispatch_new(value_handle, next_hop_values);
+}
+
 static gboolean
 log_multiplexer_init(LogPipe *s)
 {
@@ -75,9 +203,22 @@ log_multiplexer_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
   local_options.matched = &matched;
   for (fallback = 0; (fallback == 0) || (fallback == 1 && self->fallback_exists && !delivered); fallback++)
     {
-      for (i = 0; i < self->next_hops->len; i++)
+      gint num_hops = self->next_hops->len;
+      gint *hops = NULL;
+      gint hop;
+
+      if (fallback == 0 && self->dispatch)
         {
-          LogPipe *next_hop = g_ptr_array_index(self->next_hops, i);
+          hops = g_alloca(num_hops * sizeof(gint));
+          num_hops = log_multiplexer_dispatch_get_candidates(self->dispatch, msg, num_hops, hops);
+        }
+
+      for (hop = 0; hop < num_hops; hop++)
+        {
+          LogPipe *next_hop;
+
+          i = hops ? hops[hop] : hop;
+          next_hop = g_ptr_array_index(self->next_hops, i);
 
           if (G_UNLIKELY(fallback == 0 && (next_hop->flags & PIF_BRANCH_FALLBACK) != 0))
             {
@@ -98,7 +239,7 @@ log_multiplexer_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_op
            */
            
           last_delivery = (self->super.pipe_next == NULL) && 
-                          (i == self->next_hops->len - 1) && 
+                          (hop == num_hops - 1) && 
                           (!self->fallback_exists || delivered || fallback == 1);
           
           if (!last_delivery)
@@ -123,6 +264,7 @@ log_multiplexer_free(LogPipe *s)
 {
   LogMultiplexer *self = (LogMultiplexer *) s;
 
+  log_multiplexer_dispatch_free(self->dispatch);
   g_ptr_array_free(self->next_hops, TRUE);
   log_pipe_free_method(s);
 }
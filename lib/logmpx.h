@@ -36,15 +36,20 @@
  * This object is used for example for each source to send messages to all
  * log pipelines that refer to the source.
  **/
+typedef struct _LogMultiplexerDispatch LogMultiplexerDispatch;
+
 typedef struct _LogMultiplexer
 {
   LogPipe super;
   GPtrArray *next_hops;
   gboolean fallback_exists;
+  /* optional index of next_hops, see log_multiplexer_set_dispatch() */
+  LogMultiplexerDispatch *dispatch;
 } LogMultiplexer;
 
 LogMultiplexer *log_multiplexer_new(guint32 flags, GlobalConfig *cfg);
 void log_multiplexer_add_next_hop(LogMultiplexer *self, LogPipe *next_hop);
+void log_multiplexer_set_dispatch(LogMultiplexer *self, NVHandle value_handle, GPtrArray *next_hop_values);
 
 
 #endif
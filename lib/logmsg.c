@@ -34,6 +34,7 @@
 #include "tls-support.h"
 #include "compat/string.h"
 #include "rcptid.h"
+#include "slab-alloc.h"
 
 #include <sys/types.h>
 #include <time.h>
@@ -420,6 +421,7 @@ log_msg_init_queue_node(LogMessage *msg, LogMessageQueueNode *node, const LogPat
 {
   INIT_IV_LIST_HEAD(&node->list);
   node->ack_needed = path_options->ack_needed;
+  node->timestamp = 0;
   node->msg = log_msg_ref(msg);
   log_msg_write_protect(msg);
 }
@@ -539,7 +541,15 @@ log_msg_set_value_indirect(LogMessage *self, NVHandle handle, NVHandle ref_handl
   if (handle == LM_V_NONE)
     return;
 
-  g_assert(handle >= LM_V_MAX);
+  /* built-in values are used as NUL terminated strings all over the
+   * place, they can only reference the tail of another value */
+  if (handle < LM_V_MAX)
+    {
+      gssize ref_len;
+
+      log_msg_get_value(self, ref_handle, &ref_len);
+      g_assert(ofs + len == ref_len);
+    }
 
   name = log_msg_get_value_name(handle, &name_len);
 
@@ -1051,7 +1061,7 @@ log_msg_alloc(gsize payload_size)
       payload_ofs = alloc_size;
       alloc_size += payload_space;
     }
-  msg = g_malloc(alloc_size);
+  msg = slab_alloc(alloc_size);
 
   memset(msg, 0, sizeof(LogMessage));
 
@@ -1204,6 +1214,197 @@ log_msg_new_mark(void)
   return self;
 }
 
+/*
+ * Serialization of LogMessage instances
+ *
+ * The serialized format is independent of the in-memory NVTable layout and
+ * of the NVHandle/LogTagId assignment of the running process: values and
+ * tags are stored by name, so that a message written by one syslog-ng
+ * process (e.g. into a disk-buffer) can be read back by another one.
+ */
+
+#define LOGMSG_SERIALIZE_VERSION 1
+
+static gboolean
+log_msg_write_value(NVHandle handle, const gchar *name, const gchar *value, gssize value_len, gpointer user_data)
+{
+  SerializeArchive *sa = (SerializeArchive *) ((gpointer *) user_data)[0];
+  gboolean *success = (gboolean *) ((gpointer *) user_data)[1];
+
+  if (!name || !name[0])
+    return FALSE;
+
+  if (!serialize_write_cstring(sa, name, -1) ||
+      !serialize_write_cstring(sa, value, value_len))
+    {
+      *success = FALSE;
+      return TRUE;
+    }
+  return FALSE;
+}
+
+static gboolean
+log_msg_write_tag(LogMessage *self, LogTagId tag_id, const gchar *name, gpointer user_data)
+{
+  SerializeArchive *sa = (SerializeArchive *) ((gpointer *) user_data)[0];
+  gboolean *success = (gboolean *) ((gpointer *) user_data)[1];
+
+  if (name && !serialize_write_cstring(sa, name, -1))
+    *success = FALSE;
+  return TRUE;
+}
+
+static gboolean
+log_msg_write_stamp(LogStamp *stamp, SerializeArchive *sa)
+{
+  return serialize_write_uint64(sa, (guint64) (gint64) stamp->tv_sec) &&
+         serialize_write_uint32(sa, stamp->tv_usec) &&
+         serialize_write_uint32(sa, (guint32) stamp->zone_offset);
+}
+
+static gboolean
+log_msg_read_stamp(LogStamp *stamp, SerializeArchive *sa)
+{
+  guint64 tv_sec;
+  guint32 tv_usec, zone_offset;
+
+  if (!serialize_read_uint64(sa, &tv_sec) ||
+      !serialize_read_uint32(sa, &tv_usec) ||
+      !serialize_read_uint32(sa, &zone_offset))
+    return FALSE;
+  stamp->tv_sec = (time_t) (gint64) tv_sec;
+  stamp->tv_usec = tv_usec;
+  stamp->zone_offset = (gint32) zone_offset;
+  return TRUE;
+}
+
+/**
+ * log_msg_write:
+ * @self: LogMessage instance
+ * @sa: archive to write the message into
+ *
+ * Serializes @self into @sa, in a format that log_msg_read() is able to
+ * restore.  Runtime-only state (ack/ref counts, the original message of a
+ * clone, state flags) is not saved.
+ **/
+gboolean
+log_msg_write(LogMessage *self, SerializeArchive *sa)
+{
+  gboolean success = TRUE;
+  gpointer args[] = { sa, &success };
+  gint i;
+
+  if (!serialize_write_uint8(sa, LOGMSG_SERIALIZE_VERSION) ||
+      !serialize_write_uint32(sa, self->flags & ~LF_STATE_MASK) ||
+      !serialize_write_uint16(sa, self->pri) ||
+      !serialize_write_uint64(sa, self->rcptid))
+    return FALSE;
+
+  for (i = 0; i < LM_TS_MAX; i++)
+    {
+      if (!log_msg_write_stamp(&self->timestamps[i], sa))
+        return FALSE;
+    }
+
+  if (self->saddr)
+    {
+      if (!serialize_write_uint32(sa, self->saddr->salen) ||
+          !serialize_write_blob(sa, g_sockaddr_get_sa(self->saddr), self->saddr->salen))
+        return FALSE;
+    }
+  else if (!serialize_write_uint32(sa, 0))
+    return FALSE;
+
+  log_msg_tags_foreach(self, log_msg_write_tag, args);
+  if (!success || !serialize_write_cstring(sa, "", 0))
+    return FALSE;
+
+  log_msg_nv_table_foreach(self->payload, log_msg_write_value, args);
+  if (!success || !serialize_write_cstring(sa, "", 0))
+    return FALSE;
+  return TRUE;
+}
+
+/**
+ * log_msg_read:
+ * @self: LogMessage instance, as returned by log_msg_new_empty()
+ * @sa: archive to read the message from
+ *
+ * Restores the contents of a message serialized by log_msg_write() into
+ * @self.
+ **/
+gboolean
+log_msg_read(LogMessage *self, SerializeArchive *sa)
+{
+  guint8 version;
+  guint32 flags, salen;
+  guint16 pri;
+  guint64 rcptid;
+  gchar *name, *value;
+  gsize name_len, value_len;
+  gint i;
+
+  if (!serialize_read_uint8(sa, &version) ||
+      version != LOGMSG_SERIALIZE_VERSION ||
+      !serialize_read_uint32(sa, &flags) ||
+      !serialize_read_uint16(sa, &pri) ||
+      !serialize_read_uint64(sa, &rcptid))
+    return FALSE;
+
+  self->flags = (self->flags & LF_STATE_MASK) | (flags & ~LF_STATE_MASK);
+  self->pri = pri;
+  self->rcptid = rcptid;
+
+  for (i = 0; i < LM_TS_MAX; i++)
+    {
+      if (!log_msg_read_stamp(&self->timestamps[i], sa))
+        return FALSE;
+    }
+
+  if (!serialize_read_uint32(sa, &salen))
+    return FALSE;
+  if (salen > 0)
+    {
+      struct sockaddr_storage ss;
+
+      if (salen > sizeof(ss) || !serialize_read_blob(sa, &ss, salen))
+        return FALSE;
+      if (log_msg_chk_flag(self, LF_STATE_OWN_SADDR))
+        g_sockaddr_unref(self->saddr);
+      self->saddr = g_sockaddr_new((struct sockaddr *) &ss, salen);
+      self->flags |= LF_STATE_OWN_SADDR;
+    }
+
+  while (serialize_read_cstring(sa, &name, &name_len))
+    {
+      if (name_len == 0)
+        {
+          g_free(name);
+          break;
+        }
+      log_msg_set_tag_by_name(self, name);
+      g_free(name);
+    }
+
+  while (serialize_read_cstring(sa, &name, &name_len))
+    {
+      if (name_len == 0)
+        {
+          g_free(name);
+          return TRUE;
+        }
+      if (!serialize_read_cstring(sa, &value, &value_len))
+        {
+          g_free(name);
+          return FALSE;
+        }
+      log_msg_set_value(self, log_msg_get_value_handle(name), value, value_len);
+      g_free(name);
+      g_free(value);
+    }
+  return FALSE;
+}
+
 /**
  * log_msg_free:
  * @self: LogMessage instance
@@ -1226,7 +1427,7 @@ log_msg_free(LogMessage *self)
   if (self->original)
     log_msg_unref(self->original);
 
-  g_free(self);
+  slab_free(self);
 }
 
 /**
@@ -116,6 +116,9 @@ typedef struct _LogMessageQueueNode
   struct iv_list_head list;
   LogMessage *msg;
   gboolean ack_needed:1, embedded:1;
+  /* monotonic time of the last enqueue/dequeue in usecs, used for latency
+   * histograms, 0 if not tracked or already recorded */
+  guint64 timestamp;
 } LogMessageQueueNode;
 
 
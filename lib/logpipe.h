@@ -201,9 +201,14 @@ struct _LogPathOptions
     flow_control_requested:1;
 
   gboolean *matched;
+
+  /* set by log_queue_pop_head() if the time the message spent in the
+   * queue was recorded, so that it is not recorded again if the message
+   * is pushed back with log_queue_push_head() */
+  gboolean queue_latency_recorded;
 };
 
-#define LOG_PATH_OPTIONS_INIT { TRUE, FALSE, NULL }
+#define LOG_PATH_OPTIONS_INIT { TRUE, FALSE, NULL, FALSE }
 
 struct _LogPipe
 {
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2002-2012 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2012 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "find-eom.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__x86_64__) || defined(__i386__))
+/* gcc 4.9+ lets us compile SSE2/AVX2 code paths using function level
+ * target attributes, without requiring the whole binary to be compiled for
+ * those instruction sets.  The right variant is selected at runtime. */
+#define FIND_EOM_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+static inline gboolean
+is_eom_char(guchar c)
+{
+  return c == '\n' || c == '\0';
+}
+
+static inline const guchar *
+find_eom_bytewise(const guchar *s, gsize n)
+{
+  const guchar *end = s + n;
+
+  for (; s < end; s++)
+    {
+      if (is_eom_char(*s))
+        return s;
+    }
+  return NULL;
+}
+
+static inline gsize
+find_all_eom_bytewise(const guchar *s, gsize n, gsize base, guint32 *eoms, gsize max_eoms)
+{
+  gsize count = 0;
+  gsize i;
+
+  for (i = 0; i < n && count < max_eoms; i++)
+    {
+      if (is_eom_char(s[i]))
+        eoms[count++] = base + i;
+    }
+  return count;
+}
+
+/**
+ * Find the character terminating the buffer.
+ *
+ * NOTE: when looking for the end-of-message here, it either needs to be
+ * terminated via NUL or via NL, when terminating via NL we have to make
+ * sure that there's no NUL left in the message. This function iterates over
+ * the input data and returns a pointer to the first occurence of NL or NUL.
+ *
+ * It uses an algorithm similar to what there's in libc memchr/strchr.
+ **/
+static const guchar *
+find_eom_scalar(const guchar *s, gsize n)
+{
+  const guchar *char_ptr;
+  const gulong *longword_ptr;
+  gulong longword, magic_bits, charmask;
+  gchar c;
+
+  c = '\n';
+
+  /* align input to long boundary */
+  for (char_ptr = s; n > 0 && ((gulong) char_ptr & (sizeof(longword) - 1)) != 0; ++char_ptr, n--)
+    {
+      if (*char_ptr == c || *char_ptr == '\0')
+        return char_ptr;
+    }
+
+  longword_ptr = (gulong *) char_ptr;
+
+#if GLIB_SIZEOF_LONG == 8
+  magic_bits = 0x7efefefefefefeffL;
+#elif GLIB_SIZEOF_LONG == 4
+  magic_bits = 0x7efefeffL;
+#else
+  #error "unknown architecture"
+#endif
+  memset(&charmask, c, sizeof(charmask));
+
+  while (n > sizeof(longword))
+    {
+      longword = *longword_ptr++;
+      if ((((longword + magic_bits) ^ ~longword) & ~magic_bits) != 0 ||
+          ((((longword ^ charmask) + magic_bits) ^ ~(longword ^ charmask)) & ~magic_bits) != 0)
+        {
+          gint i;
+
+          char_ptr = (const guchar *) (longword_ptr - 1);
+
+          for (i = 0; i < sizeof(longword); i++)
+            {
+              if (*char_ptr == c || *char_ptr == '\0')
+                return char_ptr;
+              char_ptr++;
+            }
+        }
+      n -= sizeof(longword);
+    }
+
+  char_ptr = (const guchar *) longword_ptr;
+
+  while (n-- > 0)
+    {
+      if (*char_ptr == c || *char_ptr == '\0')
+        return char_ptr;
+      ++char_ptr;
+    }
+
+  return NULL;
+}
+
+static gsize
+find_all_eom_scalar(const guchar *s, gsize n, guint32 *eoms, gsize max_eoms)
+{
+  const guchar *eom;
+  const guchar *p = s;
+  gsize count = 0;
+
+  while (count < max_eoms && (eom = find_eom_scalar(p, n - (p - s))))
+    {
+      eoms[count++] = eom - s;
+      p = eom + 1;
+    }
+  return count;
+}
+
+#if FIND_EOM_X86_SIMD
+
+__attribute__((target("sse2")))
+static inline guint
+find_eom_sse2_mask(const guchar *s)
+{
+  const __m128i nl = _mm_set1_epi8('\n');
+  const __m128i nul = _mm_setzero_si128();
+  __m128i chunk = _mm_loadu_si128((const __m128i *) s);
+
+  return (guint) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, nl),
+                                                _mm_cmpeq_epi8(chunk, nul)));
+}
+
+__attribute__((target("sse2")))
+static const guchar *
+find_eom_sse2(const guchar *s, gsize n)
+{
+  gsize i;
+
+  for (i = 0; i + sizeof(__m128i) <= n; i += sizeof(__m128i))
+    {
+      guint mask = find_eom_sse2_mask(s + i);
+
+      if (mask)
+        return s + i + __builtin_ctz(mask);
+    }
+  return find_eom_bytewise(s + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static gsize
+find_all_eom_sse2(const guchar *s, gsize n, guint32 *eoms, gsize max_eoms)
+{
+  gsize count = 0;
+  gsize i;
+
+  for (i = 0; i + sizeof(__m128i) <= n; i += sizeof(__m128i))
+    {
+      guint mask = find_eom_sse2_mask(s + i);
+
+      while (mask)
+        {
+          if (count == max_eoms)
+            return count;
+          eoms[count++] = i + __builtin_ctz(mask);
+          mask &= mask - 1;
+        }
+    }
+  return count + find_all_eom_bytewise(s + i, n - i, i, eoms + count, max_eoms - count);
+}
+
+__attribute__((target("avx2")))
+static inline guint
+find_eom_avx2_mask(const guchar *s)
+{
+  const __m256i nl = _mm256_set1_epi8('\n');
+  const __m256i nul = _mm256_setzero_si256();
+  __m256i chunk = _mm256_loadu_si256((const __m256i *) s);
+
+  return (guint) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, nl),
+                                                      _mm256_cmpeq_epi8(chunk, nul)));
+}
+
+__attribute__((target("avx2")))
+static const guchar *
+find_eom_avx2(const guchar *s, gsize n)
+{
+  gsize i;
+
+  for (i = 0; i + sizeof(__m256i) <= n; i += sizeof(__m256i))
+    {
+      guint mask = find_eom_avx2_mask(s + i);
+
+      if (mask)
+        return s + i + __builtin_ctz(mask);
+    }
+  return find_eom_bytewise(s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static gsize
+find_all_eom_avx2(const guchar *s, gsize n, guint32 *eoms, gsize max_eoms)
+{
+  gsize count = 0;
+  gsize i;
+
+  for (i = 0; i + sizeof(__m256i) <= n; i += sizeof(__m256i))
+    {
+      guint mask = find_eom_avx2_mask(s + i);
+
+      while (mask)
+        {
+          if (count == max_eoms)
+            return count;
+          eoms[count++] = i + __builtin_ctz(mask);
+          mask &= mask - 1;
+        }
+    }
+  return count + find_all_eom_bytewise(s + i, n - i, i, eoms + count, max_eoms - count);
+}
+
+#endif
+
+/* ordered from the fastest to the slowest, the scalar one is always available */
+static const FindEOMImplementation find_eom_implementations[] =
+{
+#if FIND_EOM_X86_SIMD
+  { "avx2", find_eom_avx2, find_all_eom_avx2 },
+  { "sse2", find_eom_sse2, find_all_eom_sse2 },
+#endif
+  { "scalar", find_eom_scalar, find_all_eom_scalar },
+  { NULL }
+};
+
+static const FindEOMImplementation *find_eom_selected_implementation;
+
+static const FindEOMImplementation *
+find_eom_select_implementation(void)
+{
+  const FindEOMImplementation *impl = &find_eom_implementations[0];
+
+#if FIND_EOM_X86_SIMD
+  __builtin_cpu_init();
+  if (!__builtin_cpu_supports("avx2"))
+    {
+      impl++;
+      if (!__builtin_cpu_supports("sse2"))
+        impl++;
+    }
+#endif
+  return impl;
+}
+
+/*
+ * Returns the fastest implementation supported by the running CPU.  The
+ * returned pointer points into an array that continues with the slower
+ * fallbacks and is terminated by an entry with a NULL name, which makes it
+ * possible to compare them in the unit tests.
+ */
+const FindEOMImplementation *
+find_eom_get_implementation(void)
+{
+  /* racing threads would store the same value, so no locking is needed */
+  if (G_UNLIKELY(!find_eom_selected_implementation))
+    find_eom_selected_implementation = find_eom_select_implementation();
+  return find_eom_selected_implementation;
+}
+
+/*
+ * Returns a pointer to the first NL or NUL character in @s, or NULL if
+ * there's none in the first @n bytes.
+ */
+const guchar *
+find_eom(const guchar *s, gsize n)
+{
+  return find_eom_get_implementation()->find_eom(s, n);
+}
+
+/*
+ * Looks up all NL/NUL characters in the first @n bytes of @s in a single
+ * pass and stores their offsets (relative to @s) into @eoms.  At most
+ * @max_eoms offsets are stored, the return value is the number of offsets
+ * found.  If it equals to @max_eoms the scan may have stopped before the
+ * end of the buffer.
+ */
+gsize
+find_all_eom(const guchar *s, gsize n, guint32 *eoms, gsize max_eoms)
+{
+  return find_eom_get_implementation()->find_all_eom(s, n, eoms, max_eoms);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2002-2012 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2012 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef LOGPROTO_FIND_EOM_H_INCLUDED
+#define LOGPROTO_FIND_EOM_H_INCLUDED
+
+#include "syslog-ng.h"
+
+typedef const guchar *(*FindEOMFunc)(const guchar *s, gsize n);
+typedef gsize (*FindAllEOMFunc)(const guchar *s, gsize n, guint32 *eoms, gsize max_eoms);
+
+/* one implementation of the end-of-message scanners, the available ones
+ * depend on the CPU we are running on */
+typedef struct _FindEOMImplementation
+{
+  const gchar *name;
+  FindEOMFunc find_eom;
+  FindAllEOMFunc find_all_eom;
+} FindEOMImplementation;
+
+const guchar *find_eom(const guchar *s, gsize n);
+gsize find_all_eom(const guchar *s, gsize n, guint32 *eoms, gsize max_eoms);
+
+const FindEOMImplementation *find_eom_get_implementation(void);
+
+#endif
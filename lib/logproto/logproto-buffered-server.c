@@ -297,6 +297,7 @@ log_proto_buffered_server_apply_state(LogProtoBufferedServer *self, PersistEntry
   lseek(fd, 0, SEEK_SET);
 
  exit:
+  self->buffer_generation++;
   state->file_inode = st.st_ino;
   state->file_size = st.st_size;
   state->raw_stream_pos = ofs;
@@ -546,6 +547,10 @@ log_proto_buffered_server_prepare(LogProtoServer *s, GIOCondition *cond)
   if (*cond == 0)
     *cond = G_IO_IN;
 
+  /* the transport has already received data we need to process without polling */
+  if (log_transport_has_buffered_data(self->super.transport))
+    return TRUE;
+
   return FALSE;
 }
 
@@ -582,6 +587,7 @@ log_proto_buffered_server_fetch_from_buffer(LogProtoBufferedServer *self, const
           state->pending_raw_buffer_size = 0;
         }
       state->pending_buffer_pos = state->pending_buffer_end = 0;
+      self->buffer_generation++;
       goto exit;
     }
 
@@ -670,6 +676,7 @@ log_proto_buffered_server_fetch_into_buffer(LogProtoBufferedServer *self)
           msg_error("EOF read on a channel with leftovers from previous character conversion, dropping input",
                     NULL);
           state->pending_buffer_pos = state->pending_buffer_end = 0;
+          self->buffer_generation++;
         }
       result = G_IO_STATUS_EOF;
     }
@@ -785,6 +792,7 @@ log_proto_buffered_server_queued(LogProtoServer *s)
     {
       state->pending_buffer_end = 0;
       state->buffer_pos = state->pending_buffer_pos = 0;
+      self->buffer_generation++;
     }
   if (self->pos_tracking)
     {
@@ -88,6 +88,9 @@ struct _LogProtoBufferedServer
   PersistEntryHandle persist_handle;
   GIConv convert;
   guchar *buffer;
+  /* incremented whenever the contents of @buffer is discarded, lets
+   * descendant classes invalidate offsets they cached into it */
+  guint32 buffer_generation;
 
   /* auxiliary data (e.g. GSockAddr, other transport related meta
    * data) associated with the already buffered data */
@@ -35,6 +35,7 @@
  * name */
 
 DEFINE_LOG_PROTO_SERVER(log_proto_dgram);
+DEFINE_LOG_PROTO_CLIENT(log_proto_dgram);
 DEFINE_LOG_PROTO_CLIENT(log_proto_text);
 DEFINE_LOG_PROTO_SERVER(log_proto_text);
 DEFINE_LOG_PROTO_SERVER(log_proto_indented_multiline);
@@ -43,8 +44,8 @@ DEFINE_LOG_PROTO_SERVER(log_proto_framed);
 
 static Plugin framed_server_plugins[] =
 {
-  /* there's no separate client side for the 'dgram' transport */
-  LOG_PROTO_CLIENT_PLUGIN(log_proto_text, "dgram"),
+  /* the 'dgram' client is the text one, without coalescing writes */
+  LOG_PROTO_CLIENT_PLUGIN(log_proto_dgram, "dgram"),
   LOG_PROTO_SERVER_PLUGIN(log_proto_dgram, "dgram"),
   LOG_PROTO_CLIENT_PLUGIN(log_proto_text, "text"),
   LOG_PROTO_SERVER_PLUGIN(log_proto_text, "text"),
@@ -57,6 +57,9 @@ struct _LogProtoClient
   gboolean (*prepare)(LogProtoClient *s, gint *fd, GIOCondition *cond);
   LogProtoStatus (*post)(LogProtoClient *s, guchar *msg, gsize msg_len, gboolean *consumed);
   LogProtoStatus (*flush)(LogProtoClient *s);
+  /* number of posted (consumed) messages that are not yet completely
+   * written to the transport, NULL if messages are written right away */
+  gint (*get_pending_messages)(LogProtoClient *s);
   gboolean (*validate_options)(LogProtoClient *s);
   void (*free_fn)(LogProtoClient *s);
 };
@@ -91,6 +94,15 @@ log_proto_client_post(LogProtoClient *s, guchar *msg, gsize msg_len, gboolean *c
   return s->post(s, msg, msg_len, consumed);
 }
 
+static inline gint
+log_proto_client_get_pending_messages(LogProtoClient *s)
+{
+  if (s->get_pending_messages)
+    return s->get_pending_messages(s);
+  else
+    return 0;
+}
+
 static inline gint
 log_proto_client_get_fd(LogProtoClient *s)
 {
@@ -107,6 +119,7 @@ log_proto_client_reset_error(LogProtoClient *s)
 gboolean log_proto_client_validate_options(LogProtoClient *self);
 void log_proto_client_init(LogProtoClient *s, LogTransport *transport, const LogProtoClientOptions *options);
 void log_proto_client_free(LogProtoClient *s);
+void log_proto_client_free_method(LogProtoClient *s);
 
 #define DEFINE_LOG_PROTO_CLIENT(prefix) \
   static gpointer                                                       \
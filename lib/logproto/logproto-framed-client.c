@@ -39,7 +39,7 @@ log_proto_framed_client_post(LogProtoClient *s, guchar *msg, gsize msg_len, gboo
 {
   LogProtoFramedClient *self = (LogProtoFramedClient *) s;
   gint frame_hdr_len;
-  gint rc;
+  LogProtoStatus rc;
 
   if (msg_len > 9999999)
     {
@@ -55,6 +55,19 @@ log_proto_framed_client_post(LogProtoClient *s, guchar *msg, gsize msg_len, gboo
       msg_len = 9999999;
     }
 
+  if (self->super.state == LPFCS_FRAME_SEND && self->super.partial == NULL)
+    {
+      /* the frame header is coalesced together with the message */
+      frame_hdr_len = g_snprintf((gchar *) self->frame_hdr_buf, sizeof(self->frame_hdr_buf), "%" G_GSIZE_FORMAT" ", msg_len);
+      if (log_proto_text_client_buffer_message(&self->super, self->frame_hdr_buf, frame_hdr_len, msg, msg_len, &rc))
+        {
+          *consumed = TRUE;
+          return rc;
+        }
+      if (rc != LPS_SUCCESS)
+        return rc;
+    }
+
   rc = LPS_SUCCESS;
   while (rc == LPS_SUCCESS && !(*consumed) && self->super.partial == NULL)
     {
@@ -62,11 +75,11 @@ log_proto_framed_client_post(LogProtoClient *s, guchar *msg, gsize msg_len, gboo
         {
         case LPFCS_FRAME_SEND:
           frame_hdr_len = g_snprintf((gchar *) self->frame_hdr_buf, sizeof(self->frame_hdr_buf), "%" G_GSIZE_FORMAT" ", msg_len);
-          rc = log_proto_text_client_submit_write(s, self->frame_hdr_buf, frame_hdr_len, NULL, LPFCS_MESSAGE_SEND);
+          rc = log_proto_text_client_submit_write(s, self->frame_hdr_buf, frame_hdr_len, NULL, 0, LPFCS_MESSAGE_SEND);
           break;
         case LPFCS_MESSAGE_SEND:
           *consumed = TRUE;
-          rc = log_proto_text_client_submit_write(s, msg, msg_len, (GDestroyNotify) g_free, LPFCS_FRAME_SEND);
+          rc = log_proto_text_client_submit_write(s, msg, msg_len, (GDestroyNotify) g_free, 1, LPFCS_FRAME_SEND);
           break;
         default:
           g_assert_not_reached();
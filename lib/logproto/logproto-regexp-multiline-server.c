@@ -20,9 +20,9 @@
 #include "logproto-regexp-multiline-server.h"
 #include "messages.h"
 #include "misc.h"
+#include "logmatcher-pcre.h"
 
 #include <string.h>
-#include <pcre.h>
 
 struct _MultiLineRegexp
 {
@@ -34,7 +34,6 @@ MultiLineRegexp *
 multi_line_regexp_compile(const gchar *regexp, GError **error)
 {
   MultiLineRegexp *self = g_new0(MultiLineRegexp, 1);
-  gint optflags = 0;
   gint rc;
   const gchar *errptr;
   gint erroffset;
@@ -49,12 +48,8 @@ multi_line_regexp_compile(const gchar *regexp, GError **error)
       goto error;
     }
 
-#ifdef PCRE_STUDY_JIT_COMPILE
-  optflags = PCRE_STUDY_JIT_COMPILE;
-#endif
-
   /* optimize regexp */
-  self->extra = pcre_study(self->pattern, optflags, &errptr);
+  self->extra = log_matcher_pcre_study(self->pattern, log_matcher_pcre_is_jit_enabled(), &errptr);
   if (errptr != NULL)
     {
       g_set_error(error, 0, 0, "Error while studying multi-line regexp, error=%s", errptr);
@@ -76,8 +71,7 @@ multi_line_regexp_free(MultiLineRegexp *self)
     {
       if (self->pattern)
         pcre_free(self->pattern);
-      if (self->extra)
-        pcre_free(self->extra);
+      log_matcher_pcre_free_study(self->extra);
       g_free(self);
     }
 }
@@ -26,6 +26,7 @@
 #define LOGPROTO_SERVER_H_INCLUDED
 
 #include "logproto.h"
+#include "find-eom.h"
 #include "persist-state.h"
 #include "transport/transport-aux-data.h"
 
@@ -177,6 +178,4 @@ log_proto_server_factory_construct(LogProtoServerFactory *self, LogTransport *tr
 
 LogProtoServerFactory *log_proto_server_get_factory(GlobalConfig *cfg, const gchar *name);
 
-const guchar *find_eom(const guchar *s, gsize n);
-
 #endif
@@ -24,6 +24,11 @@
 #include "logproto-text-client.h"
 #include "messages.h"
 
+#include <string.h>
+
+/* the largest TLS record, so that a coalesced write maps to a single record */
+#define LOG_PROTO_TEXT_CLIENT_BUFFER_SIZE 16384
+
 static gboolean
 log_proto_text_client_prepare(LogProtoClient *s, gint *fd, GIOCondition *cond)
 {
@@ -35,11 +40,11 @@ log_proto_text_client_prepare(LogProtoClient *s, gint *fd, GIOCondition *cond)
   /* if there's no pending I/O in the transport layer, then we want to do a write */
   if (*cond == 0)
     *cond = G_IO_OUT;
-  return self->partial != NULL;
+  return self->partial != NULL || self->buffer_len > 0;
 }
 
 static LogProtoStatus
-log_proto_text_client_flush(LogProtoClient *s)
+log_proto_text_client_flush_partial(LogProtoClient *s)
 {
   LogProtoTextClient *self = (LogProtoTextClient *) s;
   gint rc;
@@ -72,6 +77,7 @@ log_proto_text_client_flush(LogProtoClient *s)
           if (self->partial_free)
             self->partial_free(self->partial);
           self->partial = NULL;
+          self->partial_messages = 0;
           if (self->next_state >= 0)
             {
               self->state = self->next_state;
@@ -84,8 +90,84 @@ log_proto_text_client_flush(LogProtoClient *s)
   return LPS_SUCCESS;
 }
 
+/* writes out the coalesced messages, whatever is left becomes the partial buffer */
+static LogProtoStatus
+log_proto_text_client_flush_buffer(LogProtoTextClient *self)
+{
+  guchar *buffer = self->buffer;
+  gsize buffer_len = self->buffer_len;
+  gint buffer_messages = self->buffer_messages;
+
+  if (buffer_len == 0)
+    return LPS_SUCCESS;
+
+  self->buffer = NULL;
+  self->buffer_len = 0;
+  self->buffer_messages = 0;
+  return log_proto_text_client_submit_write(&self->super, buffer, buffer_len, (GDestroyNotify) g_free, buffer_messages, -1);
+}
+
+static LogProtoStatus
+log_proto_text_client_flush(LogProtoClient *s)
+{
+  LogProtoTextClient *self = (LogProtoTextClient *) s;
+  LogProtoStatus rc;
+
+  rc = log_proto_text_client_flush_partial(s);
+  if (rc != LPS_SUCCESS || self->partial)
+    return rc;
+  return log_proto_text_client_flush_buffer(self);
+}
+
+/*
+ * log_proto_text_client_buffer_message:
+ * @hdr: optional frame header to precede @msg
+ * @msg: formatted log message, freed if it was added to the buffer
+ * @rc: status of writing out the buffer, if it had to be done
+ *
+ * Appends the message to the output buffer, so that messages posted in a
+ * row are written using a single write() (or SSL_write()) call.  The buffer
+ * is written out once it gets full or when LogWriter flushes the
+ * protocol, e.g. when there are no more messages in the queue.
+ *
+ * Returns FALSE if the message was not buffered, in this case the output
+ * buffer is empty and the caller either has to write @msg directly or,
+ * if a partial write is pending, retry later.
+ */
+gboolean
+log_proto_text_client_buffer_message(LogProtoTextClient *self, const guchar *hdr, gsize hdr_len,
+                                     guchar *msg, gsize msg_len, LogProtoStatus *rc)
+{
+  gsize len = hdr_len + msg_len;
+
+  *rc = LPS_SUCCESS;
+  if (self->buffer_size == 0 || self->partial)
+    return FALSE;
+
+  if (self->buffer_len + len > self->buffer_size)
+    {
+      *rc = log_proto_text_client_flush_buffer(self);
+      if (*rc != LPS_SUCCESS || self->partial || len > self->buffer_size)
+        return FALSE;
+    }
+
+  if (!self->buffer)
+    self->buffer = g_malloc(self->buffer_size);
+  memcpy(self->buffer + self->buffer_len, hdr, hdr_len);
+  memcpy(self->buffer + self->buffer_len + hdr_len, msg, msg_len);
+  self->buffer_len += len;
+  self->buffer_messages++;
+  g_free(msg);
+  return TRUE;
+}
+
+/*
+ * @messages: the number of log messages contained in @msg, these are
+ * reported as pending until @msg is completely written
+ */
 LogProtoStatus
-log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len, GDestroyNotify msg_free, gint next_state)
+log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len, GDestroyNotify msg_free,
+                                   gint messages, gint next_state)
 {
   LogProtoTextClient *self = (LogProtoTextClient *) s;
 
@@ -94,8 +176,9 @@ log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len
   self->partial_len = msg_len;
   self->partial_pos = 0;
   self->partial_free = msg_free;
+  self->partial_messages = messages;
   self->next_state = next_state;
-  return log_proto_text_client_flush(s);
+  return log_proto_text_client_flush_partial(s);
 }
 
 
@@ -114,11 +197,11 @@ static LogProtoStatus
 log_proto_text_client_post(LogProtoClient *s, guchar *msg, gsize msg_len, gboolean *consumed)
 {
   LogProtoTextClient *self = (LogProtoTextClient *) s;
-  gint rc;
+  LogProtoStatus rc;
 
   /* try to flush already buffered data */
   *consumed = FALSE;
-  rc = log_proto_text_client_flush(s);
+  rc = log_proto_text_client_flush_partial(s);
   if (rc == LPS_ERROR)
     {
       /* log_proto_flush() already logs in the case of an error */
@@ -141,8 +224,35 @@ log_proto_text_client_post(LogProtoClient *s, guchar *msg, gsize msg_len, gboole
       return rc;
     }
 
+  if (log_proto_text_client_buffer_message(self, NULL, 0, msg, msg_len, &rc))
+    {
+      *consumed = TRUE;
+      return rc;
+    }
+  if (rc != LPS_SUCCESS || self->partial)
+    return rc;
+
   *consumed = TRUE;
-  return log_proto_text_client_submit_write(s, msg, msg_len, (GDestroyNotify) g_free, -1);
+  return log_proto_text_client_submit_write(s, msg, msg_len, (GDestroyNotify) g_free, 1, -1);
+}
+
+static gint
+log_proto_text_client_get_pending_messages(LogProtoClient *s)
+{
+  LogProtoTextClient *self = (LogProtoTextClient *) s;
+
+  return (self->partial ? self->partial_messages : 0) + self->buffer_messages;
+}
+
+static void
+log_proto_text_client_free(LogProtoClient *s)
+{
+  LogProtoTextClient *self = (LogProtoTextClient *) s;
+
+  if (self->partial && self->partial_free)
+    self->partial_free(self->partial);
+  g_free(self->buffer);
+  log_proto_client_free_method(s);
 }
 
 void
@@ -152,8 +262,11 @@ log_proto_text_client_init(LogProtoTextClient *self, LogTransport *transport, co
   self->super.prepare = log_proto_text_client_prepare;
   self->super.flush = log_proto_text_client_flush;
   self->super.post = log_proto_text_client_post;
+  self->super.get_pending_messages = log_proto_text_client_get_pending_messages;
+  self->super.free_fn = log_proto_text_client_free;
   self->super.transport = transport;
   self->next_state = -1;
+  self->buffer_size = LOG_PROTO_TEXT_CLIENT_BUFFER_SIZE;
 }
 
 LogProtoClient *
@@ -164,3 +277,14 @@ log_proto_text_client_new(LogTransport *transport, const LogProtoClientOptions *
   log_proto_text_client_init(self, transport, options);
   return &self->super;
 }
+
+/* each message is sent as a separate datagram, so they are never coalesced */
+LogProtoClient *
+log_proto_dgram_client_new(LogTransport *transport, const LogProtoClientOptions *options)
+{
+  LogProtoTextClient *self = g_new0(LogProtoTextClient, 1);
+
+  log_proto_text_client_init(self, transport, options);
+  self->buffer_size = 0;
+  return &self->super;
+}
@@ -33,11 +33,21 @@ typedef struct _LogProtoTextClient
   guchar *partial;
   GDestroyNotify partial_free;
   gsize partial_len, partial_pos;
+  /* the number of messages contained in partial */
+  gint partial_messages;
+  /* messages waiting to be written out together, 0 size disables coalescing */
+  guchar *buffer;
+  gsize buffer_len, buffer_size;
+  gint buffer_messages;
 } LogProtoTextClient;
 
-LogProtoStatus log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len, GDestroyNotify msg_free, gint next_state);
+LogProtoStatus log_proto_text_client_submit_write(LogProtoClient *s, guchar *msg, gsize msg_len, GDestroyNotify msg_free,
+                                                  gint messages, gint next_state);
+gboolean log_proto_text_client_buffer_message(LogProtoTextClient *self, const guchar *hdr, gsize hdr_len,
+                                              guchar *msg, gsize msg_len, LogProtoStatus *rc);
 void log_proto_text_client_init(LogProtoTextClient *self, LogTransport *transport, const LogProtoClientOptions *options);
 LogProtoClient *log_proto_text_client_new(LogTransport *transport, const LogProtoClientOptions *options);
+LogProtoClient *log_proto_dgram_client_new(LogTransport *transport, const LogProtoClientOptions *options);
 
 #define log_proto_text_client_free_method log_proto_client_free_method
 
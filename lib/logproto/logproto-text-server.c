@@ -188,6 +188,58 @@ log_proto_text_server_accumulate_line_method(LogProtoTextServer *self, const guc
   return LPT_CONSUME_LINE | LPT_EXTRACTED;
 }
 
+static void
+log_proto_text_server_fill_eol_cache(LogProtoTextServer *self, guint32 start, guint32 end)
+{
+  gsize i, count;
+
+  count = find_all_eom(self->super.buffer + start, end - start, self->eol_cache, LPT_EOL_CACHE_SIZE);
+  for (i = 0; i < count; i++)
+    self->eol_cache[i] += start;
+
+  self->eol_cache_len = count;
+  self->eol_cache_ndx = 0;
+  if (count == LPT_EOL_CACHE_SIZE)
+    self->eol_cache_end = self->eol_cache[count - 1] + 1;
+  else
+    self->eol_cache_end = end;
+}
+
+/*
+ * Find the first EOL in the [start, end) range of the buffer.  The EOLs
+ * are looked up in bulk as data arrives, so subsequent lookups for the
+ * lines of the same read are answered from the cache.
+ */
+static const guchar *
+log_proto_text_server_find_eol(LogProtoTextServer *self, guint32 start, guint32 end)
+{
+  if (self->eol_cache_generation != self->super.buffer_generation ||
+      start < self->eol_cache_query_pos)
+    {
+      self->eol_cache_len = self->eol_cache_ndx = 0;
+      self->eol_cache_end = start;
+      self->eol_cache_generation = self->super.buffer_generation;
+    }
+  self->eol_cache_query_pos = start;
+
+  while (1)
+    {
+      while (self->eol_cache_ndx < self->eol_cache_len &&
+             self->eol_cache[self->eol_cache_ndx] < start)
+        self->eol_cache_ndx++;
+
+      if (self->eol_cache_ndx < self->eol_cache_len)
+        {
+          guint32 eol = self->eol_cache[self->eol_cache_ndx];
+
+          return eol < end ? self->super.buffer + eol : NULL;
+        }
+      if (self->eol_cache_end >= end)
+        return NULL;
+      log_proto_text_server_fill_eol_cache(self, MAX(start, self->eol_cache_end), end);
+    }
+}
+
 static void
 log_proto_text_server_split_buffer(LogProtoTextServer *self, LogProtoBufferedServerState *state, const guchar *buffer_start, gsize buffer_bytes)
 {
@@ -200,6 +252,7 @@ log_proto_text_server_split_buffer(LogProtoTextServer *self, LogProtoBufferedSer
   memmove(self->super.buffer, buffer_start, buffer_bytes);
   state->pending_buffer_pos = 0;
   state->pending_buffer_end = buffer_bytes;
+  self->super.buffer_generation++;
 
   if (G_UNLIKELY(self->super.pos_tracking))
     {
@@ -242,7 +295,7 @@ log_proto_text_server_try_extract(LogProtoTextServer *self, LogProtoBufferedServ
        * read further data, or the buffer already contains a
        * complete line */
 
-      eom = find_eom(self->super.buffer + next_line_pos, state->pending_buffer_end - next_line_pos);
+      eom = log_proto_text_server_find_eol(self, next_line_pos, state->pending_buffer_end);
       if (eom)
         next_eol_pos = eom - self->super.buffer;
     }
@@ -353,7 +406,9 @@ log_proto_text_server_locate_next_eol(LogProtoTextServer *self, LogProtoBuffered
     }
   else
     {
-      eol = find_eom(buffer_start + self->consumed_len + 1, buffer_bytes - self->consumed_len - 1);
+      eol = log_proto_text_server_find_eol(self,
+                                           buffer_start + self->consumed_len + 1 - self->super.buffer,
+                                           buffer_start + buffer_bytes - self->super.buffer);
     }
   return eol;
 }
@@ -38,6 +38,8 @@ enum
 #define LPT_CONSUME_PARTIAL_AMOUNT_MASK      ~0xFF
 #define LPT_CONSUME_PARTIALLY(drop_length) (LPT_CONSUME_LINE | ((drop_length) << LPT_CONSUME_PARTIAL_AMOUNT_SHIFT))
 
+#define LPT_EOL_CACHE_SIZE 256
+
 typedef struct _LogProtoTextServer LogProtoTextServer;
 struct _LogProtoTextServer
 {
@@ -55,6 +57,17 @@ struct _LogProtoTextServer
 
   gint32 consumed_len;
   gint32 cached_eol_pos;
+
+  /* EOL offsets (relative to the start of the buffer) found by a single
+   * find_all_eom() pass over freshly read data.  The cache covers the
+   * buffer up to eol_cache_end and is only valid while the buffer
+   * generation matches. */
+  guint32 eol_cache[LPT_EOL_CACHE_SIZE];
+  guint32 eol_cache_len;
+  guint32 eol_cache_ndx;
+  guint32 eol_cache_end;
+  guint32 eol_cache_query_pos;
+  guint32 eol_cache_generation;
 };
 
 /* LogProtoTextServer
@@ -0,0 +1,90 @@
+#include "mock-transport.h"
+#include "proto_lib.h"
+#include "logproto/logproto-framed-client.h"
+
+#include <string.h>
+
+/****************************************************************************************
+ * LogProtoFramedClient
+ ****************************************************************************************/
+
+static LogProtoClientOptionsStorage proto_client_options;
+
+static void
+test_log_proto_framed_client_coalesces_writes(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClient *proto = log_proto_framed_client_new(transport, &proto_client_options.super);
+
+  assert_proto_client_post(proto, "foo", TRUE);
+  assert_proto_client_post(proto, "barbaz", TRUE);
+  assert_gint(log_proto_client_get_pending_messages(proto), 2, "coalesced messages are not reported as pending");
+
+  assert_proto_client_flush_all(proto);
+  assert_gint(log_transport_mock_writer_get_write_count(transport), 1, "frame headers and messages were not written at once");
+  assert_string(log_transport_mock_writer_get_output(transport)->str, "3 foo6 barbaz", "written data mismatch");
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_framed_client_short_writes(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(2);
+  LogProtoClient *proto = log_proto_framed_client_new(transport, &proto_client_options.super);
+
+  assert_proto_client_post(proto, "foo", TRUE);
+  assert_proto_client_post(proto, "barbaz", TRUE);
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+  assert_proto_client_post(proto, "qux", FALSE);
+
+  assert_proto_client_flush_all(proto);
+  assert_proto_client_post(proto, "qux", TRUE);
+  assert_proto_client_flush_all(proto);
+  assert_string(log_transport_mock_writer_get_output(transport)->str, "3 foo6 barbaz3 qux", "written data mismatch");
+  log_proto_client_free(proto);
+}
+
+/* messages larger than the coalescing buffer are written with a separate
+ * frame header, which must not be split from its message by a short write */
+static void
+test_log_proto_framed_client_short_writes_of_large_message(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(4096);
+  LogProtoClient *proto = log_proto_framed_client_new(transport, &proto_client_options.super);
+  gchar *large = g_malloc(20001);
+  gchar *expected;
+  gboolean consumed = FALSE;
+
+  memset(large, 'x', 20000);
+  large[20000] = 0;
+  expected = g_strdup_printf("3 foo20000 %s3 bar", large);
+
+  assert_proto_client_post(proto, "foo", TRUE);
+  while (!consumed)
+    {
+      guchar *msg = (guchar *) g_strdup(large);
+
+      assert_gint(log_proto_client_post(proto, msg, 20000, &consumed), LPS_SUCCESS, "post failed");
+      if (!consumed)
+        {
+          g_free(msg);
+          assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+        }
+    }
+  assert_proto_client_flush_all(proto);
+  assert_proto_client_post(proto, "bar", TRUE);
+  assert_proto_client_flush_all(proto);
+
+  assert_string(log_transport_mock_writer_get_output(transport)->str, expected, "written data mismatch");
+  g_free(expected);
+  g_free(large);
+  log_proto_client_free(proto);
+}
+
+void
+test_log_proto_framed_client(void)
+{
+  PROTO_TESTCASE(test_log_proto_framed_client_coalesces_writes);
+  PROTO_TESTCASE(test_log_proto_framed_client_short_writes);
+  PROTO_TESTCASE(test_log_proto_framed_client_short_writes_of_large_message);
+}
@@ -0,0 +1,104 @@
+#include "mock-transport.h"
+#include "proto_lib.h"
+#include "logproto/logproto-text-client.h"
+
+#include <string.h>
+
+/****************************************************************************************
+ * LogProtoTextClient
+ ****************************************************************************************/
+
+static LogProtoClientOptionsStorage proto_client_options;
+
+static void
+test_log_proto_text_client_coalesces_writes(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClient *proto = log_proto_text_client_new(transport, &proto_client_options.super);
+
+  assert_proto_client_post(proto, "foo\n", TRUE);
+  assert_proto_client_post(proto, "bar\n", TRUE);
+  assert_proto_client_post(proto, "baz\n", TRUE);
+
+  /* consumed, but nothing was written yet, so they may not be acked */
+  assert_gint(log_proto_client_get_pending_messages(proto), 3, "coalesced messages are not reported as pending");
+  assert_gint(log_transport_mock_writer_get_write_count(transport), 0, "coalesced messages were written early");
+
+  assert_proto_client_flush_all(proto);
+  assert_gint(log_transport_mock_writer_get_write_count(transport), 1, "coalesced messages were not written at once");
+  assert_string(log_transport_mock_writer_get_output(transport)->str, "foo\nbar\nbaz\n", "written data mismatch");
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_text_client_writes_full_buffer(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClient *proto = log_proto_text_client_new(transport, &proto_client_options.super);
+  GString *expected = g_string_new("");
+  gchar line[1001];
+  gint i;
+
+  memset(line, 'x', sizeof(line) - 2);
+  line[sizeof(line) - 2] = '\n';
+  line[sizeof(line) - 1] = 0;
+
+  /* 16 lines fit into the buffer, the 17th triggers a write */
+  for (i = 0; i < 17; i++)
+    {
+      assert_proto_client_post(proto, line, TRUE);
+      g_string_append(expected, line);
+    }
+  assert_gint(log_transport_mock_writer_get_write_count(transport), 1, "full buffer was not written");
+  assert_gint(log_proto_client_get_pending_messages(proto), 1, "written messages are still reported as pending");
+
+  assert_proto_client_flush_all(proto);
+  assert_nstring(log_transport_mock_writer_get_output(transport)->str, log_transport_mock_writer_get_output(transport)->len,
+                 expected->str, expected->len, "written data mismatch");
+  g_string_free(expected, TRUE);
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_text_client_short_writes(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(3);
+  LogProtoClient *proto = log_proto_text_client_new(transport, &proto_client_options.super);
+
+  assert_proto_client_post(proto, "foo\n", TRUE);
+  assert_proto_client_post(proto, "bar\n", TRUE);
+  assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "flush failed");
+
+  /* the buffer was only partially written, the next message has to wait */
+  assert_gint(log_proto_client_get_pending_messages(proto), 2, "partially written messages are not pending");
+  assert_proto_client_post(proto, "baz\n", FALSE);
+
+  assert_proto_client_flush_all(proto);
+  assert_proto_client_post(proto, "baz\n", TRUE);
+  assert_proto_client_flush_all(proto);
+  assert_string(log_transport_mock_writer_get_output(transport)->str, "foo\nbar\nbaz\n", "written data mismatch");
+  log_proto_client_free(proto);
+}
+
+static void
+test_log_proto_dgram_client_does_not_coalesce(void)
+{
+  LogTransport *transport = log_transport_mock_writer_new(0);
+  LogProtoClient *proto = log_proto_dgram_client_new(transport, &proto_client_options.super);
+
+  assert_proto_client_post(proto, "foo\n", TRUE);
+  assert_gint(log_proto_client_get_pending_messages(proto), 0, "datagram was not written right away");
+  assert_proto_client_post(proto, "bar\n", TRUE);
+  assert_gint(log_transport_mock_writer_get_write_count(transport), 2, "datagrams were coalesced");
+  assert_string(log_transport_mock_writer_get_output(transport)->str, "foo\nbar\n", "written data mismatch");
+  log_proto_client_free(proto);
+}
+
+void
+test_log_proto_text_client(void)
+{
+  PROTO_TESTCASE(test_log_proto_text_client_coalesces_writes);
+  PROTO_TESTCASE(test_log_proto_text_client_writes_full_buffer);
+  PROTO_TESTCASE(test_log_proto_text_client_short_writes);
+  PROTO_TESTCASE(test_log_proto_dgram_client_does_not_coalesce);
+}
@@ -8,5 +8,7 @@ void test_log_proto_indented_multiline_server(void);
 void test_log_proto_regexp_multiline_server(void);
 void test_log_proto_dgram_server(void);
 void test_log_proto_framed_server(void);
+void test_log_proto_text_client(void);
+void test_log_proto_framed_client(void);
 
 #endif
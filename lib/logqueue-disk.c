@@ -0,0 +1,961 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logqueue-disk.h"
+#include "logpipe.h"
+#include "messages.h"
+#include "serialize.h"
+#include "persistable-state-header.h"
+#include "stats/stats-registry.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * LogQueueDisk is a LogQueue implementation that stores every message in
+ * a file, so that the contents of the queue survives reloads and
+ * restarts.
+ *
+ * The file is used as a ring of records, each record is a 32 bit length
+ * (in network byte order, including the length field itself) followed
+ * by the message as serialized by log_msg_write().  The first
+ * QDISK_RESERVED_SPACE bytes hold a small header that identifies the
+ * file.  The following positions describe the state of the queue:
+ *
+ *   - backlog_head: the first record that was not acknowledged yet
+ *   - read_head: the first record that was not read yet
+ *   - write_head: the position where the next record will be written
+ *   - file_end: the position where the writer wrapped around the last
+ *     time, only meaningful while write_head < read_head/backlog_head
+ *
+ * These positions are kept in PersistState, so that the queue is resumed
+ * at the right place once syslog-ng restarts.  Messages that were read but
+ * not acked are delivered again after a restart.
+ *
+ * The state is saved by every push_tail(), as the record is acked towards
+ * the source right away and the write position must not be lost.  The
+ * read side (pop_head/ack_backlog) only saves it after every
+ * QDISK_STATE_SAVE_INTERVAL operations or once the queue runs empty: a
+ * stale read position only causes messages to be delivered once more after
+ * a crash.  push_tail() saves pending read side changes before writing a
+ * record, so the saved read position never points to reused space.
+ *
+ * To avoid having to read messages back from disk in the common case, a
+ * limited number (mem_buf_length) of recently written messages are also
+ * kept in memory (qcache), along with the position of their record.  If
+ * the record at read_head is at the front of the cache, the message is
+ * taken from there, otherwise it is read back from the file.
+ *
+ * Messages pushed back to the front with push_head() are not written to
+ * disk, they are only kept in the cache with a negative position.
+ *
+ * Flow-control: as soon as a message hits the disk, it is considered
+ * safe and is acknowledged towards its source.
+ *
+ * Latency histograms: the enqueue time is not part of the record, only
+ * messages taken from the cache have their queue latency recorded.
+ * Delivery and end-to-end latencies are recorded for every message.
+ *
+ * Durability limits:
+ *   - "hits the disk" means the record was handed over to the kernel with
+ *     pwrite(), there's no fsync(), so records survive a crash of
+ *     syslog-ng but not a crash of the OS or a power failure
+ *   - the disk space of a record is released as soon as it is popped
+ *     without push_to_backlog (as LogWriter does), so such a message only
+ *     lives in memory until it is delivered
+ *   - messages pushed back with push_head() also live only in memory;
+ *     they are kept across reloads (see keep_on_reload), but are lost if
+ *     syslog-ng is stopped or crashes before delivering them
+ * Destinations that need at-least-once delivery across restarts must pop
+ * with push_to_backlog set and ack/rewind the backlog.
+ *
+ * Threading: all operations are protected by super.lock, as the file
+ * positions are shared between the input and the output threads.
+ */
+
+#define QDISK_RESERVED_SPACE 16
+#define QDISK_FILE_MAGIC "SLQF"
+#define QDISK_FILE_VERSION 1
+#define QDISK_STATE_VERSION 1
+/* number of read side operations after which the state is saved */
+#define QDISK_STATE_SAVE_INTERVAL 100
+
+typedef struct _LogQueueDiskState
+{
+  PersistableStateHeader header;
+  gint64 backlog_head;
+  gint64 read_head;
+  gint64 write_head;
+  gint64 file_end;
+  /* number of records between read_head and write_head */
+  gint64 length;
+  /* number of records between backlog_head and read_head */
+  gint64 backlog_len;
+} LogQueueDiskState;
+
+typedef struct _LogQueueDiskNode
+{
+  struct iv_list_head list;
+  LogMessage *msg;
+  /* position & length of the record in the file, pos is -1 if the
+   * message is not stored on disk */
+  gint64 pos;
+  guint32 len;
+  /* latency tracking, see log_queue_item_enqueued(), 0 for records read
+   * back from disk as their enqueue time is not stored */
+  guint64 timestamp;
+} LogQueueDiskNode;
+
+typedef struct _LogQueueDisk
+{
+  LogQueue super;
+
+  gchar *filename;
+  gint fd;
+  gint64 disk_buf_size;
+  gint mem_buf_length;
+
+  PersistState *persist_state;
+  PersistEntryHandle persist_handle;
+
+  gint64 backlog_head;
+  gint64 read_head;
+  gint64 write_head;
+  gint64 file_end;
+  gint64 length;
+  /* read side operations since the state was last saved */
+  gint state_unsaved;
+
+  /* messages in front of the queue, either read-ahead copies of records
+   * or items pushed back by push_head() (pos < 0) */
+  struct iv_list_head qcache;
+  gint qcache_len;
+  gint qpushback_len;
+
+  /* entries that were sent but not acked yet */
+  struct iv_list_head qbacklog;
+  gint qbacklog_len;
+  gint qbacklog_disk_len;
+
+  GString *record;
+} LogQueueDisk;
+
+static LogQueueDiskNode *
+log_queue_disk_node_new(LogMessage *msg, gint64 pos, guint32 len)
+{
+  LogQueueDiskNode *node = g_slice_new(LogQueueDiskNode);
+
+  INIT_IV_LIST_HEAD(&node->list);
+  node->msg = msg;
+  node->pos = pos;
+  node->len = len;
+  node->timestamp = 0;
+  return node;
+}
+
+static void
+log_queue_disk_node_free(LogQueueDiskNode *node)
+{
+  g_slice_free(LogQueueDiskNode, node);
+}
+
+static void
+log_queue_disk_save_state(LogQueueDisk *self)
+{
+  LogQueueDiskState *state;
+
+  state = persist_state_map_entry(self->persist_state, self->persist_handle);
+  state->header.version = QDISK_STATE_VERSION;
+  state->header.big_endian = (G_BYTE_ORDER == G_BIG_ENDIAN);
+  state->backlog_head = self->backlog_head;
+  state->read_head = self->read_head;
+  state->write_head = self->write_head;
+  state->file_end = self->file_end;
+  state->length = self->length;
+  state->backlog_len = self->qbacklog_disk_len;
+  persist_state_unmap_entry(self->persist_state, self->persist_handle);
+  self->state_unsaved = 0;
+}
+
+/* called by the read side, which saves the state in batches */
+static void
+log_queue_disk_read_state_changed(LogQueueDisk *self)
+{
+  self->state_unsaved++;
+  if (self->state_unsaved >= QDISK_STATE_SAVE_INTERVAL ||
+      (self->length == 0 && self->qbacklog_disk_len == 0))
+    log_queue_disk_save_state(self);
+}
+
+static void
+log_queue_disk_reset_positions(LogQueueDisk *self)
+{
+  self->backlog_head = self->read_head = self->write_head = QDISK_RESERVED_SPACE;
+  self->file_end = QDISK_RESERVED_SPACE;
+  self->length = 0;
+}
+
+/* wrap a read position around, once it reaches the point where the writer wrapped */
+static inline gint64
+log_queue_disk_normalize_pos(LogQueueDisk *self, gint64 pos)
+{
+  if (pos == self->file_end && self->write_head < pos)
+    return QDISK_RESERVED_SPACE;
+  return pos;
+}
+
+/* backlog_head is the position of the oldest record in the backlog, or read_head if there's none */
+static void
+log_queue_disk_update_backlog_head(LogQueueDisk *self)
+{
+  struct iv_list_head *lh;
+
+  iv_list_for_each(lh, &self->qbacklog)
+    {
+      LogQueueDiskNode *node = iv_list_entry(lh, LogQueueDiskNode, list);
+
+      if (node->pos >= 0)
+        {
+          self->backlog_head = node->pos;
+          return;
+        }
+    }
+  self->backlog_head = self->read_head;
+}
+
+/*
+ * Checks whether a record of @len bytes fits in the file and returns the
+ * position where it can be written.  Wraps the writer around if
+ * necessary.  Returns -1 if the queue is full.
+ */
+static gint64
+log_queue_disk_reserve(LogQueueDisk *self, gint64 len)
+{
+  if (self->length == 0 && self->backlog_head == self->write_head)
+    {
+      /* no live records on disk, start over at the beginning of the file */
+      log_queue_disk_reset_positions(self);
+    }
+
+  if (self->write_head >= self->backlog_head)
+    {
+      if (self->write_head + len <= self->disk_buf_size)
+        return self->write_head;
+
+      /* the writer must never catch up with backlog_head, as that would
+       * make a full queue indistinguishable from an empty one */
+      if (QDISK_RESERVED_SPACE + len < self->backlog_head)
+        {
+          self->file_end = self->write_head;
+          self->write_head = QDISK_RESERVED_SPACE;
+          /* the reader may have been waiting at the old end of the file */
+          self->read_head = log_queue_disk_normalize_pos(self, self->read_head);
+          return self->write_head;
+        }
+      return -1;
+    }
+
+  if (self->write_head + len < self->backlog_head)
+    return self->write_head;
+  return -1;
+}
+
+static gboolean
+log_queue_disk_serialize_msg(LogQueueDisk *self, LogMessage *msg)
+{
+  SerializeArchive *sa;
+  guint32 n;
+  gboolean success;
+
+  g_string_truncate(self->record, 0);
+  g_string_append_len(self->record, "\0\0\0\0", sizeof(n));
+
+  sa = serialize_string_archive_new(self->record);
+  success = log_msg_write(msg, sa);
+  serialize_archive_free(sa);
+
+  n = GUINT32_TO_BE(self->record->len);
+  memcpy(self->record->str, &n, sizeof(n));
+  return success;
+}
+
+static gboolean
+log_queue_disk_pwrite(LogQueueDisk *self, const gchar *buf, gsize len, gint64 pos)
+{
+  gssize rc;
+
+  while (len > 0)
+    {
+      rc = pwrite(self->fd, buf, len, pos);
+      if (rc < 0 && errno == EINTR)
+        continue;
+      if (rc <= 0)
+        {
+          msg_error("Error writing disk-buffer file",
+                    evt_tag_str("filename", self->filename),
+                    evt_tag_errno("error", errno),
+                    NULL);
+          return FALSE;
+        }
+      buf += rc;
+      len -= rc;
+      pos += rc;
+    }
+  return TRUE;
+}
+
+static gboolean
+log_queue_disk_pread(LogQueueDisk *self, gchar *buf, gsize len, gint64 pos)
+{
+  gssize rc;
+
+  while (len > 0)
+    {
+      rc = pread(self->fd, buf, len, pos);
+      if (rc < 0 && errno == EINTR)
+        continue;
+      if (rc <= 0)
+        {
+          msg_error("Error reading disk-buffer file",
+                    evt_tag_str("filename", self->filename),
+                    rc < 0 ? evt_tag_errno("error", errno) : evt_tag_str("error", "short read"),
+                    NULL);
+          return FALSE;
+        }
+      buf += rc;
+      len -= rc;
+      pos += rc;
+    }
+  return TRUE;
+}
+
+/* reads the record at read_head, returns a new node holding a reference to the message */
+static LogQueueDiskNode *
+log_queue_disk_read_record(LogQueueDisk *self)
+{
+  LogMessage *msg;
+  SerializeArchive *sa;
+  guint32 n, len;
+  gboolean success;
+
+  if (!log_queue_disk_pread(self, (gchar *) &n, sizeof(n), self->read_head))
+    return NULL;
+
+  len = GUINT32_FROM_BE(n);
+  if (len <= sizeof(n) || self->read_head + len > self->disk_buf_size)
+    {
+      msg_error("Invalid record length in disk-buffer file",
+                evt_tag_str("filename", self->filename),
+                evt_tag_int("length", len),
+                NULL);
+      return NULL;
+    }
+
+  g_string_set_size(self->record, len - sizeof(n));
+  if (!log_queue_disk_pread(self, self->record->str, len - sizeof(n), self->read_head + sizeof(n)))
+    return NULL;
+
+  msg = log_msg_new_empty();
+  sa = serialize_buffer_archive_new(self->record->str, self->record->len);
+  success = log_msg_read(msg, sa);
+  serialize_archive_free(sa);
+  if (!success)
+    {
+      msg_error("Error deserializing message from disk-buffer file",
+                evt_tag_str("filename", self->filename),
+                NULL);
+      log_msg_unref(msg);
+      return NULL;
+    }
+  return log_queue_disk_node_new(msg, self->read_head, len);
+}
+
+/* drops every record stored on disk, used when the file is found to be corrupted */
+static void
+log_queue_disk_drop_records(LogQueueDisk *self)
+{
+  struct iv_list_head *lh, *lh_next;
+
+  iv_list_for_each_safe(lh, lh_next, &self->qcache)
+    {
+      LogQueueDiskNode *node = iv_list_entry(lh, LogQueueDiskNode, list);
+
+      if (node->pos >= 0)
+        {
+          iv_list_del(&node->list);
+          self->qcache_len--;
+          log_msg_unref(node->msg);
+          log_queue_disk_node_free(node);
+        }
+    }
+  stats_counter_add(self->super.dropped_messages, self->length);
+  stats_counter_add(self->super.stored_messages, -self->length);
+
+  self->length = 0;
+  self->read_head = self->write_head;
+  log_queue_disk_update_backlog_head(self);
+  log_queue_disk_save_state(self);
+}
+
+static gint64
+log_queue_disk_get_length(LogQueue *s)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+
+  return self->length + self->qpushback_len;
+}
+
+/* NOTE: this is inherently racy, can only be called if log processing is
+ * suspended (e.g. reload time).  Records on disk are not lost when the
+ * queue is freed, they are picked up by the next instance using the same
+ * persist name, only the in-memory only elements need the instance to be
+ * kept. */
+static gboolean
+log_queue_disk_keep_on_reload(LogQueue *s)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+
+  return self->qpushback_len > 0 || self->qbacklog_len > self->qbacklog_disk_len;
+}
+
+/*
+ * Puts the message at the end of the queue, writing it to disk. The
+ * message is acked once it was written.
+ *
+ * NOTE: It consumes the reference passed by the caller.
+ */
+static void
+log_queue_disk_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+  gint64 pos;
+
+  g_static_mutex_lock(&self->super.lock);
+
+  if (!log_queue_disk_serialize_msg(self, msg))
+    {
+      msg_error("Error serializing message for the disk-buffer, dropping message",
+                evt_tag_str("persist_name", self->super.persist_name),
+                NULL);
+      goto drop;
+    }
+
+  pos = log_queue_disk_reserve(self, self->record->len);
+  if (pos < 0)
+    {
+      msg_debug("Destination disk-buffer full, dropping message",
+                evt_tag_int("queue_len", log_queue_disk_get_length(s)),
+                evt_tag_printf("disk_buf_size", "%" G_GINT64_FORMAT, self->disk_buf_size),
+                evt_tag_str("persist_name", self->super.persist_name),
+                NULL);
+      goto drop;
+    }
+
+  /* the record may overwrite space released by the read side */
+  if (self->state_unsaved)
+    log_queue_disk_save_state(self);
+
+  if (!log_queue_disk_pwrite(self, self->record->str, self->record->len, pos))
+    goto drop;
+
+  if (self->qcache_len < self->mem_buf_length)
+    {
+      LogQueueDiskNode *node = log_queue_disk_node_new(log_msg_ref(msg), pos, self->record->len);
+
+      log_queue_item_enqueued(&self->super, &node->timestamp);
+      iv_list_add_tail(&node->list, &self->qcache);
+      self->qcache_len++;
+    }
+
+  self->write_head = pos + self->record->len;
+  self->length++;
+  log_queue_disk_save_state(self);
+  stats_counter_inc(self->super.stored_messages);
+
+  log_queue_push_notify(&self->super);
+  g_static_mutex_unlock(&self->super.lock);
+
+  log_msg_ack(msg, path_options);
+  log_msg_unref(msg);
+  return;
+
+ drop:
+  stats_counter_inc(self->super.dropped_messages);
+  g_static_mutex_unlock(&self->super.lock);
+  log_msg_drop(msg, path_options);
+}
+
+/*
+ * Put an item back to the front of the queue. The item is only kept in
+ * memory.
+ *
+ * This is assumed to be called only from the output thread.
+ *
+ * NOTE: It consumes the reference passed by the caller.
+ */
+static void
+log_queue_disk_push_head(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+  LogQueueDiskNode *node;
+
+  /* in-memory items are not tracked by flow-control */
+  log_msg_ack(msg, path_options);
+
+  node = log_queue_disk_node_new(msg, -1, 0);
+  log_queue_item_requeued(&self->super, &node->timestamp, path_options);
+  g_static_mutex_lock(&self->super.lock);
+  iv_list_add(&node->list, &self->qcache);
+  self->qcache_len++;
+  self->qpushback_len++;
+  g_static_mutex_unlock(&self->super.lock);
+
+  stats_counter_inc(self->super.stored_messages);
+}
+
+/*
+ * Can only run from the output thread.
+ *
+ * NOTE: this returns a reference which the caller must take care to free.
+ */
+static gboolean
+log_queue_disk_pop_head(LogQueue *s, LogMessage **msg, LogPathOptions *path_options, gboolean push_to_backlog, gboolean ignore_throttle)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+  LogQueueDiskNode *node = NULL;
+
+  if (!ignore_throttle && self->super.throttle && self->super.throttle_buckets == 0)
+    {
+      return FALSE;
+    }
+
+  g_static_mutex_lock(&self->super.lock);
+  if (!iv_list_empty(&self->qcache))
+    {
+      node = iv_list_entry(self->qcache.next, LogQueueDiskNode, list);
+
+      if (node->pos < 0 || node->pos == self->read_head)
+        {
+          iv_list_del_init(&node->list);
+          self->qcache_len--;
+        }
+      else
+        {
+          /* the record at read_head was not cached */
+          node = NULL;
+        }
+    }
+
+  if (!node && self->length > 0)
+    {
+      node = log_queue_disk_read_record(self);
+      if (!node)
+        {
+          msg_error("Disk-buffer file is corrupted, dropping the messages stored in it",
+                    evt_tag_str("filename", self->filename),
+                    evt_tag_str("persist_name", self->super.persist_name),
+                    NULL);
+          log_queue_disk_drop_records(self);
+        }
+    }
+
+  if (!node)
+    {
+      g_static_mutex_unlock(&self->super.lock);
+      return FALSE;
+    }
+
+  if (node->pos >= 0)
+    {
+      self->read_head = log_queue_disk_normalize_pos(self, node->pos + node->len);
+      self->length--;
+    }
+  else
+    {
+      self->qpushback_len--;
+    }
+
+  *msg = node->msg;
+  path_options->ack_needed = FALSE;
+  log_queue_item_dequeued(&self->super, &node->timestamp, path_options);
+
+  if (push_to_backlog)
+    {
+      log_msg_ref(*msg);
+      iv_list_add_tail(&node->list, &self->qbacklog);
+      self->qbacklog_len++;
+      if (node->pos >= 0)
+        self->qbacklog_disk_len++;
+    }
+  else
+    {
+      log_queue_disk_node_free(node);
+      if (self->qbacklog_len == 0)
+        self->backlog_head = self->read_head;
+    }
+  log_queue_disk_read_state_changed(self);
+  g_static_mutex_unlock(&self->super.lock);
+
+  stats_counter_dec(self->super.stored_messages);
+
+  if (!ignore_throttle && self->super.throttle_buckets > 0)
+    {
+      self->super.throttle_buckets--;
+    }
+
+  return TRUE;
+}
+
+/*
+ * Can only run from the output thread.
+ */
+static void
+log_queue_disk_ack_backlog(LogQueue *s, gint n)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+  gint i;
+
+  g_static_mutex_lock(&self->super.lock);
+  for (i = 0; i < n && self->qbacklog_len > 0; i++)
+    {
+      LogQueueDiskNode *node;
+
+      node = iv_list_entry(self->qbacklog.next, LogQueueDiskNode, list);
+      iv_list_del(&node->list);
+      self->qbacklog_len--;
+      if (node->pos >= 0)
+        self->qbacklog_disk_len--;
+
+      log_queue_message_delivered(&self->super, node->msg, node->timestamp);
+      log_msg_unref(node->msg);
+      log_queue_disk_node_free(node);
+    }
+  log_queue_disk_update_backlog_head(self);
+  log_queue_disk_read_state_changed(self);
+  g_static_mutex_unlock(&self->super.lock);
+}
+
+/*
+ * Move items on our backlog back to the front of the queue, the
+ * corresponding records on disk become readable again.
+ *
+ * NOTE: this is assumed to be called from the output thread.
+ */
+static void
+log_queue_disk_rewind_backlog(LogQueue *s)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+  struct iv_list_head *lh;
+
+  g_static_mutex_lock(&self->super.lock);
+  /* the queue latency of these was recorded when they were popped */
+  if (self->super.queue_latency)
+    {
+      iv_list_for_each(lh, &self->qbacklog)
+        {
+          iv_list_entry(lh, LogQueueDiskNode, list)->timestamp = 0;
+        }
+    }
+  log_queue_disk_update_backlog_head(self);
+  self->read_head = self->backlog_head;
+  self->length += self->qbacklog_disk_len;
+  self->qpushback_len += self->qbacklog_len - self->qbacklog_disk_len;
+  self->qcache_len += self->qbacklog_len;
+
+  iv_list_splice_init(&self->qbacklog, &self->qcache);
+  stats_counter_add(self->super.stored_messages, self->qbacklog_len);
+  self->qbacklog_len = 0;
+  self->qbacklog_disk_len = 0;
+  log_queue_disk_save_state(self);
+  g_static_mutex_unlock(&self->super.lock);
+}
+
+static void
+log_queue_disk_free_queue(struct iv_list_head *q)
+{
+  while (!iv_list_empty(q))
+    {
+      LogQueueDiskNode *node;
+
+      node = iv_list_entry(q->next, LogQueueDiskNode, list);
+      iv_list_del(&node->list);
+
+      log_msg_unref(node->msg);
+      log_queue_disk_node_free(node);
+    }
+}
+
+static void
+log_queue_disk_free(LogQueue *s)
+{
+  LogQueueDisk *self = (LogQueueDisk *) s;
+
+  /* unacked records are delivered again by the next instance */
+  if (self->persist_handle)
+    log_queue_disk_rewind_backlog(s);
+
+  log_queue_disk_free_queue(&self->qcache);
+  log_queue_disk_free_queue(&self->qbacklog);
+
+  if (self->fd >= 0)
+    close(self->fd);
+  g_free(self->filename);
+  g_string_free(self->record, TRUE);
+  log_queue_free_method(s);
+}
+
+static gchar *
+log_queue_disk_format_persist_name(const gchar *persist_name, const gchar *suffix)
+{
+  return g_strdup_printf("%s.%s", persist_name, suffix);
+}
+
+static gchar *
+log_queue_disk_generate_filename(PersistState *persist_state)
+{
+  gchar *dir, *filename = NULL;
+  gint i;
+
+  dir = g_path_get_dirname(persist_state_get_filename(persist_state));
+  for (i = 0; i < 100000; i++)
+    {
+      filename = g_strdup_printf("%s/syslog-ng-%05d.qf", dir, i);
+      if (!g_file_test(filename, G_FILE_TEST_EXISTS))
+        break;
+      g_free(filename);
+      filename = NULL;
+    }
+  g_free(dir);
+  return filename;
+}
+
+static gboolean
+log_queue_disk_load_state(LogQueueDisk *self)
+{
+  LogQueueDiskState *state;
+  gchar *state_name;
+  gsize size;
+  guint8 version;
+
+  state_name = log_queue_disk_format_persist_name(self->super.persist_name, "disk_queue");
+  self->persist_handle = persist_state_lookup_entry(self->persist_state, state_name, &size, &version);
+  if (self->persist_handle)
+    {
+      gboolean valid;
+
+      state = persist_state_map_entry(self->persist_state, self->persist_handle);
+      valid = size >= sizeof(LogQueueDiskState) && state->header.version == QDISK_STATE_VERSION;
+      persist_state_unmap_entry(self->persist_state, self->persist_handle);
+      if (!valid)
+        {
+          msg_error("Invalid disk-buffer state found in the persist file, starting with an empty queue",
+                    evt_tag_str("persist_name", self->super.persist_name),
+                    NULL);
+          self->persist_handle = 0;
+        }
+    }
+
+  if (!self->persist_handle)
+    {
+      log_queue_disk_reset_positions(self);
+      self->persist_handle = persist_state_alloc_entry(self->persist_state, state_name, sizeof(LogQueueDiskState));
+      g_free(state_name);
+      if (!self->persist_handle)
+        return FALSE;
+      log_queue_disk_save_state(self);
+      return TRUE;
+    }
+  g_free(state_name);
+
+  state = persist_state_map_entry(self->persist_state, self->persist_handle);
+  if ((state->header.big_endian != 0) != (G_BYTE_ORDER == G_BIG_ENDIAN))
+    {
+      state->backlog_head = GUINT64_SWAP_LE_BE(state->backlog_head);
+      state->read_head = GUINT64_SWAP_LE_BE(state->read_head);
+      state->write_head = GUINT64_SWAP_LE_BE(state->write_head);
+      state->file_end = GUINT64_SWAP_LE_BE(state->file_end);
+      state->length = GUINT64_SWAP_LE_BE(state->length);
+      state->backlog_len = GUINT64_SWAP_LE_BE(state->backlog_len);
+      state->header.big_endian = (G_BYTE_ORDER == G_BIG_ENDIAN);
+    }
+
+  /* records that were read but not acked are delivered again */
+  self->backlog_head = state->backlog_head;
+  self->read_head = state->backlog_head;
+  self->write_head = state->write_head;
+  self->file_end = state->file_end;
+  self->length = state->length + state->backlog_len;
+  persist_state_unmap_entry(self->persist_state, self->persist_handle);
+  return TRUE;
+}
+
+static gboolean
+log_queue_disk_open_file(LogQueueDisk *self)
+{
+  gchar *filename_name;
+  gchar header[QDISK_RESERVED_SPACE];
+  struct stat st;
+
+  filename_name = log_queue_disk_format_persist_name(self->super.persist_name, "disk_queue_file");
+  self->filename = persist_state_lookup_string(self->persist_state, filename_name, NULL, NULL);
+  if (!self->filename)
+    {
+      self->filename = log_queue_disk_generate_filename(self->persist_state);
+      if (!self->filename)
+        {
+          g_free(filename_name);
+          return FALSE;
+        }
+      persist_state_alloc_string(self->persist_state, filename_name, self->filename, -1);
+    }
+  g_free(filename_name);
+
+  self->fd = open(self->filename, O_RDWR | O_CREAT, 0600);
+  if (self->fd < 0)
+    {
+      msg_error("Error opening disk-buffer file",
+                evt_tag_str("filename", self->filename),
+                evt_tag_errno("error", errno),
+                NULL);
+      return FALSE;
+    }
+  g_fd_set_cloexec(self->fd, TRUE);
+
+  memset(header, 0, sizeof(header));
+  if (fstat(self->fd, &st) < 0 ||
+      st.st_size < QDISK_RESERVED_SPACE ||
+      !log_queue_disk_pread(self, header, sizeof(header), 0) ||
+      memcmp(header, QDISK_FILE_MAGIC, 4) != 0 ||
+      header[4] != QDISK_FILE_VERSION ||
+      MAX(self->write_head, self->file_end) > st.st_size)
+    {
+      if (self->length > 0)
+        msg_error("Disk-buffer file is missing or corrupted, dropping the messages stored in it",
+                  evt_tag_str("filename", self->filename),
+                  evt_tag_str("persist_name", self->super.persist_name),
+                  NULL);
+      log_queue_disk_reset_positions(self);
+
+      memset(header, 0, sizeof(header));
+      memcpy(header, QDISK_FILE_MAGIC, 4);
+      header[4] = QDISK_FILE_VERSION;
+      if (ftruncate(self->fd, 0) < 0 ||
+          !log_queue_disk_pwrite(self, header, sizeof(header), 0))
+        return FALSE;
+      log_queue_disk_save_state(self);
+    }
+
+  if (self->length > 0)
+    msg_verbose("Reliable disk-buffer loaded",
+                evt_tag_str("filename", self->filename),
+                evt_tag_str("persist_name", self->super.persist_name),
+                evt_tag_int("queue_len", self->length),
+                NULL);
+  return TRUE;
+}
+
+/*
+ * Returns NULL if the disk-buffer cannot be opened, the caller should
+ * fall back to an in-memory queue in that case.
+ */
+LogQueue *
+log_queue_disk_new(gint64 disk_buf_size, gint mem_buf_length, const gchar *persist_name, PersistState *persist_state)
+{
+  LogQueueDisk *self;
+
+  g_assert(persist_name != NULL);
+
+  self = g_new0(LogQueueDisk, 1);
+  log_queue_init_instance(&self->super, persist_name);
+  self->super.get_length = log_queue_disk_get_length;
+  self->super.keep_on_reload = log_queue_disk_keep_on_reload;
+  self->super.push_tail = log_queue_disk_push_tail;
+  self->super.push_head = log_queue_disk_push_head;
+  self->super.pop_head = log_queue_disk_pop_head;
+  self->super.ack_backlog = log_queue_disk_ack_backlog;
+  self->super.rewind_backlog = log_queue_disk_rewind_backlog;
+  self->super.free_fn = log_queue_disk_free;
+
+  INIT_IV_LIST_HEAD(&self->qcache);
+  INIT_IV_LIST_HEAD(&self->qbacklog);
+  self->record = g_string_sized_new(1024);
+  self->fd = -1;
+  self->disk_buf_size = MAX(disk_buf_size, QDISK_RESERVED_SPACE);
+  self->mem_buf_length = mem_buf_length;
+  self->persist_state = persist_state;
+
+  if (!log_queue_disk_load_state(self) ||
+      !log_queue_disk_open_file(self))
+    {
+      msg_error("Error initializing disk-buffer",
+                evt_tag_str("persist_name", persist_name),
+                NULL);
+      log_queue_unref(&self->super);
+      return NULL;
+    }
+  return &self->super;
+}
+
+/* whether a disk-buffer was created under @persist_name, e.g. by a previous run */
+gboolean
+log_queue_disk_exists(const gchar *persist_name, PersistState *persist_state)
+{
+  gchar *filename_name;
+  gchar *filename;
+  gboolean exists;
+
+  filename_name = log_queue_disk_format_persist_name(persist_name, "disk_queue_file");
+  filename = persist_state_lookup_string(persist_state, filename_name, NULL, NULL);
+  exists = (filename != NULL);
+  g_free(filename);
+  g_free(filename_name);
+  return exists;
+}
+
+/*
+ * Removes the file and the persist state of a disk-buffer that is no
+ * longer used, the queue must have been emptied and freed.
+ */
+void
+log_queue_disk_remove(const gchar *persist_name, PersistState *persist_state)
+{
+  gchar *filename_name;
+  gchar *state_name;
+  gchar *filename;
+
+  filename_name = log_queue_disk_format_persist_name(persist_name, "disk_queue_file");
+  state_name = log_queue_disk_format_persist_name(persist_name, "disk_queue");
+  filename = persist_state_lookup_string(persist_state, filename_name, NULL, NULL);
+  if (filename)
+    unlink(filename);
+  persist_state_remove_entry(persist_state, filename_name);
+  persist_state_remove_entry(persist_state, state_name);
+  g_free(filename);
+  g_free(state_name);
+  g_free(filename_name);
+}
@@ -243,6 +243,7 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
         }
 
       node = log_msg_alloc_queue_node(msg, path_options);
+      log_queue_item_enqueued(&self->super, &node->timestamp);
       iv_list_add_tail(&node->list, &self->qoverflow_input[thread_id].items);
       self->qoverflow_input[thread_id].len++;
       log_msg_unref(msg);
@@ -259,6 +260,7 @@ log_queue_fifo_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
   if (log_queue_fifo_get_length(s) < self->qoverflow_size)
     {
       node = log_msg_alloc_queue_node(msg, path_options);
+      log_queue_item_enqueued(&self->super, &node->timestamp);
 
       iv_list_add_tail(&node->list, &self->qoverflow_wait);
       self->qoverflow_wait_len++;
@@ -302,6 +304,7 @@ log_queue_fifo_push_head(LogQueue *s, LogMessage *msg, const LogPathOptions *pat
    * can't deliver it. No checks, no drops either. */
 
   node = log_msg_alloc_dynamic_queue_node(msg, path_options);
+  log_queue_item_requeued(&self->super, &node->timestamp, path_options);
   iv_list_add(&node->list, &self->qoverflow_output);
   self->qoverflow_output_len++;
   log_msg_unref(msg);
@@ -342,6 +345,7 @@ log_queue_fifo_pop_head(LogQueue *s, LogMessage **msg, LogPathOptions *path_opti
       *msg = node->msg;
       path_options->ack_needed = node->ack_needed;
       self->qoverflow_output_len--;
+      log_queue_item_dequeued(&self->super, &node->timestamp, path_options);
       if (!push_to_backlog)
         {
           iv_list_del(&node->list);
@@ -400,6 +404,7 @@ log_queue_fifo_ack_backlog(LogQueue *s, gint n)
       iv_list_del(&node->list);
       self->qbacklog_len--;
       path_options.ack_needed = node->ack_needed;
+      log_queue_message_delivered(&self->super, node->msg, node->timestamp);
       log_msg_ack(msg, &path_options);
       log_msg_free_queue_node(node);
       log_msg_unref(msg);
@@ -421,7 +426,16 @@ static void
 log_queue_fifo_rewind_backlog(LogQueue *s)
 {
   LogQueueFifo *self = (LogQueueFifo *) s;
+  struct iv_list_head *lh;
 
+  /* the queue latency of these was recorded when they were popped */
+  if (self->super.queue_latency)
+    {
+      iv_list_for_each(lh, &self->qbacklog)
+        {
+          iv_list_entry(lh, LogMessageQueueNode, list)->timestamp = 0;
+        }
+    }
   iv_list_splice_tail_init(&self->qbacklog, &self->qoverflow_output);
   self->qoverflow_output_len += self->qbacklog_len;
   stats_counter_add(self->super.stored_messages, self->qbacklog_len);
@@ -0,0 +1,473 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logqueue-ring.h"
+#include "messages.h"
+#include "stats/stats-registry.h"
+#include "mainloop-worker.h"
+
+#include <iv_list.h>
+
+/*
+ * LogQueueRing is an alternative to LogQueueFifo, where input threads put
+ * their items directly into a bounded, lock-free multi-producer /
+ * single-consumer ring instead of per-thread lists that are spliced under
+ * the queue lock.
+ *
+ * The ring stores pointers to LogMessageQueueNode instances, every slot
+ * carries a sequence number, which tells producers whether the slot is
+ * free and the consumer whether it has been published. Producers reserve
+ * a slot by advancing the tail with compare-and-swap, the consumer is the
+ * only one advancing the head, so it needs no atomic read-modify-write
+ * operation.
+ *
+ * The output side (items put back by push_head(), rewound backlog and the
+ * backlog itself) is only touched by the output thread, thus pop_head()
+ * and ack_backlog() don't take the queue lock at all.
+ *
+ * The queue lock is only grabbed to wake up the consumer, once per batch
+ * in worker threads (using a batch callback) or for every message if the
+ * caller is not a worker thread.
+ *
+ * Threading assumptions:
+ *   - push_tail() can be called from any thread
+ *   - everything else is only called from the output thread
+ */
+
+#define LOG_QUEUE_RING_CACHE_LINE_SIZE 64
+
+/* head and tail are written by different threads, make sure they don't
+ * share a cache line */
+typedef union _LogQueueRingIndex
+{
+  gint value;
+  gchar __pad[LOG_QUEUE_RING_CACHE_LINE_SIZE];
+} LogQueueRingIndex;
+
+typedef struct _LogQueueRingSlot
+{
+  gint sequence;
+  LogMessageQueueNode *node;
+} LogQueueRingSlot;
+
+typedef struct _LogQueueRing
+{
+  LogQueue super;
+
+  /* output thread only */
+  struct iv_list_head qoverflow_output;
+  gint qoverflow_output_len;
+  struct iv_list_head qbacklog;
+  gint qbacklog_len;
+
+  gint qoverflow_size; /* in number of elements */
+  guint mask;
+  LogQueueRingSlot *slots;
+
+  LogQueueRingIndex head;
+  LogQueueRingIndex tail;
+
+  struct
+  {
+    WorkerBatchCallback cb;
+    gboolean finish_cb_registered;
+  } notify[0];
+} LogQueueRing;
+
+static inline gint
+log_queue_ring_get_ring_length(LogQueueRing *self)
+{
+  guint tail = (guint) g_atomic_int_get(&self->tail.value);
+  guint head = (guint) g_atomic_int_get(&self->head.value);
+
+  /* the tail counts slots that are reserved but not yet published, and the
+   * two loads are not atomic together, clamp the result */
+  return MAX((gint) (tail - head), 0);
+}
+
+static gint64
+log_queue_ring_get_length(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+
+  return log_queue_ring_get_ring_length(self) + self->qoverflow_output_len;
+}
+
+/* NOTE: this is inherently racy, can only be called if log processing is suspended (e.g. reload time) */
+static gboolean
+log_queue_ring_keep_on_reload(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+
+  return log_queue_ring_get_length(s) > 0 || self->qbacklog_len > 0;
+}
+
+/*
+ * Reserve a slot at the tail and publish @node in it. Returns FALSE if the
+ * queue already contains qoverflow_size elements.
+ *
+ * Can be called from any thread.
+ */
+static gboolean
+log_queue_ring_enqueue(LogQueueRing *self, LogMessageQueueNode *node)
+{
+  LogQueueRingSlot *slot;
+  guint pos;
+  gint diff;
+
+  pos = (guint) g_atomic_int_get(&self->tail.value);
+  while (1)
+    {
+      slot = &self->slots[pos & self->mask];
+      diff = (gint) ((guint) g_atomic_int_get(&slot->sequence) - pos);
+
+      if (diff == 0)
+        {
+          /* the slot is free, but the ring is rounded up to a power of
+           * two, so check the user supplied limit too. If pos is stale
+           * the difference is negative and the CAS below fails anyway. */
+          if ((gint) (pos - (guint) g_atomic_int_get(&self->head.value)) >= self->qoverflow_size)
+            return FALSE;
+
+          if (g_atomic_int_compare_and_exchange(&self->tail.value, (gint) pos, (gint) (pos + 1)))
+            break;
+        }
+      else if (diff < 0)
+        {
+          /* the consumer hasn't released this slot yet, the ring is full */
+          return FALSE;
+        }
+      pos = (guint) g_atomic_int_get(&self->tail.value);
+    }
+
+  slot->node = node;
+  g_atomic_int_set(&slot->sequence, (gint) (pos + 1));
+  return TRUE;
+}
+
+/*
+ * Take the published node from the head of the ring, returns NULL if the
+ * ring is empty or the producer of the head slot hasn't finished yet.
+ *
+ * Can only run from the output thread.
+ */
+static LogMessageQueueNode *
+log_queue_ring_dequeue(LogQueueRing *self)
+{
+  LogQueueRingSlot *slot;
+  LogMessageQueueNode *node;
+  guint pos;
+
+  pos = (guint) self->head.value;
+  slot = &self->slots[pos & self->mask];
+  if ((gint) ((guint) g_atomic_int_get(&slot->sequence) - (pos + 1)) < 0)
+    return NULL;
+
+  node = slot->node;
+  g_atomic_int_set(&slot->sequence, (gint) (pos + self->mask + 1));
+  g_atomic_int_set(&self->head.value, (gint) (pos + 1));
+  return node;
+}
+
+static void
+log_queue_ring_notify_consumer(LogQueueRing *self)
+{
+  g_static_mutex_lock(&self->super.lock);
+  log_queue_push_notify(&self->super);
+  g_static_mutex_unlock(&self->super.lock);
+}
+
+/* wake up the consumer once the input worker thread finishes its batch */
+static gpointer
+log_queue_ring_notify_batch(gpointer user_data)
+{
+  LogQueueRing *self = (LogQueueRing *) user_data;
+  gint thread_id;
+
+  thread_id = main_loop_worker_get_thread_id();
+
+  g_assert(thread_id >= 0);
+
+  log_queue_ring_notify_consumer(self);
+  self->notify[thread_id].finish_cb_registered = FALSE;
+  return NULL;
+}
+
+/*
+ * Puts the message to the ring, or drops it if the queue is full.
+ *
+ * NOTE: It consumes the reference passed by the caller.
+ */
+static void
+log_queue_ring_push_tail(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogMessageQueueNode *node;
+  gint thread_id;
+
+  thread_id = main_loop_worker_get_thread_id();
+
+  g_assert(thread_id < 0 || log_queue_max_threads > thread_id);
+
+  node = log_msg_alloc_queue_node(msg, path_options);
+  log_queue_item_enqueued(&self->super, &node->timestamp);
+  if (!log_queue_ring_enqueue(self, node))
+    {
+      log_msg_free_queue_node(node);
+      stats_counter_inc(self->super.dropped_messages);
+      log_msg_drop(msg, path_options);
+
+      msg_debug("Destination queue full, dropping message",
+                evt_tag_int("queue_len", log_queue_ring_get_length(&self->super)),
+                evt_tag_int("log_fifo_size", self->qoverflow_size),
+                evt_tag_str("persist_name", self->super.persist_name),
+                NULL);
+      return;
+    }
+  stats_counter_inc(self->super.stored_messages);
+  log_msg_unref(msg);
+
+  if (thread_id >= 0)
+    {
+      if (!self->notify[thread_id].finish_cb_registered)
+        {
+          main_loop_worker_register_batch_callback(&self->notify[thread_id].cb);
+          self->notify[thread_id].finish_cb_registered = TRUE;
+        }
+    }
+  else
+    {
+      log_queue_ring_notify_consumer(self);
+    }
+}
+
+/*
+ * Put an item back to the front of the queue.
+ *
+ * This is assumed to be called only from the output thread.
+ *
+ * NOTE: It consumes the reference passed by the caller.
+ */
+static void
+log_queue_ring_push_head(LogQueue *s, LogMessage *msg, const LogPathOptions *path_options)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogMessageQueueNode *node;
+
+  /* no limit checks here, see log_queue_fifo_push_head() */
+  node = log_msg_alloc_dynamic_queue_node(msg, path_options);
+  log_queue_item_requeued(&self->super, &node->timestamp, path_options);
+  iv_list_add(&node->list, &self->qoverflow_output);
+  self->qoverflow_output_len++;
+  log_msg_unref(msg);
+
+  stats_counter_inc(self->super.stored_messages);
+}
+
+/*
+ * Can only run from the output thread.
+ *
+ * NOTE: this returns a reference which the caller must take care to free.
+ */
+static gboolean
+log_queue_ring_pop_head(LogQueue *s, LogMessage **msg, LogPathOptions *path_options, gboolean push_to_backlog, gboolean ignore_throttle)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogMessageQueueNode *node;
+
+  if (!ignore_throttle && self->super.throttle && self->super.throttle_buckets == 0)
+    return FALSE;
+
+  if (self->qoverflow_output_len > 0)
+    {
+      node = iv_list_entry(self->qoverflow_output.next, LogMessageQueueNode, list);
+      iv_list_del_init(&node->list);
+      self->qoverflow_output_len--;
+    }
+  else
+    {
+      node = log_queue_ring_dequeue(self);
+      if (!node)
+        return FALSE;
+    }
+
+  *msg = node->msg;
+  path_options->ack_needed = node->ack_needed;
+  stats_counter_dec(self->super.stored_messages);
+  log_queue_item_dequeued(&self->super, &node->timestamp, path_options);
+
+  if (push_to_backlog)
+    {
+      log_msg_ref(*msg);
+      iv_list_add_tail(&node->list, &self->qbacklog);
+      self->qbacklog_len++;
+    }
+  else
+    {
+      log_msg_free_queue_node(node);
+    }
+
+  if (!ignore_throttle && self->super.throttle_buckets > 0)
+    self->super.throttle_buckets--;
+
+  return TRUE;
+}
+
+/*
+ * Can only run from the output thread.
+ */
+static void
+log_queue_ring_ack_backlog(LogQueue *s, gint n)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg;
+  gint i;
+
+  for (i = 0; i < n && self->qbacklog_len > 0; i++)
+    {
+      LogMessageQueueNode *node;
+
+      node = iv_list_entry(self->qbacklog.next, LogMessageQueueNode, list);
+      msg = node->msg;
+
+      iv_list_del(&node->list);
+      self->qbacklog_len--;
+      path_options.ack_needed = node->ack_needed;
+      log_queue_message_delivered(&self->super, node->msg, node->timestamp);
+      log_msg_ack(msg, &path_options);
+      log_msg_free_queue_node(node);
+      log_msg_unref(msg);
+    }
+}
+
+/*
+ * Move the backlog back to the output queue, see
+ * log_queue_fifo_rewind_backlog().
+ *
+ * NOTE: this is assumed to be called from the output thread.
+ */
+static void
+log_queue_ring_rewind_backlog(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  struct iv_list_head *lh;
+
+  /* the queue latency of these was recorded when they were popped */
+  if (self->super.queue_latency)
+    {
+      iv_list_for_each(lh, &self->qbacklog)
+        {
+          iv_list_entry(lh, LogMessageQueueNode, list)->timestamp = 0;
+        }
+    }
+  iv_list_splice_tail_init(&self->qbacklog, &self->qoverflow_output);
+  self->qoverflow_output_len += self->qbacklog_len;
+  stats_counter_add(self->super.stored_messages, self->qbacklog_len);
+  self->qbacklog_len = 0;
+}
+
+static void
+log_queue_ring_free_node(LogMessageQueueNode *node)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = node->msg;
+
+  path_options.ack_needed = node->ack_needed;
+  log_msg_free_queue_node(node);
+  log_msg_ack(msg, &path_options);
+  log_msg_unref(msg);
+}
+
+static void
+log_queue_ring_free_queue(struct iv_list_head *q)
+{
+  while (!iv_list_empty(q))
+    {
+      LogMessageQueueNode *node;
+
+      node = iv_list_entry(q->next, LogMessageQueueNode, list);
+      iv_list_del(&node->list);
+      log_queue_ring_free_node(node);
+    }
+}
+
+static void
+log_queue_ring_free(LogQueue *s)
+{
+  LogQueueRing *self = (LogQueueRing *) s;
+  LogMessageQueueNode *node;
+
+  while ((node = log_queue_ring_dequeue(self)) != NULL)
+    log_queue_ring_free_node(node);
+
+  log_queue_ring_free_queue(&self->qoverflow_output);
+  log_queue_ring_free_queue(&self->qbacklog);
+  g_free(self->slots);
+  log_queue_free_method(s);
+}
+
+LogQueue *
+log_queue_ring_new(gint qoverflow_size, const gchar *persist_name)
+{
+  LogQueueRing *self;
+  guint capacity, slot;
+  gint i;
+
+  self = g_malloc0(sizeof(LogQueueRing) + log_queue_max_threads * sizeof(self->notify[0]));
+
+  log_queue_init_instance(&self->super, persist_name);
+  self->super.get_length = log_queue_ring_get_length;
+  self->super.keep_on_reload = log_queue_ring_keep_on_reload;
+  self->super.push_tail = log_queue_ring_push_tail;
+  self->super.push_head = log_queue_ring_push_head;
+  self->super.pop_head = log_queue_ring_pop_head;
+  self->super.ack_backlog = log_queue_ring_ack_backlog;
+  self->super.rewind_backlog = log_queue_ring_rewind_backlog;
+
+  self->super.free_fn = log_queue_ring_free;
+
+  for (i = 0; i < log_queue_max_threads; i++)
+    {
+      worker_batch_callback_init(&self->notify[i].cb);
+      self->notify[i].cb.user_data = self;
+      self->notify[i].cb.func = log_queue_ring_notify_batch;
+    }
+  INIT_IV_LIST_HEAD(&self->qoverflow_output);
+  INIT_IV_LIST_HEAD(&self->qbacklog);
+
+  self->qoverflow_size = MAX(qoverflow_size, 1);
+
+  /* the ring is preallocated, rounded up to the next power of two */
+  for (capacity = 1; capacity < (guint) self->qoverflow_size; capacity <<= 1)
+    ;
+  self->mask = capacity - 1;
+  self->slots = g_new(LogQueueRingSlot, capacity);
+  for (slot = 0; slot < capacity; slot++)
+    {
+      self->slots[slot].sequence = slot;
+      self->slots[slot].node = NULL;
+    }
+  return &self->super;
+}
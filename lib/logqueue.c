@@ -175,6 +175,32 @@ log_queue_set_counters(LogQueue *self, StatsCounterItem *stored_messages, StatsC
   stats_counter_set(self->stored_messages, log_queue_get_length(self));
 }
 
+void
+log_queue_set_latency_histograms(LogQueue *self, StatsHistogram *queue_latency, StatsHistogram *delivery_latency, StatsHistogram *latency)
+{
+  self->queue_latency = queue_latency;
+  self->delivery_latency = delivery_latency;
+  self->latency = latency;
+}
+
+void
+log_queue_message_delivered(LogQueue *self, LogMessage *msg, guint64 delivery_start)
+{
+  if (self->delivery_latency && delivery_start)
+    stats_histogram_record(self->delivery_latency, stats_histogram_now() - delivery_start);
+
+  if (self->latency)
+    {
+      LogStamp *recvd = &msg->timestamps[LM_TS_RECVD];
+      GTimeVal now;
+      gint64 diff;
+
+      g_get_current_time(&now);
+      diff = (gint64) (now.tv_sec - recvd->tv_sec) * G_USEC_PER_SEC + (now.tv_usec - recvd->tv_usec);
+      stats_histogram_record(self->latency, MAX(diff, 0));
+    }
+}
+
 void
 log_queue_init_instance(LogQueue *self, const gchar *persist_name)
 {
@@ -46,6 +46,9 @@ struct _LogQueue
   gchar *persist_name;
   StatsCounterItem *stored_messages;
   StatsCounterItem *dropped_messages;
+  StatsHistogram *queue_latency;
+  StatsHistogram *delivery_latency;
+  StatsHistogram *latency;
 
   GStaticMutex lock;
   LogQueuePushNotifyFunc parallel_push_notify;
@@ -129,11 +132,69 @@ log_queue_set_throttle(LogQueue *self, gint throttle)
   self->throttle_buckets = throttle;
 }
 
+/*
+ * Latency tracking, to be called by queue implementations with the
+ * timestamp stored along the queued message, when it is put into the
+ * queue, when it is taken out for delivery and when the delivery is
+ * acknowledged (see log_queue_message_delivered()).  The queue latency
+ * is recorded once per message, when it is first taken out of the queue.
+ */
+static inline void
+log_queue_item_enqueued(LogQueue *self, guint64 *timestamp)
+{
+  *timestamp = self->queue_latency ? stats_histogram_now() : 0;
+}
+
+/* the queue latency of a message pushed back to the head was already
+ * recorded when it was popped, it is not counted again */
+static inline void
+log_queue_item_requeued(LogQueue *self, guint64 *timestamp, const LogPathOptions *path_options)
+{
+  if (path_options->queue_latency_recorded)
+    *timestamp = 0;
+  else
+    log_queue_item_enqueued(self, timestamp);
+}
+
+static inline void
+log_queue_item_dequeued(LogQueue *self, guint64 *timestamp, LogPathOptions *path_options)
+{
+  guint64 now;
+
+  path_options->queue_latency_recorded = FALSE;
+  if (!self->queue_latency && !self->delivery_latency)
+    return;
+
+  now = stats_histogram_now();
+  if (*timestamp && self->queue_latency)
+    {
+      stats_histogram_record(self->queue_latency, now - *timestamp);
+      path_options->queue_latency_recorded = TRUE;
+    }
+  /* from now on the timestamp measures the delivery latency */
+  *timestamp = now;
+}
+
+/*
+ * To be used by consumers that pop messages without using the backlog,
+ * (e.g. LogWriter), the value returned right after log_queue_pop_head()
+ * is to be passed to log_queue_message_delivered() once the message was
+ * consumed.
+ */
+static inline guint64
+log_queue_get_delivery_start(LogQueue *self)
+{
+  return self->delivery_latency ? stats_histogram_now() : 0;
+}
+
+void log_queue_message_delivered(LogQueue *self, LogMessage *msg, guint64 delivery_start);
+
 void log_queue_push_notify(LogQueue *self);
 void log_queue_reset_parallel_push(LogQueue *self);
 void log_queue_set_parallel_push(LogQueue *self, LogQueuePushNotifyFunc parallel_push_notify, gpointer user_data, GDestroyNotify user_data_destroy);
 gboolean log_queue_check_items(LogQueue *self, gint *timeout, LogQueuePushNotifyFunc parallel_push_notify, gpointer user_data, GDestroyNotify user_data_destroy);
 void log_queue_set_counters(LogQueue *self, StatsCounterItem *stored_messages, StatsCounterItem *dropped_messages);
+void log_queue_set_latency_histograms(LogQueue *self, StatsHistogram *queue_latency, StatsHistogram *delivery_latency, StatsHistogram *latency);
 void log_queue_init_instance(LogQueue *self, const gchar *persist_name);
 void log_queue_free_method(LogQueue *self);
 
@@ -29,6 +29,7 @@
 #include "timeutils.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-syslog.h"
+#include "stats/stats-dynamic.h"
 #include "tags.h"
 
 #include <string.h>
@@ -177,7 +178,7 @@ log_source_init(LogPipe *s)
   LogSource *self = (LogSource *) s;
 
   stats_lock();
-  stats_register_counter(self->stats_level, self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->recvd_messages);
+  stats_register_sharded_counter(self->stats_level, self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->recvd_messages);
   stats_register_counter(self->stats_level, self->stats_source | SCS_SOURCE, self->stats_id, self->stats_instance, SC_TYPE_STAMP, &self->last_message_seen);
   stats_unlock();
   return TRUE;
@@ -244,16 +245,12 @@ log_source_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options
   /* stats counters */
   if (stats_check_level(2))
     {
-      stats_lock();
-
-      stats_register_and_increment_dynamic_counter(2, SCS_HOST | SCS_SOURCE, NULL, log_msg_get_value(msg, LM_V_HOST, NULL), msg->timestamps[LM_TS_RECVD].tv_sec);
+      stats_dynamic_counter_inc(2, SCS_HOST | SCS_SOURCE, log_msg_get_value(msg, LM_V_HOST, NULL), msg->timestamps[LM_TS_RECVD].tv_sec);
       if (stats_check_level(3))
         {
-          stats_register_and_increment_dynamic_counter(3, SCS_SENDER | SCS_SOURCE, NULL, log_msg_get_value(msg, LM_V_HOST_FROM, NULL), msg->timestamps[LM_TS_RECVD].tv_sec);
-          stats_register_and_increment_dynamic_counter(3, SCS_PROGRAM | SCS_SOURCE, NULL, log_msg_get_value(msg, LM_V_PROGRAM, NULL), msg->timestamps[LM_TS_RECVD].tv_sec);
+          stats_dynamic_counter_inc(3, SCS_SENDER | SCS_SOURCE, log_msg_get_value(msg, LM_V_HOST_FROM, NULL), msg->timestamps[LM_TS_RECVD].tv_sec);
+          stats_dynamic_counter_inc(3, SCS_PROGRAM | SCS_SOURCE, log_msg_get_value(msg, LM_V_PROGRAM, NULL), msg->timestamps[LM_TS_RECVD].tv_sec);
         }
-
-      stats_unlock();
     }
   stats_syslog_process_message_pri(msg->pri);
 
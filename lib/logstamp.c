@@ -25,7 +25,35 @@
 #include "logstamp.h"
 #include "messages.h"
 #include "timeutils.h"
-#include "str-format.h"
+#include "tls-support.h"
+
+#include <string.h>
+
+/* the number of rendered timestamps cached per thread and format */
+#define LOG_STAMP_CACHE_SIZE 4
+
+typedef struct _LogStampCacheEntry
+{
+  gboolean valid;
+  time_t sec;
+  glong zone_offset;
+  /* the timestamp up to its fractional digits and the part following them */
+  gchar prefix[32];
+  gint prefix_len;
+  gchar suffix[8];
+  gint suffix_len;
+} LogStampCacheEntry;
+
+/* most messages formatted in a row share the same second and zone
+ * offset, so the rendered timestamps are cached, keyed by these and the
+ * format */
+TLS_BLOCK_START
+{
+  LogStampCacheEntry stamp_cache[TS_FMT_UNIX + 1][LOG_STAMP_CACHE_SIZE];
+}
+TLS_BLOCK_END;
+
+#define stamp_cache  __tls_deref(stamp_cache)
 
 static void
 log_stamp_append_frac_digits(LogStamp *stamp, GString *target, gint frac_digits)
@@ -48,86 +76,78 @@ log_stamp_append_frac_digits(LogStamp *stamp, GString *target, gint frac_digits)
     }
 }
 
-/** 
- * log_stamp_format:
- * @stamp: Timestamp to format
- * @target: Target storage for formatted timestamp
- * @ts_format: Specifies basic timestamp format (TS_FMT_BSD, TS_FMT_ISO)
- * @zone_offset: Specifies custom zone offset if @tz_convert == TZ_CNV_CUSTOM
- *
- * Emits the formatted version of @stamp into @target as specified by
- * @ts_format and @tz_convert. 
- **/
-void
-log_stamp_append_format(LogStamp *stamp, GString *target, gint ts_format, glong zone_offset, gint frac_digits)
+static void
+log_stamp_cache_fill(LogStampCacheEntry *entry, time_t sec, glong zone_offset, gint ts_format)
 {
-  glong target_zone_offset = 0;
   struct tm *tm, tm_storage;
-  char buf[8];
   time_t t;
-  
-  if (zone_offset != -1)
-    target_zone_offset = zone_offset;
-  else
-    target_zone_offset = stamp->zone_offset;
 
-  t = stamp->tv_sec + target_zone_offset;
+  t = sec + zone_offset;
   cached_gmtime(&t, &tm_storage);
   tm = &tm_storage;
+
+  entry->suffix[0] = 0;
   switch (ts_format)
     {
     case TS_FMT_BSD:
-      g_string_append(target, month_names_abbrev[tm->tm_mon]);
-      g_string_append_c(target, ' ');
-      format_uint32_padded(target, 2, ' ', 10, tm->tm_mday);
-      g_string_append_c(target, ' ');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_hour);
-      g_string_append_c(target, ':');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_min);
-      g_string_append_c(target, ':');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_sec);
-      log_stamp_append_frac_digits(stamp, target, frac_digits);
+      g_snprintf(entry->prefix, sizeof(entry->prefix), "%s %2d %02d:%02d:%02d",
+                 month_names_abbrev[tm->tm_mon], tm->tm_mday,
+                 tm->tm_hour, tm->tm_min, tm->tm_sec);
       break;
     case TS_FMT_ISO:
-      format_uint32_padded(target, 0, 0, 10, tm->tm_year + 1900);
-      g_string_append_c(target, '-');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_mon + 1);
-      g_string_append_c(target, '-');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_mday);
-      g_string_append_c(target, 'T');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_hour);
-      g_string_append_c(target, ':');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_min);
-      g_string_append_c(target, ':');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_sec);
-
-      log_stamp_append_frac_digits(stamp, target, frac_digits);
-      format_zone_info(buf, sizeof(buf), target_zone_offset);
-      g_string_append(target, buf);
+      g_snprintf(entry->prefix, sizeof(entry->prefix), "%d-%02d-%02dT%02d:%02d:%02d",
+                 tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+                 tm->tm_hour, tm->tm_min, tm->tm_sec);
+      format_zone_info(entry->suffix, sizeof(entry->suffix), zone_offset);
       break;
     case TS_FMT_FULL:
-      format_uint32_padded(target, 0, 0, 10, tm->tm_year + 1900);
-      g_string_append_c(target, ' ');
-      g_string_append(target, month_names_abbrev[tm->tm_mon]);
-      g_string_append_c(target, ' ');
-      format_uint32_padded(target, 2, ' ', 10, tm->tm_mday);
-      g_string_append_c(target, ' ');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_hour);
-      g_string_append_c(target, ':');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_min);
-      g_string_append_c(target, ':');
-      format_uint32_padded(target, 2, '0', 10, tm->tm_sec);
-
-      log_stamp_append_frac_digits(stamp, target, frac_digits);
+      g_snprintf(entry->prefix, sizeof(entry->prefix), "%d %s %2d %02d:%02d:%02d",
+                 tm->tm_year + 1900, month_names_abbrev[tm->tm_mon], tm->tm_mday,
+                 tm->tm_hour, tm->tm_min, tm->tm_sec);
       break;
     case TS_FMT_UNIX:
-      format_uint32_padded(target, 0, 0, 10, (int) stamp->tv_sec);
-      log_stamp_append_frac_digits(stamp, target, frac_digits);
+      g_snprintf(entry->prefix, sizeof(entry->prefix), "%u", (guint32) sec);
       break;
     default:
       g_assert_not_reached();
       break;
     }
+  entry->prefix_len = strlen(entry->prefix);
+  entry->suffix_len = strlen(entry->suffix);
+  entry->sec = sec;
+  entry->zone_offset = zone_offset;
+  entry->valid = TRUE;
+}
+
+/** 
+ * log_stamp_format:
+ * @stamp: Timestamp to format
+ * @target: Target storage for formatted timestamp
+ * @ts_format: Specifies basic timestamp format (TS_FMT_BSD, TS_FMT_ISO)
+ * @zone_offset: Specifies custom zone offset if @tz_convert == TZ_CNV_CUSTOM
+ *
+ * Emits the formatted version of @stamp into @target as specified by
+ * @ts_format and @tz_convert. 
+ **/
+void
+log_stamp_append_format(LogStamp *stamp, GString *target, gint ts_format, glong zone_offset, gint frac_digits)
+{
+  LogStampCacheEntry *entry;
+  glong target_zone_offset = 0;
+  
+  if (zone_offset != -1)
+    target_zone_offset = zone_offset;
+  else
+    target_zone_offset = stamp->zone_offset;
+
+  g_assert(ts_format >= TS_FMT_BSD && ts_format <= TS_FMT_UNIX);
+  entry = &stamp_cache[ts_format][(stamp->tv_sec + target_zone_offset) & (LOG_STAMP_CACHE_SIZE - 1)];
+  if (!entry->valid || entry->sec != stamp->tv_sec || entry->zone_offset != target_zone_offset)
+    log_stamp_cache_fill(entry, stamp->tv_sec, target_zone_offset, ts_format);
+
+  g_string_append_len(target, entry->prefix, entry->prefix_len);
+  log_stamp_append_frac_digits(stamp, target, frac_digits);
+  g_string_append_len(target, entry->suffix, entry->suffix_len);
 }
 
 void
@@ -23,132 +23,504 @@
  */
 
 #include "logthrdestdrv.h"
+#include "logqueue-disk.h"
 #include "mainloop-worker.h"
+#include "scratch-buffers.h"
+
+void
+log_threaded_dest_worker_suspend(LogThrDestWorker *self)
+{
+  self->suspended = TRUE;
+  g_get_current_time(&self->suspend_target);
+  g_time_val_add(&self->suspend_target,
+                 self->owner->time_reopen * 1000000);
+}
 
 void
 log_threaded_dest_driver_suspend(LogThrDestDriver *self)
 {
-  self->writer_thread_suspended = TRUE;
-  g_get_current_time(&self->writer_thread_suspend_target);
-  g_time_val_add(&self->writer_thread_suspend_target,
-                 self->time_reopen * 1000000);
+  log_threaded_dest_worker_suspend(self->workers[0]);
 }
 
 static void
-log_threaded_dest_driver_message_became_available_in_the_queue(gpointer user_data)
+log_threaded_dest_worker_message_became_available_in_the_queue(gpointer user_data)
 {
-  LogThrDestDriver *self = (LogThrDestDriver *) user_data;
+  LogThrDestWorker *self = (LogThrDestWorker *) user_data;
 
   g_mutex_lock(self->suspend_mutex);
-  g_cond_signal(self->writer_thread_wakeup_cond);
+  g_cond_signal(self->wakeup_cond);
   g_mutex_unlock(self->suspend_mutex);
 }
 
+/* waits at most batch_timeout milliseconds for batch_lines messages to
+ * accumulate, returns early if the thread is asked to stop */
 static void
-log_threaded_dest_driver_worker_thread_main(gpointer arg)
+log_threaded_dest_worker_wait_for_batch(LogThrDestWorker *self)
 {
-  LogThrDestDriver *self = (LogThrDestDriver *)arg;
+  LogThrDestDriver *owner = self->owner;
+  GTimeVal flush_target;
+
+  if (owner->batch_timeout <= 0 ||
+      log_queue_get_length(self->queue) >= owner->batch_lines)
+    return;
+
+  g_get_current_time(&flush_target);
+  g_time_val_add(&flush_target, owner->batch_timeout * 1000);
+
+  g_mutex_lock(self->suspend_mutex);
+  while (!self->terminate &&
+         log_queue_get_length(self->queue) < owner->batch_lines)
+    {
+      /* the notification is one-shot, get woken up by the next push
+       * to recheck the length. It is registered while suspend_mutex is
+       * held, so the signal can't be lost before we start waiting. */
+      log_queue_set_parallel_push(self->queue,
+                                  log_threaded_dest_worker_message_became_available_in_the_queue,
+                                  self, NULL);
+      if (!g_cond_timed_wait(self->wakeup_cond,
+                             self->suspend_mutex,
+                             &flush_target))
+        break;
+    }
+  g_mutex_unlock(self->suspend_mutex);
+  log_queue_reset_parallel_push(self->queue);
+}
+
+/*
+ * Pops up to batch_lines messages into the backlog of the queue and hands
+ * them over to the driver in a single call. Messages are acknowledged when
+ * the whole batch was delivered, otherwise they are put back to the front
+ * of the queue and retried after time_reopen.
+ */
+static gboolean
+log_threaded_dest_worker_insert_batch(LogThrDestWorker *self)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gboolean success;
+  gint i, n = 0;
+
+  log_threaded_dest_worker_wait_for_batch(self);
+
+  while (n < self->owner->batch_lines &&
+         log_queue_pop_head(self->queue, &self->batch[n], &path_options, TRUE, FALSE))
+    n++;
+
+  if (n == 0)
+    return TRUE;
+
+  success = self->insert_batch(self, self->batch, n);
+
+  if (success)
+    log_queue_ack_backlog(self->queue, n);
+  else
+    log_queue_rewind_backlog(self->queue);
+
+  for (i = 0; i < n; i++)
+    {
+      log_msg_unref(self->batch[i]);
+      self->batch[i] = NULL;
+    }
+  return success;
+}
+
+/*
+ * Without insert_batch() the driver pops the messages itself without the
+ * backlog, so it has to call log_queue_get_delivery_start() and
+ * log_queue_message_delivered() to record the delivery and end-to-end
+ * latencies, as LogWriter does.
+ */
+static gboolean
+log_threaded_dest_worker_insert(LogThrDestWorker *self)
+{
+  if (self->insert_batch)
+    return log_threaded_dest_worker_insert_batch(self);
+  return self->insert(self);
+}
+
+static void
+log_threaded_dest_worker_thread_main(gpointer arg)
+{
+  LogThrDestWorker *self = (LogThrDestWorker *)arg;
 
   msg_debug("Worker thread started",
-            evt_tag_str("driver", self->super.super.id),
+            evt_tag_str("driver", self->owner->super.super.id),
+            evt_tag_int("worker", self->worker_index),
             NULL);
 
-  if (self->worker.thread_init)
-    self->worker.thread_init(self);
+  if (self->thread_init)
+    self->thread_init(self);
 
-  while (!self->writer_thread_terminate)
+  while (!self->terminate)
     {
       g_mutex_lock(self->suspend_mutex);
-      if (self->writer_thread_suspended)
+      if (self->suspended)
         {
-          g_cond_timed_wait(self->writer_thread_wakeup_cond,
+          g_cond_timed_wait(self->wakeup_cond,
                             self->suspend_mutex,
-                            &self->writer_thread_suspend_target);
-          self->writer_thread_suspended = FALSE;
+                            &self->suspend_target);
+          self->suspended = FALSE;
           g_mutex_unlock(self->suspend_mutex);
         }
       else if (!log_queue_check_items(self->queue, NULL,
-                                      log_threaded_dest_driver_message_became_available_in_the_queue,
+                                      log_threaded_dest_worker_message_became_available_in_the_queue,
                                       self, NULL))
         {
-          g_cond_wait(self->writer_thread_wakeup_cond, self->suspend_mutex);
+          g_cond_wait(self->wakeup_cond, self->suspend_mutex);
           g_mutex_unlock(self->suspend_mutex);
         }
       else
         g_mutex_unlock(self->suspend_mutex);
 
-      if (self->writer_thread_terminate)
+      if (self->terminate)
         break;
 
-      if (!self->worker.insert(self))
+      if (!log_threaded_dest_worker_insert(self))
         {
-          if (self->worker.disconnect)
-            self->worker.disconnect(self);
-          log_threaded_dest_driver_suspend(self);
+          if (self->disconnect)
+            self->disconnect(self);
+          log_threaded_dest_worker_suspend(self);
         }
     }
 
-  if (self->worker.disconnect)
-    self->worker.disconnect(self);
+  if (self->disconnect)
+    self->disconnect(self);
 
-  if (self->worker.thread_deinit)
-    self->worker.thread_deinit(self);
+  if (self->thread_deinit)
+    self->thread_deinit(self);
 
   msg_debug("Worker thread finished",
-            evt_tag_str("driver", self->super.super.id),
+            evt_tag_str("driver", self->owner->super.super.id),
+            evt_tag_int("worker", self->worker_index),
             NULL);
 }
 
 static void
-log_threaded_dest_driver_stop_thread(gpointer s)
+log_threaded_dest_worker_stop_thread(gpointer s)
 {
-  LogThrDestDriver *self = (LogThrDestDriver *) s;
+  LogThrDestWorker *self = (LogThrDestWorker *) s;
 
-  self->writer_thread_terminate = TRUE;
+  self->terminate = TRUE;
   g_mutex_lock(self->suspend_mutex);
-  g_cond_signal(self->writer_thread_wakeup_cond);
+  g_cond_signal(self->wakeup_cond);
   g_mutex_unlock(self->suspend_mutex);
 }
 
 static void
-log_threaded_dest_driver_start_thread(LogThrDestDriver *self)
+log_threaded_dest_worker_start_thread(LogThrDestWorker *self)
 {
-  main_loop_create_worker_thread(log_threaded_dest_driver_worker_thread_main,
-                                 log_threaded_dest_driver_stop_thread,
+  main_loop_create_worker_thread(log_threaded_dest_worker_thread_main,
+                                 log_threaded_dest_worker_stop_thread,
                                  self);
 }
 
+/*
+ * The first worker keeps the persist name of the driver, so that the
+ * queue survives changing the number of workers.
+ */
+static gboolean
+log_threaded_dest_worker_start(LogThrDestWorker *self)
+{
+  LogThrDestDriver *owner = self->owner;
+  gchar *persist_name;
+
+  if (self->worker_index == 0)
+    persist_name = g_strdup(owner->format.persist_name(owner));
+  else
+    persist_name = g_strdup_printf("%s#%d", owner->format.persist_name(owner), self->worker_index);
+
+  self->queue = log_dest_driver_acquire_queue(&owner->super, persist_name);
+  g_free(persist_name);
+
+  if (self->queue == NULL)
+    return FALSE;
+
+  if (owner->num_workers > 1)
+    self->stats_instance = g_strdup_printf("%s#%d", owner->format.stats_instance(owner), self->worker_index);
+  else
+    self->stats_instance = g_strdup(owner->format.stats_instance(owner));
+
+  stats_lock();
+  stats_register_sharded_counter(0, owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                                 self->stats_instance,
+                                 SC_TYPE_STORED, &self->stored_messages);
+  stats_register_sharded_counter(0, owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                                 self->stats_instance,
+                                 SC_TYPE_DROPPED, &self->dropped_messages);
+  stats_register_histogram(STATS_LEVEL1, owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                           self->stats_instance,
+                           SC_HISTOGRAM_QUEUE_LATENCY, &self->queue_latency);
+  stats_register_histogram(STATS_LEVEL1, owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                           self->stats_instance,
+                           SC_HISTOGRAM_DELIVERY_LATENCY, &self->delivery_latency);
+  stats_register_histogram(STATS_LEVEL1, owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                           self->stats_instance,
+                           SC_HISTOGRAM_LATENCY, &self->latency);
+  stats_unlock();
+
+  log_queue_set_counters(self->queue, self->stored_messages,
+                         self->dropped_messages);
+  log_queue_set_latency_histograms(self->queue, self->queue_latency,
+                                   self->delivery_latency, self->latency);
+
+  if (self->insert_batch)
+    self->batch = g_new0(LogMessage *, owner->batch_lines);
+  return TRUE;
+}
+
+static void
+log_threaded_dest_worker_stop(LogThrDestWorker *self)
+{
+  LogThrDestDriver *owner = self->owner;
+
+  if (!self->queue)
+    return;
+
+  log_queue_reset_parallel_push(self->queue);
+
+  log_queue_set_counters(self->queue, NULL, NULL);
+  log_queue_set_latency_histograms(self->queue, NULL, NULL, NULL);
+
+  stats_lock();
+  stats_unregister_counter(owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                           self->stats_instance,
+                           SC_TYPE_STORED, &self->stored_messages);
+  stats_unregister_counter(owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                           self->stats_instance,
+                           SC_TYPE_DROPPED, &self->dropped_messages);
+  stats_unregister_histogram(owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                             self->stats_instance,
+                             SC_HISTOGRAM_QUEUE_LATENCY, &self->queue_latency);
+  stats_unregister_histogram(owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                             self->stats_instance,
+                             SC_HISTOGRAM_DELIVERY_LATENCY, &self->delivery_latency);
+  stats_unregister_histogram(owner->stats_source | SCS_DESTINATION, owner->super.super.id,
+                             self->stats_instance,
+                             SC_HISTOGRAM_LATENCY, &self->latency);
+  stats_unlock();
+}
+
+static void
+log_threaded_dest_worker_free(LogThrDestWorker *self)
+{
+  if (self->free_fn)
+    self->free_fn(self);
+
+  g_mutex_free(self->suspend_mutex);
+  g_cond_free(self->wakeup_cond);
+  g_free(self->batch);
+  g_free(self->stats_instance);
+
+  if (self->queue)
+    log_queue_unref(self->queue);
+  g_free(self);
+}
+
+void
+log_threaded_dest_worker_init_instance(LogThrDestWorker *self, LogThrDestDriver *owner, gint worker_index)
+{
+  self->owner = owner;
+  self->worker_index = worker_index;
+  self->wakeup_cond = g_cond_new();
+  self->suspend_mutex = g_mutex_new();
+}
+
+/*
+ * Worker used for drivers that implement the driver-level callbacks, it
+ * simply delegates to them.
+ */
+static void
+log_threaded_dest_legacy_worker_thread_init(LogThrDestWorker *s)
+{
+  if (s->owner->worker.thread_init)
+    s->owner->worker.thread_init(s->owner);
+}
+
+static void
+log_threaded_dest_legacy_worker_thread_deinit(LogThrDestWorker *s)
+{
+  if (s->owner->worker.thread_deinit)
+    s->owner->worker.thread_deinit(s->owner);
+}
+
+static void
+log_threaded_dest_legacy_worker_disconnect(LogThrDestWorker *s)
+{
+  if (s->owner->worker.disconnect)
+    s->owner->worker.disconnect(s->owner);
+}
+
+static gboolean
+log_threaded_dest_legacy_worker_insert(LogThrDestWorker *s)
+{
+  return s->owner->worker.insert(s->owner);
+}
+
+static gboolean
+log_threaded_dest_legacy_worker_insert_batch(LogThrDestWorker *s, LogMessage **msgs, gint msgs_len)
+{
+  return s->owner->worker.insert_batch(s->owner, msgs, msgs_len);
+}
+
+static LogThrDestWorker *
+log_threaded_dest_legacy_worker_new(LogThrDestDriver *owner)
+{
+  LogThrDestWorker *self = g_new0(LogThrDestWorker, 1);
+
+  log_threaded_dest_worker_init_instance(self, owner, 0);
+  self->thread_init = log_threaded_dest_legacy_worker_thread_init;
+  self->thread_deinit = log_threaded_dest_legacy_worker_thread_deinit;
+  self->disconnect = log_threaded_dest_legacy_worker_disconnect;
+  if (owner->worker.insert_batch)
+    self->insert_batch = log_threaded_dest_legacy_worker_insert_batch;
+  else
+    self->insert = log_threaded_dest_legacy_worker_insert;
+  return self;
+}
+
+static gchar *
+log_threaded_dest_driver_format_workers_persist_name(LogThrDestDriver *self)
+{
+  return g_strdup_printf("%s.workers", self->format.persist_name(self));
+}
+
+static gboolean
+log_threaded_dest_driver_has_orphaned_queue(LogThrDestDriver *self, gint worker_index,
+                                            gint prev_num_workers, const gchar *persist_name)
+{
+  GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
+
+  if (worker_index < prev_num_workers)
+    return TRUE;
+
+  /* the number of workers is not known across restarts, but disk-buffers are */
+  return self->super.disk_buffer && cfg->state && log_queue_disk_exists(persist_name, cfg->state);
+}
+
+/*
+ * The queues of workers removed by lowering workers() are left behind
+ * under their "#N" persist names. Their messages are moved to the
+ * remaining workers before these start, otherwise they would be lost (or
+ * picked up only when workers() is raised again).
+ */
+static void
+log_threaded_dest_driver_claim_orphaned_queues(LogThrDestDriver *self)
+{
+  GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
+  gchar *persist_name;
+  gint prev_num_workers, i, target = 0;
+
+  persist_name = log_threaded_dest_driver_format_workers_persist_name(self);
+  prev_num_workers = GPOINTER_TO_INT(cfg_persist_config_fetch(cfg, persist_name));
+  g_free(persist_name);
+
+  for (i = self->num_workers; ; i++)
+    {
+      LogQueue *orphan;
+      LogMessage *msg;
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+      gint moved = 0;
+
+      persist_name = g_strdup_printf("%s#%d", self->format.persist_name(self), i);
+      if (!log_threaded_dest_driver_has_orphaned_queue(self, i, prev_num_workers, persist_name))
+        {
+          g_free(persist_name);
+          break;
+        }
+
+      orphan = log_dest_driver_acquire_queue(&self->super, persist_name);
+      if (orphan)
+        {
+          /* unacked messages of the backlog are delivered again */
+          log_queue_rewind_backlog(orphan);
+          while (log_queue_pop_head(orphan, &msg, &path_options, FALSE, TRUE))
+            {
+              log_queue_push_tail(self->workers[target]->queue, msg, &path_options);
+              target = (target + 1) % self->num_workers;
+              moved++;
+            }
+          log_dest_driver_release_queue(&self->super, orphan);
+        }
+
+      if (self->super.disk_buffer && cfg->state)
+        log_queue_disk_remove(persist_name, cfg->state);
+
+      if (moved > 0)
+        msg_notice("Moving the queue of a removed worker to the remaining ones",
+                   evt_tag_str("driver", self->super.super.id),
+                   evt_tag_int("worker", i),
+                   evt_tag_int("messages", moved),
+                   NULL);
+      g_free(persist_name);
+    }
+}
+
+static void
+log_threaded_dest_driver_free_workers(LogThrDestDriver *self)
+{
+  gint i;
+
+  if (!self->workers)
+    return;
+
+  for (i = 0; i < self->num_workers; i++)
+    {
+      if (self->workers[i])
+        log_threaded_dest_worker_free(self->workers[i]);
+    }
+  g_free(self->workers);
+  self->workers = NULL;
+  self->queue = NULL;
+  self->stored_messages = NULL;
+  self->dropped_messages = NULL;
+}
 
 gboolean
 log_threaded_dest_driver_start(LogPipe *s)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)s;
   GlobalConfig *cfg = log_pipe_get_config(s);
+  gint i;
 
   if (cfg)
     self->time_reopen = cfg->time_reopen;
 
-  self->queue = log_dest_driver_acquire_queue(&self->super,
-                                              self->format.persist_name(self));
+  if (self->batch_lines < 0)
+    self->batch_lines = cfg ? cfg->flush_lines : 0;
+  if (self->batch_lines < 1)
+    self->batch_lines = 1;
 
-  if (self->queue == NULL)
+  if (self->num_workers < 1)
+    self->num_workers = 1;
+  if (self->num_workers > 1 && !self->worker.construct)
     {
-      return FALSE;
+      msg_warning("This destination does not support multiple workers, using a single one",
+                  evt_tag_str("driver", self->super.super.id),
+                  evt_tag_int("workers", self->num_workers),
+                  NULL);
+      self->num_workers = 1;
     }
 
-  stats_lock();
-  stats_register_counter(0, self->stats_source | SCS_DESTINATION, self->super.super.id,
-                         self->format.stats_instance(self),
-                         SC_TYPE_STORED, &self->stored_messages);
-  stats_register_counter(0, self->stats_source | SCS_DESTINATION, self->super.super.id,
-                         self->format.stats_instance(self),
-                         SC_TYPE_DROPPED, &self->dropped_messages);
-  stats_unlock();
+  log_threaded_dest_driver_free_workers(self);
+  self->workers = g_new0(LogThrDestWorker *, self->num_workers);
+  for (i = 0; i < self->num_workers; i++)
+    {
+      if (self->worker.construct)
+        self->workers[i] = self->worker.construct(self, i);
+      else
+        self->workers[i] = log_threaded_dest_legacy_worker_new(self);
 
-  log_queue_set_counters(self->queue, self->stored_messages,
-                         self->dropped_messages);
+      if (!log_threaded_dest_worker_start(self->workers[i]))
+        return FALSE;
+    }
+
+  self->queue = self->workers[0]->queue;
+  self->stored_messages = self->workers[0]->stored_messages;
+  self->dropped_messages = self->workers[0]->dropped_messages;
 
-  log_threaded_dest_driver_start_thread(self);
+  log_threaded_dest_driver_claim_orphaned_queues(self);
+
+  for (i = 0; i < self->num_workers; i++)
+    log_threaded_dest_worker_start_thread(self->workers[i]);
 
   return TRUE;
 }
@@ -157,19 +529,21 @@ gboolean
 log_threaded_dest_driver_deinit_method(LogPipe *s)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)s;
+  GlobalConfig *cfg = log_pipe_get_config(s);
+  gint i;
 
-  log_queue_reset_parallel_push(self->queue);
+  for (i = 0; self->workers && i < self->num_workers; i++)
+    log_threaded_dest_worker_stop(self->workers[i]);
 
-  log_queue_set_counters(self->queue, NULL, NULL);
+  /* lets the next configuration find the queues of removed workers */
+  if (self->workers && cfg)
+    {
+      gchar *persist_name = log_threaded_dest_driver_format_workers_persist_name(self);
 
-  stats_lock();
-  stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->super.super.id,
-                           self->format.stats_instance(self),
-                           SC_TYPE_STORED, &self->stored_messages);
-  stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->super.super.id,
-                           self->format.stats_instance(self),
-                           SC_TYPE_DROPPED, &self->dropped_messages);
-  stats_unlock();
+      cfg_persist_config_add(cfg, persist_name, GINT_TO_POINTER(self->num_workers), NULL, TRUE);
+      g_free(persist_name);
+    }
+  log_threaded_dest_driver_free_workers(self);
 
   if (!log_dest_driver_deinit_method(s))
     return FALSE;
@@ -182,21 +556,42 @@ log_threaded_dest_driver_free(LogPipe *s)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)s;
 
-  g_mutex_free(self->suspend_mutex);
-  g_cond_free(self->writer_thread_wakeup_cond);
-
-  if (self->queue)
-    log_queue_unref(self->queue);
+  log_threaded_dest_driver_free_workers(self);
+  log_template_unref(self->worker_partition_key);
 
   log_dest_driver_free((LogPipe *)self);
 }
 
+static LogThrDestWorker *
+log_threaded_dest_driver_select_worker(LogThrDestDriver *self, LogMessage *msg)
+{
+  guint index;
+
+  if (self->num_workers == 1)
+    return self->workers[0];
+
+  if (self->worker_partition_key)
+    {
+      SBGString *key = sb_gstring_acquire();
+
+      log_template_format(self->worker_partition_key, msg, NULL, LTZ_SEND,
+                          0, NULL, sb_gstring_string(key));
+      index = g_str_hash(sb_gstring_string(key)->str);
+      sb_gstring_release(key);
+    }
+  else
+    index = (guint) g_atomic_counter_exchange_and_add(&self->next_worker, 1);
+
+  return self->workers[index % self->num_workers];
+}
+
 static void
 log_threaded_dest_driver_queue(LogPipe *s, LogMessage *msg,
                                const LogPathOptions *path_options,
                                gpointer user_data)
 {
   LogThrDestDriver *self = (LogThrDestDriver *)s;
+  LogThrDestWorker *worker;
   LogPathOptions local_options;
 
   if (!path_options->flow_control_requested)
@@ -205,19 +600,55 @@ log_threaded_dest_driver_queue(LogPipe *s, LogMessage *msg,
   if (self->queue_method)
     self->queue_method(self);
 
+  worker = log_threaded_dest_driver_select_worker(self, msg);
+
   log_msg_add_ack(msg, path_options);
-  log_queue_push_tail(self->queue, log_msg_ref(msg), path_options);
+  log_queue_push_tail(worker->queue, log_msg_ref(msg), path_options);
 
   log_dest_driver_queue_method(s, msg, path_options, user_data);
 }
 
+void
+log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->batch_lines = batch_lines;
+}
+
+void
+log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->batch_timeout = batch_timeout;
+}
+
+void
+log_threaded_dest_driver_set_num_workers(LogDriver *s, gint num_workers)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  self->num_workers = num_workers;
+}
+
+void
+log_threaded_dest_driver_set_worker_partition_key(LogDriver *s, LogTemplate *key)
+{
+  LogThrDestDriver *self = (LogThrDestDriver *)s;
+
+  log_template_unref(self->worker_partition_key);
+  self->worker_partition_key = key;
+}
+
 void
 log_threaded_dest_driver_init_instance(LogThrDestDriver *self, GlobalConfig *cfg)
 {
   log_dest_driver_init_instance(&self->super, cfg);
 
-  self->writer_thread_wakeup_cond = g_cond_new();
-  self->suspend_mutex = g_mutex_new();
+  self->batch_lines = -1;
+  self->batch_timeout = 0;
+  self->num_workers = 1;
 
   self->super.super.super.init = log_threaded_dest_driver_start;
   self->super.super.super.deinit = log_threaded_dest_driver_deinit_method;
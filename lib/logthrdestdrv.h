@@ -29,34 +29,83 @@
 #include "driver.h"
 #include "stats/stats-registry.h"
 #include "logqueue.h"
+#include "atomic.h"
+#include "template/templates.h"
 
 typedef struct _LogThrDestDriver LogThrDestDriver;
+typedef struct _LogThrDestWorker LogThrDestWorker;
+
+/*
+ * LogThrDestWorker: the state of a single writer thread. A driver runs
+ * workers(N) of these, each draining its own partition of the messages
+ * routed to the driver. Drivers that support more than one worker derive
+ * their per-connection state from this struct and construct it via
+ * worker.construct(), the others keep using the driver-level callbacks.
+ */
+struct _LogThrDestWorker
+{
+  LogThrDestDriver *owner;
+  gint worker_index;
+
+  /* Thread related stuff; shared */
+  GMutex *suspend_mutex;
+  GCond *wakeup_cond;
+
+  gboolean terminate;
+  gboolean suspended;
+  GTimeVal suspend_target;
+
+  LogQueue *queue;
+  LogMessage **batch;
+
+  gchar *stats_instance;
+  StatsCounterItem *dropped_messages;
+  StatsCounterItem *stored_messages;
+  StatsHistogram *queue_latency;
+  StatsHistogram *delivery_latency;
+  StatsHistogram *latency;
+
+  void (*thread_init) (LogThrDestWorker *s);
+  void (*thread_deinit) (LogThrDestWorker *s);
+  gboolean (*insert) (LogThrDestWorker *s);
+  gboolean (*insert_batch) (LogThrDestWorker *s, LogMessage **msgs, gint msgs_len);
+  void (*disconnect) (LogThrDestWorker *s);
+  void (*free_fn) (LogThrDestWorker *s);
+};
 
 struct _LogThrDestDriver
 {
   LogDestDriver super;
 
+  /* these belong to the first worker, drivers implementing the
+   * single-worker callbacks below use them directly */
   StatsCounterItem *dropped_messages;
   StatsCounterItem *stored_messages;
+  LogQueue *queue;
 
   time_t time_reopen;
 
-  /* Thread related stuff; shared */
-  GMutex *suspend_mutex;
-  GCond *writer_thread_wakeup_cond;
+  /* batching: the worker pops up to batch_lines messages and waits at
+   * most batch_timeout milliseconds for a batch to fill up */
+  gint batch_lines;
+  gint batch_timeout;
 
-  gboolean writer_thread_terminate;
-  gboolean writer_thread_suspended;
-  GTimeVal writer_thread_suspend_target;
-
-  LogQueue *queue;
+  gint num_workers;
+  LogThrDestWorker **workers;
+  /* messages are distributed between workers by the hash of this
+   * template, or round-robin if it is not set */
+  LogTemplate *worker_partition_key;
+  GAtomicCounter next_worker;
 
   /* Worker stuff */
   struct
   {
+    LogThrDestWorker *(*construct) (LogThrDestDriver *s, gint worker_index);
+
     void (*thread_init) (LogThrDestDriver *s);
     void (*thread_deinit) (LogThrDestDriver *s);
     gboolean (*insert) (LogThrDestDriver *s);
+    gboolean (*insert_batch) (LogThrDestDriver *s, LogMessage **msgs, gint msgs_len);
     void (*disconnect) (LogThrDestDriver *s);
   } worker;
 
@@ -78,4 +127,12 @@ void log_threaded_dest_driver_free(LogPipe *s);
 
 void log_threaded_dest_driver_suspend(LogThrDestDriver *self);
 
+void log_threaded_dest_driver_set_batch_lines(LogDriver *s, gint batch_lines);
+void log_threaded_dest_driver_set_batch_timeout(LogDriver *s, gint batch_timeout);
+void log_threaded_dest_driver_set_num_workers(LogDriver *s, gint num_workers);
+void log_threaded_dest_driver_set_worker_partition_key(LogDriver *s, LogTemplate *key);
+
+void log_threaded_dest_worker_suspend(LogThrDestWorker *self);
+void log_threaded_dest_worker_init_instance(LogThrDestWorker *self, LogThrDestDriver *owner, gint worker_index);
+
 #endif
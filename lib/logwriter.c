@@ -66,6 +66,9 @@ struct _LogWriter
   StatsCounterItem *suppressed_messages;
   StatsCounterItem *processed_messages;
   StatsCounterItem *stored_messages;
+  StatsHistogram *queue_latency;
+  StatsHistogram *delivery_latency;
+  StatsHistogram *latency;
   LogPipe *control;
   LogWriterOptions *options;
   LogMessage *last_msg;
@@ -88,6 +91,9 @@ struct _LogWriter
   gboolean work_result;
   gint pollable_state;
   LogProtoClient *proto, *pending_proto;
+  /* messages consumed by proto, but not yet completely written out */
+  struct iv_list_head unacked_msgs;
+  gint unacked_msgs_len;
   gboolean watches_running:1, suspended:1, working:1, flush_waiting_for_timeout:1;
   gboolean pending_proto_present;
   GCond *pending_proto_cond;
@@ -115,6 +121,12 @@ struct _LogWriter
  * usual GQueue and messages get acknowledged when they are moved to the
  * disk buffer.
  *
+ * LogProtoClient instances may consume messages before writing them out
+ * (e.g. to coalesce them into a single write), these are only
+ * acknowledged once the LogProtoClient reports them written. If the
+ * LogProtoClient is replaced (e.g. because of a reconnect), they are put
+ * back to the queue to be sent again.
+ *
  **/
 
 static gboolean log_writer_flush(LogWriter *self, LogWriterFlushMode flush_mode);
@@ -157,6 +169,49 @@ log_writer_set_queue(LogWriter *s, LogQueue *queue)
   self->queue = queue;
 }
 
+/* acknowledge the messages the LogProtoClient has completely written out */
+static void
+log_writer_ack_written_messages(LogWriter *self, LogProtoClient *proto)
+{
+  gint n = self->unacked_msgs_len - log_proto_client_get_pending_messages(proto);
+
+  while (n > 0)
+    {
+      LogMessageQueueNode *node = iv_list_entry(self->unacked_msgs.next, LogMessageQueueNode, list);
+      LogMessage *msg = node->msg;
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+      iv_list_del(&node->list);
+      self->unacked_msgs_len--;
+      n--;
+
+      path_options.ack_needed = node->ack_needed;
+      log_queue_message_delivered(self->queue, msg, node->timestamp);
+      log_msg_ack(msg, &path_options);
+      log_msg_free_queue_node(node);
+      log_msg_unref(msg);
+    }
+}
+
+/* put the messages that were not written out by the current
+ * LogProtoClient back to the queue, to be called before it is freed */
+static void
+log_writer_rewind_unacked_messages(LogWriter *self)
+{
+  while (!iv_list_empty(&self->unacked_msgs))
+    {
+      LogMessageQueueNode *node = iv_list_entry(self->unacked_msgs.prev, LogMessageQueueNode, list);
+      LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+      iv_list_del(&node->list);
+      path_options.ack_needed = node->ack_needed;
+      /* push_head() takes over the reference of the node */
+      log_queue_push_head(self->queue, node->msg, &path_options);
+      log_msg_free_queue_node(node);
+    }
+  self->unacked_msgs_len = 0;
+}
+
 static void
 log_writer_work_perform(gpointer s)
 {
@@ -182,6 +237,7 @@ log_writer_work_finished(gpointer s)
        * non-main thread. */
 
       g_static_mutex_lock(&self->pending_proto_lock);
+      log_writer_rewind_unacked_messages(self);
       if (self->proto)
         log_proto_client_free(self->proto);
 
@@ -1020,12 +1076,18 @@ log_writer_flush(LogWriter *self, LogWriterFlushMode flush_mode)
       LogMessage *lm;
       LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
       gboolean consumed = FALSE;
+      /* whether the message was handed over to the LogProtoClient */
+      gboolean posted = FALSE;
+      guint64 delivery_start;
       
       if (!log_queue_pop_head(self->queue, &lm, &path_options, FALSE, ignore_throttle))
         {
           /* no more items are available */
           break;
         }
+      /* messages are not put into the backlog, so the queue can't
+       * measure the delivery latency on its own */
+      delivery_start = log_queue_get_delivery_start(self->queue);
 
       log_msg_refcache_start_consumer(lm, &path_options);
       msg_set_context(lm);
@@ -1035,6 +1097,7 @@ log_writer_flush(LogWriter *self, LogWriterFlushMode flush_mode)
       if (self->line_buffer->len)
         {
           status = log_proto_client_post(proto, (guchar *) self->line_buffer->str, self->line_buffer->len, &consumed);
+          posted = consumed;
 
           if (consumed)
             log_writer_realloc_line_buffer(self);
@@ -1056,9 +1119,27 @@ log_writer_flush(LogWriter *self, LogWriterFlushMode flush_mode)
         }
       if (consumed)
         {
+          LogMessageQueueNode *node;
+
           if (lm->flags & LF_LOCAL)
             step_sequence_number(&self->seq_num);
-          log_msg_ack(lm, &path_options);
+
+          if (posted)
+            {
+              /* acked by log_writer_ack_written_messages() once written
+               * out, the pending messages of the proto are counted
+               * against this list, so it may only hold posted messages */
+              node = log_msg_alloc_dynamic_queue_node(lm, &path_options);
+              node->timestamp = delivery_start;
+              iv_list_add_tail(&node->list, &self->unacked_msgs);
+              self->unacked_msgs_len++;
+              log_writer_ack_written_messages(self, proto);
+            }
+          else
+            {
+              /* skipped or dropped, there's nothing to wait for */
+              log_msg_ack(lm, &path_options);
+            }
           log_msg_unref(lm);
         }
       else
@@ -1082,6 +1163,7 @@ log_writer_flush(LogWriter *self, LogWriterFlushMode flush_mode)
     {
       if (log_proto_client_flush(proto) == LPS_ERROR)
         return FALSE;
+      log_writer_ack_written_messages(self, proto);
     }
 
   return TRUE;
@@ -1133,15 +1215,22 @@ log_writer_init(LogPipe *s)
   if ((self->options->options & LWO_NO_STATS) == 0 && !self->dropped_messages)
     {
       stats_lock();
-      stats_register_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_DROPPED, &self->dropped_messages);
+      stats_register_sharded_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_DROPPED, &self->dropped_messages);
       if (self->options->suppress > 0)
         stats_register_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_SUPPRESSED, &self->suppressed_messages);
-      stats_register_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->processed_messages);
+      stats_register_sharded_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->processed_messages);
       
-      stats_register_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_STORED, &self->stored_messages);
+      stats_register_sharded_counter(self->stats_level, self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_STORED, &self->stored_messages);
+
+      /* latency histograms cost a few clock reads per message, only
+       * maintain them from stats-level(1) up */
+      stats_register_histogram(MAX(self->stats_level, STATS_LEVEL1), self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_HISTOGRAM_QUEUE_LATENCY, &self->queue_latency);
+      stats_register_histogram(MAX(self->stats_level, STATS_LEVEL1), self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_HISTOGRAM_DELIVERY_LATENCY, &self->delivery_latency);
+      stats_register_histogram(MAX(self->stats_level, STATS_LEVEL1), self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_HISTOGRAM_LATENCY, &self->latency);
       stats_unlock();
     }
   log_queue_set_counters(self->queue, self->stored_messages, self->dropped_messages);
+  log_queue_set_latency_histograms(self->queue, self->queue_latency, self->delivery_latency, self->latency);
   if (self->proto)
     {
       LogProtoClient *proto;
@@ -1181,12 +1270,16 @@ log_writer_deinit(LogPipe *s)
   ml_batched_timer_unregister(&self->suppress_timer);
   ml_batched_timer_unregister(&self->mark_timer);
   log_queue_set_counters(self->queue, NULL, NULL);
+  log_queue_set_latency_histograms(self->queue, NULL, NULL, NULL);
 
   stats_lock();
   stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_DROPPED, &self->dropped_messages);
   stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_SUPPRESSED, &self->suppressed_messages);
   stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_PROCESSED, &self->processed_messages);
   stats_unregister_counter(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_TYPE_STORED, &self->stored_messages);
+  stats_unregister_histogram(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_HISTOGRAM_QUEUE_LATENCY, &self->queue_latency);
+  stats_unregister_histogram(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_HISTOGRAM_DELIVERY_LATENCY, &self->delivery_latency);
+  stats_unregister_histogram(self->stats_source | SCS_DESTINATION, self->stats_id, self->stats_instance, SC_HISTOGRAM_LATENCY, &self->latency);
   stats_unlock();
   
   return TRUE;
@@ -1197,6 +1290,7 @@ log_writer_free(LogPipe *s)
 {
   LogWriter *self = (LogWriter *) s;
 
+  log_writer_rewind_unacked_messages(self);
   if (self->proto)
     log_proto_client_free(self->proto);
 
@@ -1253,6 +1347,7 @@ log_writer_reopen_deferred(gpointer s)
 
   log_writer_stop_watches(self);
 
+  log_writer_rewind_unacked_messages(self);
   if (self->proto)
     log_proto_client_free(self->proto);
 
@@ -1338,6 +1433,7 @@ log_writer_new(guint32 flags, GlobalConfig *cfg)
   self->flags = flags;
   self->line_buffer = g_string_sized_new(128);
   self->pollable_state = -1;
+  INIT_IV_LIST_HEAD(&self->unacked_msgs);
   init_sequence_number(&self->seq_num);
 
   log_writer_init_watches(self);
@@ -35,6 +35,7 @@
 #include "service-management.h"
 #include "persist-state.h"
 #include "run-id.h"
+#include "dnscache.h"
 
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -174,7 +175,11 @@ main_loop_initialize_state(GlobalConfig *cfg, const gchar *persist_filename)
   success = cfg_init(cfg);
 
   if (success)
-    persist_state_commit(cfg->state);
+    {
+      /* after cfg_init(), so that the configured cache size applies */
+      dns_cache_restore(cfg->state);
+      persist_state_commit(cfg->state);
+    }
   else
     persist_state_cancel(cfg->state);
   return success;
@@ -290,6 +295,7 @@ main_loop_exit_finish(void)
   /* deinit the current configuration, as at this point we _know_ that no
    * threads are running.  This will unregister ivykis tasks and timers
    * that could fire while the configuration is being destructed */
+  dns_cache_save(current_configuration->state);
   cfg_deinit(current_configuration);
   iv_quit();
 }
@@ -51,6 +51,9 @@ enum
   LP_EXPECT_HOSTNAME = 0x0080,
   /* message is locally generated and should be marked with LF_LOCAL */
   LP_LOCAL = 0x0100,
+  /* store the unparsed message in $RAWMSG, $MSG references it instead of
+   * being copied (the header fields are still copied) */
+  LP_STORE_RAW_MESSAGE = 0x0200,
 };
 
 typedef struct _MsgFormatHandler MsgFormatHandler;
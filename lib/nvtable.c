@@ -23,6 +23,7 @@
  */
 #include "nvtable.h"
 #include "messages.h"
+#include "slab-alloc.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -200,7 +201,8 @@ nv_table_resolve_indirect(NVTable *self, NVEntry *entry, gssize *length)
    * non-zero terminated strings properly handled, thus the caller has
    * to supply a non-NULL value_len */
 
-  *length = MIN(entry->vindirect.ofs + entry->vindirect.len, referenced_length) - entry->vindirect.ofs;
+  if (length)
+    *length = MIN(entry->vindirect.ofs + entry->vindirect.len, referenced_length) - entry->vindirect.ofs;
   return referenced_value + entry->vindirect.ofs;
 }
 
@@ -633,7 +635,7 @@ nv_table_new(gint num_static_entries, gint num_dyn_values, gint init_length)
   gsize alloc_length;
 
   alloc_length = nv_table_get_alloc_size(num_static_entries, num_dyn_values, init_length);
-  self = (NVTable *) g_malloc(alloc_length);
+  self = (NVTable *) slab_alloc(alloc_length);
 
   nv_table_init(self, alloc_length, num_static_entries);
   return self;
@@ -667,7 +669,7 @@ nv_table_realloc(NVTable *self, NVTable **new)
 
   if (self->ref_cnt == 1 && !self->borrowed)
     {
-      *new = self = g_realloc(self, new_size);
+      *new = self = slab_realloc(self, new_size);
 
       self->size = new_size;
       /* move the downwards growing region to the end of the new buffer */
@@ -677,7 +679,7 @@ nv_table_realloc(NVTable *self, NVTable **new)
     }
   else
     {
-      *new = g_malloc(new_size);
+      *new = slab_alloc(new_size);
 
       /* we only copy the header first */
       memcpy(*new, self, sizeof(NVTable) + self->num_static_entries * sizeof(self->static_entries[0]) + self->num_dyn_entries * sizeof(NVDynValue));
@@ -706,7 +708,7 @@ nv_table_unref(NVTable *self)
 {
   if ((--self->ref_cnt == 0) && !self->borrowed)
     {
-      g_free(self);
+      slab_free(self);
     }
 }
 
@@ -731,7 +733,7 @@ nv_table_clone(NVTable *self, gint additional_space)
   if (new_size > NV_TABLE_MAX_BYTES)
     new_size = NV_TABLE_MAX_BYTES;
 
-  new = g_malloc(new_size);
+  new = slab_alloc(new_size);
   memcpy(new, self, sizeof(NVTable) + self->num_static_entries * sizeof(self->static_entries[0]) + self->num_dyn_entries * sizeof(NVDynValue));
   new->size = new_size;
   new->ref_cnt = 1;
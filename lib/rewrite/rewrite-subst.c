@@ -23,6 +23,8 @@
  */
 
 #include "rewrite-subst.h"
+#include "cfg.h"
+#include "stats/stats.h"
 
 /* LogRewriteSubst
  *
@@ -81,7 +83,27 @@ log_rewrite_subst_compile_pattern(LogRewrite *s, const gchar *regexp, GError **e
       return FALSE;
     }
 
-  return log_matcher_compile(self->matcher, regexp, error);
+  if (!log_matcher_compile(self->matcher, regexp, error))
+    return FALSE;
+
+  log_matcher_attach_prefilter(self->matcher, cfg_tree_get_matcher_prefilter(&cfg->tree, self->super.value_handle));
+  return TRUE;
+}
+
+static gboolean
+log_rewrite_subst_init(LogPipe *s)
+{
+  LogRewriteSubst *self = (LogRewriteSubst *) s;
+
+  if (!log_rewrite_init_method(s))
+    return FALSE;
+
+  if (self->matcher)
+    {
+      log_matcher_set_jit(self->matcher, s->cfg->pcre_jit);
+      log_matcher_register_stats(self->matcher, STATS_LEVEL3, self->super.name);
+    }
+  return TRUE;
 }
 
 static LogPipe *
@@ -115,6 +137,7 @@ log_rewrite_subst_new(LogTemplate *replacement, GlobalConfig *cfg)
 
   log_rewrite_init_instance(&self->super, cfg);
 
+  self->super.super.init = log_rewrite_subst_init;
   self->super.super.free_fn = log_rewrite_subst_free;
   self->super.super.clone = log_rewrite_subst_clone;
   self->super.process = log_rewrite_subst_process;
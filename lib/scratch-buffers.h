@@ -67,6 +67,7 @@ extern ScratchBufferStack SBGStringStack;
 #define sb_gstring_release(b) (scratch_buffer_release(&SBGStringStack, (GTrashStack *)b))
 
 #define sb_gstring_string(buffer) (&buffer->s)
+#define sb_gstring_from_string(str) ((SBGString *) (((gchar *) (str)) - G_STRUCT_OFFSET(SBGString, s)))
 
 /* Type-hinted GStrings */
 
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "slab-alloc.h"
+#include "tls-support.h"
+#include "stats/stats-registry.h"
+
+#include <string.h>
+
+/*
+ * Blocks are grouped into power-of-two size classes, starting at
+ * 1 << SLAB_MIN_SHIFT bytes.  Every thread keeps a freelist per size class,
+ * so allocation and release is lockless in the common case.
+ *
+ * As messages are usually allocated by the source thread and freed by the
+ * destination thread, freelists would grow on one side and become empty
+ * on the other.  To balance this, once a thread's freelist reaches two
+ * magazines worth of blocks, one magazine is moved to a global, locked
+ * depot, and threads with an empty freelist grab a complete magazine from
+ * there.  This way the lock is taken once per SLAB_MAGAZINE_SIZE
+ * operations at most.
+ *
+ * Requests that don't fit in the largest size class go to g_malloc()
+ * directly.
+ */
+
+#define SLAB_MIN_SHIFT            8
+#define SLAB_NUM_CLASSES          7
+#define SLAB_MAGAZINE_SIZE        64
+#define SLAB_DEPOT_MAX_MAGAZINES  16
+#define SLAB_STATS_FOLD_INTERVAL  256
+#define SLAB_CLASS_LARGE          ((guint32) -1)
+
+#define SLAB_CLASS_SIZE(cls)      (((gsize) 1) << (SLAB_MIN_SHIFT + (cls)))
+
+/* every block is prefixed with this header, keeps the payload 8 byte aligned */
+typedef struct _SlabHeader
+{
+  guint32 size_class;
+  /* only used for SLAB_CLASS_LARGE */
+  guint32 size;
+} SlabHeader;
+
+/* free blocks are linked through their own memory */
+typedef struct _SlabFreeBlock SlabFreeBlock;
+struct _SlabFreeBlock
+{
+  SlabFreeBlock *next;
+  /* only valid for the first block of a magazine in the depot */
+  SlabFreeBlock *next_magazine;
+};
+
+typedef struct _SlabFreeList
+{
+  SlabFreeBlock *blocks;
+  gint count;
+} SlabFreeList;
+
+TLS_BLOCK_START
+{
+  SlabFreeList slab_local[SLAB_NUM_CLASSES];
+  gint slab_local_hits;
+  gint slab_local_misses;
+  gint slab_local_pooled_bytes;
+  gint slab_local_ops;
+}
+TLS_BLOCK_END;
+
+#define slab_local               __tls_deref(slab_local)
+#define slab_local_hits          __tls_deref(slab_local_hits)
+#define slab_local_misses        __tls_deref(slab_local_misses)
+#define slab_local_pooled_bytes  __tls_deref(slab_local_pooled_bytes)
+#define slab_local_ops           __tls_deref(slab_local_ops)
+
+static GStaticMutex slab_depot_lock = G_STATIC_MUTEX_INIT;
+static SlabFreeList slab_depot[SLAB_NUM_CLASSES];
+
+static StatsCounterItem *count_slab_hits;
+static StatsCounterItem *count_slab_misses;
+static StatsCounterItem *count_slab_pooled_bytes;
+
+static inline gint
+slab_get_size_class(gsize size)
+{
+  gint cls;
+
+  for (cls = 0; cls < SLAB_NUM_CLASSES; cls++)
+    {
+      if (size <= SLAB_CLASS_SIZE(cls))
+        return cls;
+    }
+  return -1;
+}
+
+static void
+slab_fold_stats(void)
+{
+  stats_counter_add(count_slab_hits, slab_local_hits);
+  stats_counter_add(count_slab_misses, slab_local_misses);
+  stats_counter_add(count_slab_pooled_bytes, slab_local_pooled_bytes);
+  slab_local_hits = 0;
+  slab_local_misses = 0;
+  slab_local_pooled_bytes = 0;
+  slab_local_ops = 0;
+}
+
+static inline void
+slab_account_op(void)
+{
+  if (++slab_local_ops >= SLAB_STATS_FOLD_INTERVAL)
+    slab_fold_stats();
+}
+
+/* grab a magazine from the depot if the local freelist is empty */
+static void
+slab_refill(gint cls)
+{
+  SlabFreeList *local = &slab_local[cls];
+  SlabFreeBlock *magazine;
+
+  g_static_mutex_lock(&slab_depot_lock);
+  magazine = slab_depot[cls].blocks;
+  if (magazine)
+    {
+      slab_depot[cls].blocks = magazine->next_magazine;
+      slab_depot[cls].count--;
+    }
+  g_static_mutex_unlock(&slab_depot_lock);
+
+  if (magazine)
+    {
+      local->blocks = magazine;
+      local->count = SLAB_MAGAZINE_SIZE;
+    }
+}
+
+static void
+slab_free_blocks(SlabFreeBlock *blocks, gint cls)
+{
+  SlabFreeBlock *next;
+
+  while (blocks)
+    {
+      next = blocks->next;
+      g_free(blocks);
+      slab_local_pooled_bytes -= SLAB_CLASS_SIZE(cls);
+      blocks = next;
+    }
+}
+
+/* move a magazine from the local freelist to the depot */
+static void
+slab_flush(gint cls)
+{
+  SlabFreeList *local = &slab_local[cls];
+  SlabFreeBlock *magazine, *last;
+  gint i;
+
+  magazine = last = local->blocks;
+  for (i = 1; i < SLAB_MAGAZINE_SIZE; i++)
+    last = last->next;
+  local->blocks = last->next;
+  local->count -= SLAB_MAGAZINE_SIZE;
+  last->next = NULL;
+
+  g_static_mutex_lock(&slab_depot_lock);
+  if (slab_depot[cls].count < SLAB_DEPOT_MAX_MAGAZINES)
+    {
+      magazine->next_magazine = slab_depot[cls].blocks;
+      slab_depot[cls].blocks = magazine;
+      slab_depot[cls].count++;
+      magazine = NULL;
+    }
+  g_static_mutex_unlock(&slab_depot_lock);
+
+  /* the depot is full, give the memory back */
+  slab_free_blocks(magazine, cls);
+}
+
+gpointer
+slab_alloc(gsize size)
+{
+  SlabFreeList *local;
+  SlabHeader *header;
+  gint cls;
+
+  cls = slab_get_size_class(size + sizeof(SlabHeader));
+  if (cls < 0)
+    {
+      header = g_malloc(size + sizeof(SlabHeader));
+      header->size_class = SLAB_CLASS_LARGE;
+      header->size = size;
+      return header + 1;
+    }
+
+  local = &slab_local[cls];
+  if (!local->blocks)
+    slab_refill(cls);
+
+  if (local->blocks)
+    {
+      header = (SlabHeader *) local->blocks;
+      local->blocks = local->blocks->next;
+      local->count--;
+      slab_local_hits++;
+      slab_local_pooled_bytes -= SLAB_CLASS_SIZE(cls);
+    }
+  else
+    {
+      header = g_malloc(SLAB_CLASS_SIZE(cls));
+      slab_local_misses++;
+    }
+  slab_account_op();
+
+  header->size_class = cls;
+  return header + 1;
+}
+
+void
+slab_free(gpointer block)
+{
+  SlabFreeList *local;
+  SlabFreeBlock *free_block;
+  SlabHeader *header;
+  gint cls;
+
+  if (!block)
+    return;
+
+  header = ((SlabHeader *) block) - 1;
+  if (header->size_class == SLAB_CLASS_LARGE)
+    {
+      g_free(header);
+      return;
+    }
+
+  cls = header->size_class;
+  local = &slab_local[cls];
+
+  free_block = (SlabFreeBlock *) header;
+  free_block->next = local->blocks;
+  local->blocks = free_block;
+  local->count++;
+  slab_local_pooled_bytes += SLAB_CLASS_SIZE(cls);
+
+  if (local->count >= 2 * SLAB_MAGAZINE_SIZE)
+    slab_flush(cls);
+  slab_account_op();
+}
+
+gpointer
+slab_realloc(gpointer block, gsize size)
+{
+  SlabHeader *header;
+  gpointer new_block;
+  gsize old_size;
+
+  if (!block)
+    return slab_alloc(size);
+
+  header = ((SlabHeader *) block) - 1;
+  if (header->size_class == SLAB_CLASS_LARGE)
+    {
+      if (slab_get_size_class(size + sizeof(SlabHeader)) < 0)
+        {
+          header = g_realloc(header, size + sizeof(SlabHeader));
+          header->size = size;
+          return header + 1;
+        }
+      old_size = header->size;
+    }
+  else
+    {
+      old_size = SLAB_CLASS_SIZE(header->size_class) - sizeof(SlabHeader);
+      if (size <= old_size)
+        return block;
+    }
+
+  new_block = slab_alloc(size);
+  memcpy(new_block, block, MIN(old_size, size));
+  slab_free(block);
+  return new_block;
+}
+
+/* give the thread's freelists to the depot, as the thread is exiting */
+void
+slab_alloc_thread_deinit(void)
+{
+  gint cls;
+
+  for (cls = 0; cls < SLAB_NUM_CLASSES; cls++)
+    {
+      while (slab_local[cls].count >= SLAB_MAGAZINE_SIZE)
+        slab_flush(cls);
+      slab_free_blocks(slab_local[cls].blocks, cls);
+      slab_local[cls].blocks = NULL;
+      slab_local[cls].count = 0;
+    }
+  slab_fold_stats();
+}
+
+void
+slab_alloc_global_init(void)
+{
+  stats_lock();
+  stats_register_counter(0, SCS_GLOBAL, "slab_alloc_hits", NULL, SC_TYPE_PROCESSED, &count_slab_hits);
+  stats_register_counter(0, SCS_GLOBAL, "slab_alloc_misses", NULL, SC_TYPE_PROCESSED, &count_slab_misses);
+  stats_register_counter(0, SCS_GLOBAL, "slab_alloc_pooled_bytes", NULL, SC_TYPE_STORED, &count_slab_pooled_bytes);
+  stats_unlock();
+}
+
+void
+slab_alloc_global_deinit(void)
+{
+  SlabFreeBlock *magazine, *next;
+  gint cls;
+
+  slab_alloc_thread_deinit();
+
+  g_static_mutex_lock(&slab_depot_lock);
+  for (cls = 0; cls < SLAB_NUM_CLASSES; cls++)
+    {
+      for (magazine = slab_depot[cls].blocks; magazine; magazine = next)
+        {
+          next = magazine->next_magazine;
+          slab_free_blocks(magazine, cls);
+        }
+      slab_depot[cls].blocks = NULL;
+      slab_depot[cls].count = 0;
+    }
+  g_static_mutex_unlock(&slab_depot_lock);
+  slab_fold_stats();
+
+  stats_lock();
+  stats_unregister_counter(SCS_GLOBAL, "slab_alloc_hits", NULL, SC_TYPE_PROCESSED, &count_slab_hits);
+  stats_unregister_counter(SCS_GLOBAL, "slab_alloc_misses", NULL, SC_TYPE_PROCESSED, &count_slab_misses);
+  stats_unregister_counter(SCS_GLOBAL, "slab_alloc_pooled_bytes", NULL, SC_TYPE_STORED, &count_slab_pooled_bytes);
+  stats_unlock();
+}
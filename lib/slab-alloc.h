@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef SLAB_ALLOC_H_INCLUDED
+#define SLAB_ALLOC_H_INCLUDED
+
+#include "syslog-ng.h"
+
+/*
+ * Size-classed allocator with per-thread freelists, used for LogMessage
+ * and NVTable blocks. Blocks must be released with slab_free(), they can
+ * be freed by any thread.
+ */
+gpointer slab_alloc(gsize size);
+gpointer slab_realloc(gpointer block, gsize size);
+void slab_free(gpointer block);
+
+void slab_alloc_thread_deinit(void);
+void slab_alloc_global_init(void);
+void slab_alloc_global_deinit(void);
+
+#endif
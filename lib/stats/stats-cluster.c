@@ -39,6 +39,33 @@ stats_cluster_foreach_counter(StatsCluster *self, StatsForeachCounterFunc func,
     }
 }
 
+void
+stats_cluster_foreach_histogram(StatsCluster *self, StatsForeachHistogramFunc func, gpointer user_data)
+{
+  gint type;
+
+  for (type = 0; type < SC_HISTOGRAM_MAX; type++)
+    {
+      if (self->histograms[type])
+        {
+          func(self, type, self->histograms[type], user_data);
+        }
+    }
+}
+
+const gchar *
+stats_cluster_get_histogram_type_name(gint type)
+{
+  static const gchar *histogram_names[SC_HISTOGRAM_MAX] =
+  {
+    /* [SC_HISTOGRAM_QUEUE_LATENCY]    = */ "queue_latency",
+    /* [SC_HISTOGRAM_DELIVERY_LATENCY] = */ "delivery_latency",
+    /* [SC_HISTOGRAM_LATENCY]          = */ "latency",
+  };
+
+  return histogram_names[type];
+}
+
 const gchar *
 stats_cluster_get_type_name(gint type)
 {
@@ -49,6 +76,7 @@ stats_cluster_get_type_name(gint type)
     /* [SC_TYPE_STORED]   = */  "stored",
     /* [SC_TYPE_SUPPRESSED] = */ "suppressed",
     /* [SC_TYPE_STAMP] = */ "stamp",
+    /* [SC_TYPE_ELAPSED] = */ "elapsed_ns",
   };
 
   return tag_names[type];
@@ -92,6 +120,7 @@ _get_module_name(gint source)
     "stomp",
     "redis",
     "snmp",
+    "regexp",
   };
   return module_names[source & SCS_SOURCE_MASK];
 }
@@ -160,6 +189,27 @@ stats_cluster_untrack_counter(StatsCluster *self, gint type, StatsCounterItem **
   *counter = NULL;
 }
 
+StatsHistogram *
+stats_cluster_track_histogram(StatsCluster *self, gint type)
+{
+  g_assert(type < SC_HISTOGRAM_MAX);
+
+  if (!self->histograms[type])
+    self->histograms[type] = g_new0(StatsHistogram, 1);
+  self->use_count++;
+  return self->histograms[type];
+}
+
+void
+stats_cluster_untrack_histogram(StatsCluster *self, gint type, StatsHistogram **histogram)
+{
+  g_assert(self && self->histograms[type] && self->histograms[type] == (*histogram));
+  g_assert(self->use_count > 0);
+
+  self->use_count--;
+  *histogram = NULL;
+}
+
 StatsCluster *
 stats_cluster_new(gint component, const gchar *id, const gchar *instance)
 {
@@ -175,6 +225,12 @@ stats_cluster_new(gint component, const gchar *id, const gchar *instance)
 void
 stats_cluster_free(StatsCluster *self)
 { 
+  gint type;
+
+  for (type = 0; type < SC_TYPE_MAX; type++)
+    stats_counter_free_slots(&self->counters[type]);
+  for (type = 0; type < SC_HISTOGRAM_MAX; type++)
+    g_free(self->histograms[type]);
   g_free(self->id);
   g_free(self->instance);
   g_free(self);
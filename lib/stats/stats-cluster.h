@@ -25,6 +25,7 @@
 #define STATS_CLUSTER_H_INCLUDED 1
 
 #include "stats/stats-counter.h"
+#include "stats/stats-histogram.h"
 
 typedef enum
 {
@@ -34,9 +35,18 @@ typedef enum
   SC_TYPE_STORED,    /* number of messages on disk */
   SC_TYPE_SUPPRESSED,/* number of messages suppressed */
   SC_TYPE_STAMP,     /* timestamp */
+  SC_TYPE_ELAPSED,   /* time spent processing, in nanoseconds */
   SC_TYPE_MAX
 } StatsCounterType;
 
+typedef enum
+{
+  SC_HISTOGRAM_QUEUE_LATENCY = 0,  /* time spent waiting in a queue */
+  SC_HISTOGRAM_DELIVERY_LATENCY,   /* time between taking a message from the queue and its ack */
+  SC_HISTOGRAM_LATENCY,            /* time between the reception of a message and its ack */
+  SC_HISTOGRAM_MAX
+} StatsHistogramType;
+
 enum
 {
   /* direction bits, used to distinguish between source/destination drivers */
@@ -76,6 +86,7 @@ enum
   SCS_STOMP          = 30,
   SCS_REDIS          = 31,
   SCS_SNMP           = 32,
+  SCS_REGEXP         = 33,
   SCS_MAX,
   SCS_SOURCE_MASK    = 0xff
 };
@@ -92,6 +103,8 @@ enum
 typedef struct _StatsCluster
 {
   StatsCounterItem counters[SC_TYPE_MAX];
+  /* allocated on first use */
+  StatsHistogram *histograms[SC_HISTOGRAM_MAX];
   guint16 use_count;
   /* syslog-ng component/driver/subsystem that registered this cluster */
   guint16 component;
@@ -102,17 +115,22 @@ typedef struct _StatsCluster
 } StatsCluster;
 
 typedef void (*StatsForeachCounterFunc)(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data);
+typedef void (*StatsForeachHistogramFunc)(StatsCluster *sc, gint type, StatsHistogram *histogram, gpointer user_data);
 
 const gchar *stats_cluster_get_type_name(gint type);
+const gchar *stats_cluster_get_histogram_type_name(gint type);
 const gchar *stats_cluster_get_component_name(StatsCluster *self, gchar *buf, gsize buf_len);
 
 void stats_cluster_foreach_counter(StatsCluster *self, StatsForeachCounterFunc func, gpointer user_data);
+void stats_cluster_foreach_histogram(StatsCluster *self, StatsForeachHistogramFunc func, gpointer user_data);
 
 gboolean stats_cluster_equal(const StatsCluster *sc1, const StatsCluster *sc2);
 guint stats_cluster_hash(const StatsCluster *self);
 
 StatsCounterItem *stats_cluster_track_counter(StatsCluster *self, gint type);
 void stats_cluster_untrack_counter(StatsCluster *self, gint type, StatsCounterItem **counter);
+StatsHistogram *stats_cluster_track_histogram(StatsCluster *self, gint type);
+void stats_cluster_untrack_histogram(StatsCluster *self, gint type, StatsHistogram **histogram);
 
 StatsCluster *stats_cluster_new(gint component, const gchar *id, const gchar *instance);
 void stats_cluster_free(StatsCluster *self);
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-counter.h"
+#include "tls-support.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+TLS_BLOCK_START
+{
+  /* slot index + 1, 0 means not assigned yet */
+  gint stats_counter_slot;
+}
+TLS_BLOCK_END;
+
+#define stats_counter_slot  __tls_deref(stats_counter_slot)
+
+static gint stats_counter_next_slot;
+
+gint
+stats_counter_get_slot(void)
+{
+  if (G_UNLIKELY(stats_counter_slot == 0))
+    stats_counter_slot = (((guint) __sync_fetch_and_add(&stats_counter_next_slot, 1)) % STATS_COUNTER_SLOTS) + 1;
+  return stats_counter_slot - 1;
+}
+
+/*
+ * Turns @counter into a sharded counter.  Concurrent updates are not lost,
+ * as @value is still part of the sum.  Slots are freed together with the
+ * counter, see stats_counter_free_slots().
+ *
+ * NOTE: stats_lock() must be held.
+ */
+void
+stats_counter_enable_slots(StatsCounterItem *counter)
+{
+  gpointer slots;
+
+  if (counter->slots)
+    return;
+
+  if (posix_memalign(&slots, STATS_COUNTER_CACHE_LINE_SIZE, STATS_COUNTER_SLOTS * sizeof(StatsCounterSlot)) != 0)
+    return;
+  memset(slots, 0, STATS_COUNTER_SLOTS * sizeof(StatsCounterSlot));
+  g_atomic_pointer_set(&counter->slots, slots);
+}
+
+void
+stats_counter_free_slots(StatsCounterItem *counter)
+{
+  free(counter->slots);
+  counter->slots = NULL;
+}
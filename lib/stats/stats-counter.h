@@ -26,49 +26,85 @@
 
 #include "syslog-ng.h"
 
+/* number of slots of a sharded counter, threads are assigned to slots
+ * round-robin, so that concurrent writers don't share a cache line */
+#define STATS_COUNTER_SLOTS             16
+#define STATS_COUNTER_CACHE_LINE_SIZE   64
+
+typedef struct _StatsCounterSlot
+{
+  gint64 value;
+} __attribute__((aligned(STATS_COUNTER_CACHE_LINE_SIZE))) StatsCounterSlot;
+
 typedef struct _StatsCounterItem
 {
-  gint value;
+  gint64 value;
+  /* if non-NULL, updates go to the slot of the current thread and the
+   * value of the counter is the sum of @value and all slots */
+  StatsCounterSlot *slots;
 } StatsCounterItem;
 
+gint stats_counter_get_slot(void);
+void stats_counter_enable_slots(StatsCounterItem *counter);
+void stats_counter_free_slots(StatsCounterItem *counter);
 
 static inline void
 stats_counter_add(StatsCounterItem *counter, gint add)
 {
   if (counter)
-    g_atomic_int_add(&counter->value, add);
+    {
+      if (counter->slots)
+        __sync_fetch_and_add(&counter->slots[stats_counter_get_slot()].value, add);
+      else
+        __sync_fetch_and_add(&counter->value, add);
+    }
 }
 
 static inline void
 stats_counter_inc(StatsCounterItem *counter)
 {
-  if (counter)
-    g_atomic_int_inc(&counter->value);
+  stats_counter_add(counter, 1);
 }
 
 static inline void
 stats_counter_dec(StatsCounterItem *counter)
 {
-  if (counter)
-    g_atomic_int_add(&counter->value, -1);
+  stats_counter_add(counter, -1);
 }
 
 /* NOTE: this is _not_ atomic and doesn't have to be as sets would race anyway */
 static inline void
-stats_counter_set(StatsCounterItem *counter, guint32 value)
+stats_counter_set(StatsCounterItem *counter, guint64 value)
 {
+  gint i;
+
   if (counter)
-    counter->value = value;
+    {
+      counter->value = value;
+      if (counter->slots)
+        {
+          for (i = 0; i < STATS_COUNTER_SLOTS; i++)
+            counter->slots[i].value = 0;
+        }
+    }
 }
 
-/* NOTE: this is _not_ atomic and doesn't have to be as sets would race anyway */
-static inline guint32
+static inline guint64
 stats_counter_get(StatsCounterItem *counter)
 {
-  guint32 result = 0;
+  gint64 result = 0;
+  gint i;
 
   if (counter)
-    result = counter->value;
+    {
+      /* atomic reads, so that 64 bit values are not torn on 32 bit platforms */
+      result = __sync_fetch_and_add(&counter->value, 0);
+      if (counter->slots)
+        {
+          for (i = 0; i < STATS_COUNTER_SLOTS; i++)
+            result += __sync_fetch_and_add(&counter->slots[i].value, 0);
+        }
+    }
   return result;
 }
 
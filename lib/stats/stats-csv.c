@@ -23,6 +23,7 @@
  */
 #include "stats/stats-csv.h"
 #include "stats/stats-registry.h"
+#include "stats/stats-dynamic.h"
 #include "misc.h"
 
 #include <string.h>
@@ -97,7 +98,7 @@ stats_format_csv(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointe
     state = 'a';
 
   tag_name = stats_format_csv_escapevar(stats_cluster_get_type_name(type));
-  g_string_append_printf(csv, "%s;%s;%s;%c;%s;%u\n",
+  g_string_append_printf(csv, "%s;%s;%s;%c;%s;%" G_GUINT64_FORMAT "\n",
                          stats_cluster_get_component_name(sc, buf, sizeof(buf)),
                          s_id, s_instance, state, tag_name, stats_counter_get(&sc->counters[type]));
   g_free(tag_name);
@@ -113,6 +114,7 @@ stats_generate_csv(void)
 
   g_string_append_printf(csv, "%s;%s;%s;%s;%s;%s\n", "SourceName", "SourceId", "SourceInstance", "State", "Type", "Number");
   stats_lock();
+  stats_dynamic_counters_flush();
   stats_foreach_counter(stats_format_csv, csv);
   stats_unlock();
   return g_string_free(csv, FALSE);
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-dynamic.h"
+#include "stats/stats-registry.h"
+#include "tls-support.h"
+
+/*
+ * Per-thread dynamic counters
+ *
+ * Dynamic counters keyed by information found in the log stream (host,
+ * sender, program) would need stats_lock() and a lookup in the global
+ * registry for every message.  Instead, every thread accumulates these in
+ * its own hash table, which is merged into the registry by
+ * stats_dynamic_counters_flush(), invoked whenever the registry is about
+ * to be published (stats timer, STATS control command).
+ *
+ * The per-thread table is protected by its own mutex, which is only
+ * contended while a flush is running, so the hot path never touches a
+ * global lock.  Locking order: stats_lock, stats_local_list_lock and
+ * finally the lock of the per-thread table.
+ */
+
+typedef struct _StatsLocalCounter
+{
+  /* only component & instance are used, as the hash key */
+  StatsCluster key;
+  gint stats_level;
+  guint32 count;
+  time_t stamp;
+} StatsLocalCounter;
+
+typedef struct _StatsLocalCounters
+{
+  GStaticMutex lock;
+  GHashTable *counters;
+} StatsLocalCounters;
+
+TLS_BLOCK_START
+{
+  StatsLocalCounters *stats_local_counters;
+}
+TLS_BLOCK_END;
+
+#define stats_local_counters  __tls_deref(stats_local_counters)
+
+static GStaticMutex stats_local_list_lock = G_STATIC_MUTEX_INIT;
+static GList *stats_local_list;
+
+static StatsLocalCounters *
+stats_local_counters_new(void)
+{
+  StatsLocalCounters *self = g_new0(StatsLocalCounters, 1);
+
+  g_static_mutex_init(&self->lock);
+  self->counters = g_hash_table_new_full((GHashFunc) stats_cluster_hash, (GEqualFunc) stats_cluster_equal, NULL, (GDestroyNotify) stats_cluster_free);
+
+  g_static_mutex_lock(&stats_local_list_lock);
+  stats_local_list = g_list_prepend(stats_local_list, self);
+  g_static_mutex_unlock(&stats_local_list_lock);
+  return self;
+}
+
+static void
+stats_local_counters_free(StatsLocalCounters *self)
+{
+  g_hash_table_destroy(self->counters);
+  g_static_mutex_free(&self->lock);
+  g_free(self);
+}
+
+/* NOTE: stats_lock() must be held */
+static gboolean
+_flush_local_counter(gpointer key, gpointer value, gpointer user_data)
+{
+  StatsLocalCounter *lc = (StatsLocalCounter *) value;
+
+  /* drop entries that were idle since the last flush, so that the table
+   * doesn't grow with every host that ever sent a message */
+  if (lc->count == 0)
+    return TRUE;
+
+  stats_register_and_add_dynamic_counter(lc->stats_level, lc->key.component, NULL, lc->key.instance, lc->count, lc->stamp);
+  lc->count = 0;
+  return FALSE;
+}
+
+static void
+stats_local_counters_flush(StatsLocalCounters *self)
+{
+  g_static_mutex_lock(&self->lock);
+  g_hash_table_foreach_remove(self->counters, _flush_local_counter, NULL);
+  g_static_mutex_unlock(&self->lock);
+}
+
+/*
+ * stats_dynamic_counter_inc:
+ * @timestamp: if non-negative, an associated timestamp will be set
+ *
+ * Counts a message for a dynamic counter in the current thread, the
+ * per-thread counts become visible in the registry at the next flush.
+ * The counterpart of stats_register_and_increment_dynamic_counter(),
+ * which doesn't need stats_lock().
+ */
+void
+stats_dynamic_counter_inc(gint stats_level, gint component, const gchar *instance, time_t timestamp)
+{
+  StatsLocalCounters *self;
+  StatsLocalCounter *lc;
+  StatsCluster key;
+
+  if (!stats_check_level(stats_level))
+    return;
+
+  self = stats_local_counters;
+  if (G_UNLIKELY(!self))
+    {
+      self = stats_local_counters_new();
+      stats_local_counters = self;
+    }
+
+  key.component = component;
+  key.id = "";
+  key.instance = (gchar *) (instance ? : "");
+
+  g_static_mutex_lock(&self->lock);
+  lc = g_hash_table_lookup(self->counters, &key);
+  if (!lc)
+    {
+      lc = g_new0(StatsLocalCounter, 1);
+      lc->key.component = component;
+      lc->key.id = g_strdup("");
+      lc->key.instance = g_strdup(key.instance);
+      lc->stats_level = stats_level;
+      g_hash_table_insert(self->counters, &lc->key, lc);
+    }
+  lc->count++;
+  lc->stamp = timestamp;
+  g_static_mutex_unlock(&self->lock);
+}
+
+/* NOTE: stats_lock() must be held */
+void
+stats_dynamic_counters_flush(void)
+{
+  GList *l;
+
+  g_static_mutex_lock(&stats_local_list_lock);
+  for (l = stats_local_list; l; l = l->next)
+    stats_local_counters_flush((StatsLocalCounters *) l->data);
+  g_static_mutex_unlock(&stats_local_list_lock);
+}
+
+/* merge the counts of the exiting thread into the registry */
+void
+stats_dynamic_counters_thread_deinit(void)
+{
+  StatsLocalCounters *self = stats_local_counters;
+
+  if (!self)
+    return;
+
+  stats_lock();
+  g_static_mutex_lock(&stats_local_list_lock);
+  stats_local_list = g_list_remove(stats_local_list, self);
+  g_static_mutex_unlock(&stats_local_list_lock);
+  stats_local_counters_flush(self);
+  stats_unlock();
+
+  stats_local_counters_free(self);
+  stats_local_counters = NULL;
+}
+
+/* frees the tables of threads that exited without calling thread_deinit */
+void
+stats_dynamic_counters_global_deinit(void)
+{
+  g_static_mutex_lock(&stats_local_list_lock);
+  g_list_foreach(stats_local_list, (GFunc) stats_local_counters_free, NULL);
+  g_list_free(stats_local_list);
+  stats_local_list = NULL;
+  g_static_mutex_unlock(&stats_local_list_lock);
+  stats_local_counters = NULL;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-histogram.h"
+
+#include <time.h>
+
+/* the largest value (inclusive) that falls into @bucket */
+guint64
+stats_histogram_get_bucket_upper_bound(gint bucket)
+{
+  gint shift;
+  guint64 sub;
+
+  if (bucket < STATS_HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+  if (bucket >= STATS_HISTOGRAM_BUCKETS - 1)
+    return G_MAXUINT64;
+
+  shift = (bucket >> STATS_HISTOGRAM_SUB_BUCKET_BITS) - 1;
+  sub = bucket & (STATS_HISTOGRAM_SUB_BUCKETS - 1);
+  return ((STATS_HISTOGRAM_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+/* copies the histogram, while it is being updated concurrently */
+void
+stats_histogram_snapshot(StatsHistogram *self, StatsHistogram *snapshot)
+{
+  gint i;
+
+  snapshot->count = 0;
+  for (i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+    {
+      snapshot->buckets[i] = __sync_fetch_and_add(&self->buckets[i], 0);
+      snapshot->count += snapshot->buckets[i];
+    }
+  /* the sum may be slightly off compared to the buckets, but count is
+   * kept consistent with them */
+  snapshot->sum = __sync_fetch_and_add(&self->sum, 0);
+}
+
+/* returns the upper bound of the bucket containing the given percentile (0-100) */
+guint64
+stats_histogram_get_percentile(StatsHistogram *self, gdouble percentile)
+{
+  gint64 rank, seen = 0;
+  gint i;
+
+  if (self->count == 0)
+    return 0;
+
+  rank = (gint64) (self->count * percentile / 100.0 + 0.5);
+  if (rank < 1)
+    rank = 1;
+  for (i = 0; i < STATS_HISTOGRAM_BUCKETS; i++)
+    {
+      seen += self->buckets[i];
+      if (seen >= rank)
+        return stats_histogram_get_bucket_upper_bound(i);
+    }
+  return G_MAXUINT64;
+}
+
+guint64
+stats_histogram_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (guint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
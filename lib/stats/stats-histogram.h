@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#ifndef STATS_HISTOGRAM_H_INCLUDED
+#define STATS_HISTOGRAM_H_INCLUDED 1
+
+#include "syslog-ng.h"
+
+/*
+ * HDR style histogram of durations, measured in microseconds.
+ *
+ * Buckets are log-linear: every power of two range is split into
+ * 1 << STATS_HISTOGRAM_SUB_BUCKET_BITS equal buckets, which keeps the
+ * relative error below 25% over the whole range, while recording a value
+ * is a few shifts and an atomic add.  Values above
+ * 1 << STATS_HISTOGRAM_MAX_SHIFT usecs (~19 hours) go to the last bucket.
+ */
+#define STATS_HISTOGRAM_SUB_BUCKET_BITS  2
+#define STATS_HISTOGRAM_SUB_BUCKETS      (1 << STATS_HISTOGRAM_SUB_BUCKET_BITS)
+#define STATS_HISTOGRAM_MAX_SHIFT        36
+#define STATS_HISTOGRAM_BUCKETS          ((STATS_HISTOGRAM_MAX_SHIFT - STATS_HISTOGRAM_SUB_BUCKET_BITS + 1) * STATS_HISTOGRAM_SUB_BUCKETS)
+
+typedef struct _StatsHistogram
+{
+  gint64 count;
+  /* sum of the recorded values, in usecs */
+  gint64 sum;
+  gint64 buckets[STATS_HISTOGRAM_BUCKETS];
+} StatsHistogram;
+
+static inline gint
+stats_histogram_get_bucket(guint64 value)
+{
+  gint shift;
+
+  if (value < STATS_HISTOGRAM_SUB_BUCKETS)
+    return value;
+  if (value >= (G_GUINT64_CONSTANT(1) << STATS_HISTOGRAM_MAX_SHIFT))
+    return STATS_HISTOGRAM_BUCKETS - 1;
+
+  /* the position of the highest bit set */
+  shift = 63 - __builtin_clzll(value);
+  return ((shift - STATS_HISTOGRAM_SUB_BUCKET_BITS + 1) << STATS_HISTOGRAM_SUB_BUCKET_BITS) +
+         ((value >> (shift - STATS_HISTOGRAM_SUB_BUCKET_BITS)) & (STATS_HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+static inline void
+stats_histogram_record(StatsHistogram *self, guint64 value)
+{
+  if (self)
+    {
+      __sync_fetch_and_add(&self->buckets[stats_histogram_get_bucket(value)], 1);
+      __sync_fetch_and_add(&self->sum, value);
+      __sync_fetch_and_add(&self->count, 1);
+    }
+}
+
+guint64 stats_histogram_get_bucket_upper_bound(gint bucket);
+void stats_histogram_snapshot(StatsHistogram *self, StatsHistogram *snapshot);
+guint64 stats_histogram_get_percentile(StatsHistogram *self, gdouble percentile);
+
+/* monotonic time in usecs, the clock used to measure durations */
+guint64 stats_histogram_now(void);
+
+#endif
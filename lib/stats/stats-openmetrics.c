@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+#include "stats/stats-openmetrics.h"
+#include "stats/stats-registry.h"
+#include "stats/stats-dynamic.h"
+
+#include <string.h>
+
+/*
+ * Exports the stats registry in the OpenMetrics text format.
+ *
+ * Registration of counters would be blocked while the export is running,
+ * if it was formatted with stats_lock() held.  Therefore only the values
+ * and labels of the counters are copied under the lock, the text itself
+ * is produced from this snapshot in chunks of the requested size, without
+ * holding the lock, as the consumer (e.g. a control connection) is able
+ * to take it.
+ *
+ * Every counter type is a metric family, with the component, id and
+ * instance of the StatsCluster as labels, e.g.:
+ *
+ *   # TYPE syslogng_processed counter
+ *   syslogng_processed_total{component="src.file",id="s_local#0",instance="/var/log/messages"} 1234
+ *
+ * The "stored" family is a gauge holding the number of messages waiting
+ * in the queue of a destination, memory pool statistics are published as
+ * "global" counters.  Latency histograms follow the counters, only their
+ * non-empty buckets are listed.
+ */
+
+/* families of counters are indexed by StatsCounterType, those of
+ * histograms by StatsHistogramType + SC_TYPE_MAX */
+#define STATS_OPENMETRICS_FAMILIES (SC_TYPE_MAX + SC_HISTOGRAM_MAX)
+
+typedef struct _StatsOpenMetricsFamily
+{
+  const gchar *name;
+  const gchar *type;
+  const gchar *help;
+  /* appended to the family name in samples, e.g. "_total" for counters */
+  const gchar *sample_suffix;
+} StatsOpenMetricsFamily;
+
+static StatsOpenMetricsFamily stats_openmetrics_families[STATS_OPENMETRICS_FAMILIES] =
+{
+  /* [SC_TYPE_DROPPED]    = */ { "syslogng_dropped", "counter", "Number of messages dropped", "_total" },
+  /* [SC_TYPE_PROCESSED]  = */ { "syslogng_processed", "counter", "Number of messages processed", "_total" },
+  /* [SC_TYPE_STORED]     = */ { "syslogng_stored", "gauge", "Number of messages waiting in the queue", "" },
+  /* [SC_TYPE_SUPPRESSED] = */ { "syslogng_suppressed", "counter", "Number of messages suppressed as repeated", "_total" },
+  /* [SC_TYPE_STAMP]      = */ { "syslogng_last_message_timestamp_seconds", "gauge", "Time of the last message", "" },
+  /* [SC_TYPE_ELAPSED]    = */ { "syslogng_elapsed_nanoseconds", "counter", "Time spent processing messages", "_total" },
+  /* [SC_HISTOGRAM_QUEUE_LATENCY]    = */ { "syslogng_queue_latency_seconds", "histogram", "Time messages spent in the queue", "" },
+  /* [SC_HISTOGRAM_DELIVERY_LATENCY] = */ { "syslogng_delivery_latency_seconds", "histogram", "Time between taking messages from the queue and their acknowledgement", "" },
+  /* [SC_HISTOGRAM_LATENCY]          = */ { "syslogng_latency_seconds", "histogram", "Time between the reception of messages and their acknowledgement", "" },
+};
+
+typedef struct _StatsOpenMetricsSample
+{
+  gchar *component;
+  gchar *id;
+  gchar *instance;
+  guint64 value;
+  /* only for histogram families */
+  StatsHistogram *histogram;
+} StatsOpenMetricsSample;
+
+struct _StatsOpenMetricsExport
+{
+  /* one array of StatsOpenMetricsSample per family */
+  GArray *samples[STATS_OPENMETRICS_FAMILIES];
+  /* position of the formatting */
+  gint family;
+  guint index;
+  gboolean header_done;
+  gboolean finished;
+};
+
+static void
+_snapshot_labels(StatsOpenMetricsSample *sample, StatsCluster *sc)
+{
+  gchar buf[32];
+
+  sample->component = g_strdup(stats_cluster_get_component_name(sc, buf, sizeof(buf)));
+  sample->id = g_strdup(sc->id);
+  sample->instance = g_strdup(sc->instance);
+}
+
+static void
+_snapshot_counter(StatsCluster *sc, gint type, StatsCounterItem *counter, gpointer user_data)
+{
+  StatsOpenMetricsExport *self = (StatsOpenMetricsExport *) user_data;
+  StatsOpenMetricsSample sample;
+
+  _snapshot_labels(&sample, sc);
+  sample.value = stats_counter_get(counter);
+  sample.histogram = NULL;
+  g_array_append_val(self->samples[type], sample);
+}
+
+static void
+_snapshot_histogram(StatsCluster *sc, gint type, StatsHistogram *histogram, gpointer user_data)
+{
+  StatsOpenMetricsExport *self = (StatsOpenMetricsExport *) user_data;
+  StatsOpenMetricsSample sample;
+
+  _snapshot_labels(&sample, sc);
+  sample.histogram = g_new(StatsHistogram, 1);
+  stats_histogram_snapshot(histogram, sample.histogram);
+  sample.value = sample.histogram->count;
+  g_array_append_val(self->samples[SC_TYPE_MAX + type], sample);
+}
+
+StatsOpenMetricsExport *
+stats_openmetrics_export_new(void)
+{
+  StatsOpenMetricsExport *self = g_new0(StatsOpenMetricsExport, 1);
+  gint family;
+
+  for (family = 0; family < STATS_OPENMETRICS_FAMILIES; family++)
+    self->samples[family] = g_array_new(FALSE, FALSE, sizeof(StatsOpenMetricsSample));
+
+  stats_lock();
+  stats_dynamic_counters_flush();
+  stats_foreach_counter(_snapshot_counter, self);
+  stats_foreach_histogram(_snapshot_histogram, self);
+  stats_unlock();
+  return self;
+}
+
+static void
+_append_label_value(GString *output, const gchar *value)
+{
+  const gchar *p;
+
+  for (p = value; *p; p++)
+    {
+      switch (*p)
+        {
+        case '\\':
+          g_string_append(output, "\\\\");
+          break;
+        case '"':
+          g_string_append(output, "\\\"");
+          break;
+        case '\n':
+          g_string_append(output, "\\n");
+          break;
+        default:
+          g_string_append_c(output, *p);
+          break;
+        }
+    }
+}
+
+/* appends name{labels without the closing brace */
+static void
+_format_sample_start(GString *output, StatsOpenMetricsFamily *family, const gchar *suffix, StatsOpenMetricsSample *sample)
+{
+  g_string_append(output, family->name);
+  g_string_append(output, suffix);
+  g_string_append(output, "{component=\"");
+  _append_label_value(output, sample->component);
+  g_string_append(output, "\",id=\"");
+  _append_label_value(output, sample->id);
+  g_string_append(output, "\",instance=\"");
+  _append_label_value(output, sample->instance);
+  g_string_append_c(output, '"');
+}
+
+static void
+_format_counter_sample(GString *output, StatsOpenMetricsFamily *family, StatsOpenMetricsSample *sample)
+{
+  _format_sample_start(output, family, family->sample_suffix, sample);
+  g_string_append_printf(output, "} %" G_GUINT64_FORMAT "\n", sample->value);
+}
+
+static void
+_format_histogram_sample(GString *output, StatsOpenMetricsFamily *family, StatsOpenMetricsSample *sample)
+{
+  StatsHistogram *histogram = sample->histogram;
+  gint64 cumulative = 0;
+  gint i;
+
+  for (i = 0; i < STATS_HISTOGRAM_BUCKETS - 1; i++)
+    {
+      if (histogram->buckets[i] == 0)
+        continue;
+
+      cumulative += histogram->buckets[i];
+      _format_sample_start(output, family, "_bucket", sample);
+      g_string_append_printf(output, ",le=\"%.6f\"} %" G_GINT64_FORMAT "\n",
+                             stats_histogram_get_bucket_upper_bound(i) / 1e6, cumulative);
+    }
+  _format_sample_start(output, family, "_bucket", sample);
+  g_string_append_printf(output, ",le=\"+Inf\"} %" G_GINT64_FORMAT "\n", histogram->count);
+  _format_sample_start(output, family, "_count", sample);
+  g_string_append_printf(output, "} %" G_GINT64_FORMAT "\n", histogram->count);
+  _format_sample_start(output, family, "_sum", sample);
+  g_string_append_printf(output, "} %.6f\n", histogram->sum / 1e6);
+}
+
+/*
+ * Appends the next part of the export to @output, stopping once @output
+ * is longer than @max_len.  Returns FALSE if the export is complete, in
+ * which case the terminating "# EOF" line has been appended.
+ */
+gboolean
+stats_openmetrics_export_format_next(StatsOpenMetricsExport *self, GString *output, gsize max_len)
+{
+  if (self->finished)
+    return FALSE;
+
+  while (self->family < STATS_OPENMETRICS_FAMILIES)
+    {
+      StatsOpenMetricsFamily *family = &stats_openmetrics_families[self->family];
+      GArray *samples = self->samples[self->family];
+
+      if (output->len >= max_len)
+        return TRUE;
+
+      if (samples->len > 0 && !self->header_done)
+        {
+          g_string_append_printf(output, "# TYPE %s %s\n# HELP %s %s\n", family->name, family->type, family->name, family->help);
+          self->header_done = TRUE;
+        }
+
+      while (self->index < samples->len && output->len < max_len)
+        {
+          StatsOpenMetricsSample *sample = &g_array_index(samples, StatsOpenMetricsSample, self->index);
+
+          if (sample->histogram)
+            _format_histogram_sample(output, family, sample);
+          else
+            _format_counter_sample(output, family, sample);
+          self->index++;
+        }
+
+      if (self->index < samples->len)
+        return TRUE;
+
+      self->family++;
+      self->index = 0;
+      self->header_done = FALSE;
+    }
+
+  g_string_append(output, "# EOF\n");
+  self->finished = TRUE;
+  return FALSE;
+}
+
+void
+stats_openmetrics_export_free(StatsOpenMetricsExport *self)
+{
+  gint family;
+  guint i;
+
+  for (family = 0; family < STATS_OPENMETRICS_FAMILIES; family++)
+    {
+      for (i = 0; i < self->samples[family]->len; i++)
+        {
+          StatsOpenMetricsSample *sample = &g_array_index(self->samples[family], StatsOpenMetricsSample, i);
+
+          g_free(sample->component);
+          g_free(sample->id);
+          g_free(sample->instance);
+          g_free(sample->histogram);
+        }
+      g_array_free(self->samples[family], TRUE);
+    }
+  g_free(self);
+}
+
+gchar *
+stats_generate_openmetrics(void)
+{
+  StatsOpenMetricsExport *export = stats_openmetrics_export_new();
+  GString *output = g_string_sized_new(1024);
+
+  while (stats_openmetrics_export_format_next(export, output, G_MAXSIZE))
+    ;
+  stats_openmetrics_export_free(export);
+  return g_string_free(output, FALSE);
+}
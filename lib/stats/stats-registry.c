@@ -119,6 +119,22 @@ stats_register_counter(gint stats_level, gint component, const gchar *id, const
   _register_counter(stats_level, component, id, instance, type, FALSE, counter);
 }
 
+/**
+ * stats_register_sharded_counter:
+ *
+ * Same as stats_register_counter(), but the counter is split into
+ * cache-line sized per-thread slots, which are summed when the counter is
+ * read.  Use this for counters that are updated for every message from
+ * several threads concurrently.
+ **/
+void
+stats_register_sharded_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, StatsCounterType type, StatsCounterItem **counter)
+{
+  _register_counter(stats_level, component, id, instance, type, FALSE, counter);
+  if (*counter)
+    stats_counter_enable_slots(*counter);
+}
+
 StatsCluster *
 stats_register_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, StatsCounterType type, StatsCounterItem **counter)
 {
@@ -126,29 +142,44 @@ stats_register_dynamic_counter(gint stats_level, gint component, const gchar *id
 }
 
 /*
- * stats_instant_inc_dynamic_counter
- * @timestamp: if non-negative, an associated timestamp will be created and set
+ * stats_register_and_add_dynamic_counter
+ * @add: the value to add to the processed counter
+ * @timestamp: if non-negative, an associated timestamp will be created and
+ *             set, unless it already holds a later one
  *
- * Instantly create (if not exists) and increment a dynamic counter.
+ * Instantly create (if not exists) and add to a dynamic counter.
  */
 void
-stats_register_and_increment_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, time_t timestamp)
+stats_register_and_add_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, gint add, time_t timestamp)
 {
   StatsCounterItem *counter, *stamp;
   StatsCluster *handle;
 
   g_assert(stats_locked);
   handle = stats_register_dynamic_counter(stats_level, component, id, instance, SC_TYPE_PROCESSED, &counter);
-  stats_counter_inc(counter);
+  stats_counter_add(counter, add);
   if (timestamp >= 0)
     {
       stats_register_associated_counter(handle, SC_TYPE_STAMP, &stamp);
-      stats_counter_set(stamp, timestamp);
+      if (stats_counter_get(stamp) < timestamp)
+        stats_counter_set(stamp, timestamp);
       stats_unregister_dynamic_counter(handle, SC_TYPE_STAMP, &stamp);
     }
   stats_unregister_dynamic_counter(handle, SC_TYPE_PROCESSED, &counter);
 }
 
+/*
+ * stats_register_and_increment_dynamic_counter
+ * @timestamp: if non-negative, an associated timestamp will be created and set
+ *
+ * Instantly create (if not exists) and increment a dynamic counter.
+ */
+void
+stats_register_and_increment_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, time_t timestamp)
+{
+  stats_register_and_add_dynamic_counter(stats_level, component, id, instance, 1, timestamp);
+}
+
 /**
  * stats_register_associated_counter:
  * @sc: the dynamic counter that was registered with stats_register_dynamic_counter
@@ -196,6 +227,49 @@ stats_unregister_counter(gint component, const gchar *id, const gchar *instance,
   stats_cluster_untrack_counter(sc, type, counter);
 }
 
+/**
+ * stats_register_histogram:
+ * @type: the histogram type (SC_HISTOGRAM_*)
+ * @histogram: returned pointer to the histogram, NULL if @stats_level is
+ *             not enabled
+ *
+ * Registers a latency histogram in the StatsCluster identified by
+ * @component, @id and @instance, the same way as stats_register_counter()
+ * does for counters.
+ **/
+void
+stats_register_histogram(gint stats_level, gint component, const gchar *id, const gchar *instance, StatsHistogramType type, StatsHistogram **histogram)
+{
+  StatsCluster *sc;
+
+  g_assert(stats_locked);
+
+  sc = _grab_cluster(stats_level, component, id, instance, FALSE);
+  if (sc)
+    *histogram = stats_cluster_track_histogram(sc, type);
+  else
+    *histogram = NULL;
+}
+
+void
+stats_unregister_histogram(gint component, const gchar *id, const gchar *instance, StatsHistogramType type, StatsHistogram **histogram)
+{
+  StatsCluster *sc;
+  StatsCluster key;
+
+  g_assert(stats_locked);
+
+  if (*histogram == NULL)
+    return;
+
+  key.component = component;
+  key.id = (gchar *) (id ? : "");
+  key.instance = (gchar *) (instance ? : "");
+
+  sc = g_hash_table_lookup(counter_hash, &key);
+  stats_cluster_untrack_histogram(sc, type, histogram);
+}
+
 void
 stats_unregister_dynamic_counter(StatsCluster *sc, StatsCounterType type, StatsCounterItem **counter)
 {
@@ -262,6 +336,25 @@ stats_foreach_counter(StatsForeachCounterFunc func, gpointer user_data)
   stats_foreach_cluster(_foreach_counter_helper, args);
 }
 
+static void
+_foreach_histogram_helper(StatsCluster *sc, gpointer user_data)
+{
+  gpointer *args = (gpointer *) user_data;
+  StatsForeachHistogramFunc func = args[0];
+  gpointer func_data = args[1];
+
+  stats_cluster_foreach_histogram(sc, func, func_data);
+}
+
+void
+stats_foreach_histogram(StatsForeachHistogramFunc func, gpointer user_data)
+{
+  gpointer args[] = { func, user_data };
+
+  g_assert(stats_locked);
+  stats_foreach_cluster(_foreach_histogram_helper, args);
+}
+
 void
 stats_registry_init(void)
 {
@@ -34,13 +34,18 @@ void stats_lock(void);
 void stats_unlock(void);
 gboolean stats_check_level(gint level);
 void stats_register_counter(gint level, gint component, const gchar *id, const gchar *instance, StatsCounterType type, StatsCounterItem **counter);
+void stats_register_sharded_counter(gint level, gint component, const gchar *id, const gchar *instance, StatsCounterType type, StatsCounterItem **counter);
 StatsCluster *stats_register_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, StatsCounterType type, StatsCounterItem **counter);
+void stats_register_and_add_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, gint add, time_t timestamp);
 void stats_register_and_increment_dynamic_counter(gint stats_level, gint component, const gchar *id, const gchar *instance, time_t timestamp);
 void stats_register_associated_counter(StatsCluster *handle, StatsCounterType type, StatsCounterItem **counter);
 void stats_unregister_counter(gint component, const gchar *id, const gchar *instance, StatsCounterType type, StatsCounterItem **counter);
 void stats_unregister_dynamic_counter(StatsCluster *handle, StatsCounterType type, StatsCounterItem **counter);
+void stats_register_histogram(gint stats_level, gint component, const gchar *id, const gchar *instance, StatsHistogramType type, StatsHistogram **histogram);
+void stats_unregister_histogram(gint component, const gchar *id, const gchar *instance, StatsHistogramType type, StatsHistogram **histogram);
 
 void stats_foreach_counter(StatsForeachCounterFunc func, gpointer user_data);
+void stats_foreach_histogram(StatsForeachHistogramFunc func, gpointer user_data);
 void stats_foreach_cluster(StatsForeachClusterFunc func, gpointer user_data);
 void stats_foreach_cluster_remove(StatsForeachClusterRemoveFunc func, gpointer user_data);
 
@@ -26,6 +26,7 @@
 #include "stats/stats-syslog.h"
 #include "stats/stats-registry.h"
 #include "stats/stats-log.h"
+#include "stats/stats-dynamic.h"
 #include "timeutils.h"
 
 #include <string.h>
@@ -77,6 +78,10 @@
  *
  * Counters are updated atomically by the use of the stats_counter_inc/dec()
  * methods.
+ *
+ * Dynamic counters that would be registered for every message (host,
+ * sender, program) are accumulated per-thread instead, see
+ * stats-dynamic.c, and are merged into the registry before publishing.
  */
 
 StatsOptions *stats_options;
@@ -109,7 +114,7 @@ stats_cluster_is_expired(StatsCluster *sc, time_t now)
   if ((sc->live_mask & (1 << SC_TYPE_STAMP)) == 0)
     return FALSE;
 
-  tstamp = sc->counters[SC_TYPE_STAMP].value;
+  tstamp = stats_counter_get(&sc->counters[SC_TYPE_STAMP]);
   return (tstamp <= now - stats_options->lifetime);
 }
 
@@ -129,7 +134,7 @@ stats_prune_counter(StatsCluster *sc, StatsTimerState *st)
   expired = stats_cluster_is_expired(sc, st->now.tv_sec);
   if (expired)
     {
-      time_t tstamp = sc->counters[SC_TYPE_STAMP].value;
+      time_t tstamp = stats_counter_get(&sc->counters[SC_TYPE_STAMP]);
       if ((st->oldest_counter) == 0 || st->oldest_counter > tstamp)
         st->oldest_counter = tstamp;
       st->dropped_counters++;
@@ -162,6 +167,7 @@ stats_publish_and_prune_counters(void)
     st.stats_event = msg_event_create(EVT_PRI_INFO, "Log statistics", NULL);
 
   stats_lock();
+  stats_dynamic_counters_flush();
   stats_foreach_cluster_remove(stats_format_and_prune_cluster, &st);
   stats_unlock();
 
@@ -250,6 +256,7 @@ stats_init(void)
 void
 stats_destroy(void)
 {
+  stats_dynamic_counters_global_deinit();
   stats_registry_deinit();
 }
 
@@ -156,6 +156,94 @@ test_get_component_name_translates_component_to_name_properly(void)
   assert_stats_component_name(SCS_DESTINATION | SCS_GROUP, "destination");
 }
 
+static void
+test_stats_counter_is_64_bits_wide(void)
+{
+  StatsCounterItem counter = { 0 };
+  gint i;
+
+  for (i = 0; i < 4; i++)
+    stats_counter_add(&counter, G_MAXINT);
+  assert_guint64(stats_counter_get(&counter), 4 * (guint64) G_MAXINT, "stats counter wrapped around");
+
+  stats_counter_enable_slots(&counter);
+  stats_counter_add(&counter, G_MAXINT);
+  assert_guint64(stats_counter_get(&counter), 5 * (guint64) G_MAXINT, "sharded counter doesn't include its previous value");
+
+  stats_counter_set(&counter, 10);
+  assert_guint64(stats_counter_get(&counter), 10, "setting a sharded counter doesn't reset its slots");
+  stats_counter_free_slots(&counter);
+}
+
+#define SHARDED_COUNTER_THREADS     (STATS_COUNTER_SLOTS + 4)
+#define SHARDED_COUNTER_INCREMENTS  100000
+
+static gpointer
+_increment_sharded_counter(gpointer user_data)
+{
+  StatsCounterItem *counter = (StatsCounterItem *) user_data;
+  gint i;
+
+  for (i = 0; i < SHARDED_COUNTER_INCREMENTS; i++)
+    {
+      stats_counter_inc(counter);
+      stats_counter_add(counter, 2);
+      stats_counter_dec(counter);
+    }
+  return NULL;
+}
+
+static void
+test_sharded_counter_sums_updates_of_all_threads(void)
+{
+  StatsCounterItem counter = { 0 };
+  GThread *threads[SHARDED_COUNTER_THREADS];
+  gint i;
+
+  stats_counter_enable_slots(&counter);
+  for (i = 0; i < SHARDED_COUNTER_THREADS; i++)
+    threads[i] = g_thread_create(_increment_sharded_counter, &counter, TRUE, NULL);
+  for (i = 0; i < SHARDED_COUNTER_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  assert_guint64(stats_counter_get(&counter), 2 * SHARDED_COUNTER_THREADS * SHARDED_COUNTER_INCREMENTS,
+                 "sharded counter lost updates");
+  stats_counter_free_slots(&counter);
+}
+
+static void
+test_histogram_buckets_are_ordered_and_contain_their_values(void)
+{
+  guint64 value;
+  gint bucket, prev_bucket = 0;
+
+  for (value = 0; value < 1000000; value += (value >> 4) + 1)
+    {
+      bucket = stats_histogram_get_bucket(value);
+      assert_true(bucket >= prev_bucket, "histogram buckets are not monotonic, value: %" G_GUINT64_FORMAT, value);
+      assert_true(value <= stats_histogram_get_bucket_upper_bound(bucket), "value is above the upper bound of its bucket, value: %" G_GUINT64_FORMAT, value);
+      assert_true(bucket == 0 || value > stats_histogram_get_bucket_upper_bound(bucket - 1),
+                  "value is below the lower bound of its bucket, value: %" G_GUINT64_FORMAT, value);
+      prev_bucket = bucket;
+    }
+  assert_gint(stats_histogram_get_bucket(G_MAXUINT64), STATS_HISTOGRAM_BUCKETS - 1, "huge values don't go to the last bucket");
+}
+
+static void
+test_histogram_percentiles(void)
+{
+  StatsHistogram histogram = { 0 };
+  gint i;
+
+  for (i = 1; i <= 100; i++)
+    stats_histogram_record(&histogram, i * 1000);
+
+  assert_gint64(histogram.count, 100, "histogram count mismatch");
+  assert_gint64(histogram.sum, 5050 * 1000, "histogram sum mismatch");
+  assert_guint64(stats_histogram_get_percentile(&histogram, 50), 57343, "histogram median mismatch");
+  assert_guint64(stats_histogram_get_percentile(&histogram, 100), 114687, "histogram max mismatch");
+}
+
 static void
 test_stats_cluster(void)
 {
@@ -164,11 +252,16 @@ test_stats_cluster(void)
   STATS_CLUSTER_TESTCASE(test_stats_foreach_counter_yields_tracked_counters);
   STATS_CLUSTER_TESTCASE(test_stats_foreach_counter_never_forgets_untracked_counters);
   STATS_CLUSTER_TESTCASE(test_get_component_name_translates_component_to_name_properly);
+  STATS_CLUSTER_TESTCASE(test_stats_counter_is_64_bits_wide);
+  STATS_CLUSTER_TESTCASE(test_sharded_counter_sums_updates_of_all_threads);
+  STATS_CLUSTER_TESTCASE(test_histogram_buckets_are_ordered_and_contain_their_values);
+  STATS_CLUSTER_TESTCASE(test_histogram_percentiles);
 }
 
 int
 main(int argc, char *argv[])
 {
+  g_thread_init(NULL);
   test_stats_cluster();
   return 0;
 }
@@ -0,0 +1,126 @@
+#include "testutils.h"
+#include "apphook.h"
+#include "stats/stats-dynamic.h"
+#include "stats/stats-registry.h"
+
+#include <iv.h>
+#include <string.h>
+
+#define STATS_DYNAMIC_TESTCASE(x) x()
+
+#define NUM_THREADS      4
+#define NUM_INCREMENTS   10000
+
+typedef struct _FindCounterState
+{
+  gint component;
+  const gchar *instance;
+  StatsCluster *found;
+} FindCounterState;
+
+static void
+_find_cluster(StatsCluster *sc, gpointer user_data)
+{
+  FindCounterState *st = (FindCounterState *) user_data;
+
+  if (sc->component == st->component && strcmp(sc->instance, st->instance) == 0)
+    st->found = sc;
+}
+
+static void
+assert_dynamic_counter(gint component, const gchar *instance, guint32 expected_count, guint32 expected_stamp)
+{
+  FindCounterState st = { component, instance, NULL };
+
+  stats_lock();
+  stats_dynamic_counters_flush();
+  stats_foreach_cluster(_find_cluster, &st);
+  stats_unlock();
+
+  assert_not_null(st.found, "dynamic counter is not registered, instance: %s", instance);
+  assert_guint32(stats_counter_get(&st.found->counters[SC_TYPE_PROCESSED]), expected_count,
+                 "dynamic counter value mismatch, instance: %s", instance);
+  assert_guint32(stats_counter_get(&st.found->counters[SC_TYPE_STAMP]), expected_stamp,
+                 "dynamic counter stamp mismatch, instance: %s", instance);
+}
+
+static gpointer
+_increment_thread(gpointer user_data)
+{
+  gboolean deinit = GPOINTER_TO_INT(user_data);
+  gint i;
+
+  for (i = 0; i < NUM_INCREMENTS; i++)
+    {
+      stats_dynamic_counter_inc(2, SCS_HOST | SCS_SOURCE, "shared", 1000 + i);
+      stats_dynamic_counter_inc(3, SCS_PROGRAM | SCS_SOURCE, (i & 1) ? "odd" : "even", 1000);
+    }
+  if (deinit)
+    stats_dynamic_counters_thread_deinit();
+  return NULL;
+}
+
+static void
+test_dynamic_counters_are_merged_from_all_threads(void)
+{
+  GThread *threads[NUM_THREADS];
+  gint i;
+
+  for (i = 0; i < NUM_THREADS; i++)
+    {
+      /* half of the threads exit without merging their counters */
+      threads[i] = g_thread_create(_increment_thread, GINT_TO_POINTER(i & 1), TRUE, NULL);
+    }
+  for (i = 0; i < NUM_THREADS; i++)
+    g_thread_join(threads[i]);
+
+  assert_dynamic_counter(SCS_HOST | SCS_SOURCE, "shared", NUM_THREADS * NUM_INCREMENTS, 1000 + NUM_INCREMENTS - 1);
+  assert_dynamic_counter(SCS_PROGRAM | SCS_SOURCE, "odd", NUM_THREADS * NUM_INCREMENTS / 2, 1000);
+  assert_dynamic_counter(SCS_PROGRAM | SCS_SOURCE, "even", NUM_THREADS * NUM_INCREMENTS / 2, 1000);
+}
+
+static void
+test_dynamic_counters_are_only_added_once(void)
+{
+  stats_dynamic_counter_inc(2, SCS_HOST | SCS_SOURCE, "once", 2000);
+  assert_dynamic_counter(SCS_HOST | SCS_SOURCE, "once", 1, 2000);
+  assert_dynamic_counter(SCS_HOST | SCS_SOURCE, "once", 1, 2000);
+
+  stats_dynamic_counter_inc(2, SCS_HOST | SCS_SOURCE, "once", 2001);
+  assert_dynamic_counter(SCS_HOST | SCS_SOURCE, "once", 2, 2001);
+}
+
+static void
+test_dynamic_counters_above_stats_level_are_ignored(void)
+{
+  FindCounterState st = { SCS_SENDER | SCS_SOURCE, "ignored", NULL };
+
+  stats_dynamic_counter_inc(4, SCS_SENDER | SCS_SOURCE, "ignored", 3000);
+
+  stats_lock();
+  stats_dynamic_counters_flush();
+  stats_foreach_cluster(_find_cluster, &st);
+  stats_unlock();
+  assert_null(st.found, "dynamic counter above stats-level was registered");
+}
+
+int
+main(int argc, char *argv[])
+{
+  StatsOptions options;
+
+  iv_init();
+  app_startup();
+
+  stats_options_defaults(&options);
+  options.level = 3;
+  stats_reinit(&options);
+
+  STATS_DYNAMIC_TESTCASE(test_dynamic_counters_are_merged_from_all_threads);
+  STATS_DYNAMIC_TESTCASE(test_dynamic_counters_are_only_added_once);
+  STATS_DYNAMIC_TESTCASE(test_dynamic_counters_above_stats_level_are_ignored);
+
+  app_shutdown();
+  iv_deinit();
+  return 0;
+}
@@ -35,6 +35,8 @@
 #include "str-format.h"
 #include "rcptid.h"
 #include "run-id.h"
+#include "scratch-buffers.h"
+#include "tls-support.h"
 
 #include <time.h>
 #include <string.h>
@@ -710,6 +712,87 @@ typedef struct _LogTemplateElem
   };
 } LogTemplateElem;
 
+enum
+{
+  LTO_LITERAL,
+  LTO_VALUE,
+  LTO_MACRO,
+  LTO_FUNC
+};
+
+/* one instruction of the flattened template, adjacent literal texts are
+ * coalesced into a single LTO_LITERAL op */
+struct _LogTemplateOp
+{
+  guint8 type;
+  /* the default value was given for a macro, it is not escaped */
+  guint8 raw_default_value;
+  guint16 msg_ref;
+  const gchar *default_value;
+  union
+  {
+    struct
+    {
+      const gchar *text;
+      gsize text_len;
+    } literal;
+    guint macro;
+    NVHandle value_handle;
+    struct
+    {
+      LogTemplateFunction *ops;
+      gpointer state;
+    } func;
+  };
+};
+
+TLS_BLOCK_START
+{
+  /* argument buffers of template function invocations, indexed by the
+   * nesting depth of the invocation */
+  GPtrArray *invoke_bufs_stack;
+  gint invoke_depth;
+}
+TLS_BLOCK_END;
+
+#define invoke_bufs_stack  __tls_deref(invoke_bufs_stack)
+#define invoke_depth       __tls_deref(invoke_depth)
+
+static GPtrArray *
+log_template_acquire_invoke_bufs(void)
+{
+  if (!invoke_bufs_stack)
+    invoke_bufs_stack = g_ptr_array_new();
+  if (invoke_bufs_stack->len <= invoke_depth)
+    g_ptr_array_add(invoke_bufs_stack, g_ptr_array_sized_new(4));
+  return (GPtrArray *) g_ptr_array_index(invoke_bufs_stack, invoke_depth++);
+}
+
+static void
+log_template_release_invoke_bufs(GPtrArray *bufs)
+{
+  gint i;
+
+  for (i = 0; i < bufs->len; i++)
+    sb_gstring_release(sb_gstring_from_string(g_ptr_array_index(bufs, i)));
+  g_ptr_array_set_size(bufs, 0);
+  invoke_depth--;
+}
+
+void
+log_template_thread_deinit(void)
+{
+  gint i;
+
+  if (!invoke_bufs_stack)
+    return;
+
+  for (i = 0; i < invoke_bufs_stack->len; i++)
+    g_ptr_array_free(g_ptr_array_index(invoke_bufs_stack, i), TRUE);
+  g_ptr_array_free(invoke_bufs_stack, TRUE);
+  invoke_bufs_stack = NULL;
+}
+
 
 /* simple template functions which take templates as arguments */
 
@@ -746,15 +829,17 @@ tf_simple_func_eval(LogTemplateFunction *self, gpointer s, const LogTemplateInvo
 
   for (i = 0; i < state->argc; i++)
     {
-      GString **arg;
-
-      if (args->bufs->len <= i)
-        g_ptr_array_add(args->bufs, g_string_sized_new(256));
-
-      arg = (GString **) &g_ptr_array_index(args->bufs, i);
-      g_string_truncate(*arg, 0);
-
-      log_template_append_format_recursive(state->argv[i], args, *arg);
+      GString *arg = sb_gstring_string(sb_gstring_acquire());
+      const gchar *literal;
+      gssize literal_len;
+
+      /* constant arguments were already expanded at compile time */
+      literal = log_template_get_literal_value(state->argv[i], &literal_len);
+      if (literal)
+        g_string_append_len(arg, literal, literal_len);
+      else
+        log_template_append_format_recursive(state->argv[i], args, arg);
+      g_ptr_array_add(args->bufs, arg);
     }
 }
 
@@ -1273,11 +1358,111 @@ log_template_compiler_clear(LogTemplateCompiler *self)
   g_string_free(self->text, TRUE);
 }
 
+/* NOTE: literal ops store offsets into self->literals until the program is complete */
+static void
+log_template_flush_literal(GArray *ops, GString *literals, gsize *literal_start)
+{
+  LogTemplateOp op = { 0 };
+
+  if (literals->len == *literal_start)
+    return;
+
+  op.type = LTO_LITERAL;
+  op.literal.text = GSIZE_TO_POINTER(*literal_start);
+  op.literal.text_len = literals->len - *literal_start;
+  g_array_append_val(ops, op);
+  *literal_start = literals->len;
+}
+
+static gboolean
+log_template_resolve_macro_to_value(LogTemplate *self, guint macro, NVHandle *handle)
+{
+  /* $MSG is a plain name-value pair unless the legacy semantics are in effect */
+  if (macro == M_MESSAGE && self->cfg && !cfg_is_config_version_older(self->cfg, 0x0300))
+    {
+      *handle = LM_V_MESSAGE;
+      return TRUE;
+    }
+  return FALSE;
+}
+
+/*
+ * Lower the element list into a flat array of ops: adjacent literal texts
+ * (and macros that expand to nothing) are coalesced and macros that are
+ * equivalent to a name-value pair are turned into direct NVTable lookups.
+ */
+static void
+log_template_link(LogTemplate *self)
+{
+  GArray *ops = g_array_new(FALSE, FALSE, sizeof(LogTemplateOp));
+  GString *literals = g_string_sized_new(64);
+  gsize literal_start = 0;
+  GList *p;
+  gint i;
+
+  for (p = self->compiled_template; p; p = g_list_next(p))
+    {
+      LogTemplateElem *e = (LogTemplateElem *) p->data;
+      LogTemplateOp op = { 0 };
+
+      if (e->text)
+        g_string_append_len(literals, e->text, e->text_len);
+
+      op.msg_ref = e->msg_ref;
+      op.default_value = e->default_value;
+      switch (e->type)
+        {
+        case LTE_MACRO:
+          if (e->macro == M_NONE)
+            continue;
+          if (log_template_resolve_macro_to_value(self, e->macro, &op.value_handle))
+            {
+              op.type = LTO_VALUE;
+              op.raw_default_value = TRUE;
+            }
+          else
+            {
+              op.type = LTO_MACRO;
+              op.macro = e->macro;
+            }
+          break;
+        case LTE_VALUE:
+          op.type = LTO_VALUE;
+          op.value_handle = e->value_handle;
+          break;
+        case LTE_FUNC:
+          op.type = LTO_FUNC;
+          op.func.ops = e->func.ops;
+          op.func.state = e->func.state;
+          break;
+        default:
+          g_assert_not_reached();
+        }
+      log_template_flush_literal(ops, literals, &literal_start);
+      g_array_append_val(ops, op);
+    }
+  log_template_flush_literal(ops, literals, &literal_start);
+
+  self->ops_len = ops->len;
+  self->ops = (LogTemplateOp *) g_array_free(ops, FALSE);
+  self->literals = g_string_free(literals, FALSE);
+  for (i = 0; i < self->ops_len; i++)
+    {
+      if (self->ops[i].type == LTO_LITERAL)
+        self->ops[i].literal.text = self->literals + GPOINTER_TO_SIZE(self->ops[i].literal.text);
+    }
+}
+
 static void
 log_template_reset_compiled(LogTemplate *self)
 {
   log_template_elem_free_list(self->compiled_template);
   self->compiled_template = NULL;
+  g_free(self->ops);
+  self->ops = NULL;
+  self->ops_len = 0;
+  g_free(self->literals);
+  self->literals = NULL;
 }
 
 gboolean
@@ -1296,9 +1481,30 @@ log_template_compile(LogTemplate *self, const gchar *template, GError **error)
   log_template_compiler_init(&compiler, self);
   result = log_template_compiler_compile(&compiler, &self->compiled_template, error);
   log_template_compiler_clear(&compiler);
+  log_template_link(self);
   return result;
 }
 
+/*
+ * Returns the expansion of the template if it doesn't depend on the
+ * message at all, NULL otherwise.
+ */
+const gchar *
+log_template_get_literal_value(const LogTemplate *self, gssize *value_len)
+{
+  if (self->ops_len == 0)
+    {
+      *value_len = 0;
+      return "";
+    }
+  if (self->ops_len == 1 && self->ops[0].type == LTO_LITERAL)
+    {
+      *value_len = self->ops[0].literal.text_len;
+      return self->ops[0].literal.text;
+    }
+  return NULL;
+}
+
 void
 log_template_set_escape(LogTemplate *self, gboolean enable)
 {
@@ -1317,20 +1523,19 @@ log_template_set_type_hint(LogTemplate *self, const gchar *type_hint, GError **e
 void
 log_template_append_format_with_context(LogTemplate *self, LogMessage **messages, gint num_messages, const LogTemplateOptions *opts, gint tz, gint32 seq_num, const gchar *context_id, GString *result)
 {
-  GList *p;
-  LogTemplateElem *e;
+  const LogTemplateOp *op, *end;
 
   if (!opts)
     opts = &self->cfg->template_options;
 
-  for (p = self->compiled_template; p; p = g_list_next(p))
+  for (op = self->ops, end = self->ops + self->ops_len; op < end; op++)
     {
       gint msg_ndx;
 
-      e = (LogTemplateElem *) p->data;
-      if (e->text)
+      if (op->type == LTO_LITERAL)
         {
-          g_string_append_len(result, e->text, e->text_len);
+          g_string_append_len(result, op->literal.text, op->literal.text_len);
+          continue;
         }
 
       /* NOTE: msg_ref is 1 larger than the index specified by the user in
@@ -1339,70 +1544,60 @@ log_template_append_format_with_context(LogTemplate *self, LogMessage **messages
        *
        * msg_ref == 0 means that the user didn't specify msg_ref
        * msg_ref >= 1 means that the user supplied the given msg_ref, 1 is equal to @0 */
-      if (e->msg_ref > num_messages)
+      if (op->msg_ref > num_messages)
         continue;
-      msg_ndx = num_messages - e->msg_ref;
+      msg_ndx = num_messages - op->msg_ref;
 
       /* value and macro can't understand a context, assume that no msg_ref means @0 */
-      if (e->msg_ref == 0)
+      if (op->msg_ref == 0)
         msg_ndx--;
 
-      switch (e->type)
+      switch (op->type)
         {
-        case LTE_VALUE:
+        case LTO_VALUE:
           {
             const gchar *value = NULL;
             gssize value_len = -1;
 
-            value = log_msg_get_value(messages[msg_ndx], e->value_handle, &value_len);
+            value = log_msg_get_value(messages[msg_ndx], op->value_handle, &value_len);
             if (value && value[0])
               result_append(result, value, value_len, self->escape);
-            else if (e->default_value)
-              result_append(result, e->default_value, -1, self->escape);
+            else if (op->default_value)
+              result_append(result, op->default_value, -1, self->escape && !op->raw_default_value);
             break;
           }
-        case LTE_MACRO:
+        case LTO_MACRO:
           {
             gint len = result->len;
 
-            if (e->macro)
-              {
-                log_macro_expand(result, e->macro, self->escape, opts ? opts : &self->cfg->template_options, tz, seq_num, context_id, messages[msg_ndx]);
-                if (len == result->len && e->default_value)
-                  g_string_append(result, e->default_value);
-              }
+            log_macro_expand(result, op->macro, self->escape, opts, tz, seq_num, context_id, messages[msg_ndx]);
+            if (len == result->len && op->default_value)
+              g_string_append(result, op->default_value);
             break;
           }
-        case LTE_FUNC:
+        case LTO_FUNC:
           {
-            g_static_mutex_lock(&self->arg_lock);
-            if (!self->arg_bufs)
-              self->arg_bufs = g_ptr_array_sized_new(0);
-
-            if (1)
+            GPtrArray *bufs = log_template_acquire_invoke_bufs();
+            LogTemplateInvokeArgs args =
               {
-                LogTemplateInvokeArgs args =
-                  {
-                    self->arg_bufs,
-                    e->msg_ref ? &messages[msg_ndx] : messages,
-                    e->msg_ref ? 1 : num_messages,
-                    opts,
-                    tz,
-                    seq_num,
-                    context_id
-                  };
-
-
-                /* if a function call is called with an msg_ref, we only
-                 * pass that given logmsg to argument resolution, otherwise
-                 * we pass the whole set so the arguments can individually
-                 * specify which message they want to resolve from
-                 */
-                if (e->func.ops->eval)
-                  e->func.ops->eval(e->func.ops, e->func.state, &args);
-                e->func.ops->call(e->func.ops, e->func.state, &args, result);
-              }
-            g_static_mutex_unlock(&self->arg_lock);
+                bufs,
+                op->msg_ref ? &messages[msg_ndx] : messages,
+                op->msg_ref ? 1 : num_messages,
+                opts,
+                tz,
+                seq_num,
+                context_id
+              };
+
+            /* if a function call is called with an msg_ref, we only
+             * pass that given logmsg to argument resolution, otherwise
+             * we pass the whole set so the arguments can individually
+             * specify which message they want to resolve from
+             */
+            if (op->func.ops->eval)
+              op->func.ops->eval(op->func.ops, op->func.state, &args);
+            op->func.ops->call(op->func.ops, op->func.state, &args, result);
+            log_template_release_invoke_bufs(bufs);
             break;
           }
         }
@@ -1445,7 +1640,6 @@ log_template_new(GlobalConfig *cfg, gchar *name)
   self->name = g_strdup(name);
   self->ref_cnt = 1;
   self->cfg = cfg;
-  g_static_mutex_init(&self->arg_lock);
   if (cfg_is_config_version_older(cfg, 0x0300))
     {
       static gboolean warn_written = FALSE;
@@ -1464,18 +1658,9 @@ log_template_new(GlobalConfig *cfg, gchar *name)
 static void
 log_template_free(LogTemplate *self)
 {
-  if (self->arg_bufs)
-    {
-      gint i;
-
-      for (i = 0; i < self->arg_bufs->len; i++)
-        g_string_free(g_ptr_array_index(self->arg_bufs, i), TRUE);
-      g_ptr_array_free(self->arg_bufs, TRUE);
-    }
   log_template_reset_compiled(self);
   g_free(self->name);
   g_free(self->template);
-  g_static_mutex_free(&self->arg_lock);
   g_free(self);
 }
 
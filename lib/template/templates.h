@@ -52,18 +52,23 @@ typedef enum
   ON_ERROR_SILENT              = 0x08
 } LogTemplateOnError;
 
+typedef struct _LogTemplateOp LogTemplateOp;
+
 /* structure that represents an expandable syslog-ng template */
 typedef struct _LogTemplate
 {
   gint ref_cnt;
   gchar *name;
   gchar *template;
+  /* the elements as parsed from the template string */
   GList *compiled_template;
+  /* the flat program executed at format time, built from compiled_template */
+  LogTemplateOp *ops;
+  gint ops_len;
+  gchar *literals;
   gboolean escape;
   gboolean def_inline;
   GlobalConfig *cfg;
-  GStaticMutex arg_lock;
-  GPtrArray *arg_bufs;
   TypeHint type_hint;
 } LogTemplate;
 
@@ -106,9 +111,9 @@ extern LogMacroDef macros[];
  * several times. */
 typedef struct _LogTemplateInvokeArgs
 {
-  /* scratch buffers, stores GString *, elements are managed by the
-   * function, storage/free is performed by the core. Can be used to
-   * avoid allocating GString buffers in the fast-path. */
+  /* per-thread scratch buffers, stores GString *, elements are added
+   * by the function and have to be acquired using sb_gstring_acquire(),
+   * they are released by the core once the function returns. */
 
   GPtrArray *bufs;
 
@@ -136,7 +141,7 @@ struct _LogTemplateFunction
    * representation if necessary.  Returns the compiled state in state */
   gboolean (*prepare)(LogTemplateFunction *self, gpointer state, LogTemplate *parent, gint argc, gchar *argv[], GError **error);
 
-  /* evaluate arguments, storing argument buffers in arg_bufs in case it
+  /* evaluate arguments, storing argument buffers in args->bufs in case it
    * makes sense to reuse those buffers */
   void (*eval)(LogTemplateFunction *self, gpointer state, const LogTemplateInvokeArgs *args);
 
@@ -208,6 +213,7 @@ void log_template_append_format(LogTemplate *self, LogMessage *lm, const LogTemp
 void log_template_append_format_with_context(LogTemplate *self, LogMessage **messages, gint num_messages, const LogTemplateOptions *opts, gint tz, gint32 seq_num, const gchar *context_id, GString *result);
 void log_template_format_with_context(LogTemplate *self, LogMessage **messages, gint num_messages, const LogTemplateOptions *opts, gint tz, gint32 seq_num, const gchar *context_id, GString *result);
 void log_template_append_format_recursive(LogTemplate *self, const LogTemplateInvokeArgs *args, GString *result);
+const gchar *log_template_get_literal_value(const LogTemplate *self, gssize *value_len);
 
 
 /* low level macro functions */
@@ -226,6 +232,7 @@ void log_template_options_defaults(LogTemplateOptions *options);
 
 void log_template_global_init(void);
 void log_template_global_deinit(void);
+void log_template_thread_deinit(void);
 
 gboolean log_template_on_error_parse(const gchar *on_error, gint *out);
 void log_template_options_set_on_error(LogTemplateOptions *options, gint on_error);
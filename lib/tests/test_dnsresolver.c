@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "dnsresolver.h"
+#include "dnscache.h"
+#include "host-resolve.h"
+#include "testutils.h"
+#include "apphook.h"
+#include "gsocket.h"
+#include "timeutils.h"
+
+#include <string.h>
+#include <arpa/inet.h>
+
+#define DNS_RESOLVER_TESTCASE(x, ...) do { testcase_begin("%s(%s)", #x, #__VA_ARGS__); x(__VA_ARGS__); testcase_end(); } while(0)
+
+/* a local stub resolver, addresses in 10.0.0.0/8 have no names, the
+ * others are called host<last octet>.example.com */
+
+static GStaticMutex stub_lock = G_STATIC_MUTEX_INIT;
+static GCond *stub_unblocked_cond;
+static gboolean stub_blocked;
+static gint stub_lookups;
+
+static gboolean
+stub_resolve(GSockAddr *saddr, gchar *buf, gsize buf_len)
+{
+  gchar ip[64];
+
+  g_static_mutex_lock(&stub_lock);
+  stub_lookups++;
+  while (stub_blocked)
+    g_cond_wait(stub_unblocked_cond, g_static_mutex_get_mutex(&stub_lock));
+  g_static_mutex_unlock(&stub_lock);
+
+  g_sockaddr_format(saddr, ip, sizeof(ip), GSA_ADDRESS_ONLY);
+  if (strncmp(ip, "10.", 3) == 0)
+    return FALSE;
+  g_snprintf(buf, buf_len, "host%s.example.com", strrchr(ip, '.') + 1);
+  return TRUE;
+}
+
+static void
+stub_block(void)
+{
+  g_static_mutex_lock(&stub_lock);
+  stub_blocked = TRUE;
+  stub_lookups = 0;
+  g_static_mutex_unlock(&stub_lock);
+}
+
+static void
+stub_unblock(void)
+{
+  g_static_mutex_lock(&stub_lock);
+  stub_blocked = FALSE;
+  g_cond_broadcast(stub_unblocked_cond);
+  g_static_mutex_unlock(&stub_lock);
+}
+
+static gint
+stub_get_lookups(void)
+{
+  gint lookups;
+
+  g_static_mutex_lock(&stub_lock);
+  lookups = stub_lookups;
+  g_static_mutex_unlock(&stub_lock);
+  return lookups;
+}
+
+static void
+assert_lookup(const gchar *ip, gint wait_msec, const gchar *expected)
+{
+  GSockAddr *sa = g_sockaddr_inet_new(ip, 0);
+  gchar hostname[256];
+  gboolean positive = TRUE;
+
+  assert_true(dns_resolver_lookup(sa, TRUE, wait_msec, hostname, sizeof(hostname), &positive),
+              "lookup is expected to finish, ip: %s", ip);
+  if (expected)
+    {
+      assert_true(positive, "lookup is expected to be positive, ip: %s", ip);
+      assert_string(hostname, expected, "resolved name mismatch, ip: %s", ip);
+    }
+  else
+    assert_false(positive, "lookup is expected to be negative, ip: %s", ip);
+  g_sockaddr_unref(sa);
+}
+
+static void
+assert_lookup_in_progress(const gchar *ip)
+{
+  GSockAddr *sa = g_sockaddr_inet_new(ip, 0);
+  gchar hostname[256];
+  gboolean positive;
+
+  assert_false(dns_resolver_lookup(sa, TRUE, 0, hostname, sizeof(hostname), &positive),
+               "lookup is expected to be in progress, ip: %s", ip);
+  g_sockaddr_unref(sa);
+}
+
+/* waits for the resolver threads to store the result of a lookup */
+static void
+assert_cached(const gchar *ip, const gchar *expected)
+{
+  struct in_addr addr;
+  const gchar *hostname = NULL;
+  gsize hostname_len;
+  gboolean positive = FALSE;
+  gint i;
+
+  inet_aton(ip, &addr);
+  for (i = 0; i < 500 && !dns_cache_lookup(AF_INET, &addr, &hostname, &hostname_len, &positive); i++)
+    g_usleep(10000);
+
+  assert_not_null(hostname, "lookup result didn't get into the DNS cache, ip: %s", ip);
+  assert_string(hostname, expected, "cached name mismatch, ip: %s", ip);
+  assert_gboolean(positive, strcmp(ip, expected) != 0, "cached entry has an unexpected type, ip: %s", ip);
+}
+
+static void
+test_lookup_waits_for_the_result(void)
+{
+  assert_lookup("192.168.1.1", 5000, "host1.example.com");
+  assert_cached("192.168.1.1", "host1.example.com");
+  assert_lookup("10.1.1.1", 5000, NULL);
+  assert_cached("10.1.1.1", "10.1.1.1");
+}
+
+static void
+test_result_is_not_cached_without_the_dns_cache(void)
+{
+  struct in_addr addr;
+  const gchar *hostname;
+  gsize hostname_len;
+  gboolean positive;
+  GSockAddr *sa = g_sockaddr_inet_new("192.168.1.4", 0);
+  gchar buf[256];
+
+  assert_true(dns_resolver_lookup(sa, FALSE, 5000, buf, sizeof(buf), &positive),
+              "lookup is expected to finish");
+  assert_string(buf, "host4.example.com", "resolved name mismatch");
+  g_sockaddr_unref(sa);
+
+  /* the result would have been stored before the lookup finished */
+  inet_aton("192.168.1.4", &addr);
+  assert_false(dns_cache_lookup(AF_INET, &addr, &hostname, &hostname_len, &positive),
+               "lookup result got into the DNS cache with the cache disabled");
+}
+
+static void
+test_result_is_kept_for_callers_without_the_dns_cache(void)
+{
+  struct in_addr addr;
+  const gchar *hostname;
+  gsize hostname_len;
+  gboolean positive;
+  GSockAddr *sa = g_sockaddr_inet_new("192.168.1.6", 0);
+  gchar buf[256];
+  gint i;
+
+  stub_block();
+  assert_false(dns_resolver_lookup(sa, FALSE, 0, buf, sizeof(buf), &positive),
+               "lookup is expected to be in progress");
+  stub_unblock();
+
+  /* collected by one of the later lookups once it's done */
+  positive = FALSE;
+  for (i = 0; i < 500 && !dns_resolver_lookup(sa, FALSE, 0, buf, sizeof(buf), &positive); i++)
+    g_usleep(10000);
+  assert_true(positive, "the result of the lookup was not kept");
+  assert_string(buf, "host6.example.com", "resolved name mismatch");
+  assert_gint(stub_get_lookups(), 1, "the address was resolved more than once");
+
+  inet_aton("192.168.1.6", &addr);
+  assert_false(dns_cache_lookup(AF_INET, &addr, &hostname, &hostname_len, &positive),
+               "lookup result got into the DNS cache with the cache disabled");
+  g_sockaddr_unref(sa);
+}
+
+static void
+test_concurrent_lookups_of_the_same_address_are_coalesced(void)
+{
+  stub_block();
+  assert_lookup_in_progress("192.168.1.2");
+  assert_lookup_in_progress("192.168.1.2");
+  assert_lookup_in_progress("192.168.1.2");
+  stub_unblock();
+
+  assert_cached("192.168.1.2", "host2.example.com");
+  assert_gint(stub_get_lookups(), 1, "concurrent lookups were not coalesced");
+}
+
+static void
+test_wait_is_measured_from_the_start_of_the_lookup(void)
+{
+  GSockAddr *sa = g_sockaddr_inet_new("192.168.1.5", 0);
+  gchar hostname[256];
+  gboolean positive;
+  GTimeVal start, end;
+
+  stub_block();
+  assert_false(dns_resolver_lookup(sa, TRUE, 500, hostname, sizeof(hostname), &positive),
+               "lookup is expected to time out");
+
+  /* the lookup is older than the wait time, joining it doesn't block */
+  g_get_current_time(&start);
+  assert_false(dns_resolver_lookup(sa, TRUE, 500, hostname, sizeof(hostname), &positive),
+               "lookup is expected to time out");
+  g_get_current_time(&end);
+  stub_unblock();
+
+  assert_true(g_time_val_diff(&end, &start) < 250000,
+              "a caller joining a timed out lookup waited again");
+  assert_cached("192.168.1.5", "host5.example.com");
+  g_sockaddr_unref(sa);
+}
+
+static void
+test_unresolved_address_is_backfilled_into_the_cache(void)
+{
+  HostResolveOptions options;
+  GSockAddr *sa = g_sockaddr_inet_new("192.168.1.3", 0);
+  const gchar *result;
+  gsize result_len;
+
+  host_resolve_options_defaults(&options);
+  options.use_dns = TRUE;
+  options.use_dns_cache = TRUE;
+  options.use_fqdn = TRUE;
+  options.normalize_hostnames = FALSE;
+  options.dns_wait = 1;
+
+  stub_block();
+  result = resolve_sockaddr_to_hostname(&result_len, sa, &options);
+  assert_string(result, "192.168.1.3", "the IP address is expected while the lookup is in progress");
+  stub_unblock();
+
+  assert_cached("192.168.1.3", "host3.example.com");
+  result = resolve_sockaddr_to_hostname(&result_len, sa, &options);
+  assert_string(result, "host3.example.com", "the name is expected once the lookup finished");
+  assert_gint(result_len, strlen(result), "returned length is not true");
+  assert_gint(stub_get_lookups(), 1, "the address was resolved more than once");
+  g_sockaddr_unref(sa);
+}
+
+int
+main(int argc, char *argv[])
+{
+  app_startup();
+  stub_unblocked_cond = g_cond_new();
+  dns_resolver_set_resolve_func(stub_resolve);
+
+  DNS_RESOLVER_TESTCASE(test_lookup_waits_for_the_result);
+  DNS_RESOLVER_TESTCASE(test_result_is_not_cached_without_the_dns_cache);
+  DNS_RESOLVER_TESTCASE(test_result_is_kept_for_callers_without_the_dns_cache);
+  DNS_RESOLVER_TESTCASE(test_concurrent_lookups_of_the_same_address_are_coalesced);
+  DNS_RESOLVER_TESTCASE(test_wait_is_measured_from_the_start_of_the_lookup);
+  DNS_RESOLVER_TESTCASE(test_unresolved_address_is_backfilled_into_the_cache);
+
+  dns_resolver_set_resolve_func(NULL);
+  g_cond_free(stub_unblocked_cond);
+  app_shutdown();
+  return 0;
+}
@@ -41,10 +41,10 @@
   do                                                            	\
     {                                                           	\
       testcase_begin("%s(%s)", func, args);                     	\
-      dns_cache_thread_init();						\
       host_resolve_options_defaults(&host_resolve_options);		\
       host_resolve_options_init(&host_resolve_options, configuration);	\
       hostname_reinit(NULL);						\
+      dns_cache_clear();						\
     }                                                           	\
   while (0)
 
@@ -52,7 +52,6 @@
   do                                                            \
     {                                                           \
       host_resolve_options_destroy(&host_resolve_options);	\
-      dns_cache_thread_deinit();				\
       testcase_end();                                           \
     }                                                           \
   while (0)
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2013 BalaBit IT Ltd, Budapest, Hungary
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logmpx.h"
+#include "cfg.h"
+#include "cfg-tree.h"
+#include "filter/filter-re.h"
+#include "filter/filter-pipe.h"
+#include "apphook.h"
+#include "testutils.h"
+
+#define LOGMPX_TESTCASE(x, ...) do { logmpx_testcase_begin(#x, #__VA_ARGS__); x(__VA_ARGS__); logmpx_testcase_end(); } while(0)
+
+#define logmpx_testcase_begin(func, args)                               \
+  do                                                                    \
+    {                                                                   \
+      testcase_begin("%s(%s)", func, args);                             \
+      configuration = cfg_new(0x0306);                                  \
+      source_pipe = log_pipe_new(configuration);                         \
+      source_pipe->flags |= PIF_SOURCE;                                 \
+      cfg_tree_add_object(&configuration->tree,                         \
+                          log_expr_node_new_source("s_test",            \
+                            log_expr_node_new_junction(log_expr_node_new_pipe(source_pipe, NULL), NULL), NULL)); \
+      num_paths = 0;                                                    \
+    }                                                                   \
+  while (0)
+
+#define logmpx_testcase_end()                                           \
+  do                                                                    \
+    {                                                                   \
+      cfg_tree_stop(&configuration->tree);                              \
+      cfg_free(configuration);                                          \
+      configuration = NULL;                                             \
+      testcase_end();                                                   \
+    }                                                                   \
+  while (0)
+
+static LogPipe *source_pipe;
+static gint num_paths;
+static GString *deliveries;
+
+/*
+ * Destination of the test log paths, records its index in @deliveries,
+ * followed by a "!" if flow-control was requested.
+ */
+typedef struct _RecorderPipe
+{
+  LogPipe super;
+  gint index;
+} RecorderPipe;
+
+static void
+recorder_pipe_queue(LogPipe *s, LogMessage *msg, const LogPathOptions *path_options, gpointer user_data)
+{
+  RecorderPipe *self = (RecorderPipe *) s;
+
+  g_string_append_printf(deliveries, "%d%s,", self->index, path_options->flow_control_requested ? "!" : "");
+  log_pipe_forward_msg(s, msg, path_options);
+}
+
+static LogPipe *
+recorder_pipe_new(gint index)
+{
+  RecorderPipe *self = g_new0(RecorderPipe, 1);
+
+  log_pipe_init_instance(&self->super, configuration);
+  self->super.queue = recorder_pipe_queue;
+  self->index = index;
+  return &self->super;
+}
+
+static FilterExprNode *
+create_host_filter(gchar *regexp)
+{
+  FilterRE *f = filter_re_new(LM_V_HOST);
+
+  log_matcher_options_defaults(&f->matcher_options);
+  log_matcher_options_set_type(&f->matcher_options, "pcre");
+  assert_true(filter_re_compile_pattern(f, configuration, regexp, NULL), "error compiling regexp: %s", regexp);
+  return &f->super;
+}
+
+/*
+ * Adds log { source(s_test); filter { host(@regexp) }; destination { recorder }; flags(@flags); };
+ * the filter is omitted if @regexp is NULL.
+ */
+static void
+add_log_path(gchar *regexp, guint32 flags)
+{
+  LogExprNode *children;
+
+  children = log_expr_node_new_destination(NULL,
+                                           log_expr_node_new_junction(log_expr_node_new_pipe(recorder_pipe_new(num_paths), NULL), NULL),
+                                           NULL);
+  if (regexp)
+    children = log_expr_node_append_tail(log_expr_node_new_filter(NULL,
+                                                                  log_expr_node_new_pipe(log_filter_pipe_new(create_host_filter(regexp), configuration), NULL),
+                                                                  NULL),
+                                         children);
+  children = log_expr_node_append_tail(log_expr_node_new_source_reference("s_test", NULL), children);
+
+  cfg_tree_add_object(&configuration->tree, log_expr_node_new_log(children, flags, NULL));
+  num_paths++;
+}
+
+/* adds log paths matching the hosts "host<first>" ... "host<last>" */
+static void
+add_host_log_paths(gint first, gint last, guint32 flags)
+{
+  gint i;
+
+  for (i = first; i <= last; i++)
+    {
+      gchar regexp[32];
+
+      g_snprintf(regexp, sizeof(regexp), "^host%d$", i);
+      add_log_path(regexp, flags);
+    }
+}
+
+/* the multiplexer forking the messages of s_test to the log paths, at the end of the source */
+static LogMultiplexer *
+get_source_multiplexer(void)
+{
+  LogPipe *p;
+
+  for (p = source_pipe; p->pipe_next; p = p->pipe_next)
+    ;
+  return (LogMultiplexer *) p;
+}
+
+static void
+start_tree(gboolean expect_dispatch)
+{
+  assert_true(cfg_tree_start(&configuration->tree), "error starting the configuration");
+  assert_gboolean(get_source_multiplexer()->dispatch != NULL, expect_dispatch,
+                  "log paths are not dispatched the expected way");
+}
+
+static gchar *
+deliver(const gchar *host, gboolean dispatched)
+{
+  LogMultiplexer *mpx = get_source_multiplexer();
+  LogMultiplexerDispatch *dispatch = mpx->dispatch;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg = log_msg_new_empty();
+
+  log_msg_set_value(msg, LM_V_HOST, host, -1);
+  g_string_truncate(deliveries, 0);
+
+  if (!dispatched)
+    mpx->dispatch = NULL;
+  log_pipe_queue(source_pipe, msg, &path_options);
+  mpx->dispatch = dispatch;
+
+  return g_strdup(deliveries->str);
+}
+
+/* the hash lookup may only skip log paths that would not match anyway */
+static void
+assert_delivery(const gchar *host, const gchar *expected)
+{
+  gchar *dispatched = deliver(host, TRUE);
+  gchar *linear = deliver(host, FALSE);
+
+  assert_string(linear, expected, "linear delivery mismatch, host: %s", host);
+  assert_string(dispatched, linear, "dispatched delivery differs from the linear one, host: %s", host);
+  g_free(dispatched);
+  g_free(linear);
+}
+
+static void
+test_dispatched_delivery_keeps_the_order_of_log_paths(void)
+{
+  add_host_log_paths(0, 2, 0);
+  add_log_path("^host[13]$", 0);
+  add_host_log_paths(3, 5, 0);
+  add_log_path(NULL, 0);
+  add_host_log_paths(6, 7, 0);
+  add_host_log_paths(3, 3, 0);
+  start_tree(TRUE);
+
+  assert_delivery("host0", "0,7,");
+  assert_delivery("host1", "1,3,7,");
+  assert_delivery("host3", "3,4,7,10,");
+  assert_delivery("host7", "7,9,");
+  assert_delivery("unknown", "7,");
+  /* PCRE "$" also matches before a trailing newline */
+  assert_delivery("host3\n", "3,4,7,10,");
+}
+
+static void
+test_final_flag_stops_dispatched_delivery(void)
+{
+  add_log_path("^host", 0);
+  add_host_log_paths(0, 0, 0);
+  add_host_log_paths(1, 1, LC_FINAL);
+  add_host_log_paths(2, 7, 0);
+  add_host_log_paths(1, 1, 0);
+  add_log_path(NULL, 0);
+  start_tree(TRUE);
+
+  assert_delivery("host1", "0,2,");
+  assert_delivery("host5", "0,6,10,");
+}
+
+static void
+test_fallback_flag_with_dispatched_delivery(void)
+{
+  add_host_log_paths(0, 7, 0);
+  add_host_log_paths(0, 0, LC_FALLBACK);
+  add_log_path(NULL, LC_FALLBACK);
+  start_tree(TRUE);
+
+  assert_delivery("host0", "0,");
+  assert_delivery("host4", "4,");
+  assert_delivery("unknown", "9,");
+}
+
+static void
+test_flow_control_flag_with_dispatched_delivery(void)
+{
+  add_host_log_paths(0, 2, 0);
+  add_host_log_paths(3, 3, LC_FLOW_CONTROL);
+  add_host_log_paths(4, 7, 0);
+  start_tree(TRUE);
+
+  assert_delivery("host3", "3!,");
+  assert_delivery("host4", "4,");
+}
+
+static void
+test_few_log_paths_are_not_dispatched(void)
+{
+  add_host_log_paths(0, 3, 0);
+  add_log_path("^host[0-9]$", 0);
+  add_log_path("^host[0-9]$", 0);
+  add_log_path(NULL, 0);
+  add_log_path(NULL, 0);
+  start_tree(FALSE);
+
+  assert_delivery("host2", "2,4,5,6,7,");
+}
+
+int
+main(int argc, char *argv[])
+{
+  app_startup();
+  deliveries = g_string_sized_new(64);
+
+  LOGMPX_TESTCASE(test_dispatched_delivery_keeps_the_order_of_log_paths);
+  LOGMPX_TESTCASE(test_final_flag_stops_dispatched_delivery);
+  LOGMPX_TESTCASE(test_fallback_flag_with_dispatched_delivery);
+  LOGMPX_TESTCASE(test_flow_control_flag_with_dispatched_delivery);
+  LOGMPX_TESTCASE(test_few_log_paths_are_not_dispatched);
+
+  g_string_free(deliveries, TRUE);
+  app_shutdown();
+  return 0;
+}
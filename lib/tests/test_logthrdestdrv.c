@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2013 BalaBit IT Ltd, Budapest, Hungary
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "logthrdestdrv.h"
+#include "mainloop.h"
+#include "mainloop-call.h"
+#include "mainloop-worker.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "testutils.h"
+
+#define THRDEST_TESTCASE(x, ...) do { thrdest_testcase_begin(#x, #__VA_ARGS__); x(__VA_ARGS__); thrdest_testcase_end(); } while(0)
+
+#define thrdest_testcase_begin(func, args)                              \
+  do                                                                    \
+    {                                                                   \
+      testcase_begin("%s(%s)", func, args);                             \
+      current_config = cfg_new(0x0306);                                 \
+      current_config->persist = persist_config_new();                   \
+    }                                                                   \
+  while (0)
+
+#define thrdest_testcase_end()                                          \
+  do                                                                    \
+    {                                                                   \
+      persist_config_free(current_config->persist);                     \
+      current_config->persist = NULL;                                   \
+      cfg_free(current_config);                                         \
+      testcase_end();                                                   \
+    }                                                                   \
+  while (0)
+
+/* the worker threads are held in thread_init(), so that the queues can
+ * be checked before anything is consumed from them */
+static GStaticMutex gate_lock = G_STATIC_MUTEX_INIT;
+static GCond *gate_cond;
+static gboolean gate_open;
+static gint running_workers;
+
+static GlobalConfig *current_config;
+
+static void
+test_worker_thread_init(LogThrDestWorker *s)
+{
+  g_static_mutex_lock(&gate_lock);
+  running_workers++;
+  g_cond_broadcast(gate_cond);
+  while (!gate_open)
+    g_cond_wait(gate_cond, g_static_mutex_get_mutex(&gate_lock));
+  g_static_mutex_unlock(&gate_lock);
+}
+
+static void
+test_worker_thread_deinit(LogThrDestWorker *s)
+{
+  g_static_mutex_lock(&gate_lock);
+  running_workers--;
+  g_cond_broadcast(gate_cond);
+  g_static_mutex_unlock(&gate_lock);
+}
+
+static gboolean
+test_worker_insert(LogThrDestWorker *s)
+{
+  return TRUE;
+}
+
+static LogThrDestWorker *
+test_worker_construct(LogThrDestDriver *owner, gint worker_index)
+{
+  LogThrDestWorker *self = g_new0(LogThrDestWorker, 1);
+
+  log_threaded_dest_worker_init_instance(self, owner, worker_index);
+  self->thread_init = test_worker_thread_init;
+  self->thread_deinit = test_worker_thread_deinit;
+  self->insert = test_worker_insert;
+  return self;
+}
+
+static gchar *
+test_dd_format_persist_name(LogThrDestDriver *s)
+{
+  return "test_thrdest";
+}
+
+static gchar *
+test_dd_format_stats_instance(LogThrDestDriver *s)
+{
+  return "test_thrdest";
+}
+
+static gboolean
+test_dd_init(LogPipe *s)
+{
+  if (!log_dest_driver_init_method(s))
+    return FALSE;
+  return log_threaded_dest_driver_start(s);
+}
+
+static LogThrDestDriver *
+start_driver(gint num_workers)
+{
+  LogThrDestDriver *self = g_new0(LogThrDestDriver, 1);
+
+  log_threaded_dest_driver_init_instance(self, current_config);
+  self->super.super.super.init = test_dd_init;
+  self->super.super.group = g_strdup("d_test");
+  self->super.super.id = g_strdup("d_test#0");
+  self->worker.construct = test_worker_construct;
+  self->format.persist_name = test_dd_format_persist_name;
+  self->format.stats_instance = test_dd_format_stats_instance;
+  log_threaded_dest_driver_set_num_workers(&self->super.super, num_workers);
+
+  assert_true(log_pipe_init(&self->super.super.super), "error initializing the driver, workers: %d", num_workers);
+
+  g_static_mutex_lock(&gate_lock);
+  while (running_workers < num_workers)
+    g_cond_wait(gate_cond, g_static_mutex_get_mutex(&gate_lock));
+  g_static_mutex_unlock(&gate_lock);
+  return self;
+}
+
+static void
+stop_driver(LogThrDestDriver *self)
+{
+  gint i;
+
+  for (i = 0; i < self->num_workers; i++)
+    self->workers[i]->terminate = TRUE;
+
+  g_static_mutex_lock(&gate_lock);
+  gate_open = TRUE;
+  g_cond_broadcast(gate_cond);
+  while (running_workers > 0)
+    g_cond_wait(gate_cond, g_static_mutex_get_mutex(&gate_lock));
+  gate_open = FALSE;
+  g_static_mutex_unlock(&gate_lock);
+
+  log_pipe_deinit(&self->super.super.super);
+  log_pipe_unref(&self->super.super.super);
+}
+
+/* stops the driver and moves its queues into a new configuration */
+static void
+reload_driver(LogThrDestDriver *self)
+{
+  GlobalConfig *old_config = current_config;
+
+  stop_driver(self);
+  current_config = cfg_new(0x0306);
+  cfg_persist_config_move(old_config, current_config);
+  cfg_free(old_config);
+}
+
+static void
+send_messages(LogThrDestDriver *self, gint n)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint i;
+
+  for (i = 0; i < n; i++)
+    log_pipe_queue(&self->super.super.super, log_msg_new_empty(), &path_options);
+}
+
+static void
+assert_worker_queue_length(LogThrDestDriver *self, gint worker_index, gint expected)
+{
+  assert_gint(log_queue_get_length(self->workers[worker_index]->queue), expected,
+              "queue length mismatch, worker: %d", worker_index);
+}
+
+static void
+test_queues_of_removed_workers_are_moved_on_reload(void)
+{
+  LogThrDestDriver *driver = start_driver(3);
+
+  /* round-robin, two messages for each worker */
+  send_messages(driver, 6);
+  assert_worker_queue_length(driver, 0, 2);
+  assert_worker_queue_length(driver, 1, 2);
+  assert_worker_queue_length(driver, 2, 2);
+  reload_driver(driver);
+
+  driver = start_driver(1);
+  assert_worker_queue_length(driver, 0, 6);
+  reload_driver(driver);
+
+  /* nothing is left behind to be picked up again */
+  driver = start_driver(3);
+  assert_worker_queue_length(driver, 0, 6);
+  assert_worker_queue_length(driver, 1, 0);
+  assert_worker_queue_length(driver, 2, 0);
+  stop_driver(driver);
+}
+
+static void
+test_orphaned_queues_are_spread_over_the_remaining_workers(void)
+{
+  LogThrDestDriver *driver = start_driver(4);
+
+  send_messages(driver, 8);
+  reload_driver(driver);
+
+  driver = start_driver(2);
+  assert_worker_queue_length(driver, 0, 4);
+  assert_worker_queue_length(driver, 1, 4);
+  stop_driver(driver);
+}
+
+static void
+test_empty_queues_of_removed_workers_are_skipped(void)
+{
+  LogThrDestDriver *driver = start_driver(3);
+
+  /* the queue of the second worker stays empty */
+  send_messages(driver, 1);
+  driver->next_worker.counter = 2;
+  send_messages(driver, 1);
+  reload_driver(driver);
+
+  driver = start_driver(1);
+  assert_worker_queue_length(driver, 0, 2);
+  stop_driver(driver);
+}
+
+int
+main(int argc, char *argv[])
+{
+  app_startup();
+  main_thread_handle = get_thread_id();
+  main_loop_worker_init();
+  main_loop_call_init();
+  gate_cond = g_cond_new();
+
+  THRDEST_TESTCASE(test_queues_of_removed_workers_are_moved_on_reload);
+  THRDEST_TESTCASE(test_orphaned_queues_are_spread_over_the_remaining_workers);
+  THRDEST_TESTCASE(test_empty_queues_of_removed_workers_are_skipped);
+
+  g_cond_free(gate_cond);
+
+  /* the finished worker threads are waiting for the main loop to
+   * account for their exit, which never runs here */
+  return 0;
+}
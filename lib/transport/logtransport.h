@@ -36,6 +36,9 @@ struct _LogTransport
   GIOCondition cond;
   gssize (*read)(LogTransport *self, gpointer buf, gsize count, LogTransportAuxData *aux);
   gssize (*write)(LogTransport *self, const gpointer buf, gsize count);
+  /* optional, TRUE if data was already read from the fd and is waiting
+   * in the transport, e.g. poll() would not indicate it */
+  gboolean (*has_buffered_data)(LogTransport *self);
   void (*free_fn)(LogTransport *self);
 };
 
@@ -51,6 +54,12 @@ log_transport_read(LogTransport *self, gpointer buf, gsize count, LogTransportAu
   return self->read(self, buf, count, aux);
 }
 
+static inline gboolean
+log_transport_has_buffered_data(LogTransport *self)
+{
+  return self->has_buffered_data && self->has_buffered_data(self);
+}
+
 void log_transport_init_instance(LogTransport *s, gint fd);
 void log_transport_free_method(LogTransport *s);
 void log_transport_free(LogTransport *s);
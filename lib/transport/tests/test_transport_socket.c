@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2002-2013 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2013 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ */
+#include "testutils.h"
+#include "transport/transport-socket.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRANSPORT_SOCKET_TESTCASE(x, ...) do { testcase_begin("%s(%s)", #x, #__VA_ARGS__); x(__VA_ARGS__); testcase_end(); } while(0)
+
+static gint
+create_bound_udp_socket(GSockAddr **addr)
+{
+  struct sockaddr_in sin;
+  socklen_t sinlen = sizeof(sin);
+  gint fd;
+
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  assert_true(fd >= 0, "socket() failed");
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  assert_gint(bind(fd, (struct sockaddr *) &sin, sizeof(sin)), 0, "bind() failed");
+  assert_gint(getsockname(fd, (struct sockaddr *) &sin, &sinlen), 0, "getsockname() failed");
+
+  *addr = g_sockaddr_new((struct sockaddr *) &sin, sinlen);
+  return fd;
+}
+
+static void
+send_datagram(gint fd, GSockAddr *dest, const gchar *payload)
+{
+  assert_gint(sendto(fd, payload, strlen(payload), 0, &dest->sa, dest->salen), strlen(payload),
+              "sendto() failed");
+}
+
+static void
+assert_next_datagram(LogTransport *transport, const gchar *expected_payload, GSockAddr *expected_peer)
+{
+  LogTransportAuxData aux;
+  gchar buf[1024];
+  gchar peer[64], expected[64];
+  gssize rc;
+
+  log_transport_aux_data_init(&aux);
+  rc = log_transport_read(transport, buf, sizeof(buf), &aux);
+  assert_nstring(buf, rc, expected_payload, -1, "datagram payload mismatch");
+
+  assert_true(aux.peer_addr != NULL, "peer address was not set");
+  g_sockaddr_format(aux.peer_addr, peer, sizeof(peer), GSA_FULL);
+  g_sockaddr_format(expected_peer, expected, sizeof(expected), GSA_FULL);
+  assert_string(peer, expected, "peer address mismatch");
+  log_transport_aux_data_destroy(&aux);
+}
+
+static void
+test_batched_dgram_socket_returns_datagrams_one_by_one(gint batch_size)
+{
+  GSockAddr *server_addr, *client1_addr, *client2_addr;
+  gint server_fd, client1_fd, client2_fd;
+  LogTransport *transport;
+
+  server_fd = create_bound_udp_socket(&server_addr);
+  client1_fd = create_bound_udp_socket(&client1_addr);
+  client2_fd = create_bound_udp_socket(&client2_addr);
+
+  send_datagram(client1_fd, server_addr, "first");
+  send_datagram(client2_fd, server_addr, "second");
+  send_datagram(client1_fd, server_addr, "third");
+
+  transport = log_transport_dgram_socket_batched_new(server_fd, batch_size);
+  assert_next_datagram(transport, "first", client1_addr);
+  assert_next_datagram(transport, "second", client2_addr);
+  assert_next_datagram(transport, "third", client1_addr);
+  assert_false(log_transport_has_buffered_data(transport), "transport has datagrams left after reading all of them");
+  log_transport_free(transport);
+
+  close(client1_fd);
+  close(client2_fd);
+  g_sockaddr_unref(server_addr);
+  g_sockaddr_unref(client1_addr);
+  g_sockaddr_unref(client2_addr);
+}
+
+int
+main(int argc, char *argv[])
+{
+  TRANSPORT_SOCKET_TESTCASE(test_batched_dgram_socket_returns_datagrams_one_by_one, 1);
+  TRANSPORT_SOCKET_TESTCASE(test_batched_dgram_socket_returns_datagrams_one_by_one, 2);
+  TRANSPORT_SOCKET_TESTCASE(test_batched_dgram_socket_returns_datagrams_one_by_one, 16);
+  return 0;
+}
@@ -23,6 +23,8 @@
 
 #include "transport-socket.h"
 
+#include <string.h>
+
 
 static gssize
 log_transport_dgram_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
@@ -93,6 +95,162 @@ log_transport_dgram_socket_new(gint fd)
   return &self->super;
 }
 
+#if HAVE_RECVMMSG
+
+/*
+ * Datagram socket that receives up to batch_size datagrams with a single
+ * recvmmsg() call and returns them one-by-one from its read method, each
+ * with its own peer address.
+ */
+typedef struct _LogTransportDGramSocketBatched
+{
+  LogTransportSocket super;
+  gint batch_size;
+  gsize buffer_size;
+  guchar *buffers;
+  struct mmsghdr *msgs;
+  struct iovec *iovs;
+  struct sockaddr_storage *addrs;
+
+  /* datagrams received by the last recvmmsg() and the next one to return */
+  gint received;
+  gint pos;
+} LogTransportDGramSocketBatched;
+
+static void
+log_transport_dgram_socket_batched_free_buffers(LogTransportDGramSocketBatched *self)
+{
+  g_free(self->buffers);
+  g_free(self->msgs);
+  g_free(self->iovs);
+  g_free(self->addrs);
+  self->buffers = NULL;
+  self->msgs = NULL;
+  self->iovs = NULL;
+  self->addrs = NULL;
+}
+
+/* buffers are sized after the first read, as only the caller knows the
+ * maximum message size */
+static void
+log_transport_dgram_socket_batched_alloc_buffers(LogTransportDGramSocketBatched *self, gsize buffer_size)
+{
+  gint i;
+
+  log_transport_dgram_socket_batched_free_buffers(self);
+
+  self->buffer_size = buffer_size;
+  self->buffers = g_malloc(self->batch_size * buffer_size);
+  self->msgs = g_new0(struct mmsghdr, self->batch_size);
+  self->iovs = g_new0(struct iovec, self->batch_size);
+  self->addrs = g_new0(struct sockaddr_storage, self->batch_size);
+
+  for (i = 0; i < self->batch_size; i++)
+    {
+      self->iovs[i].iov_base = self->buffers + i * buffer_size;
+      self->iovs[i].iov_len = buffer_size;
+      self->msgs[i].msg_hdr.msg_iov = &self->iovs[i];
+      self->msgs[i].msg_hdr.msg_iovlen = 1;
+      self->msgs[i].msg_hdr.msg_name = &self->addrs[i];
+    }
+}
+
+static gint
+log_transport_dgram_socket_batched_receive(LogTransportDGramSocketBatched *self)
+{
+  gint i, rc;
+
+  for (i = 0; i < self->batch_size; i++)
+    self->msgs[i].msg_hdr.msg_namelen = sizeof(self->addrs[i]);
+
+  do
+    {
+      rc = recvmmsg(self->super.super.fd, self->msgs, self->batch_size, 0, NULL);
+    }
+  while (rc == -1 && errno == EINTR);
+
+  self->pos = 0;
+  self->received = MAX(rc, 0);
+  return rc;
+}
+
+static gssize
+log_transport_dgram_socket_batched_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
+{
+  LogTransportDGramSocketBatched *self = (LogTransportDGramSocketBatched *) s;
+  struct mmsghdr *msg;
+  gssize rc;
+  gint i;
+
+  if (self->pos >= self->received)
+    {
+      if (self->buffer_size != buflen)
+        log_transport_dgram_socket_batched_alloc_buffers(self, buflen);
+
+      if (log_transport_dgram_socket_batched_receive(self) < 0)
+        return -1;
+    }
+
+  i = self->pos++;
+  msg = &self->msgs[i];
+  rc = MIN(msg->msg_len, buflen);
+  memcpy(buf, self->iovs[i].iov_base, rc);
+
+  if (msg->msg_hdr.msg_namelen && aux)
+    log_transport_aux_data_set_peer_addr_ref(aux, g_sockaddr_new((struct sockaddr *) msg->msg_hdr.msg_name, msg->msg_hdr.msg_namelen));
+  if (rc == 0)
+    {
+      /* DGRAM sockets should never return EOF, they just need to be read again */
+      rc = -1;
+      errno = EAGAIN;
+    }
+  return rc;
+}
+
+static gboolean
+log_transport_dgram_socket_batched_has_buffered_data(LogTransport *s)
+{
+  LogTransportDGramSocketBatched *self = (LogTransportDGramSocketBatched *) s;
+
+  return self->pos < self->received;
+}
+
+static void
+log_transport_dgram_socket_batched_free_method(LogTransport *s)
+{
+  LogTransportDGramSocketBatched *self = (LogTransportDGramSocketBatched *) s;
+
+  log_transport_dgram_socket_batched_free_buffers(self);
+  log_transport_free_method(s);
+}
+
+LogTransport *
+log_transport_dgram_socket_batched_new(gint fd, gint batch_size)
+{
+  LogTransportDGramSocketBatched *self;
+
+  if (batch_size <= 1)
+    return log_transport_dgram_socket_new(fd);
+
+  self = g_new0(LogTransportDGramSocketBatched, 1);
+  log_transport_dgram_socket_init_instance(&self->super, fd);
+  self->super.super.read = log_transport_dgram_socket_batched_read_method;
+  self->super.super.has_buffered_data = log_transport_dgram_socket_batched_has_buffered_data;
+  self->super.super.free_fn = log_transport_dgram_socket_batched_free_method;
+  self->batch_size = batch_size;
+  return &self->super.super;
+}
+
+#else
+
+LogTransport *
+log_transport_dgram_socket_batched_new(gint fd, gint batch_size)
+{
+  return log_transport_dgram_socket_new(fd);
+}
+
+#endif
+
 static gssize
 log_transport_stream_socket_read_method(LogTransport *s, gpointer buf, gsize buflen, LogTransportAuxData *aux)
 {
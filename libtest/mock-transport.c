@@ -181,3 +181,74 @@ log_transport_mock_endless_records_new(gchar *read_buffer1, gssize read_buffer_l
   self->eof_is_eagain = TRUE;
   return &self->super;
 }
+
+typedef struct
+{
+  LogTransport super;
+  GString *output;
+  /* 0 means unlimited, otherwise writes are short and every other
+   * write fails with EAGAIN */
+  gsize max_write_size;
+  gint write_count;
+  gboolean inject_eagain;
+} LogTransportMockWriter;
+
+static gssize
+log_transport_mock_writer_write_method(LogTransport *s, const gpointer buf, gsize count)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  if (self->max_write_size)
+    {
+      if (self->inject_eagain)
+        {
+          self->inject_eagain = FALSE;
+          errno = EAGAIN;
+          return -1;
+        }
+      self->inject_eagain = TRUE;
+      count = MIN(count, self->max_write_size);
+    }
+  g_string_append_len(self->output, buf, count);
+  self->write_count++;
+  return count;
+}
+
+static void
+log_transport_mock_writer_free_method(LogTransport *s)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  g_string_free(self->output, TRUE);
+  log_transport_free_method(s);
+}
+
+LogTransport *
+log_transport_mock_writer_new(gsize max_write_size)
+{
+  LogTransportMockWriter *self = g_new0(LogTransportMockWriter, 1);
+
+  self->super.fd = -1;
+  self->super.cond = 0;
+  self->super.write = log_transport_mock_writer_write_method;
+  self->super.free_fn = log_transport_mock_writer_free_method;
+  self->output = g_string_new("");
+  self->max_write_size = max_write_size;
+  return &self->super;
+}
+
+const GString *
+log_transport_mock_writer_get_output(LogTransport *s)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  return self->output;
+}
+
+gint
+log_transport_mock_writer_get_write_count(LogTransport *s)
+{
+  LogTransportMockWriter *self = (LogTransportMockWriter *) s;
+
+  return self->write_count;
+}
@@ -45,4 +45,15 @@ log_transport_mock_records_new(gchar *read_buffer1, gssize read_buffer_length1,
 LogTransport *
 log_transport_mock_endless_records_new(gchar *read_buffer1, gssize read_buffer_length1, ...);
 
+/* collects the written data, max_write_size limits the size of each
+ * write (and makes every other write fail with EAGAIN), 0 disables it */
+LogTransport *
+log_transport_mock_writer_new(gsize max_write_size);
+
+const GString *
+log_transport_mock_writer_get_output(LogTransport *s);
+
+gint
+log_transport_mock_writer_get_write_count(LogTransport *s);
+
 #endif
@@ -25,6 +25,8 @@
 #include "proto_lib.h"
 #include "msg_parse_lib.h"
 
+#include <string.h>
+
 LogProtoServerOptions proto_server_options;
 
 void
@@ -144,6 +146,31 @@ assert_proto_server_fetch_ignored_eof(LogProtoServer *proto)
   stop_grabbing_messages();
 }
 
+void
+assert_proto_client_post(LogProtoClient *proto, const gchar *msg, gboolean expected_consumed)
+{
+  guchar *msg_copy = (guchar *) g_strdup(msg);
+  gboolean consumed = FALSE;
+
+  assert_gint(log_proto_client_post(proto, msg_copy, strlen(msg), &consumed), LPS_SUCCESS,
+              "LogProtoClient post failed, msg=%s", msg);
+  assert_gboolean(consumed, expected_consumed, "LogProtoClient consumed mismatch, msg=%s", msg);
+  if (!consumed)
+    g_free(msg_copy);
+}
+
+/* flushes until all consumed messages are written, the same way LogWriter
+ * does when the fd becomes writable again */
+void
+assert_proto_client_flush_all(LogProtoClient *proto)
+{
+  gint i;
+
+  for (i = 0; i < 100000 && log_proto_client_get_pending_messages(proto) > 0; i++)
+    assert_gint(log_proto_client_flush(proto), LPS_SUCCESS, "LogProtoClient flush failed");
+  assert_gint(log_proto_client_get_pending_messages(proto), 0, "LogProtoClient failed to write out all messages");
+}
+
 void
 init_proto_tests(void)
 {
@@ -27,6 +27,7 @@
 
 #include "testutils.h"
 #include "logproto/logproto-server.h"
+#include "logproto/logproto-client.h"
 
 extern LogProtoServerOptions proto_server_options;
 
@@ -56,6 +57,9 @@ void assert_proto_server_fetch_ignored_eof(LogProtoServer *proto);
 
 LogProtoServer *construct_server_proto_plugin(const gchar *name, LogTransport *transport);
 
+void assert_proto_client_post(LogProtoClient *proto, const gchar *msg, gboolean expected_consumed);
+void assert_proto_client_flush_all(LogProtoClient *proto);
+
 void init_proto_tests(void);
 void deinit_proto_tests(void);
 
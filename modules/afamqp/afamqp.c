@@ -445,33 +445,30 @@ afamqp_worker_publish(AMQPDestDriver *self, LogMessage *msg)
   return success;
 }
 
+/*
+ * Messages of a batch are published back to back on the same channel. If
+ * any of them fails, the whole batch is retried after reconnecting, so
+ * messages published before the failure may be delivered twice.
+ */
 static gboolean
-afamqp_worker_insert(LogThrDestDriver *s)
+afamqp_worker_insert_batch(LogThrDestDriver *s, LogMessage **msgs, gint msgs_len)
 {
   AMQPDestDriver *self = (AMQPDestDriver *)s;
-  gboolean success;
-  LogMessage *msg;
-  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gboolean success = TRUE;
+  gint i;
 
   afamqp_dd_connect(self, TRUE);
 
-  success = log_queue_pop_head(s->queue, &msg, &path_options, FALSE, FALSE);
-  if (!success)
-    return TRUE;
-
-  msg_set_context(msg);
-  success = afamqp_worker_publish (self, msg);
-  msg_set_context(NULL);
-
-  if (success)
+  for (i = 0; success && i < msgs_len; i++)
     {
-      stats_counter_inc(s->stored_messages);
+      msg_set_context(msgs[i]);
+      success = afamqp_worker_publish (self, msgs[i]);
       step_sequence_number(&self->seq_num);
-      log_msg_ack(msg, &path_options);
-      log_msg_unref(msg);
     }
-  else
-    log_queue_push_head(s->queue, msg, &path_options);
+  msg_set_context(NULL);
+
+  if (success)
+    stats_counter_add(s->stored_messages, msgs_len);
 
   return success;
 }
@@ -556,7 +553,7 @@ afamqp_dd_new(GlobalConfig *cfg)
 
   self->super.worker.thread_init = afamqp_worker_thread_init;
   self->super.worker.disconnect = afamqp_dd_disconnect;
-  self->super.worker.insert = afamqp_worker_insert;
+  self->super.worker.insert_batch = afamqp_worker_insert_batch;
 
   self->super.format.stats_instance = afamqp_dd_format_stats_instance;
   self->super.format.persist_name = afamqp_dd_format_persist_name;
@@ -66,16 +66,21 @@ typedef struct
   time_t last_msg_stamp;
 
   ValuePairs *vp;
+  gchar *ns;
+} MongoDBDestDriver;
+
+typedef struct
+{
+  LogThrDestWorker super;
 
   /* Writer-only stuff */
   mongo_sync_connection *conn;
   gint32 seq_num;
 
-  gchar *ns;
-
-  GString *current_value;
+  /* the document currently being formatted, points into bsons */
   bson *bson;
-} MongoDBDestDriver;
+  bson **bsons;
+} MongoDBWorker;
 
 /*
  * Configuration
@@ -237,30 +242,31 @@ afmongodb_dd_format_persist_name(LogThrDestDriver *d)
 }
 
 static void
-afmongodb_dd_disconnect(LogThrDestDriver *s)
+afmongodb_worker_disconnect(LogThrDestWorker *s)
 {
-  MongoDBDestDriver *self = (MongoDBDestDriver *)s;
+  MongoDBWorker *self = (MongoDBWorker *)s;
 
   mongo_sync_disconnect(self->conn);
   self->conn = NULL;
 }
 
 static gboolean
-afmongodb_dd_connect(MongoDBDestDriver *self, gboolean reconnect)
+afmongodb_worker_connect(MongoDBWorker *worker, gboolean reconnect)
 {
+  MongoDBDestDriver *self = (MongoDBDestDriver *)worker->super.owner;
   GList *l;
 
-  if (reconnect && self->conn)
+  if (reconnect && worker->conn)
     return TRUE;
 
-  self->conn = mongo_sync_connect(self->address, self->port, FALSE);
-  if (!self->conn)
+  worker->conn = mongo_sync_connect(self->address, self->port, FALSE);
+  if (!worker->conn)
     {
       msg_error ("Error connecting to MongoDB", NULL);
       return FALSE;
     }
 
-  mongo_sync_conn_set_safe_mode(self->conn, self->safe_mode);
+  mongo_sync_conn_set_safe_mode(worker->conn, self->safe_mode);
 
   l = self->servers;
   while ((l = g_list_next(l)) != NULL)
@@ -275,7 +281,7 @@ afmongodb_dd_connect(MongoDBDestDriver *self, gboolean reconnect)
 		      NULL);
 	  continue;
 	}
-      mongo_sync_conn_seed_add (self->conn, host, port);
+      mongo_sync_conn_seed_add (worker->conn, host, port);
       msg_verbose("Added MongoDB server seed",
 		  evt_tag_str("host", host),
 		  evt_tag_int("port", port),
@@ -291,7 +297,7 @@ afmongodb_dd_connect(MongoDBDestDriver *self, gboolean reconnect)
           return FALSE;
         }
 
-      if (!mongo_sync_cmd_authenticate (self->conn, self->db,
+      if (!mongo_sync_cmd_authenticate (worker->conn, self->db,
                                         self->user, self->password))
         {
           msg_error("MongoDB authentication failed", NULL);
@@ -327,7 +333,7 @@ afmongodb_vp_obj_end(const gchar *name,
                      const gchar *prev, gpointer *prev_data,
                      gpointer user_data)
 {
-  MongoDBDestDriver *self = (MongoDBDestDriver *)user_data;
+  MongoDBWorker *self = (MongoDBWorker *)user_data;
   bson *root;
 
   if (prev_data)
@@ -352,13 +358,14 @@ afmongodb_vp_process_value(const gchar *name, const gchar *prefix,
                            gpointer *prefix_data, gpointer user_data)
 {
   bson *o;
-  MongoDBDestDriver *self = (MongoDBDestDriver *)user_data;
+  MongoDBWorker *worker = (MongoDBWorker *)user_data;
+  MongoDBDestDriver *self = (MongoDBDestDriver *)worker->super.owner;
   gboolean fallback = self->template_options.on_error & ON_ERROR_FALLBACK_TO_STRING;
 
   if (prefix_data)
     o = (bson *)*prefix_data;
   else
-    o = self->bson;
+    o = worker->bson;
 
   switch (type)
     {
@@ -448,100 +455,112 @@ afmongodb_vp_process_value(const gchar *name, const gchar *prefix,
 }
 
 static gboolean
-afmongodb_worker_insert (LogThrDestDriver *s)
+afmongodb_worker_format_document(MongoDBWorker *worker, LogMessage *msg)
 {
-  MongoDBDestDriver *self = (MongoDBDestDriver *)s;
-  gboolean success, need_drop = self->template_options.on_error & ON_ERROR_DROP_MESSAGE;
+  MongoDBDestDriver *self = (MongoDBDestDriver *)worker->super.owner;
+  gboolean success;
   guint8 *oid;
-  LogMessage *msg;
-  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
-
-  afmongodb_dd_connect(self, TRUE);
-
-  success = log_queue_pop_head(self->super.queue, &msg, &path_options, FALSE, FALSE);
-  if (!success)
-    return TRUE;
-
-  msg_set_context(msg);
 
-  bson_reset (self->bson);
+  bson_reset (worker->bson);
 
-  oid = mongo_util_oid_new_with_time (self->last_msg_stamp, self->seq_num);
-  bson_append_oid (self->bson, "_id", oid);
+  /* object ids have to be unique across workers */
+  oid = mongo_util_oid_new_with_time (self->last_msg_stamp,
+                                      worker->seq_num * self->super.num_workers + worker->super.worker_index);
+  bson_append_oid (worker->bson, "_id", oid);
   g_free (oid);
 
   success = value_pairs_walk(self->vp,
                              afmongodb_vp_obj_start,
                              afmongodb_vp_process_value,
                              afmongodb_vp_obj_end,
-                             msg, self->seq_num, LTZ_SEND,
+                             msg, worker->seq_num, LTZ_SEND,
                              &self->template_options,
-                             self);
-  bson_finish (self->bson);
+                             worker);
+  bson_finish (worker->bson);
+  return success;
+}
+
+static gboolean
+afmongodb_worker_insert_batch (LogThrDestWorker *s, LogMessage **msgs, gint msgs_len)
+{
+  MongoDBWorker *worker = (MongoDBWorker *)s;
+  MongoDBDestDriver *self = (MongoDBDestDriver *)s->owner;
+  gboolean need_drop = self->template_options.on_error & ON_ERROR_DROP_MESSAGE;
+  gint i, docs_len = 0, dropped = 0;
+  gint32 seq_num = worker->seq_num;
 
-  if (!success && !need_drop)
-    success = TRUE;
+  afmongodb_worker_connect(worker, TRUE);
 
-  if (success)
+  for (i = 0; i < msgs_len; i++)
     {
-      if (!mongo_sync_cmd_insert_n(self->conn, self->ns, 1,
-                                   (const bson **)&self->bson))
-        {
-          msg_error("Network error while inserting into MongoDB",
-                    evt_tag_int("time_reopen", self->super.time_reopen),
-                    NULL);
-          success = FALSE;
-        }
+      msg_set_context(msgs[i]);
+      worker->bson = worker->bsons[docs_len];
+      if (afmongodb_worker_format_document(worker, msgs[i]) || !need_drop)
+        docs_len++;
+      else
+        dropped++;
+      step_sequence_number(&worker->seq_num);
     }
-
   msg_set_context(NULL);
 
-  if (success)
+  if (docs_len > 0 &&
+      !mongo_sync_cmd_insert_n(worker->conn, self->ns, docs_len,
+                               (const bson **)worker->bsons))
     {
-      stats_counter_inc(self->super.stored_messages);
-      step_sequence_number(&self->seq_num);
-      log_msg_ack(msg, &path_options);
-      log_msg_unref(msg);
-    }
-  else
-    {
-      if (need_drop)
-        {
-          stats_counter_inc(self->super.dropped_messages);
-          step_sequence_number(&self->seq_num);
-          log_msg_ack(msg, &path_options);
-          log_msg_unref(msg);
-        }
-      else
-        log_queue_push_head(self->super.queue, msg, &path_options);
+      msg_error("Network error while inserting into MongoDB",
+                evt_tag_int("time_reopen", self->super.time_reopen),
+                evt_tag_int("batch_size", msgs_len),
+                evt_tag_int("worker", s->worker_index),
+                NULL);
+      /* the batch is going to be retried, reuse the same object ids */
+      worker->seq_num = seq_num;
+      return FALSE;
     }
 
-  return success;
+  stats_counter_add(s->stored_messages, docs_len);
+  stats_counter_add(s->dropped_messages, dropped);
+  return TRUE;
 }
 
 static void
-afmongodb_worker_thread_init(LogThrDestDriver *d)
+afmongodb_worker_thread_init(LogThrDestWorker *s)
 {
-  MongoDBDestDriver *self = (MongoDBDestDriver *)d;
+  MongoDBWorker *self = (MongoDBWorker *)s;
+  gint i;
 
-  afmongodb_dd_connect(self, FALSE);
+  afmongodb_worker_connect(self, FALSE);
 
-  self->ns = g_strconcat (self->db, ".", self->coll, NULL);
-
-  self->current_value = g_string_sized_new(256);
-
-  self->bson = bson_new_sized(4096);
+  self->bsons = g_new0(bson *, s->owner->batch_lines);
+  for (i = 0; i < s->owner->batch_lines; i++)
+    self->bsons[i] = bson_new_sized(4096);
 }
 
 static void
-afmongodb_worker_thread_deinit(LogThrDestDriver *d)
+afmongodb_worker_thread_deinit(LogThrDestWorker *s)
 {
-  MongoDBDestDriver *self = (MongoDBDestDriver *)d;
+  MongoDBWorker *self = (MongoDBWorker *)s;
+  gint i;
+
+  for (i = 0; i < s->owner->batch_lines; i++)
+    bson_free (self->bsons[i]);
+  g_free (self->bsons);
+  self->bsons = NULL;
+  self->bson = NULL;
+}
+
+static LogThrDestWorker *
+afmongodb_worker_new(LogThrDestDriver *owner, gint worker_index)
+{
+  MongoDBWorker *self = g_new0(MongoDBWorker, 1);
 
-  g_free (self->ns);
-  g_string_free (self->current_value, TRUE);
+  log_threaded_dest_worker_init_instance(&self->super, owner, worker_index);
+  self->super.thread_init = afmongodb_worker_thread_init;
+  self->super.thread_deinit = afmongodb_worker_thread_deinit;
+  self->super.disconnect = afmongodb_worker_disconnect;
+  self->super.insert_batch = afmongodb_worker_insert_batch;
 
-  bson_free (self->bson);
+  init_sequence_number(&self->seq_num);
+  return &self->super;
 }
 
 /*
@@ -591,6 +610,9 @@ afmongodb_dd_init(LogPipe *s)
         }
     }
 
+  g_free(self->ns);
+  self->ns = g_strconcat (self->db, ".", self->coll, NULL);
+
   if (self->port == MONGO_CONN_LOCAL)
     msg_verbose("Initializing MongoDB destination",
                 evt_tag_str("address", self->address),
@@ -617,6 +639,7 @@ afmongodb_dd_free(LogPipe *d)
 
   g_free(self->db);
   g_free(self->coll);
+  g_free(self->ns);
   g_free(self->user);
   g_free(self->password);
   g_free(self->address);
@@ -652,10 +675,7 @@ afmongodb_dd_new(GlobalConfig *cfg)
   self->super.super.super.super.free_fn = afmongodb_dd_free;
   self->super.queue_method = afmongodb_dd_queue_method;
 
-  self->super.worker.thread_init = afmongodb_worker_thread_init;
-  self->super.worker.thread_deinit = afmongodb_worker_thread_deinit;
-  self->super.worker.disconnect = afmongodb_dd_disconnect;
-  self->super.worker.insert = afmongodb_worker_insert;
+  self->super.worker.construct = afmongodb_worker_new;
   self->super.format.stats_instance = afmongodb_dd_format_stats_instance;
   self->super.format.persist_name = afmongodb_dd_format_persist_name;
   self->super.stats_source = SCS_MONGODB;
@@ -664,8 +684,6 @@ afmongodb_dd_new(GlobalConfig *cfg)
   afmongodb_dd_set_collection((LogDriver *)self, "messages");
   afmongodb_dd_set_safe_mode((LogDriver *)self, FALSE);
 
-  init_sequence_number(&self->seq_num);
-
   log_template_options_defaults(&self->template_options);
   afmongodb_dd_set_value_pairs(&self->super.super.super, value_pairs_new_default(cfg));
 
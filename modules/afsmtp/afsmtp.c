@@ -340,10 +340,12 @@ afsmtp_worker_insert(LogThrDestDriver *s)
   smtp_session_t session;
   smtp_message_t message;
   gpointer args[] = { self, NULL, NULL };
+  guint64 delivery_start;
 
   success = log_queue_pop_head(s->queue, &msg, &path_options, FALSE, FALSE);
   if (!success)
     return TRUE;
+  delivery_start = log_queue_get_delivery_start(s->queue);
 
   msg_set_context(msg);
 
@@ -417,6 +419,7 @@ afsmtp_worker_insert(LogThrDestDriver *s)
     {
       stats_counter_inc(s->stored_messages);
       step_sequence_number(&self->seq_num);
+      log_queue_message_delivered(s->queue, msg, delivery_start);
       log_msg_ack(msg, &path_options);
       log_msg_unref(msg);
     }
@@ -65,6 +65,7 @@ static CfgLexerKeyword afsocket_keywords[] = {
   { "so_rcvbuf",          KW_SO_RCVBUF },
   { "so_sndbuf",          KW_SO_SNDBUF },
   { "so_keepalive",       KW_SO_KEEPALIVE },
+  { "so_reuseport",       KW_SO_REUSEPORT, 0x0306 },
   { "tcp_keep_alive",     KW_SO_KEEPALIVE }, /* old, once deprecated form, but revived in 3.4 */
   { "tcp_keepalive",      KW_SO_KEEPALIVE, 0x0304 }, /* alias for so-keepalive, as tcp is the only option actually using it */
   { "tcp_keepalive_time", KW_TCP_KEEPALIVE_TIME, 0x0304 },
@@ -74,6 +75,7 @@ static CfgLexerKeyword afsocket_keywords[] = {
   { "transport",          KW_TRANSPORT },
   { "ip_protocol",        KW_IP_PROTOCOL },
   { "max_connections",    KW_MAX_CONNECTIONS },
+  { "listeners",          KW_LISTENERS, 0x0306 },
   { "keep_alive",         KW_KEEP_ALIVE },
   { NULL }
 };
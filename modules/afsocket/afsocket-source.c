@@ -46,6 +46,8 @@ typedef struct _AFSocketSourceConnection
   LogReader *reader;
   int sock;
   GSockAddr *peer_addr;
+  /* index of the dgram listener socket this connection represents */
+  gint listener_index;
 } AFSocketSourceConnection;
 
 static void afsocket_sd_close_connection(AFSocketSourceDriver *self, AFSocketSourceConnection *sc);
@@ -62,6 +64,12 @@ afsocket_sc_stats_instance(AFSocketSourceConnection *self)
       if (self->owner->bind_addr)
         {
           g_sockaddr_format(self->owner->bind_addr, buf, sizeof(buf), GSA_ADDRESS_ONLY);
+          if (self->listener_index > 0)
+            {
+              gsize len = strlen(buf);
+
+              g_snprintf(buf + len, sizeof(buf) - len, "#%d", self->listener_index);
+            }
           return buf;
         }
       else
@@ -250,21 +258,47 @@ afsocket_sd_set_max_connections(LogDriver *s, gint max_connections)
   self->max_connections = max_connections;
 }
 
+void
+afsocket_sd_set_listeners(LogDriver *s, gint num_listeners)
+{
+  AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
+
+  self->num_listeners = num_listeners;
+}
+
+/* the first listener keeps the name used before listeners() was introduced */
 static inline gchar *
-afsocket_sd_format_persist_name(AFSocketSourceDriver *self, gboolean listener_name)
+afsocket_sd_format_listener_persist_name(AFSocketSourceDriver *self, gint listener_index)
 {
   static gchar persist_name[128];
   gchar buf[64];
 
-  g_snprintf(persist_name, sizeof(persist_name),
-             listener_name ? "afsocket_sd_listen_fd(%s,%s)" : "afsocket_sd_connections(%s,%s)",
+  if (listener_index == 0)
+    g_snprintf(persist_name, sizeof(persist_name), "afsocket_sd_listen_fd(%s,%s)",
+               (self->transport_mapper->sock_type == SOCK_STREAM) ? "stream" : "dgram",
+               g_sockaddr_format(self->bind_addr, buf, sizeof(buf), GSA_FULL));
+  else
+    g_snprintf(persist_name, sizeof(persist_name), "afsocket_sd_listen_fd(%s,%s)#%d",
+               (self->transport_mapper->sock_type == SOCK_STREAM) ? "stream" : "dgram",
+               g_sockaddr_format(self->bind_addr, buf, sizeof(buf), GSA_FULL),
+               listener_index);
+  return persist_name;
+}
+
+static inline gchar *
+afsocket_sd_format_persist_name(AFSocketSourceDriver *self)
+{
+  static gchar persist_name[128];
+  gchar buf[64];
+
+  g_snprintf(persist_name, sizeof(persist_name), "afsocket_sd_connections(%s,%s)",
              (self->transport_mapper->sock_type == SOCK_STREAM) ? "stream" : "dgram",
              g_sockaddr_format(self->bind_addr, buf, sizeof(buf), GSA_FULL));
   return persist_name;
 }
 
 static gboolean
-afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr, gint fd)
+afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_addr, GSockAddr *local_addr, gint fd, gint listener_index)
 {
   gchar buf[MAX_SOCKADDR_STRING], buf2[MAX_SOCKADDR_STRING];
 #if ENABLE_TCP_WRAPPER
@@ -291,7 +325,8 @@ afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_add
 
 #endif
 
-  if (self->num_connections >= self->max_connections)
+  if (self->transport_mapper->sock_type == SOCK_STREAM &&
+      self->num_connections >= self->max_connections)
     {
       msg_error("Number of allowed concurrent connections reached, rejecting connection",
                 evt_tag_str("client", g_sockaddr_format(client_addr, buf, sizeof(buf), GSA_FULL)),
@@ -305,6 +340,7 @@ afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_add
       AFSocketSourceConnection *conn;
 
       conn = afsocket_sc_new(self, client_addr, fd);
+      conn->listener_index = listener_index;
       if (log_pipe_init(&conn->super))
         {
           afsocket_sd_add_connection(self,conn);
@@ -325,7 +361,8 @@ afsocket_sd_process_connection(AFSocketSourceDriver *self, GSockAddr *client_add
 static void
 afsocket_sd_accept(gpointer s)
 {
-  AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
+  AFSocketListener *listener = (AFSocketListener *) s;
+  AFSocketSourceDriver *self = listener->owner;
   GSockAddr *peer_addr;
   gchar buf1[256], buf2[256];
   gint new_fd;
@@ -336,7 +373,7 @@ afsocket_sd_accept(gpointer s)
     {
       GIOStatus status;
 
-      status = g_accept(self->fd, &new_fd, &peer_addr);
+      status = g_accept(listener->listen_fd.fd, &new_fd, &peer_addr);
       if (status == G_IO_STATUS_AGAIN)
         {
           /* no more connections to accept */
@@ -353,7 +390,7 @@ afsocket_sd_accept(gpointer s)
       g_fd_set_nonblock(new_fd, TRUE);
       g_fd_set_cloexec(new_fd, TRUE);
 
-      res = afsocket_sd_process_connection(self, peer_addr, self->bind_addr, new_fd);
+      res = afsocket_sd_process_connection(self, peer_addr, self->bind_addr, new_fd, listener - self->listeners);
 
       if (res)
         {
@@ -405,20 +442,21 @@ afsocket_sd_close_connection(AFSocketSourceDriver *self, AFSocketSourceConnectio
 }
 
 static void
-afsocket_sd_start_watches(AFSocketSourceDriver *self)
+afsocket_sd_start_watches(AFSocketSourceDriver *self, AFSocketListener *listener, gint fd)
 {
-  IV_FD_INIT(&self->listen_fd);
-  self->listen_fd.fd = self->fd;
-  self->listen_fd.cookie = self;
-  self->listen_fd.handler_in = afsocket_sd_accept;
-  iv_fd_register(&self->listen_fd);
+  listener->owner = self;
+  IV_FD_INIT(&listener->listen_fd);
+  listener->listen_fd.fd = fd;
+  listener->listen_fd.cookie = listener;
+  listener->listen_fd.handler_in = afsocket_sd_accept;
+  iv_fd_register(&listener->listen_fd);
 }
 
 static void
-afsocket_sd_stop_watches(AFSocketSourceDriver *self)
+afsocket_sd_stop_watches(AFSocketSourceDriver *self, AFSocketListener *listener)
 {
-  if (iv_fd_registered (&self->listen_fd))
-    iv_fd_unregister(&self->listen_fd);
+  if (iv_fd_registered (&listener->listen_fd))
+    iv_fd_unregister(&listener->listen_fd);
 }
 
 static gboolean
@@ -446,6 +484,9 @@ afsocket_sd_setup_reader_options(AFSocketSourceDriver *self)
       self->window_size_initialized = TRUE;
     }
   log_reader_options_init(&self->reader_options, cfg, self->super.super.group);
+
+  /* a reader run processes at most fetch_limit datagrams, receive them in one go */
+  self->transport_mapper->receive_batch_size = self->reader_options.fetch_limit;
   return TRUE;
 }
 
@@ -470,6 +511,14 @@ afsocket_sd_setup_transport(AFSocketSourceDriver *self)
   return TRUE;
 }
 
+/* whether a dgram socket kept alive across a reload can serve the new configuration */
+static gboolean
+afsocket_sd_dgram_connection_reusable(AFSocketSourceDriver *self, AFSocketSourceConnection *conn)
+{
+  return conn->listener_index < self->num_listeners &&
+         socket_options_bind_setup_matches(self->socket_options, conn->sock);
+}
+
 static gboolean
 afsocket_sd_restore_kept_alive_connections(AFSocketSourceDriver *self)
 {
@@ -478,77 +527,168 @@ afsocket_sd_restore_kept_alive_connections(AFSocketSourceDriver *self)
   /* fetch persistent connections first */
   if (self->connections_kept_alive_accross_reloads)
     {
-      GList *p;
+      GList *p, *next;
 
-      self->connections = cfg_persist_config_fetch(cfg, afsocket_sd_format_persist_name(self, FALSE));
+      self->connections = cfg_persist_config_fetch(cfg, afsocket_sd_format_persist_name(self));
 
       self->num_connections = 0;
-      for (p = self->connections; p; p = p->next)
+      for (p = self->connections; p; p = next)
         {
-          afsocket_sc_set_owner((AFSocketSourceConnection *) p->data, self);
-          log_pipe_init((LogPipe *) p->data);
+          AFSocketSourceConnection *conn = (AFSocketSourceConnection *) p->data;
+
+          next = p->next;
+          if (self->transport_mapper->sock_type == SOCK_DGRAM && !afsocket_sd_dgram_connection_reusable(self, conn))
+            {
+              /* closed before the new sockets are bound to the same address */
+              self->connections = g_list_delete_link(self->connections, p);
+              afsocket_sd_kill_connection(conn);
+              continue;
+            }
+          afsocket_sc_set_owner(conn, self);
+          log_pipe_init((LogPipe *) conn);
           self->num_connections++;
         }
     }
   return TRUE;
 }
 
-static gboolean
-afsocket_sd_open_listener(AFSocketSourceDriver *self)
+/*
+ * Fetches the listening sockets kept alive across a reload into @socks.
+ * Sockets of removed listeners and the ones set up with different
+ * pre-bind options (e.g. a listeners(1) socket without SO_REUSEPORT,
+ * when listeners() is raised) are closed, so that they don't keep the
+ * address busy when the new sockets are bound.
+ */
+static void
+afsocket_sd_restore_kept_alive_listeners(AFSocketSourceDriver *self, gint *socks)
 {
   GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
-  gint sock;
-  gboolean res = FALSE;
+  gint sock, i;
 
-  /* ok, we have connection list, check if we need to open a listener */
-  sock = -1;
-  if (self->transport_mapper->sock_type == SOCK_STREAM)
+  for (i = 0; i < self->num_listeners; i++)
+    socks[i] = -1;
+
+  if (!self->connections_kept_alive_accross_reloads)
+    return;
+
+  for (i = 0; ; i++)
     {
-      if (self->connections_kept_alive_accross_reloads)
+      /* NOTE: this assumes that fd 0 will never be used for listening fds,
+       * main.c opens fd 0 so this assumption can hold */
+      sock = GPOINTER_TO_UINT(cfg_persist_config_fetch(cfg, afsocket_sd_format_listener_persist_name(self, i))) - 1;
+      if (sock == -1)
         {
-          /* NOTE: this assumes that fd 0 will never be used for listening fds,
-           * main.c opens fd 0 so this assumption can hold */
-          sock = GPOINTER_TO_UINT(cfg_persist_config_fetch(cfg, afsocket_sd_format_persist_name(self, TRUE))) - 1;
+          if (i >= self->num_listeners)
+            break;
+          continue;
         }
 
-      if (sock == -1)
+      if (i < self->num_listeners && socket_options_bind_setup_matches(self->socket_options, sock))
         {
-          if (!afsocket_sd_acquire_socket(self, &sock))
-            return self->super.super.optional;
-          if (sock == -1 && !transport_mapper_open_socket(self->transport_mapper, self->socket_options, self->bind_addr, AFSOCKET_DIR_RECV, &sock))
-            return self->super.super.optional;
+          socks[i] = sock;
         }
-
-      /* set up listening source */
-      if (listen(sock, self->listen_backlog) < 0)
+      else
         {
-          msg_error("Error during listen()",
-                    evt_tag_errno(EVT_TAG_OSERROR, errno),
-                    NULL);
+          msg_verbose("Closing listener fd, it does not match the new configuration",
+                      evt_tag_int("fd", sock),
+                      NULL);
           close(sock);
-          return FALSE;
         }
+    }
+}
+
+static gboolean
+afsocket_sd_open_socket(AFSocketSourceDriver *self, gint listener_index, gint *sock)
+{
+  *sock = -1;
+
+  /* a socket passed by the runtime environment can only serve a single listener */
+  if (listener_index == 0 && !afsocket_sd_acquire_socket(self, sock))
+    return FALSE;
+  if (*sock == -1 && !transport_mapper_open_socket(self->transport_mapper, self->socket_options, self->bind_addr, AFSOCKET_DIR_RECV, sock))
+    return FALSE;
+  return TRUE;
+}
+
+static gboolean
+afsocket_sd_has_dgram_connection(AFSocketSourceDriver *self, gint listener_index)
+{
+  GList *p;
+
+  for (p = self->connections; p; p = p->next)
+    {
+      if (((AFSocketSourceConnection *) p->data)->listener_index == listener_index)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+static void
+afsocket_sd_close_listener_sockets(gint *socks, gint from, gint to)
+{
+  gint i;
+
+  for (i = from; i < to; i++)
+    {
+      if (socks[i] != -1)
+        close(socks[i]);
+    }
+}
+
+static gboolean
+afsocket_sd_open_listener(AFSocketSourceDriver *self)
+{
+  gint sock, i;
+
+  /* ok, we have connection list, check if we need to open a listener */
+  if (self->transport_mapper->sock_type == SOCK_STREAM)
+    {
+      gint *socks = g_new(gint, self->num_listeners);
+
+      self->listeners = g_new0(AFSocketListener, self->num_listeners);
+      afsocket_sd_restore_kept_alive_listeners(self, socks);
+      for (i = 0; i < self->num_listeners; i++)
+        {
+          sock = socks[i];
+          if (sock == -1 && !afsocket_sd_open_socket(self, i, &sock))
+            {
+              afsocket_sd_close_listener_sockets(socks, i + 1, self->num_listeners);
+              g_free(socks);
+              return self->super.super.optional;
+            }
+
+          /* set up listening source */
+          if (listen(sock, self->listen_backlog) < 0)
+            {
+              msg_error("Error during listen()",
+                        evt_tag_errno(EVT_TAG_OSERROR, errno),
+                        NULL);
+              close(sock);
+              afsocket_sd_close_listener_sockets(socks, i + 1, self->num_listeners);
+              g_free(socks);
+              return FALSE;
+            }
 
-      self->fd = sock;
-      afsocket_sd_start_watches(self);
-      res = TRUE;
+          afsocket_sd_start_watches(self, &self->listeners[i], sock);
+        }
+      g_free(socks);
     }
   else
     {
-      if (!self->connections)
+      /* kept-alive connections are reused, only the missing dgram sockets are opened */
+      for (i = 0; i < self->num_listeners; i++)
         {
-          if (!afsocket_sd_acquire_socket(self, &sock))
-            return self->super.super.optional;
-          if (sock == -1 && !transport_mapper_open_socket(self->transport_mapper, self->socket_options, self->bind_addr, AFSOCKET_DIR_RECV, &sock))
+          if (afsocket_sd_has_dgram_connection(self, i))
+            continue;
+
+          if (!afsocket_sd_open_socket(self, i, &sock))
             return self->super.super.optional;
-        }
-      self->fd = -1;
 
-      /* we either have self->connections != NULL, or sock contains a new fd */
-      if (self->connections || afsocket_sd_process_connection(self, NULL, self->bind_addr, sock))
-        res = TRUE;
+          if (!afsocket_sd_process_connection(self, NULL, self->bind_addr, sock, i))
+            return FALSE;
+        }
     }
-  return res;
+  return TRUE;
 }
 
 static void
@@ -578,7 +718,7 @@ afsocket_sd_save_connections(AFSocketSourceDriver *self)
         {
           log_pipe_deinit((LogPipe *) p->data);
         }
-      cfg_persist_config_add(cfg, afsocket_sd_format_persist_name(self, FALSE), self->connections, (GDestroyNotify) afsocket_sd_kill_connection_list, FALSE);
+      cfg_persist_config_add(cfg, afsocket_sd_format_persist_name(self), self->connections, (GDestroyNotify) afsocket_sd_kill_connection_list, FALSE);
     }
   self->connections = NULL;
 }
@@ -587,25 +727,37 @@ static void
 afsocket_sd_save_listener(AFSocketSourceDriver *self)
 {
   GlobalConfig *cfg = log_pipe_get_config(&self->super.super.super);
+  gint i;
 
-  if (self->transport_mapper->sock_type == SOCK_STREAM)
+  if (self->transport_mapper->sock_type == SOCK_STREAM && self->listeners)
     {
-      afsocket_sd_stop_watches(self);
-      if (!self->connections_kept_alive_accross_reloads)
+      for (i = 0; i < self->num_listeners; i++)
         {
-          msg_verbose("Closing listener fd",
-                      evt_tag_int("fd", self->fd),
-                      NULL);
-          close(self->fd);
-        }
-      else
-        {
-          /* NOTE: the fd is incremented by one when added to persistent config
-           * as persist config cannot store NULL */
+          AFSocketListener *listener = &self->listeners[i];
+
+          if (!iv_fd_registered(&listener->listen_fd))
+            continue;
+
+          afsocket_sd_stop_watches(self, listener);
+          if (!self->connections_kept_alive_accross_reloads)
+            {
+              msg_verbose("Closing listener fd",
+                          evt_tag_int("fd", listener->listen_fd.fd),
+                          NULL);
+              close(listener->listen_fd.fd);
+            }
+          else
+            {
+              /* NOTE: the fd is incremented by one when added to persistent config
+               * as persist config cannot store NULL */
 
-          cfg_persist_config_add(cfg, afsocket_sd_format_persist_name(self, TRUE), GUINT_TO_POINTER(self->fd + 1), afsocket_sd_close_fd, FALSE);
+              cfg_persist_config_add(cfg, afsocket_sd_format_listener_persist_name(self, i),
+                                     GUINT_TO_POINTER(listener->listen_fd.fd + 1), afsocket_sd_close_fd, FALSE);
+            }
         }
     }
+  g_free(self->listeners);
+  self->listeners = NULL;
 }
 
 
@@ -620,6 +772,11 @@ afsocket_sd_init_method(LogPipe *s)
 {
   AFSocketSourceDriver *self = (AFSocketSourceDriver *) s;
 
+  if (self->num_listeners < 1)
+    self->num_listeners = 1;
+  if (self->num_listeners > 1)
+    self->socket_options->so_reuseport = TRUE;
+
   return log_src_driver_init_method(s) &&
          afsocket_sd_setup_transport(self) &&
          afsocket_sd_setup_addresses(self) &&
@@ -682,6 +839,7 @@ afsocket_sd_init_instance(AFSocketSourceDriver *self,
   self->socket_options = socket_options;
   self->transport_mapper = transport_mapper;
   self->max_connections = 10;
+  self->num_listeners = 1;
   self->listen_backlog = 255;
   self->connections_kept_alive_accross_reloads = TRUE;
   log_reader_options_defaults(&self->reader_options);
@@ -36,6 +36,13 @@
 
 typedef struct _AFSocketSourceDriver AFSocketSourceDriver;
 
+/* a listening stream socket */
+typedef struct _AFSocketListener
+{
+  AFSocketSourceDriver *owner;
+  struct iv_fd listen_fd;
+} AFSocketListener;
+
 struct _AFSocketSourceDriver
 {
   LogSrcDriver super;
@@ -43,8 +50,11 @@ struct _AFSocketSourceDriver
     connections_kept_alive_accross_reloads:1,
     require_tls:1,
     window_size_initialized:1;
-  struct iv_fd listen_fd;
-  gint fd;
+  /* number of SO_REUSEPORT sockets bound to the same address, each
+   * stream listener accepts connections on its own, each dgram socket
+   * gets its own reader */
+  gint num_listeners;
+  AFSocketListener *listeners;
   LogReaderOptions reader_options;
   LogProtoServerFactory *proto_factory;
   GSockAddr *bind_addr;
@@ -73,6 +83,7 @@ struct _AFSocketSourceDriver
 
 void afsocket_sd_set_keep_alive(LogDriver *self, gint enable);
 void afsocket_sd_set_max_connections(LogDriver *self, gint max_connections);
+void afsocket_sd_set_listeners(LogDriver *self, gint num_listeners);
 
 static inline gboolean
 afsocket_sd_acquire_socket(AFSocketSourceDriver *s, gint *fd)
@@ -25,6 +25,48 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <errno.h>
+
+/* options that have to be applied before bind() */
+gboolean
+socket_options_setup_bind(SocketOptions *self, gint fd)
+{
+  if (self->so_reuseport)
+    {
+#ifdef SO_REUSEPORT
+      gint on = 1;
+
+      if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+        {
+          msg_error("Error setting SO_REUSEPORT on socket",
+                    evt_tag_errno(EVT_TAG_OSERROR, errno),
+                    NULL);
+          return FALSE;
+        }
+#else
+      msg_error("SO_REUSEPORT is not supported on this platform", NULL);
+      return FALSE;
+#endif
+    }
+  return TRUE;
+}
+
+/* whether a socket inherited from a previous configuration was set up
+ * with the same pre-bind options, otherwise it has to be reopened */
+gboolean
+socket_options_bind_setup_matches(SocketOptions *self, gint fd)
+{
+#ifdef SO_REUSEPORT
+  gint on = 0;
+  socklen_t len = sizeof(on);
+
+  if (getsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, &len) < 0)
+    return TRUE;
+  return !!on == !!self->so_reuseport;
+#else
+  return TRUE;
+#endif
+}
 
 gboolean
 socket_options_setup_socket_method(SocketOptions *self, gint fd, GSockAddr *bind_addr, AFSocketDirection dir)
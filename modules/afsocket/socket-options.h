@@ -40,9 +40,12 @@ struct _SocketOptions
   gint so_rcvbuf;
   gint so_broadcast;
   gint so_keepalive;
+  gboolean so_reuseport;
   gboolean (*setup_socket)(SocketOptions *s, gint sock, GSockAddr *bind_addr, AFSocketDirection dir);
 };
 
+gboolean socket_options_setup_bind(SocketOptions *self, gint fd);
+gboolean socket_options_bind_setup_matches(SocketOptions *self, gint fd);
 gboolean socket_options_setup_socket_method(SocketOptions *self, gint fd, GSockAddr *bind_addr, AFSocketDirection dir);
 void socket_options_init_instance(SocketOptions *self);
 SocketOptions *socket_options_new(void);
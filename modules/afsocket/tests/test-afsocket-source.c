@@ -0,0 +1,204 @@
+#include "afinet-source.h"
+#include "afsocket-source.h"
+#include "apphook.h"
+#include "mainloop.h"
+#include "cfg.h"
+#include "testutils.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <string.h>
+
+#define AFSOCKET_SOURCE_TESTCASE(x, ...) do { afsocket_source_testcase_begin(#x, #__VA_ARGS__); x(__VA_ARGS__); afsocket_source_testcase_end(); } while(0)
+
+#define afsocket_source_testcase_begin(func, args)                      \
+  do                                                                    \
+    {                                                                   \
+      testcase_begin("%s(%s)", func, args);                             \
+      find_free_port();                                                 \
+      current_config = cfg_new(0x0306);                                 \
+      current_config->persist = persist_config_new();                   \
+    }                                                                   \
+  while (0)
+
+#define afsocket_source_testcase_end()                                  \
+  do                                                                    \
+    {                                                                   \
+      persist_config_free(current_config->persist);                     \
+      current_config->persist = NULL;                                   \
+      cfg_free(current_config);                                         \
+      testcase_end();                                                   \
+    }                                                                   \
+  while (0)
+
+static GlobalConfig *current_config;
+static gchar port[16];
+
+/* the tests bind to a port nobody else is listening on */
+static void
+find_free_port(void)
+{
+  struct sockaddr_in sin;
+  socklen_t len = sizeof(sin);
+  gint fd;
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  bind(fd, (struct sockaddr *) &sin, sizeof(sin));
+  getsockname(fd, (struct sockaddr *) &sin, &len);
+  close(fd);
+  g_snprintf(port, sizeof(port), "%d", ntohs(sin.sin_port));
+}
+
+static AFSocketSourceDriver *
+start_source(AFInetSourceDriver *(*construct)(GlobalConfig *cfg), gint listeners, gboolean so_reuseport)
+{
+  AFInetSourceDriver *sd = construct(current_config);
+  LogDriver *driver = &sd->super.super.super;
+
+  driver->group = g_strdup("s_test");
+  driver->id = g_strdup("s_test#0");
+  afinet_sd_set_localip(driver, "127.0.0.1");
+  afinet_sd_set_localport(driver, port);
+  afsocket_sd_set_listeners(driver, listeners);
+  sd->super.socket_options->so_reuseport = so_reuseport;
+
+  assert_true(log_pipe_init(&driver->super), "error initializing the source, listeners: %d", listeners);
+  return &sd->super;
+}
+
+/* stops the source and moves its kept-alive sockets into a new configuration */
+static void
+reload_source(AFSocketSourceDriver *sd)
+{
+  GlobalConfig *old_config = current_config;
+
+  log_pipe_deinit(&sd->super.super.super);
+  log_pipe_unref(&sd->super.super.super);
+
+  current_config = cfg_new(0x0306);
+  cfg_persist_config_move(old_config, current_config);
+  cfg_free(old_config);
+}
+
+static void
+stop_source(AFSocketSourceDriver *sd)
+{
+  log_pipe_deinit(&sd->super.super.super);
+  log_pipe_unref(&sd->super.super.super);
+}
+
+static void
+assert_listener_so_reuseport(AFSocketSourceDriver *sd, gint listener_index, gboolean expected)
+{
+  gint fd = sd->listeners[listener_index].listen_fd.fd;
+  gint on = 0;
+  socklen_t len = sizeof(on);
+
+  assert_true(iv_fd_registered(&sd->listeners[listener_index].listen_fd), "listener is not running, index: %d", listener_index);
+  assert_gint(getsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, &len), 0, "getsockopt() failed, index: %d", listener_index);
+  assert_gboolean(!!on, expected, "SO_REUSEPORT mismatch, index: %d", listener_index);
+}
+
+static void
+test_stream_listeners_share_the_address(void)
+{
+  AFSocketSourceDriver *sd = start_source(afinet_sd_new_tcp, 3, FALSE);
+
+  assert_listener_so_reuseport(sd, 0, TRUE);
+  assert_listener_so_reuseport(sd, 1, TRUE);
+  assert_listener_so_reuseport(sd, 2, TRUE);
+  stop_source(sd);
+}
+
+static void
+test_so_reuseport_with_a_single_listener(void)
+{
+  AFSocketSourceDriver *sd = start_source(afinet_sd_new_tcp, 1, TRUE);
+
+  assert_listener_so_reuseport(sd, 0, TRUE);
+  stop_source(sd);
+}
+
+static void
+test_stream_listeners_are_raised_across_reload(void)
+{
+  AFSocketSourceDriver *sd = start_source(afinet_sd_new_tcp, 1, FALSE);
+
+  assert_listener_so_reuseport(sd, 0, FALSE);
+  reload_source(sd);
+
+  /* the kept-alive socket lacks SO_REUSEPORT, it has to be reopened */
+  sd = start_source(afinet_sd_new_tcp, 2, FALSE);
+  assert_listener_so_reuseport(sd, 0, TRUE);
+  assert_listener_so_reuseport(sd, 1, TRUE);
+  stop_source(sd);
+}
+
+static void
+test_stream_listeners_are_lowered_across_reload(void)
+{
+  AFSocketSourceDriver *sd = start_source(afinet_sd_new_tcp, 2, FALSE);
+
+  reload_source(sd);
+
+  /* neither the kept-alive SO_REUSEPORT socket, nor the removed
+   * listener may keep the address busy */
+  sd = start_source(afinet_sd_new_tcp, 1, FALSE);
+  assert_listener_so_reuseport(sd, 0, FALSE);
+  stop_source(sd);
+}
+
+static void
+test_stream_listener_is_kept_when_it_matches(void)
+{
+  AFSocketSourceDriver *sd = start_source(afinet_sd_new_tcp, 2, FALSE);
+  gint fd = sd->listeners[0].listen_fd.fd;
+
+  reload_source(sd);
+
+  sd = start_source(afinet_sd_new_tcp, 1, TRUE);
+  assert_gint(sd->listeners[0].listen_fd.fd, fd, "the kept-alive listener was not reused");
+  assert_listener_so_reuseport(sd, 0, TRUE);
+  stop_source(sd);
+}
+
+static void
+test_dgram_listeners_follow_reload(void)
+{
+  AFSocketSourceDriver *sd = start_source(afinet_sd_new_udp, 1, FALSE);
+
+  assert_gint(sd->num_connections, 1, "dgram socket count mismatch");
+  reload_source(sd);
+
+  sd = start_source(afinet_sd_new_udp, 3, FALSE);
+  assert_gint(sd->num_connections, 3, "dgram socket count mismatch after raising listeners()");
+  reload_source(sd);
+
+  sd = start_source(afinet_sd_new_udp, 1, FALSE);
+  assert_gint(sd->num_connections, 1, "dgram socket count mismatch after lowering listeners()");
+  stop_source(sd);
+}
+
+int
+main(int argc, char *argv[])
+{
+  app_startup();
+  main_thread_handle = get_thread_id();
+
+  AFSOCKET_SOURCE_TESTCASE(test_stream_listeners_share_the_address);
+  AFSOCKET_SOURCE_TESTCASE(test_so_reuseport_with_a_single_listener);
+  AFSOCKET_SOURCE_TESTCASE(test_stream_listeners_are_raised_across_reload);
+  AFSOCKET_SOURCE_TESTCASE(test_stream_listeners_are_lowered_across_reload);
+  AFSOCKET_SOURCE_TESTCASE(test_stream_listener_is_kept_when_it_matches);
+  AFSOCKET_SOURCE_TESTCASE(test_dgram_listeners_follow_reload);
+
+  app_shutdown();
+  return 0;
+}
@@ -66,6 +66,9 @@ transport_mapper_open_socket(TransportMapper *self,
   g_fd_set_nonblock(sock, TRUE);
   g_fd_set_cloexec(sock, TRUE);
 
+  if (!socket_options_setup_bind(socket_options, sock))
+    goto error_close;
+
   if (!transport_mapper_privileged_bind(sock, bind_addr))
     {
       gchar buf[256];
@@ -100,7 +103,7 @@ LogTransport *
 transport_mapper_construct_log_transport_method(TransportMapper *self, gint fd)
 {
   if (self->sock_type == SOCK_DGRAM)
-    return log_transport_dgram_socket_new(fd);
+    return log_transport_dgram_socket_batched_new(fd, self->receive_batch_size);
   else
     return log_transport_stream_socket_new(fd);
 }
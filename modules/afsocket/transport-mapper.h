@@ -45,6 +45,9 @@ struct _TransportMapper
   const gchar *logproto;
   gint stats_source;
 
+  /* number of datagrams to receive with a single syscall, set by sources */
+  gint receive_batch_size;
+
   gboolean (*apply_transport)(TransportMapper *self, GlobalConfig *cfg);
   LogTransport *(*construct_log_transport)(TransportMapper *self, gint fd);
   void (*free_fn)(TransportMapper *self);
@@ -639,32 +639,42 @@ afsql_dd_ensure_accessible_database_table(AFSqlDestDriver *self, LogMessage *msg
   return table;
 }
 
-static GString *
-afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+static inline gboolean
+afsql_dd_is_last_inserted_field(AFSqlDestDriver *self, gint i)
 {
-  GString *insert_command = g_string_sized_new(256);
-  GString *value = g_string_sized_new(512);
-  gint i, j;
+  gint j;
 
-  g_string_printf(insert_command, "INSERT INTO %s (", table->str);
+  j = i + 1;
+  while (j < self->fields_len && (self->fields[j].flags & AFSQL_FF_DEFAULT) == AFSQL_FF_DEFAULT)
+    j++;
+  return j >= self->fields_len;
+}
+
+static void
+afsql_dd_build_insert_columns(AFSqlDestDriver *self)
+{
+  gint i;
 
+  g_string_assign(self->insert_columns, "(");
   for (i = 0; i < self->fields_len; i++)
     {
       if ((self->fields[i].flags & AFSQL_FF_DEFAULT) == 0 && self->fields[i].value != NULL)
         {
-           g_string_append(insert_command, self->fields[i].name);
-
-           j = i + 1;
-           while (j < self->fields_len && (self->fields[j].flags & AFSQL_FF_DEFAULT) == AFSQL_FF_DEFAULT)
-             j++;
-
-           if (j < self->fields_len)
-             g_string_append(insert_command, ", ");
+          g_string_append(self->insert_columns, self->fields[i].name);
+          if (!afsql_dd_is_last_inserted_field(self, i))
+            g_string_append(self->insert_columns, ", ");
         }
     }
+  g_string_append(self->insert_columns, ")");
+}
 
-  g_string_append(insert_command, ") VALUES (");
+/* appends the "(value1, value2, ...)" tuple of @msg to @insert_command */
+static void
+afsql_dd_append_insert_values(AFSqlDestDriver *self, LogMessage *msg, GString *insert_command, GString *value)
+{
+  gint i;
 
+  g_string_append_c(insert_command, '(');
   for (i = 0; i < self->fields_len; i++)
     {
       gchar *quoted;
@@ -690,15 +700,21 @@ afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *t
                 }
             }
 
-          j = i + 1;
-          while (j < self->fields_len && (self->fields[j].flags & AFSQL_FF_DEFAULT) == AFSQL_FF_DEFAULT)
-            j++;
-          if (j < self->fields_len)
+          if (!afsql_dd_is_last_inserted_field(self, i))
             g_string_append(insert_command, ", ");
         }
     }
+  g_string_append_c(insert_command, ')');
+}
 
-  g_string_append(insert_command, ")");
+static GString *
+afsql_dd_build_insert_command(AFSqlDestDriver *self, LogMessage *msg, GString *table)
+{
+  GString *insert_command = g_string_sized_new(256);
+  GString *value = g_string_sized_new(512);
+
+  g_string_printf(insert_command, "INSERT INTO %s %s VALUES ", table->str, self->insert_columns->str);
+  afsql_dd_append_insert_values(self, msg, insert_command, value);
 
   g_string_free(value, TRUE);
 
@@ -762,15 +778,13 @@ afsql_dd_handle_insert_row_error_depending_on_connection_availability(AFSqlDestD
 }
 
 /**
- * afsql_dd_insert_db:
- *
- * This function is running in the database thread
+ * afsql_dd_insert_row:
  *
- * Returns: FALSE to indicate that the connection should be closed and
- * this destination suspended for time_reopen() time.
+ * Insert a single message using its own INSERT statement. This function
+ * is running in the database thread.
  **/
 static gboolean
-afsql_dd_insert_db(AFSqlDestDriver *self)
+afsql_dd_insert_row(AFSqlDestDriver *self)
 {
   GString *table = NULL;
   GString *insert_command = NULL;
@@ -778,9 +792,6 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
   gboolean success;
   LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
 
-  if (!afsql_dd_ensure_initialized_connection(self))
-    return FALSE;
-
   /* connection established, try to insert a message */
   success = log_queue_pop_head(self->queue, &msg, &path_options, FALSE, self->flags & AFSQL_DDF_EXPLICIT_COMMITS);
   if (!success)
@@ -861,6 +872,215 @@ afsql_dd_insert_db(AFSqlDestDriver *self)
   return success;
 }
 
+/**
+ * afsql_dd_get_multi_row_limit:
+ *
+ * Returns the maximum number of rows the next INSERT statement may
+ * contain. Without multi-row-inserts, and while recovering from a failed
+ * multi-row INSERT, this is always 1.
+ **/
+static gint
+afsql_dd_get_multi_row_limit(AFSqlDestDriver *self)
+{
+  gint limit;
+
+  if ((self->flags & AFSQL_DDF_MULTI_ROW_INSERTS) == 0 || self->multi_row_fallback > 0)
+    return 1;
+
+  limit = self->flush_lines;
+  if (afsql_dd_is_transaction_handling_enabled(self))
+    limit -= self->flush_lines_queued;
+
+  /* SQL Server refuses VALUES lists longer than 1000 rows */
+  if (strcmp(self->type, s_freetds) == 0)
+    limit = MIN(limit, 1000);
+  return limit;
+}
+
+static void
+afsql_dd_push_rows_back(AFSqlDestDriver *self, LogMessage **msgs, LogPathOptions *path_options, gint count)
+{
+  gint i;
+
+  for (i = count - 1; i >= 0; i--)
+    log_queue_push_head(self->queue, msgs[i], &path_options[i]);
+}
+
+/**
+ * afsql_dd_handle_insert_rows_error:
+ *
+ * Handle a failed multi-row INSERT. If the connection is still alive, the
+ * messages are put back to the head of the queue in their original order
+ * and retried one-by-one, so that the usual retry/drop logic applies to
+ * the offending row only. If the connection is lost in the middle of a
+ * transaction, rewinding the backlog gives the messages back, just like
+ * in the single-row case.
+ *
+ * NOTE: This function can only be called from the database thread.
+ **/
+static gboolean
+afsql_dd_handle_insert_rows_error(AFSqlDestDriver *self, LogMessage **msgs, LogPathOptions *path_options, gint count)
+{
+  const gchar *dbi_error;
+
+  if (dbi_conn_ping(self->dbi_ctx) == 1)
+    {
+      afsql_dd_push_rows_back(self, msgs, path_options, count);
+      /* leave room for retrying the failing row num_retries times */
+      self->multi_row_fallback = count + self->num_retries;
+      return TRUE;
+    }
+
+  if (afsql_dd_is_transaction_handling_enabled(self))
+    afsql_dd_handle_transaction_error(self);
+  else
+    afsql_dd_push_rows_back(self, msgs, path_options, count);
+
+  dbi_conn_error(self->dbi_ctx, &dbi_error);
+  msg_error("Error, no SQL connection after failed multi-row INSERT attempt",
+            evt_tag_str("type", self->type),
+            evt_tag_str("host", self->host),
+            evt_tag_str("port", self->port),
+            evt_tag_str("username", self->user),
+            evt_tag_str("database", self->database),
+            evt_tag_str("error", dbi_error),
+            NULL);
+  return FALSE;
+}
+
+/**
+ * afsql_dd_insert_rows:
+ *
+ * Insert up to @limit messages destined to the same table using a single
+ * multi-row INSERT statement. This function is running in the database
+ * thread.
+ **/
+static gboolean
+afsql_dd_insert_rows(AFSqlDestDriver *self, gint limit)
+{
+  LogMessage **msgs = g_new(LogMessage *, limit);
+  LogPathOptions *path_options = g_new(LogPathOptions, limit);
+  GString *table = NULL;
+  GString *first_table_name = g_string_sized_new(32);
+  GString *table_name = g_string_sized_new(32);
+  GString *insert_command = g_string_sized_new(256);
+  GString *value = g_string_sized_new(512);
+  gint32 first_seq_num = self->seq_num;
+  gint count = 0, i;
+  gboolean success = TRUE;
+
+  while (count < limit)
+    {
+      LogPathOptions local_options = LOG_PATH_OPTIONS_INIT;
+      LogMessage *msg;
+
+      if (!log_queue_pop_head(self->queue, &msg, &local_options, FALSE, self->flags & AFSQL_DDF_EXPLICIT_COMMITS))
+        break;
+
+      if (count == 0)
+        {
+          msg_set_context(msg);
+          log_template_format(self->table, msg, &self->template_options, LTZ_LOCAL, 0, NULL, first_table_name);
+          table = afsql_dd_ensure_accessible_database_table(self, msg);
+          if (!table)
+            {
+              /* let the single-row path apply the retry logic to this message */
+              log_queue_push_head(self->queue, msg, &local_options);
+              self->multi_row_fallback = 1;
+              break;
+            }
+          g_string_printf(insert_command, "INSERT INTO %s %s VALUES ", table->str, self->insert_columns->str);
+        }
+      else
+        {
+          log_template_format(self->table, msg, &self->template_options, LTZ_LOCAL, 0, NULL, table_name);
+          if (strcmp(table_name->str, first_table_name->str) != 0)
+            {
+              /* goes to a different table, leave it for the next statement */
+              log_queue_push_head(self->queue, msg, &local_options);
+              break;
+            }
+          g_string_append(insert_command, ", ");
+        }
+
+      afsql_dd_append_insert_values(self, msg, insert_command, value);
+      step_sequence_number(&self->seq_num);
+      msgs[count] = msg;
+      path_options[count] = local_options;
+      count++;
+    }
+
+  if (count == 0)
+    goto out;
+
+  if (afsql_dd_should_start_new_transaction(self) && !afsql_dd_begin_txn(self))
+    success = FALSE;
+  else
+    success = afsql_dd_run_query(self, insert_command->str, FALSE, NULL);
+
+  if (!success)
+    {
+      self->seq_num = first_seq_num;
+      success = afsql_dd_handle_insert_rows_error(self, msgs, path_options, count);
+      goto out;
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      log_msg_ack(msgs[i], &path_options[i]);
+      log_msg_unref(msgs[i]);
+    }
+  self->failed_message_counter = 0;
+
+  if (afsql_dd_is_transaction_handling_enabled(self))
+    {
+      self->flush_lines_queued += count;
+
+      /* in case of error, the queue is rewound by afsql_dd_commit_txn() */
+      if (afsql_dd_should_commit_transaction(self) && !afsql_dd_commit_txn(self))
+        success = FALSE;
+    }
+
+ out:
+  msg_set_context(NULL);
+
+  if (table != NULL)
+    g_string_free(table, TRUE);
+  g_string_free(first_table_name, TRUE);
+  g_string_free(table_name, TRUE);
+  g_string_free(insert_command, TRUE);
+  g_string_free(value, TRUE);
+  g_free(msgs);
+  g_free(path_options);
+
+  return success;
+}
+
+/**
+ * afsql_dd_insert_db:
+ *
+ * This function is running in the database thread
+ *
+ * Returns: FALSE to indicate that the connection should be closed and
+ * this destination suspended for time_reopen() time.
+ **/
+static gboolean
+afsql_dd_insert_db(AFSqlDestDriver *self)
+{
+  gint limit;
+
+  if (!afsql_dd_ensure_initialized_connection(self))
+    return FALSE;
+
+  limit = afsql_dd_get_multi_row_limit(self);
+  if (limit > 1)
+    return afsql_dd_insert_rows(self, limit);
+
+  if (self->multi_row_fallback > 0)
+    self->multi_row_fallback--;
+  return afsql_dd_insert_row(self);
+}
+
 static void
 afsql_dd_message_became_available_in_the_queue(gpointer user_data)
 {
@@ -1112,6 +1332,16 @@ afsql_dd_init(LogPipe *s)
         }
     }
 
+  afsql_dd_build_insert_columns(self);
+
+  if ((self->flags & AFSQL_DDF_MULTI_ROW_INSERTS) && strcmp(self->type, s_oracle) == 0)
+    {
+      msg_warning("Oracle does not support multi-row INSERT statements, inserting rows one-by-one",
+                  evt_tag_str("driver", self->super.super.id),
+                  NULL);
+      self->flags &= ~AFSQL_DDF_MULTI_ROW_INSERTS;
+    }
+
   self->time_reopen = cfg->time_reopen;
 
   log_template_options_init(&self->template_options, cfg);
@@ -1214,6 +1444,7 @@ afsql_dd_free(LogPipe *s)
     }
 
   g_free(self->fields);
+  g_string_free(self->insert_columns, TRUE);
   g_free(self->type);
   g_free(self->host);
   g_free(self->port);
@@ -1259,6 +1490,7 @@ afsql_dd_new(GlobalConfig *cfg)
   self->table = log_template_new(configuration, NULL);
   log_template_compile(self->table, "messages", NULL);
   self->failed_message_counter = 0;
+  self->insert_columns = g_string_sized_new(64);
 
   self->flush_lines = -1;
   self->flush_timeout = -1;
@@ -1284,6 +1516,8 @@ afsql_dd_lookup_flag(const gchar *flag)
     return AFSQL_DDF_EXPLICIT_COMMITS;
   else if (strcmp(flag, "dont-create-tables") == 0 || strcmp(flag, "dont_create_tables") == 0)
     return AFSQL_DDF_DONT_CREATE_TABLES;
+  else if (strcmp(flag, "multi-row-inserts") == 0 || strcmp(flag, "multi_row_inserts") == 0)
+    return AFSQL_DDF_MULTI_ROW_INSERTS;
   else
     msg_warning("Unknown SQL flag",
                 evt_tag_str("flag", flag),
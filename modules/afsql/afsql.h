@@ -43,6 +43,7 @@ enum
 {
   AFSQL_DDF_EXPLICIT_COMMITS = 0x0001,
   AFSQL_DDF_DONT_CREATE_TABLES = 0x0002,
+  AFSQL_DDF_MULTI_ROW_INSERTS = 0x0004,
 };
 
 typedef struct _AFSqlField
@@ -81,6 +82,8 @@ typedef struct _AFSqlDestDriver
   LogTemplate *table;
   gint fields_len;
   AFSqlField *fields;
+  /* the "(col1, col2, ...)" part of INSERT statements, built once in init */
+  GString *insert_columns;
   gchar *null_value;
   gint time_reopen;
   gint num_retries;
@@ -110,6 +113,8 @@ typedef struct _AFSqlDestDriver
   dbi_conn dbi_ctx;
   GHashTable *validated_tables;
   guint32 failed_message_counter;
+  /* number of messages to insert one-by-one after a failed multi-row INSERT */
+  gint multi_row_fallback;
 } AFSqlDestDriver;
 
 
@@ -319,6 +319,7 @@ afstomp_worker_insert(LogThrDestDriver *s)
   gboolean success;
   LogMessage *msg;
   LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  guint64 delivery_start;
 
   if (!afstomp_dd_connect(self, TRUE))
     return FALSE;
@@ -326,6 +327,7 @@ afstomp_worker_insert(LogThrDestDriver *s)
   success = log_queue_pop_head(self->super.queue, &msg, &path_options, FALSE, FALSE);
   if (!success)
     return TRUE;
+  delivery_start = log_queue_get_delivery_start(self->super.queue);
 
   msg_set_context(msg);
   success = afstomp_worker_publish (self, msg);
@@ -335,6 +337,7 @@ afstomp_worker_insert(LogThrDestDriver *s)
     {
       stats_counter_inc(self->super.stored_messages);
       step_sequence_number(&self->seq_num);
+      log_queue_message_delivered(self->super.queue, msg, delivery_start);
       log_msg_ack(msg, &path_options);
       log_msg_unref(msg);
     }
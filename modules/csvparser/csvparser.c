@@ -23,9 +23,20 @@
 
 #include "csvparser.h"
 #include "parser/parser-expr.h"
+#include "scratch-buffers.h"
 
 #include <string.h>
 
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__x86_64__) || defined(__i386__))
+/* see find-eom.c, the SSE2 code path is selected at runtime */
+#define CSV_PARSER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* multi-character delimiter sets up to this size are searched using SSE2 */
+#define CSV_PARSER_SIMD_MAX_DELIMITERS 4
+
 typedef struct _LogCSVParser
 {
   LogColumnParser super;
@@ -34,10 +45,157 @@ typedef struct _LogCSVParser
   gchar *quotes_end;
   gchar *null_value;
   guint32 flags;
+  /* CSV_CHAR_* bits for each byte, derived from delimiters */
+  guint8 char_class[256];
+  /* the closing quote for each opening quote character, 0 otherwise */
+  gchar quote_end[256];
+  /* the delimiters padded by repeating the first one, if SSE2 can be used */
+  gboolean simd_delimiters_valid;
+  gchar simd_delimiters[CSV_PARSER_SIMD_MAX_DELIMITERS];
 } LogCSVParser;
 
 #define LOG_CSV_PARSER_SINGLE_CHAR_DELIM 0x0100
 
+#define CSV_CHAR_DELIMITER  0x01
+#define CSV_CHAR_EOS        0x02
+
+#if CSV_PARSER_X86_SIMD
+
+static gint log_csv_parser_sse2_supported = -1;
+
+static gboolean
+log_csv_parser_is_sse2_supported(void)
+{
+  /* racing threads would store the same value, so no locking is needed */
+  if (G_UNLIKELY(log_csv_parser_sse2_supported < 0))
+    {
+      __builtin_cpu_init();
+      log_csv_parser_sse2_supported = __builtin_cpu_supports("sse2") ? 1 : 0;
+    }
+  return log_csv_parser_sse2_supported;
+}
+
+/* compares 16 bytes at once to each of the delimiters */
+__attribute__((target("sse2")))
+static const gchar *
+log_csv_parser_find_delimiter_sse2(LogCSVParser *self, const gchar *src, const gchar *end)
+{
+  const __m128i d0 = _mm_set1_epi8(self->simd_delimiters[0]);
+  const __m128i d1 = _mm_set1_epi8(self->simd_delimiters[1]);
+  const __m128i d2 = _mm_set1_epi8(self->simd_delimiters[2]);
+  const __m128i d3 = _mm_set1_epi8(self->simd_delimiters[3]);
+
+  for (; src + sizeof(__m128i) <= end; src += sizeof(__m128i))
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *) src);
+      guint mask;
+
+      mask = (guint) _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, d0), _mm_cmpeq_epi8(chunk, d1)),
+                                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, d2), _mm_cmpeq_epi8(chunk, d3))));
+      if (mask)
+        return src + __builtin_ctz(mask);
+    }
+  while (src < end && !(self->char_class[(guchar) *src] & CSV_CHAR_DELIMITER))
+    src++;
+  return src;
+}
+
+#endif
+
+/*
+ * The class tables replace strchr()/strcspn() on the configured
+ * delimiters and quotes for each character, strcspn() in particular
+ * rebuilds a similar table on every call.
+ */
+static void
+log_csv_parser_update_char_class(LogCSVParser *self)
+{
+  const gchar *p;
+  gint i, len;
+
+  memset(self->char_class, 0, sizeof(self->char_class));
+  memset(self->quote_end, 0, sizeof(self->quote_end));
+
+  self->char_class[0] = CSV_CHAR_EOS;
+  for (p = self->delimiters; p && *p; p++)
+    self->char_class[(guchar) *p] |= CSV_CHAR_DELIMITER;
+
+  for (i = 0; self->quotes_start && self->quotes_start[i]; i++)
+    self->quote_end[(guchar) self->quotes_start[i]] = self->quotes_end[i];
+
+  self->simd_delimiters_valid = FALSE;
+#if CSV_PARSER_X86_SIMD
+  len = self->delimiters ? strlen(self->delimiters) : 0;
+  if (len > 0 && len <= CSV_PARSER_SIMD_MAX_DELIMITERS && log_csv_parser_is_sse2_supported())
+    {
+      for (i = 0; i < CSV_PARSER_SIMD_MAX_DELIMITERS; i++)
+        self->simd_delimiters[i] = self->delimiters[i < len ? i : 0];
+      self->simd_delimiters_valid = TRUE;
+    }
+#endif
+}
+
+/* returns the first delimiter in [@src, @end), or @end, which has to point to the terminating NUL */
+static inline const gchar *
+log_csv_parser_find_delimiter(LogCSVParser *self, const gchar *src, const gchar *end)
+{
+  if (self->flags & LOG_CSV_PARSER_SINGLE_CHAR_DELIM)
+    {
+      /* libc already vectorizes this */
+      const gchar *delim = memchr(src, self->delimiters[0], end - src);
+
+      return delim ? delim : end;
+    }
+
+#if CSV_PARSER_X86_SIMD
+  if (self->simd_delimiters_valid)
+    return log_csv_parser_find_delimiter_sse2(self, src, end);
+#endif
+
+  while (!(self->char_class[(guchar) *src] & (CSV_CHAR_DELIMITER | CSV_CHAR_EOS)))
+    src++;
+  return src;
+}
+
+/*
+ * Columns that are verbatim parts of $MESSAGE are stored as references to
+ * it instead of being copied.  @message is reset once $MESSAGE itself is
+ * overwritten by a column.
+ */
+static void
+log_csv_parser_store_value(LogMessage *msg, const gchar *column, const gchar **message, gssize message_len,
+                           const gchar *value, gssize value_len)
+{
+  NVHandle handle = log_msg_get_value_handle(column);
+  gsize ofs;
+
+  if (*message && value >= *message)
+    {
+      ofs = value - *message;
+      if (ofs + value_len <= message_len && ofs + value_len <= G_MAXUINT16 &&
+          log_msg_is_handle_settable_with_an_indirect_value(handle))
+        {
+          log_msg_set_value_indirect(msg, handle, LM_V_MESSAGE, 0, ofs, value_len);
+          return;
+        }
+    }
+  log_msg_set_value(msg, handle, value, value_len);
+  if (handle == LM_V_MESSAGE)
+    *message = NULL;
+}
+
+/* appends a run of the input to the value being parsed, @value_start is
+ * cleared when the value stops being a contiguous part of the input */
+static inline void
+log_csv_parser_append_run(GString *value, const gchar **value_start, const gchar *run, gsize run_len)
+{
+  if (value->len == 0)
+    *value_start = run;
+  else if (*value_start && *value_start + value->len != run)
+    *value_start = NULL;
+  g_string_append_len(value, run, run_len);
+}
+
 static inline gint
 _is_escape_flag(guint32 flag)
 {
@@ -96,6 +254,7 @@ log_csv_parser_set_delimiters(LogColumnParser *s, const gchar *delimiters)
     self->flags |= LOG_CSV_PARSER_SINGLE_CHAR_DELIM;
   else
     self->flags &= ~LOG_CSV_PARSER_SINGLE_CHAR_DELIM;
+  log_csv_parser_update_char_class(self);
 }
 
 void
@@ -109,6 +268,7 @@ log_csv_parser_set_quotes(LogColumnParser *s, const gchar *quotes)
     g_free(self->quotes_end);
   self->quotes_start = g_strdup(quotes);
   self->quotes_end = g_strdup(quotes);
+  log_csv_parser_update_char_class(self);
 }
 
 void
@@ -132,6 +292,7 @@ log_csv_parser_set_quote_pairs(LogColumnParser *s, const gchar *quote_pairs)
     }
   self->quotes_start[i / 2] = 0;
   self->quotes_end[i / 2] = 0;
+  log_csv_parser_update_char_class(self);
 }
 
 void
@@ -152,9 +313,18 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
   GList *cur_column = self->super.columns;
   gint len;
   LogMessage *msg;
+  const gchar *message;
+  gssize message_len;
+  const gchar *input_end;
 
   src = input;
+  input_end = input + strlen(input);
   msg = log_msg_make_writable(pmsg, path_options);
+
+  message = log_msg_get_value(msg, LM_V_MESSAGE, &message_len);
+  if (input < message || input > message + message_len)
+    message = NULL;
+
   if ((self->flags & LOG_CSV_PARSER_ESCAPE_NONE) || ((self->flags & LOG_CSV_PARSER_ESCAPE_MASK) == 0))
     {
       /* no escaping, no need to keep state, we split input and trim if necessary */
@@ -162,21 +332,15 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
       while (cur_column && *src)
         {
           const guchar *delim;
-          guchar *quote;
           guchar current_quote;
 
-          quote = (guchar *) strchr(self->quotes_start, *src);
-          if (quote != NULL)
+          /* if we didn't start with a quote character, the delimiter terminates */
+          current_quote = self->quote_end[(guchar) *src];
+          if (current_quote)
             {
               /* ok, quote character found */
-              current_quote = self->quotes_end[quote - (guchar *) self->quotes_start];
               src++;
             }
-          else
-            {
-              /* we didn't start with a quote character, no need for escaping, delimiter terminates */
-              current_quote = 0;
-            }
 
           if (self->flags & LOG_CSV_PARSER_STRIP_WHITESPACE)
             {
@@ -189,9 +353,7 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
               /* search for end of quote */
               delim = (guchar *) strchr(src, current_quote);
 
-              if (delim &&
-                  (((self->flags & LOG_CSV_PARSER_SINGLE_CHAR_DELIM) && *(delim + 1) == self->delimiters[0]) ||
-                     strchr(self->delimiters, *(delim + 1)) != NULL))
+              if (delim && (self->char_class[*(delim + 1)] & (CSV_CHAR_DELIMITER | CSV_CHAR_EOS)))
                 {
                   /* closing quote, and then a delimiter, everything is nice */
                   delim++;
@@ -204,16 +366,7 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
             }
           else
             {
-              if (self->flags & LOG_CSV_PARSER_SINGLE_CHAR_DELIM)
-                {
-                  delim = (guchar *) strchr(src, self->delimiters[0]);
-                  if (!delim)
-                    delim = (guchar *) src + strlen(src);
-                }
-              else
-                {
-                  delim = (guchar *) src + strcspn(src, self->delimiters);
-                }
+              delim = (guchar *) log_csv_parser_find_delimiter(self, src, input_end);
             }
 
 
@@ -229,7 +382,7 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
           if (self->null_value && strncmp(src, self->null_value, len) == 0)
             log_msg_set_value(msg, log_msg_get_value_handle((gchar *) cur_column->data), "", 0);
           else
-            log_msg_set_value(msg, log_msg_get_value_handle((gchar *) cur_column->data), src, len);
+            log_csv_parser_store_value(msg, (gchar *) cur_column->data, &message, message_len, src, len);
 
           src = (gchar *) delim;
           if (*src)
@@ -239,7 +392,7 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
           if (cur_column && cur_column->next == NULL && self->flags & LOG_CSV_PARSER_GREEDY)
             {
               /* greedy mode, the last column gets it all, without taking escaping, quotes or anything into account */
-              log_msg_set_value(msg, log_msg_get_value_handle((gchar *) cur_column->data), src, -1);
+              log_csv_parser_store_value(msg, (gchar *) cur_column->data, &message, message_len, src, input_end - src);
               cur_column = NULL;
               src = NULL;
               break;
@@ -259,11 +412,15 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
           PS_EOS
         };
       gchar current_quote = 0;
+      SBGString *sb_current_value;
       GString *current_value;
+      /* where current_value starts in the input, if it is a verbatim copy of it */
+      const gchar *value_start = NULL;
+      const gchar *run;
       gboolean store_value = FALSE;
-      gchar *quote;
 
-      current_value = g_string_sized_new(128);
+      sb_current_value = sb_gstring_acquire();
+      current_value = sb_gstring_string(sb_current_value);
 
       state = PS_COLUMN_START;
       while (cur_column && *src)
@@ -273,16 +430,10 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
             case PS_COLUMN_START:
               /* check for quote character */
               state = PS_WHITESPACE;
-              quote = strchr(self->quotes_start, *src);
-              if (quote != NULL)
-                {
-                  /* ok, quote character found */
-                  current_quote = self->quotes_end[quote - self->quotes_start];
-                }
-              else
+              current_quote = self->quote_end[(guchar) *src];
+              if (!current_quote)
                 {
                   /* we didn't start with a quote character, no need for escaping, delimiter terminates */
-                  current_quote = 0;
                   /* don't skip to the next character */
                   continue;
                 }
@@ -301,13 +452,13 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
                   if ((self->flags & LOG_CSV_PARSER_ESCAPE_BACKSLASH) && *src == '\\' && *(src+1))
                     {
                       src++;
-                      g_string_append_c(current_value, *src);
+                      log_csv_parser_append_run(current_value, &value_start, src, 1);
                       break;
                     }
                   else if (self->flags & LOG_CSV_PARSER_ESCAPE_DOUBLE_CHAR && *src == current_quote && *(src+1) == current_quote)
                     {
                       src++;
-                      g_string_append_c(current_value, *src);
+                      log_csv_parser_append_run(current_value, &value_start, src, 1);
                       break;
                     }
                   if (*src == current_quote)
@@ -317,17 +468,25 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
                       state = PS_DELIMITER;
                       break;
                     }
-                  g_string_append_c(current_value, *src);
+                  /* copy everything up to the next quote or escape character at once */
+                  run = src;
+                  while (*(src+1) && *(src+1) != current_quote &&
+                         !((self->flags & LOG_CSV_PARSER_ESCAPE_BACKSLASH) && *(src+1) == '\\'))
+                    src++;
+                  log_csv_parser_append_run(current_value, &value_start, run, src - run + 1);
                 }
               else
                 {
                   /* unquoted value */
-                  if (strchr(self->delimiters, *src))
+                  if (self->char_class[(guchar) *src] & CSV_CHAR_DELIMITER)
                     {
                       state = PS_DELIMITER;
                       continue;
                     }
-                  g_string_append_c(current_value, *src);
+                  /* copy everything up to the next delimiter at once */
+                  run = src;
+                  src = log_csv_parser_find_delimiter(self, src + 1, input_end) - 1;
+                  log_csv_parser_append_run(current_value, &value_start, run, src - run + 1);
                 }
               break;
             case PS_DELIMITER:
@@ -345,9 +504,12 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
                 }
               if (self->null_value && strcmp(current_value->str, self->null_value) == 0)
                 log_msg_set_value(msg, log_msg_get_value_handle((gchar *) cur_column->data), "", 0);
+              else if (value_start && len > 0)
+                log_csv_parser_store_value(msg, (gchar *) cur_column->data, &message, message_len, value_start, len);
               else
                 log_msg_set_value(msg, log_msg_get_value_handle((gchar *) cur_column->data), current_value->str, len);
               g_string_truncate(current_value, 0);
+              value_start = NULL;
               cur_column = cur_column->next;
               state = PS_COLUMN_START;
               store_value = FALSE;
@@ -355,14 +517,14 @@ log_csv_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *pa
               if (cur_column && cur_column->next == NULL && self->flags & LOG_CSV_PARSER_GREEDY)
                 {
                   /* greedy mode, the last column gets it all, without taking escaping, quotes or anything into account */
-                  log_msg_set_value(msg, log_msg_get_value_handle((gchar *) cur_column->data), src, -1);
+                  log_csv_parser_store_value(msg, (gchar *) cur_column->data, &message, message_len, src, input_end - src);
                   cur_column = NULL;
                   src = NULL;
                   break;
                 }
             }
         }
-      g_string_free(current_value, TRUE);
+      sb_gstring_release(sb_current_value);
     }
   if ((cur_column || (src && *src)) && (self->flags & LOG_CSV_PARSER_DROP_INVALID))
     {
@@ -390,6 +552,7 @@ log_csv_parser_clone(LogPipe *s)
   cloned->quotes_end = g_strdup(self->quotes_end);
   cloned->null_value = self->null_value ? g_strdup(self->null_value) : NULL;
   cloned->flags = self->flags;
+  log_csv_parser_update_char_class(cloned);
 
   cloned->super.super.template = log_template_ref(self->super.super.template);
   for (l = self->super.columns; l; l = l->next)
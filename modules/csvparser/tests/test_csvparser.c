@@ -282,6 +282,20 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   testcase("random.vhost\t10.0.0.1\t-\t\"GET /index.html HTTP/1.1\"\t\t200", LP_NOPARSE, 7, LOG_CSV_PARSER_ESCAPE_BACKSLASH, "\t", "\"\"", "-",
            "random.vhost", "10.0.0.1", "", "GET /index.html HTTP/1.1", "", "200", "", NULL);
 
+  /* escaped characters in the middle of a column */
+  testcase("a,\"b\\\"x\",c", LP_NOPARSE, -1, LOG_CSV_PARSER_ESCAPE_BACKSLASH, ",", NULL, NULL,
+           "a", "b\"x", "c", NULL);
+  testcase("a,\"b\"\"x\",c", LP_NOPARSE, -1, LOG_CSV_PARSER_ESCAPE_DOUBLE_CHAR, ",", NULL, NULL,
+           "a", "b\"x", "c", NULL);
+  testcase("a;b,c d", LP_NOPARSE, -1, LOG_CSV_PARSER_ESCAPE_DOUBLE_CHAR, ",; ", NULL, NULL,
+           "a", "b", "c", "d", NULL);
+
+  /* columns longer than a vector register, with multiple delimiters */
+  testcase("firewall-rule-0000000000000001;accept-inbound-connection-from-trusted-zone,tcp 192.168.100.200", LP_NOPARSE, -1, LOG_CSV_PARSER_ESCAPE_NONE, ",; ", NULL, NULL,
+           "firewall-rule-0000000000000001", "accept-inbound-connection-from-trusted-zone", "tcp", "192.168.100.200", NULL);
+  testcase("firewall-rule-0000000000000001;accept-inbound-connection-from-trusted-zone,tcp 192.168.100.200", LP_NOPARSE, -1, LOG_CSV_PARSER_ESCAPE_BACKSLASH, ",;:| ", NULL, NULL,
+           "firewall-rule-0000000000000001", "accept-inbound-connection-from-trusted-zone", "tcp", "192.168.100.200", NULL);
+
 
   app_shutdown();
   return 0;
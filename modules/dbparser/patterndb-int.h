@@ -191,13 +191,41 @@ PDBRule *pdb_rule_set_lookup(PDBRuleSet *self, PDBInput *input, GArray *dbg_list
 PDBRuleSet *pdb_rule_set_new(void);
 void pdb_rule_set_free(PDBRuleSet *self);
 
-struct _PatternDB
+#define PDB_STATE_SHARDS 16
+
+/* a slice of the correllation state, entries are distributed among the
+ * shards by the hash of their PDBStateKey */
+typedef struct _PDBStateShard
 {
-  GStaticRWLock lock;
-  PDBRuleSet *ruleset;
+  GStaticMutex lock;
   GHashTable *state;
+  /* NULL for rate limit shards, those don't expire */
   TimerWheel *timer_wheel;
-  GTimeVal last_tick;
+} PDBStateShard;
+
+struct _PatternDB
+{
+  /* the ruleset is immutable once loaded, lookups run without locking
+   * and reloads replace it RCU style: lookups register themselves in
+   * ruleset_readers[ruleset_epoch] and the old ruleset is freed once the
+   * readers of both epochs have drained */
+  PDBRuleSet *ruleset;
+  gint ruleset_epoch;
+  gint ruleset_readers[2];
+  GStaticMutex ruleset_lock;
+
+  /* contexts are only accessed with the lock of their shard held.  Rate
+   * limits have their own shards, their lock may be taken while holding
+   * a context shard lock, but not the other way around. */
+  PDBStateShard context_shards[PDB_STATE_SHARDS];
+  PDBStateShard rate_limit_shards[PDB_STATE_SHARDS];
+
+  /* the current time of the correllation engine (UTC seconds) and the
+   * system time of its last update, both are 64 bit wide even on 32 bit
+   * platforms and are accessed atomically, the timer wheels of the shards
+   * catch up when the shard is locked */
+  guint64 now;
+  gint64 last_tick;
   PatternDBEmitFunc emit;
   gpointer emit_data;
 };
@@ -268,6 +268,105 @@ pdb_state_entry_free(gpointer s)
     pdb_rate_limit_free(&self->rate_limit);
 }
 
+/*********************************************************
+ * PDBStateShard, a lock protected slice of the state
+ *********************************************************/
+
+static void
+pdb_state_shard_init(PDBStateShard *self, gboolean with_timers)
+{
+  g_static_mutex_init(&self->lock);
+  self->state = g_hash_table_new_full(pdb_state_key_hash, pdb_state_key_equal, NULL, (GDestroyNotify) pdb_state_entry_free);
+  self->timer_wheel = with_timers ? timer_wheel_new() : NULL;
+}
+
+static void
+pdb_state_shard_destroy(PDBStateShard *self)
+{
+  /* the timer wheel holds references to the contexts, free it first */
+  if (self->timer_wheel)
+    timer_wheel_free(self->timer_wheel);
+  g_hash_table_destroy(self->state);
+  g_static_mutex_free(&self->lock);
+}
+
+static inline PDBStateShard *
+pdb_state_shards_lookup(PDBStateShard *shards, PDBStateKey *key)
+{
+  return &shards[pdb_state_key_hash(key) % PDB_STATE_SHARDS];
+}
+
+/*********************************************************
+ * PatternDB time keeping
+ *********************************************************/
+
+/* atomic reads, so that 64 bit values are not torn on 32 bit platforms */
+static inline guint64
+pattern_db_get_time(PatternDB *self)
+{
+  return __sync_fetch_and_add(&self->now, 0);
+}
+
+static inline gint64
+pattern_db_get_last_tick(PatternDB *self)
+{
+  return __sync_fetch_and_add(&self->last_tick, 0);
+}
+
+static inline void
+pattern_db_set_last_tick(PatternDB *self, gint64 last_tick)
+{
+  gint64 old_tick;
+
+  do
+    {
+      old_tick = pattern_db_get_last_tick(self);
+    }
+  while (!__sync_bool_compare_and_swap(&self->last_tick, old_tick, last_tick));
+}
+
+/* time is not allowed to go backwards, returns whether it was changed */
+static gboolean
+pattern_db_advance_time_to(PatternDB *self, guint64 new_now)
+{
+  guint64 old_now;
+
+  do
+    {
+      old_now = pattern_db_get_time(self);
+      if (old_now >= new_now)
+        return FALSE;
+    }
+  while (!__sync_bool_compare_and_swap(&self->now, old_now, new_now));
+  return TRUE;
+}
+
+/* locks a context shard and fires the timers that expired since the shard was last used */
+static PDBStateShard *
+pattern_db_lock_context_shard(PatternDB *self, PDBStateKey *key)
+{
+  PDBStateShard *shard = pdb_state_shards_lookup(self->context_shards, key);
+
+  g_static_mutex_lock(&shard->lock);
+  timer_wheel_set_time(shard->timer_wheel, pattern_db_get_time(self));
+  return shard;
+}
+
+static void
+pattern_db_expire_shards(PatternDB *self)
+{
+  gint i;
+
+  for (i = 0; i < PDB_STATE_SHARDS; i++)
+    {
+      PDBStateShard *shard = &self->context_shards[i];
+
+      g_static_mutex_lock(&shard->lock);
+      timer_wheel_set_time(shard->timer_wheel, pattern_db_get_time(self));
+      g_static_mutex_unlock(&shard->lock);
+    }
+}
+
 /*********************************************************
  * PDBMessage
  *********************************************************/
@@ -497,8 +596,10 @@ static inline gboolean
 pdb_rule_check_rate_limit(PDBRule *self, PatternDB *db, PDBAction *action, LogMessage *msg, GString *buffer)
 {
   PDBStateKey key;
+  PDBStateShard *shard;
   PDBRateLimit *rl;
   guint64 now;
+  gboolean result = FALSE;
 
   if (action->rate == 0)
     return TRUE;
@@ -506,14 +607,16 @@ pdb_rule_check_rate_limit(PDBRule *self, PatternDB *db, PDBAction *action, LogMe
   g_string_printf(buffer, "%s:%d", self->rule_id, action->id);
   pdb_state_key_setup(&key, PSK_RATE_LIMIT, self, msg, buffer->str);
 
-  rl = g_hash_table_lookup(db->state, &key);
+  shard = pdb_state_shards_lookup(db->rate_limit_shards, &key);
+  g_static_mutex_lock(&shard->lock);
+  rl = g_hash_table_lookup(shard->state, &key);
   if (!rl)
     {
       rl = pdb_rate_limit_new(&key);
-      g_hash_table_insert(db->state, &rl->key, rl);
+      g_hash_table_insert(shard->state, &rl->key, rl);
       g_string_steal(buffer);
     }
-  now = timer_wheel_get_time(db->timer_wheel);
+  now = pattern_db_get_time(db);
   if (rl->last_check == 0)
     {
       rl->last_check = now;
@@ -537,9 +640,10 @@ pdb_rule_check_rate_limit(PDBRule *self, PatternDB *db, PDBAction *action, LogMe
   if (rl->buckets)
     {
       rl->buckets--;
-      return TRUE;
+      result = TRUE;
     }
-  return FALSE;
+  g_static_mutex_unlock(&shard->lock);
+  return result;
 }
 
 void
@@ -1452,15 +1556,17 @@ pattern_db_expire_entry(guint64 now, gpointer user_data)
 {
   PDBContext *context = user_data;
   PatternDB *pdb = context->db;
+  PDBStateShard *shard = pdb_state_shards_lookup(pdb->context_shards, &context->key);
   GString *buffer = g_string_sized_new(256);
 
+  /* NOTE: runs from the timer wheel of the shard, with its lock held */
   msg_debug("Expiring patterndb correllation context",
             evt_tag_str("last_rule", context->rule->rule_id),
-            evt_tag_long("utc", timer_wheel_get_time(context->db->timer_wheel)),
+            evt_tag_long("utc", timer_wheel_get_time(shard->timer_wheel)),
             NULL);
   if (pdb->emit)
     pdb_rule_run_actions(context->rule, RAT_TIMEOUT, context->db, context, g_ptr_array_index(context->messages, context->messages->len - 1), pdb->emit, pdb->emit_data, buffer);
-  g_hash_table_remove(context->db->state, &context->key);
+  g_hash_table_remove(shard->state, &context->key);
   g_string_free(buffer, TRUE);
 
   /* pdb_context_free is automatically called when returning from
@@ -1480,38 +1586,35 @@ void
 pattern_db_timer_tick(PatternDB *self)
 {
   GTimeVal now;
-  glong diff;
+  gint64 last_tick;
 
-  g_static_rw_lock_writer_lock(&self->lock);
   cached_g_current_time(&now);
-  diff = g_time_val_diff(&now, &self->last_tick);
+  last_tick = pattern_db_get_last_tick(self);
 
-  if (diff > 1e6)
+  if (now.tv_sec > last_tick)
     {
-      glong diff_sec = diff / 1e6;
-
-      timer_wheel_set_time(self->timer_wheel, timer_wheel_get_time(self->timer_wheel) + diff_sec);
+      pattern_db_advance_time_to(self, pattern_db_get_time(self) + (now.tv_sec - last_tick));
       msg_debug("Advancing patterndb current time because of timer tick",
-                evt_tag_long("utc", timer_wheel_get_time(self->timer_wheel)),
+                evt_tag_long("utc", pattern_db_get_time(self)),
                 NULL);
-      /* update last_tick, take the fraction of the seconds not calculated into this update into account */
-
-      self->last_tick = now;
-      g_time_val_add(&self->last_tick, -(diff - diff_sec * 1e6));
-    }
-  else if (diff < 0)
-    {
-      /* time moving backwards, this can only happen if the computer's time
-       * is changed.  We don't update patterndb's idea of the time now, wait
-       * another tick instead to update that instead.
-       */
-      self->last_tick = now;
     }
-  g_static_rw_lock_writer_unlock(&self->lock);
+  /* if time moved backwards, this can only happen if the computer's time
+   * is changed.  We don't update patterndb's idea of the time now, wait
+   * another tick instead to update that instead. */
+  pattern_db_set_last_tick(self, now.tv_sec);
+  pattern_db_expire_shards(self);
 }
 
-/* NOTE: lock should be acquired for writing before calling this function. */
+/* moves the correllation time forward by @timeout seconds, firing the
+ * timers that expire in the meanwhile */
 void
+pattern_db_advance_time(PatternDB *self, gint timeout)
+{
+  pattern_db_advance_time_to(self, pattern_db_get_time(self) + timeout);
+  pattern_db_expire_shards(self);
+}
+
+static void
 pattern_db_set_time(PatternDB *self, const LogStamp *ls)
 {
   GTimeVal now;
@@ -1522,21 +1625,54 @@ pattern_db_set_time(PatternDB *self, const LogStamp *ls)
    * correllation engine too much. */
 
   cached_g_current_time(&now);
-  self->last_tick = now;
+  if (pattern_db_get_last_tick(self) != now.tv_sec)
+    pattern_db_set_last_tick(self, now.tv_sec);
 
   if (ls->tv_sec < now.tv_sec)
     now.tv_sec = ls->tv_sec;
 
-  timer_wheel_set_time(self->timer_wheel, now.tv_sec);
-  msg_debug("Advancing patterndb current time because of an incoming message",
-            evt_tag_long("utc", timer_wheel_get_time(self->timer_wheel)),
-            NULL);
+  if (pattern_db_advance_time_to(self, now.tv_sec))
+    msg_debug("Advancing patterndb current time because of an incoming message",
+              evt_tag_long("utc", now.tv_sec),
+              NULL);
+}
+
+static PDBRuleSet *
+pattern_db_acquire_ruleset(PatternDB *self, gint *epoch)
+{
+  *epoch = g_atomic_int_get(&self->ruleset_epoch);
+  g_atomic_int_inc(&self->ruleset_readers[*epoch]);
+  return g_atomic_pointer_get(&self->ruleset);
+}
+
+static void
+pattern_db_release_ruleset(PatternDB *self, gint epoch)
+{
+  g_atomic_int_add(&self->ruleset_readers[epoch], -1);
+}
+
+/* waits until all lookups that could have seen the previous ruleset are
+ * finished.  A reader may have sampled the epoch just before a flip, thus
+ * the epoch is flipped twice, draining the readers of both. */
+static void
+pattern_db_synchronize_ruleset(PatternDB *self)
+{
+  gint i;
+
+  for (i = 0; i < 2; i++)
+    {
+      gint epoch = g_atomic_int_get(&self->ruleset_epoch);
+
+      g_atomic_int_compare_and_exchange(&self->ruleset_epoch, epoch, !epoch);
+      while (g_atomic_int_get(&self->ruleset_readers[epoch]) != 0)
+        g_usleep(100);
+    }
 }
 
 gboolean
 pattern_db_reload_ruleset(PatternDB *self, GlobalConfig *cfg, const gchar *pdb_file)
 {
-  PDBRuleSet *new_ruleset;
+  PDBRuleSet *new_ruleset, *old_ruleset;
 
   new_ruleset = pdb_rule_set_new();
   if (!pdb_rule_set_load(new_ruleset, cfg, pdb_file, NULL))
@@ -1546,11 +1682,13 @@ pattern_db_reload_ruleset(PatternDB *self, GlobalConfig *cfg, const gchar *pdb_f
     }
   else
     {
-      g_static_rw_lock_writer_lock(&self->lock);
-      if (self->ruleset)
-        pdb_rule_set_free(self->ruleset);
-      self->ruleset = new_ruleset;
-      g_static_rw_lock_writer_unlock(&self->lock);
+      g_static_mutex_lock(&self->ruleset_lock);
+      old_ruleset = self->ruleset;
+      g_atomic_pointer_set(&self->ruleset, new_ruleset);
+      pattern_db_synchronize_ruleset(self);
+      if (old_ruleset)
+        pdb_rule_set_free(old_ruleset);
+      g_static_mutex_unlock(&self->ruleset_lock);
       return TRUE;
     }
 }
@@ -1558,23 +1696,39 @@ pattern_db_reload_ruleset(PatternDB *self, GlobalConfig *cfg, const gchar *pdb_f
 void
 pattern_db_expire_state(PatternDB *self)
 {
-  g_static_rw_lock_writer_lock(&self->lock);
-  timer_wheel_expire_all(self->timer_wheel);
-  g_static_rw_lock_writer_unlock(&self->lock);
+  gint i;
+
+  for (i = 0; i < PDB_STATE_SHARDS; i++)
+    {
+      PDBStateShard *shard = &self->context_shards[i];
+
+      g_static_mutex_lock(&shard->lock);
+      timer_wheel_expire_all(shard->timer_wheel);
+      g_static_mutex_unlock(&shard->lock);
+    }
 }
 
 void
 pattern_db_forget_state(PatternDB *self)
 {
-  g_static_rw_lock_writer_lock(&self->lock);
-  if (self->timer_wheel)
-    timer_wheel_free(self->timer_wheel);
+  gint i;
 
-  if (self->state)
-    g_hash_table_destroy(self->state);
-  self->state = g_hash_table_new_full(pdb_state_key_hash, pdb_state_key_equal, NULL, (GDestroyNotify) pdb_state_entry_free);
-  self->timer_wheel = timer_wheel_new();
-  g_static_rw_lock_writer_unlock(&self->lock);
+  for (i = 0; i < PDB_STATE_SHARDS; i++)
+    {
+      PDBStateShard *shard = &self->context_shards[i];
+
+      g_static_mutex_lock(&shard->lock);
+      timer_wheel_free(shard->timer_wheel);
+      g_hash_table_destroy(shard->state);
+      shard->state = g_hash_table_new_full(pdb_state_key_hash, pdb_state_key_equal, NULL, (GDestroyNotify) pdb_state_entry_free);
+      shard->timer_wheel = timer_wheel_new();
+      g_static_mutex_unlock(&shard->lock);
+
+      shard = &self->rate_limit_shards[i];
+      g_static_mutex_lock(&shard->lock);
+      g_hash_table_remove_all(shard->state);
+      g_static_mutex_unlock(&shard->lock);
+    }
 }
 
 void
@@ -1599,22 +1753,29 @@ pattern_db_get_ruleset_version(PatternDB *self)
 gboolean
 pattern_db_process(PatternDB *self, PDBInput *input)
 {
+  PDBRuleSet *ruleset;
   PDBRule *rule;
   LogMessage *msg = input->msg;
+  gint epoch;
 
-  if (G_UNLIKELY(!self->ruleset))
-    return FALSE;
+  ruleset = pattern_db_acquire_ruleset(self, &epoch);
+  if (G_UNLIKELY(!ruleset))
+    {
+      pattern_db_release_ruleset(self, epoch);
+      return FALSE;
+    }
+
+  /* the rule returned is referenced, it remains valid after a reload */
+  rule = pdb_rule_set_lookup(ruleset, input, NULL);
+  pattern_db_release_ruleset(self, epoch);
 
-  g_static_rw_lock_reader_lock(&self->lock);
-  rule = pdb_rule_set_lookup(self->ruleset, input, NULL);
-  g_static_rw_lock_reader_unlock(&self->lock);
+  pattern_db_set_time(self, &msg->timestamps[LM_TS_STAMP]);
   if (rule)
     {
       PDBContext *context = NULL;
+      PDBStateShard *shard = NULL;
       GString *buffer = g_string_sized_new(32);
 
-      g_static_rw_lock_writer_lock(&self->lock);
-      pattern_db_set_time(self, &msg->timestamps[LM_TS_STAMP]);
       if (rule->context_id_template)
         {
           PDBStateKey key;
@@ -1623,17 +1784,18 @@ pattern_db_process(PatternDB *self, PDBInput *input)
           log_msg_set_value(msg, context_id_handle, buffer->str, -1);
 
           pdb_state_key_setup(&key, PSK_CONTEXT, rule, msg, buffer->str);
-          context = g_hash_table_lookup(self->state, &key);
+          shard = pattern_db_lock_context_shard(self, &key);
+          context = g_hash_table_lookup(shard->state, &key);
           if (!context)
             {
               msg_debug("Correllation context lookup failure, starting a new context",
                         evt_tag_str("rule", rule->rule_id),
                         evt_tag_str("context", buffer->str),
                         evt_tag_int("context_timeout", rule->context_timeout),
-                        evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context_timeout),
+                        evt_tag_int("context_expiration", timer_wheel_get_time(shard->timer_wheel) + rule->context_timeout),
                         NULL);
               context = pdb_context_new(self, &key);
-              g_hash_table_insert(self->state, &context->key, context);
+              g_hash_table_insert(shard->state, &context->key, context);
               g_string_steal(buffer);
             }
           else
@@ -1642,7 +1804,7 @@ pattern_db_process(PatternDB *self, PDBInput *input)
                         evt_tag_str("rule", rule->rule_id),
                         evt_tag_str("context", buffer->str),
                         evt_tag_int("context_timeout", rule->context_timeout),
-                        evt_tag_int("context_expiration", timer_wheel_get_time(self->timer_wheel) + rule->context_timeout),
+                        evt_tag_int("context_expiration", timer_wheel_get_time(shard->timer_wheel) + rule->context_timeout),
                         evt_tag_int("num_messages", context->messages->len),
                         NULL);
             }
@@ -1651,11 +1813,11 @@ pattern_db_process(PatternDB *self, PDBInput *input)
 
           if (context->timer)
             {
-              timer_wheel_mod_timer(self->timer_wheel, context->timer, rule->context_timeout);
+              timer_wheel_mod_timer(shard->timer_wheel, context->timer, rule->context_timeout);
             }
           else
             {
-              context->timer = timer_wheel_add_timer(self->timer_wheel, rule->context_timeout, pattern_db_expire_entry, pdb_context_ref(context), (GDestroyNotify) pdb_context_unref);
+              context->timer = timer_wheel_add_timer(shard->timer_wheel, rule->context_timeout, pattern_db_expire_entry, pdb_context_ref(context), (GDestroyNotify) pdb_context_unref);
             }
           if (context->rule != rule)
             {
@@ -1664,19 +1826,17 @@ pattern_db_process(PatternDB *self, PDBInput *input)
               context->rule = pdb_rule_ref(rule);
             }
         }
-      else
-        {
-          context = NULL;
-        }
 
+      /* the context (if any) is only accessed with its shard locked */
       pdb_message_apply(&rule->msg, context, msg, buffer);
       if (self->emit)
         {
           self->emit(msg, FALSE, self->emit_data);
           pdb_rule_run_actions(rule, RAT_MATCH, self, context, msg, self->emit, self->emit_data, buffer);
         }
+      if (shard)
+        g_static_mutex_unlock(&shard->lock);
       pdb_rule_unref(rule);
-      g_static_rw_lock_writer_unlock(&self->lock);
 
       if (context)
         log_msg_write_protect(msg);
@@ -1685,9 +1845,6 @@ pattern_db_process(PatternDB *self, PDBInput *input)
     }
   else
     {
-      g_static_rw_lock_writer_lock(&self->lock);
-      pattern_db_set_time(self, &msg->timestamps[LM_TS_STAMP]);
-      g_static_rw_lock_writer_unlock(&self->lock);
       if (self->emit)
         self->emit(msg, FALSE, self->emit_data);
     }
@@ -1699,25 +1856,35 @@ PatternDB *
 pattern_db_new(void)
 {
   PatternDB *self = g_new0(PatternDB, 1);
+  GTimeVal now;
+  gint i;
 
   self->ruleset = pdb_rule_set_new();
-  self->state = g_hash_table_new_full(pdb_state_key_hash, pdb_state_key_equal, NULL, (GDestroyNotify) pdb_state_entry_free);
-  self->timer_wheel = timer_wheel_new();
-  cached_g_current_time(&self->last_tick);
-  g_static_rw_lock_init(&self->lock);
+  g_static_mutex_init(&self->ruleset_lock);
+  for (i = 0; i < PDB_STATE_SHARDS; i++)
+    {
+      pdb_state_shard_init(&self->context_shards[i], TRUE);
+      pdb_state_shard_init(&self->rate_limit_shards[i], FALSE);
+    }
+  cached_g_current_time(&now);
+  self->last_tick = now.tv_sec;
   return self;
 }
 
 void
 pattern_db_free(PatternDB *self)
 {
+  gint i;
+
   if (self->ruleset)
     pdb_rule_set_free(self->ruleset);
 
-  if (self->state)
-    g_hash_table_destroy(self->state);
-  if (self->timer_wheel)
-    timer_wheel_free(self->timer_wheel);
+  for (i = 0; i < PDB_STATE_SHARDS; i++)
+    {
+      pdb_state_shard_destroy(&self->context_shards[i]);
+      pdb_state_shard_destroy(&self->rate_limit_shards[i]);
+    }
+  g_static_mutex_free(&self->ruleset_lock);
   g_free(self);
 }
 
@@ -59,6 +59,7 @@ const gchar *pattern_db_get_ruleset_pub_date(PatternDB *self);
 gboolean pattern_db_reload_ruleset(PatternDB *self, GlobalConfig *cfg, const gchar *pdb_file);
 
 void pattern_db_timer_tick(PatternDB *self);
+void pattern_db_advance_time(PatternDB *self, gint timeout);
 gboolean pattern_db_process(PatternDB *self, PDBInput *input);
 void pattern_db_expire_state(PatternDB *self);
 void pattern_db_forget_state(PatternDB *self);
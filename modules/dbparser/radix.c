@@ -22,12 +22,11 @@
  */
 
 #include "radix.h"
+#include "logmatcher-pcre.h"
 
 #include <string.h>
 #include <stdlib.h>
 
-#include <pcre.h>
-
 /**************************************************************
  * Parsing nodes.
  **************************************************************/
@@ -150,7 +149,7 @@ r_parser_pcre_compile_state(const gchar *expr)
       g_free(self);
       return NULL;
     }
-  self->extra = pcre_study(self->re, 0, &errptr);
+  self->extra = log_matcher_pcre_study(self->re, log_matcher_pcre_is_jit_enabled(), &errptr);
   if (errptr)
     {
       msg_error("Error while optimizing regular expression",
@@ -158,8 +157,7 @@ r_parser_pcre_compile_state(const gchar *expr)
                 evt_tag_str("error_message", errptr),
                 NULL);
       pcre_free(self->re);
-      if (self->extra)
-        pcre_free(self->extra);
+      log_matcher_pcre_free_study(self->extra);
       g_free(self);
       return NULL;
     }
@@ -173,8 +171,7 @@ r_parser_pcre_free_state(gpointer s)
 
   if (self->re)
     pcre_free(self->re);
-  if (self->extra)
-    pcre_free(self->extra);
+  log_matcher_pcre_free_study(self->extra);
   g_free(self);
 }
 
@@ -218,7 +218,7 @@ test_rule_action_message_value(const gchar *pattern, gint timeout, gint ndx, con
 
   result = pattern_db_process(patterndb, PDB_INPUT_WRAP_MESSAGE(&input, msg));
   if (timeout)
-    timer_wheel_set_time(patterndb->timer_wheel, timer_wheel_get_time(patterndb->timer_wheel) + timeout + 1);
+    pattern_db_advance_time(patterndb, timeout + 1);
 
   if (ndx >= messages->len)
     {
@@ -253,7 +253,7 @@ test_rule_action_message_tag(const gchar *pattern, gint timeout, gint ndx, const
 
   result = pattern_db_process(patterndb, PDB_INPUT_WRAP_MESSAGE(&input, msg));
   if (timeout)
-    timer_wheel_set_time(patterndb->timer_wheel, timer_wheel_get_time(patterndb->timer_wheel) + timeout + 5);
+    pattern_db_advance_time(patterndb, timeout + 5);
   if (ndx >= messages->len)
     {
       test_fail("Expected the %d. message, but no such message was returned by patterndb\n", ndx);
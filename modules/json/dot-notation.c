@@ -22,32 +22,10 @@
 #include "dot-notation.h"
 #include <stdlib.h>
 
-typedef struct _JSONDotNotationElem
-{
-  gboolean used;
-  
-  enum 
-  {
-    JS_MEMBER_REF,
-    JS_ARRAY_REF
-  } type;
-  union
-  {
-    struct
-    {
-      gchar *name;
-    } member_ref;
-    struct
-    {
-      gint index;
-    } array_ref;
-  };
-} JSONDotNotationElem;
-
-typedef struct JSONDotNotation
+struct JSONDotNotation
 {
   JSONDotNotationElem *compiled_elems;
-} JSONDotNotation;
+};
 
 static void _free_compiled_dot_notation(JSONDotNotationElem *compiled);
 
@@ -190,7 +168,7 @@ _free_compiled_dot_notation(JSONDotNotationElem *compiled)
   g_free(compiled);
 }
 
-static gboolean
+gboolean
 json_dot_notation_compile(JSONDotNotation *self, const gchar *dot_notation)
 {
   if (dot_notation[0] == 0)
@@ -202,6 +180,13 @@ json_dot_notation_compile(JSONDotNotation *self, const gchar *dot_notation)
   return self->compiled_elems != NULL;
 }
 
+/* returns NULL if the expression is empty, the array is terminated by an unused element */
+const JSONDotNotationElem *
+json_dot_notation_get_elems(JSONDotNotation *self)
+{
+  return self->compiled_elems;
+}
+
 struct json_object *
 json_dot_notation_eval(JSONDotNotation *self, struct json_object *jso)
 {
@@ -26,6 +26,36 @@
 
 #include <json.h>
 
+typedef struct _JSONDotNotationElem
+{
+  gboolean used;
+  
+  enum 
+  {
+    JS_MEMBER_REF,
+    JS_ARRAY_REF
+  } type;
+  union
+  {
+    struct
+    {
+      gchar *name;
+    } member_ref;
+    struct
+    {
+      gint index;
+    } array_ref;
+  };
+} JSONDotNotationElem;
+
+typedef struct JSONDotNotation JSONDotNotation;
+
+JSONDotNotation *json_dot_notation_new(void);
+gboolean json_dot_notation_compile(JSONDotNotation *self, const gchar *dot_notation);
+const JSONDotNotationElem *json_dot_notation_get_elems(JSONDotNotation *self);
+struct json_object *json_dot_notation_eval(JSONDotNotation *self, struct json_object *jso);
+void json_dot_notation_free(JSONDotNotation *self);
+
 struct json_object *
 json_extract(struct json_object *jso, const gchar *subscript);
 
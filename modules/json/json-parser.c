@@ -22,6 +22,7 @@
 
 #include "json-parser.h"
 #include "dot-notation.h"
+#include "json-scanner.h"
 #include "scratch-buffers.h"
 
 #include <string.h>
@@ -37,6 +38,7 @@ typedef struct _JSONParser
   gchar *marker;
   gint marker_len;
   gchar *extract_prefix;
+  JSONDotNotation *extract;
 } JSONParser;
 
 void
@@ -65,6 +67,20 @@ json_parser_set_extract_prefix(LogParser *s, const gchar *extract_prefix)
   
   g_free(self->extract_prefix);
   self->extract_prefix = g_strdup(extract_prefix);
+
+  if (self->extract)
+    json_dot_notation_free(self->extract);
+  self->extract = NULL;
+  if (extract_prefix)
+    {
+      self->extract = json_dot_notation_new();
+      /* invalid expressions are left to json-c, which reports them */
+      if (!json_dot_notation_compile(self->extract, extract_prefix))
+        {
+          json_dot_notation_free(self->extract);
+          self->extract = NULL;
+        }
+    }
 }
 
 static void
@@ -195,22 +211,11 @@ json_parser_extract(JSONParser *self, struct json_object *jso, LogMessage *msg)
 }
 
 static gboolean
-json_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
+json_parser_process_json_c(JSONParser *self, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
 {
-  JSONParser *self = (JSONParser *) s;
   struct json_object *jso;
   struct json_tokener *tok;
 
-  if (self->marker)
-    {
-      if (strncmp(input, self->marker, self->marker_len) != 0)
-        return FALSE;
-      input += self->marker_len;
-
-      while (isspace(*input))
-        input++;
-    }
-
   tok = json_tokener_new();
   jso = json_tokener_parse_ex(tok, input, input_len);
   if (tok->err != json_tokener_success || !jso)
@@ -238,6 +243,109 @@ json_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_
   return TRUE;
 }
 
+typedef struct _JSONParserScanState
+{
+  LogMessage *msg;
+  /* the value of $MESSAGE if the input is a part of it, NULL otherwise */
+  const gchar *message;
+  /* a new $MESSAGE, set only once the input is no longer needed */
+  GString *deferred_message;
+  gboolean message_deferred;
+} JSONParserScanState;
+
+static void
+json_parser_store_value(const gchar *name, const gchar *value, gsize value_len, gboolean verbatim, gpointer user_data)
+{
+  JSONParserScanState *state = (JSONParserScanState *) user_data;
+  NVHandle handle = log_msg_get_value_handle(name);
+  gsize ofs;
+
+  if (state->message)
+    {
+      ofs = value - state->message;
+      if (verbatim && log_msg_is_handle_settable_with_an_indirect_value(handle) &&
+          ofs + value_len <= G_MAXUINT16)
+        {
+          log_msg_set_value_indirect(state->msg, handle, LM_V_MESSAGE, 0, ofs, value_len);
+          return;
+        }
+      if (handle == LM_V_MESSAGE)
+        {
+          g_string_truncate(state->deferred_message, 0);
+          g_string_append_len(state->deferred_message, value, value_len);
+          state->message_deferred = TRUE;
+          return;
+        }
+    }
+  log_msg_set_value(state->msg, handle, value, value_len);
+}
+
+/*
+ * Parses the input without building a json-c object tree.  Values are
+ * referenced from $MESSAGE instead of being copied whenever possible.
+ * Returns FALSE if the input has to be parsed by json-c instead.
+ */
+static gboolean
+json_parser_process_scan(JSONParser *self, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
+{
+  JSONParserScanState state;
+  SBGString *name, *value, *deferred_message;
+  const gchar *message;
+  gssize message_len;
+  gboolean success;
+
+  if (self->extract_prefix && !self->extract)
+    return FALSE;
+
+  log_msg_make_writable(pmsg, path_options);
+
+  memset(&state, 0, sizeof(state));
+  state.msg = *pmsg;
+  message = log_msg_get_value(*pmsg, LM_V_MESSAGE, &message_len);
+  if (input >= message && input + input_len <= message + message_len)
+    state.message = message;
+
+  name = sb_gstring_acquire();
+  value = sb_gstring_acquire();
+  deferred_message = sb_gstring_acquire();
+  state.deferred_message = sb_gstring_string(deferred_message);
+
+  success = json_scanner_scan(input, input_len, self->prefix, self->extract,
+                              sb_gstring_string(name), sb_gstring_string(value),
+                              json_parser_store_value, &state);
+  if (success && state.message_deferred)
+    log_msg_set_value(*pmsg, LM_V_MESSAGE, state.deferred_message->str, state.deferred_message->len);
+
+  sb_gstring_release(name);
+  sb_gstring_release(value);
+  sb_gstring_release(deferred_message);
+  return success;
+}
+
+static gboolean
+json_parser_process(LogParser *s, LogMessage **pmsg, const LogPathOptions *path_options, const gchar *input, gsize input_len)
+{
+  JSONParser *self = (JSONParser *) s;
+
+  if (self->marker)
+    {
+      if (input_len < self->marker_len || strncmp(input, self->marker, self->marker_len) != 0)
+        return FALSE;
+      input += self->marker_len;
+      input_len -= self->marker_len;
+
+      while (input_len > 0 && isspace(*input))
+        {
+          input++;
+          input_len--;
+        }
+    }
+
+  if (json_parser_process_scan(self, pmsg, path_options, input, input_len))
+    return TRUE;
+  return json_parser_process_json_c(self, pmsg, path_options, input, input_len);
+}
+
 static LogPipe *
 json_parser_clone(LogPipe *s)
 {
@@ -260,6 +368,8 @@ json_parser_free(LogPipe *s)
   g_free(self->prefix);
   g_free(self->marker);
   g_free(self->extract_prefix);
+  if (self->extract)
+    json_dot_notation_free(self->extract);
   log_parser_free_method(s);
 }
 
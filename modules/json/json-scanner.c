@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2002-2010 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2010 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#include "json-scanner.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+/* json-c refuses deeper nesting, these inputs are left to it */
+#define JSON_SCANNER_MAX_DEPTH 32
+
+typedef struct _JSONScanner
+{
+  const gchar *pos;
+  const gchar *end;
+  gint depth;
+  /* the name of the current value, prefix included */
+  GString *name;
+  /* unescaped strings and formatted numbers */
+  GString *value;
+  /* if FALSE, the input is only validated */
+  gboolean emit;
+  JSONScannerValueFunc value_func;
+  gpointer user_data;
+} JSONScanner;
+
+typedef enum
+{
+  JSON_SCANNER_ITEM,
+  JSON_SCANNER_END,
+  JSON_SCANNER_ERROR,
+} JSONScannerStep;
+
+static gboolean json_scanner_process_value(JSONScanner *self);
+
+static inline void
+json_scanner_skip_whitespace(JSONScanner *self)
+{
+  while (self->pos < self->end && isspace((guchar) *self->pos))
+    self->pos++;
+}
+
+static gint
+json_scanner_parse_hex4(const gchar *p)
+{
+  gint i, digit, value = 0;
+
+  for (i = 0; i < 4; i++)
+    {
+      digit = g_ascii_xdigit_value(p[i]);
+      if (digit < 0)
+        return -1;
+      value = (value << 4) | digit;
+    }
+  return value;
+}
+
+static gboolean
+json_scanner_unescape_string(JSONScanner *self, const gchar *p, gchar quote)
+{
+  const gchar *run;
+  gint c;
+
+  while (p < self->end && *p != quote)
+    {
+      if (*p != '\\')
+        {
+          run = p;
+          while (p < self->end && *p != quote && *p != '\\' && *p != '\0')
+            p++;
+          if (p < self->end && *p == '\0')
+            return FALSE;
+          g_string_append_len(self->value, run, p - run);
+          continue;
+        }
+
+      p++;
+      if (p >= self->end)
+        return FALSE;
+      switch (*p)
+        {
+        case '"':
+        case '\\':
+        case '/':
+          g_string_append_c(self->value, *p);
+          break;
+        case 'b':
+          g_string_append_c(self->value, '\b');
+          break;
+        case 'f':
+          g_string_append_c(self->value, '\f');
+          break;
+        case 'n':
+          g_string_append_c(self->value, '\n');
+          break;
+        case 'r':
+          g_string_append_c(self->value, '\r');
+          break;
+        case 't':
+          g_string_append_c(self->value, '\t');
+          break;
+        case 'u':
+          if (self->end - p < 5)
+            return FALSE;
+          c = json_scanner_parse_hex4(p + 1);
+          /* NUL characters and surrogate pairs are left to json-c */
+          if (c <= 0 || (c >= 0xD800 && c <= 0xDFFF))
+            return FALSE;
+          g_string_append_unichar(self->value, c);
+          p += 4;
+          break;
+        default:
+          return FALSE;
+        }
+      p++;
+    }
+  if (p >= self->end)
+    return FALSE;
+  self->pos = p + 1;
+  return TRUE;
+}
+
+/* strings without escapes are returned as a pointer into the input */
+static gboolean
+json_scanner_scan_string(JSONScanner *self, const gchar **value, gsize *value_len, gboolean *verbatim)
+{
+  gchar quote = *self->pos;
+  const gchar *start = self->pos + 1;
+  const gchar *p = start;
+
+  while (p < self->end && *p != quote && *p != '\\' && *p != '\0')
+    p++;
+  if (p >= self->end || *p == '\0')
+    return FALSE;
+
+  if (*p == quote)
+    {
+      *value = start;
+      *value_len = p - start;
+      *verbatim = TRUE;
+      self->pos = p + 1;
+      return TRUE;
+    }
+
+  g_string_truncate(self->value, 0);
+  g_string_append_len(self->value, start, p - start);
+  if (!json_scanner_unescape_string(self, p, quote))
+    return FALSE;
+
+  *value = self->value->str;
+  *value_len = self->value->len;
+  *verbatim = FALSE;
+  return TRUE;
+}
+
+static inline const gchar *
+json_scanner_skip_digits(JSONScanner *self, const gchar *p)
+{
+  while (p < self->end && g_ascii_isdigit(*p))
+    p++;
+  return p;
+}
+
+/*
+ * Numbers are formatted the way json-parser() has always done it:
+ * integers using "%i", others using "%f".  Integers that don't fit into
+ * 32 bits are left to json-c, as their conversion depends on its version.
+ */
+static gboolean
+json_scanner_scan_number(JSONScanner *self, const gchar **value, gsize *value_len, gboolean *verbatim)
+{
+  const gchar *start = self->pos;
+  const gchar *p = start;
+  gboolean negative = FALSE, is_double = FALSE;
+  gchar buf[64];
+  gint64 number;
+
+  if (*p == '-')
+    {
+      negative = TRUE;
+      p++;
+    }
+  if (p >= self->end || !g_ascii_isdigit(*p))
+    return FALSE;
+  p = (*p == '0') ? p + 1 : json_scanner_skip_digits(self, p);
+
+  if (p < self->end && *p == '.')
+    {
+      is_double = TRUE;
+      p++;
+      if (p >= self->end || !g_ascii_isdigit(*p))
+        return FALSE;
+      p = json_scanner_skip_digits(self, p);
+    }
+  if (p < self->end && (*p == 'e' || *p == 'E'))
+    {
+      is_double = TRUE;
+      p++;
+      if (p < self->end && (*p == '+' || *p == '-'))
+        p++;
+      if (p >= self->end || !g_ascii_isdigit(*p))
+        return FALSE;
+      p = json_scanner_skip_digits(self, p);
+    }
+  /* e.g. leading zeroes */
+  if (p < self->end && (g_ascii_isdigit(*p) || (*p && strchr(".eE+-", *p))))
+    return FALSE;
+
+  self->pos = p;
+  if (is_double)
+    {
+      if (p - start >= sizeof(buf))
+        return FALSE;
+      memcpy(buf, start, p - start);
+      buf[p - start] = 0;
+      g_string_printf(self->value, "%f", strtod(buf, NULL));
+      *value = self->value->str;
+      *value_len = self->value->len;
+      *verbatim = FALSE;
+      return TRUE;
+    }
+
+  if (p - start - negative > 10)
+    return FALSE;
+  for (number = 0, p = start + negative; p < self->pos; p++)
+    number = number * 10 + (*p - '0');
+  if (negative)
+    number = -number;
+  if (number < G_MININT32 || number > G_MAXINT32)
+    return FALSE;
+
+  if (number == 0 && negative)
+    {
+      g_string_assign(self->value, "0");
+      *value = self->value->str;
+      *value_len = self->value->len;
+      *verbatim = FALSE;
+      return TRUE;
+    }
+
+  /* in strict JSON, the text of integers is the same as "%i" would produce */
+  *value = start;
+  *value_len = self->pos - start;
+  *verbatim = TRUE;
+  return TRUE;
+}
+
+static gboolean
+json_scanner_scan_literal(JSONScanner *self, const gchar *literal, gsize literal_len)
+{
+  if (self->end - self->pos < literal_len || memcmp(self->pos, literal, literal_len) != 0)
+    return FALSE;
+  self->pos += literal_len;
+  return TRUE;
+}
+
+static gboolean
+json_scanner_enter(JSONScanner *self)
+{
+  if (++self->depth > JSON_SCANNER_MAX_DEPTH)
+    return FALSE;
+  self->pos++;
+  return TRUE;
+}
+
+/* moves to the next member of an object and returns its key */
+static JSONScannerStep
+json_scanner_next_member(JSONScanner *self, gint index, const gchar **key, gsize *key_len)
+{
+  gboolean verbatim;
+
+  json_scanner_skip_whitespace(self);
+  if (self->pos >= self->end)
+    return JSON_SCANNER_ERROR;
+  if (*self->pos == '}')
+    {
+      self->pos++;
+      self->depth--;
+      return JSON_SCANNER_END;
+    }
+  if (index > 0)
+    {
+      if (*self->pos != ',')
+        return JSON_SCANNER_ERROR;
+      self->pos++;
+      json_scanner_skip_whitespace(self);
+      if (self->pos >= self->end)
+        return JSON_SCANNER_ERROR;
+    }
+
+  if ((*self->pos != '"' && *self->pos != '\'') ||
+      !json_scanner_scan_string(self, key, key_len, &verbatim))
+    return JSON_SCANNER_ERROR;
+
+  json_scanner_skip_whitespace(self);
+  if (self->pos >= self->end || *self->pos != ':')
+    return JSON_SCANNER_ERROR;
+  self->pos++;
+  return JSON_SCANNER_ITEM;
+}
+
+/* moves to the next element of an array */
+static JSONScannerStep
+json_scanner_next_element(JSONScanner *self, gint index)
+{
+  json_scanner_skip_whitespace(self);
+  if (self->pos >= self->end)
+    return JSON_SCANNER_ERROR;
+  if (*self->pos == ']')
+    {
+      self->pos++;
+      self->depth--;
+      return JSON_SCANNER_END;
+    }
+  if (index > 0)
+    {
+      if (*self->pos != ',')
+        return JSON_SCANNER_ERROR;
+      self->pos++;
+    }
+  return JSON_SCANNER_ITEM;
+}
+
+/* members are named "<name>.<key>", those of the top-level object "<prefix><key>" */
+static gboolean
+json_scanner_process_object(JSONScanner *self, gboolean top_level)
+{
+  gsize name_len = self->name->len;
+  JSONScannerStep step;
+  const gchar *key;
+  gsize key_len;
+  gint index;
+
+  if (!json_scanner_enter(self))
+    return FALSE;
+
+  for (index = 0; (step = json_scanner_next_member(self, index, &key, &key_len)) == JSON_SCANNER_ITEM; index++)
+    {
+      if (self->emit)
+        {
+          g_string_truncate(self->name, name_len);
+          if (!top_level)
+            g_string_append_c(self->name, '.');
+          g_string_append_len(self->name, key, key_len);
+        }
+      if (!json_scanner_process_value(self))
+        return FALSE;
+    }
+  g_string_truncate(self->name, name_len);
+  return step == JSON_SCANNER_END;
+}
+
+/* elements are named "<name>[<index>]" */
+static gboolean
+json_scanner_process_array(JSONScanner *self)
+{
+  gsize name_len = self->name->len;
+  JSONScannerStep step;
+  gint index;
+
+  if (!json_scanner_enter(self))
+    return FALSE;
+
+  for (index = 0; (step = json_scanner_next_element(self, index)) == JSON_SCANNER_ITEM; index++)
+    {
+      if (self->emit)
+        {
+          g_string_truncate(self->name, name_len);
+          g_string_append_printf(self->name, "[%d]", index);
+        }
+      if (!json_scanner_process_value(self))
+        return FALSE;
+    }
+  g_string_truncate(self->name, name_len);
+  return step == JSON_SCANNER_END;
+}
+
+static gboolean
+json_scanner_process_value(JSONScanner *self)
+{
+  const gchar *value;
+  gsize value_len;
+  gboolean verbatim = TRUE;
+
+  json_scanner_skip_whitespace(self);
+  if (self->pos >= self->end)
+    return FALSE;
+
+  value = self->pos;
+  switch (*self->pos)
+    {
+    case '{':
+      return json_scanner_process_object(self, FALSE);
+    case '[':
+      return json_scanner_process_array(self);
+    case '"':
+    case '\'':
+      if (!json_scanner_scan_string(self, &value, &value_len, &verbatim))
+        return FALSE;
+      break;
+    case 't':
+      if (!json_scanner_scan_literal(self, "true", 4))
+        return FALSE;
+      value_len = 4;
+      break;
+    case 'f':
+      if (!json_scanner_scan_literal(self, "false", 5))
+        return FALSE;
+      value_len = 5;
+      break;
+    case 'n':
+      return json_scanner_scan_literal(self, "null", 4);
+    default:
+      if (!json_scanner_scan_number(self, &value, &value_len, &verbatim))
+        return FALSE;
+      break;
+    }
+
+  if (self->emit)
+    self->value_func(self->name->str, value, value_len, verbatim, self->user_data);
+  return TRUE;
+}
+
+/*
+ * Validates the value at the current position and finds the value @elems
+ * refers to in it, the same way json_dot_notation_eval() does.
+ * @selected is set to NULL if there is no such value.
+ */
+static gboolean
+json_scanner_select(JSONScanner *self, const JSONDotNotationElem *elems, const gchar **selected)
+{
+  JSONScannerStep step;
+  const gchar *key;
+  gsize key_len;
+  gint index;
+
+  json_scanner_skip_whitespace(self);
+  *selected = NULL;
+  if (self->pos >= self->end)
+    return FALSE;
+
+  if (!elems || !elems->used)
+    {
+      *selected = self->pos;
+      return json_scanner_process_value(self);
+    }
+
+  if (elems->type == JS_MEMBER_REF)
+    {
+      if (*self->pos != '{')
+        return json_scanner_process_value(self);
+      if (!json_scanner_enter(self))
+        return FALSE;
+
+      for (index = 0; (step = json_scanner_next_member(self, index, &key, &key_len)) == JSON_SCANNER_ITEM; index++)
+        {
+          gboolean match = (key_len == strlen(elems->member_ref.name) &&
+                            memcmp(key, elems->member_ref.name, key_len) == 0);
+
+          /* json-c keeps the last one of duplicate keys */
+          if (!(match ? json_scanner_select(self, elems + 1, selected) : json_scanner_process_value(self)))
+            return FALSE;
+        }
+    }
+  else
+    {
+      if (*self->pos != '[')
+        return json_scanner_process_value(self);
+      if (!json_scanner_enter(self))
+        return FALSE;
+
+      for (index = 0; (step = json_scanner_next_element(self, index)) == JSON_SCANNER_ITEM; index++)
+        {
+          if (!(index == elems->array_ref.index ? json_scanner_select(self, elems + 1, selected) : json_scanner_process_value(self)))
+            return FALSE;
+        }
+    }
+  return step == JSON_SCANNER_END;
+}
+
+gboolean
+json_scanner_scan(const gchar *input, gsize input_len,
+                  const gchar *prefix, JSONDotNotation *extract,
+                  GString *name_buffer, GString *value_buffer,
+                  JSONScannerValueFunc value_func, gpointer user_data)
+{
+  JSONScanner self;
+  const gchar *selected;
+
+  memset(&self, 0, sizeof(self));
+  self.pos = input;
+  self.end = input + input_len;
+  self.name = name_buffer;
+  self.value = value_buffer;
+  self.value_func = value_func;
+  self.user_data = user_data;
+
+  /* the whole input is validated before anything is reported, so that
+   * nothing is left behind if the caller has to fall back to json-c */
+  if (!json_scanner_select(&self, extract ? json_dot_notation_get_elems(extract) : NULL, &selected) || !selected)
+    return FALSE;
+  self.pos = selected;
+  self.depth = 0;
+
+  if (*self.pos != '{')
+    return FALSE;
+
+  g_string_assign(self.name, prefix ? prefix : "");
+  self.emit = TRUE;
+  return json_scanner_process_object(&self, TRUE);
+}
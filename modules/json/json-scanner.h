@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2002-2010 BalaBit IT Ltd, Budapest, Hungary
+ * Copyright (c) 1998-2010 Balázs Scheidler
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * As an additional exemption you are allowed to compile & link against the
+ * OpenSSL libraries as published by the OpenSSL project. See the file
+ * COPYING for details.
+ *
+ */
+
+#ifndef JSON_SCANNER_H_INCLUDED
+#define JSON_SCANNER_H_INCLUDED
+
+#include "syslog-ng.h"
+#include "dot-notation.h"
+
+/*
+ * A streaming JSON tokenizer that reports the members of a JSON object
+ * as name-value pairs, using the same naming and value formatting as the
+ * json-c based json-parser(): nested objects are flattened using
+ * dot-notation ("foo.bar"), array elements are suffixed by their index
+ * ("foo[0]"), null values are skipped.
+ *
+ * No tree is built and nothing is allocated apart from the two GString
+ * buffers supplied by the caller.  String values without escapes,
+ * integers and booleans are passed to the callback as pointers into the
+ * input (@verbatim is TRUE), others point into @value_buffer.
+ *
+ * The scanner only accepts strict JSON (plus single quoted strings) and
+ * returns FALSE for anything else, including inputs json-c might accept
+ * (comments, NaN, big integers, \u0000 escapes) or reject.  The caller is
+ * expected to fall back to json-c in this case, which either produces the
+ * same name-value pairs or reports the error.  The input is validated
+ * before the first name-value pair is reported, so the callback is not
+ * called at all in this case.
+ *
+ * The only known difference to json-c is with objects having duplicate
+ * keys, json-c keeps the last member, while the scanner reports all.
+ */
+typedef void (*JSONScannerValueFunc)(const gchar *name, const gchar *value, gsize value_len, gboolean verbatim, gpointer user_data);
+
+gboolean json_scanner_scan(const gchar *input, gsize input_len,
+                           const gchar *prefix, JSONDotNotation *extract,
+                           GString *name_buffer, GString *value_buffer,
+                           JSONScannerValueFunc value_func, gpointer user_data);
+
+#endif
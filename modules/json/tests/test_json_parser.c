@@ -78,6 +78,27 @@ parse_json_into_log_message(const gchar *json)
   return msg;
 }
 
+/* parses $MESSAGE, the way json-parser() is used without a template */
+static LogMessage *
+parse_json_message_into_log_message(const gchar *json)
+{
+  LogMessage *msg;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogParser *cloned_parser;
+  const gchar *value;
+  gssize value_len;
+  gboolean success;
+
+  cloned_parser = (LogParser *) log_pipe_clone(&json_parser->super);
+  msg = log_msg_new_empty();
+  log_msg_set_value(msg, LM_V_MESSAGE, json, -1);
+  value = log_msg_get_value(msg, LM_V_MESSAGE, &value_len);
+  success = log_parser_process(cloned_parser, &msg, &path_options, value, value_len);
+  assert_true(success, "expected json-parser success and it returned failure, json=%s", json);
+  log_pipe_unref(&cloned_parser->super);
+  return msg;
+}
+
 static void
 assert_json_parser_fails(const gchar *json)
 {
@@ -168,6 +189,99 @@ test_json_parser_extracts_subobjects_if_extract_prefix_is_specified(void)
   assert_log_message_value(msg, log_msg_get_value_handle("foo"), "bar");
 }
 
+static void
+test_json_parser_unescapes_strings(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_into_log_message("{\"quote\": \"\\\"q\\\"\", \"ws\": \"a\\tb\\nc\", \"slash\": \"\\/\\\\\", \"unicode\": \"\\u00e1rv\\u00edz\"}");
+  assert_log_message_value(msg, log_msg_get_value_handle("quote"), "\"q\"");
+  assert_log_message_value(msg, log_msg_get_value_handle("ws"), "a\tb\nc");
+  assert_log_message_value(msg, log_msg_get_value_handle("slash"), "/\\");
+  assert_log_message_value(msg, log_msg_get_value_handle("unicode"), "\xc3\xa1rv\xc3\xadz");
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_flattens_nested_objects_and_arrays(void)
+{
+  LogMessage *msg;
+
+  json_parser_set_prefix(json_parser, ".prefix.");
+  msg = parse_json_into_log_message("{'a': {'b': {'c': 'deep'}}, 'matrix': [[1, 2], [3, -0]], 'list': [{'x': 'first'}, null, {'x': 'third'}], 'neg': -42, 'exp': 1e2}");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.a.b.c"), "deep");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.matrix[0][1]"), "2");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.matrix[1][0]"), "3");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.matrix[1][1]"), "0");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.list[0].x"), "first");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.list[2].x"), "third");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.neg"), "-42");
+  assert_log_message_value(msg, log_msg_get_value_handle(".prefix.exp"), "100.000000");
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_extracts_members_by_dot_notation(void)
+{
+  LogMessage *msg;
+
+  json_parser_set_extract_prefix(json_parser, "outer.list[1]");
+  msg = parse_json_into_log_message("{'outer': {'list': [{'foo': 'skipped'}, {'foo': 'bar', 'nested': {'n': 1}}]}, 'foo': 'top'}");
+  assert_log_message_value(msg, log_msg_get_value_handle("foo"), "bar");
+  assert_log_message_value(msg, log_msg_get_value_handle("nested.n"), "1");
+  log_msg_unref(msg);
+
+  /* the last one of duplicate keys is used, like json-c does */
+  msg = parse_json_into_log_message("{'outer': {'list': [{}, {'foo': 'first'}]}, 'outer': {'list': [{}, {'foo': 'last'}]}}");
+  assert_log_message_value(msg, log_msg_get_value_handle("foo"), "last");
+  log_msg_unref(msg);
+
+  assert_json_parser_fails("{'outer': {'list': [{'foo': 'bar'}]}}");
+  assert_json_parser_fails("{'outer': {'list': [{}, 'not-an-object']}}");
+}
+
+static void
+test_json_parser_falls_back_to_json_c_for_non_strict_json(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_into_log_message("{'big': 12345678901, /* comment */ 'foo': 'bar'}");
+  assert_log_message_value(msg, log_msg_get_value_handle("foo"), "bar");
+  log_msg_unref(msg);
+
+  assert_json_parser_fails("{'foo': 'bar'");
+  assert_json_parser_fails("{'foo': tru}");
+}
+
+static void
+test_json_parser_leaves_no_partial_results_behind_on_failure(void)
+{
+  LogMessage *msg;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  const gchar *json = "{'foo': 'bar', 'nested': {'baz': 1}, 'broken': tru}";
+
+  msg = log_msg_new_empty();
+  assert_false(log_parser_process(json_parser, &msg, &path_options, json, strlen(json)),
+               "expected json-parser failure and it returned success, json=%s", json);
+  assert_log_message_value(msg, log_msg_get_value_handle("foo"), "");
+  assert_log_message_value(msg, log_msg_get_value_handle("nested.baz"), "");
+  log_msg_unref(msg);
+}
+
+static void
+test_json_parser_parses_message_in_place(void)
+{
+  LogMessage *msg;
+
+  msg = parse_json_message_into_log_message("{'foo': 'bar', 'escaped': 'a\\tb', 'num': 42, 'MESSAGE': 'replaced', 'after': 'message'}");
+  assert_log_message_value(msg, log_msg_get_value_handle("foo"), "bar");
+  assert_log_message_value(msg, log_msg_get_value_handle("escaped"), "a\tb");
+  assert_log_message_value(msg, log_msg_get_value_handle("num"), "42");
+  assert_log_message_value(msg, log_msg_get_value_handle("after"), "message");
+  assert_log_message_value(msg, LM_V_MESSAGE, "replaced");
+  log_msg_unref(msg);
+}
+
 static void
 test_json_parser(void)
 {
@@ -179,6 +293,12 @@ test_json_parser(void)
   JSON_PARSER_TESTCASE(test_json_parser_validate_type_representation);
   JSON_PARSER_TESTCASE(test_json_parser_fails_for_non_object_top_element);
   JSON_PARSER_TESTCASE(test_json_parser_extracts_subobjects_if_extract_prefix_is_specified);
+  JSON_PARSER_TESTCASE(test_json_parser_unescapes_strings);
+  JSON_PARSER_TESTCASE(test_json_parser_flattens_nested_objects_and_arrays);
+  JSON_PARSER_TESTCASE(test_json_parser_extracts_members_by_dot_notation);
+  JSON_PARSER_TESTCASE(test_json_parser_falls_back_to_json_c_for_non_strict_json);
+  JSON_PARSER_TESTCASE(test_json_parser_leaves_no_partial_results_behind_on_failure);
+  JSON_PARSER_TESTCASE(test_json_parser_parses_message_in_place);
 }
 
 int
@@ -0,0 +1,139 @@
+#include "syslog-ng.h"
+#include "logmsg.h"
+#include "json-parser.h"
+#include "apphook.h"
+#include "cfg.h"
+#include "scratch-buffers.h"
+
+#include <json.h>
+#include <json_object_private.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_COUNT 20000
+
+/* an audit-trail like event, ~2KB with nested objects and arrays */
+static GString *
+build_document(void)
+{
+  GString *doc = g_string_sized_new(2048);
+  gint i;
+
+  g_string_append(doc, "{\"event\": {\"id\": 12345, \"kind\": \"login\", \"outcome\": \"success\", \"duration\": 0.125}, "
+                       "\"host\": {\"name\": \"web-01.example.com\", \"ip\": [\"10.0.0.1\", \"fe80::1\"]}, "
+                       "\"user\": {\"name\": \"jdoe\", \"roles\": [\"admin\", \"ops\", \"dev\"], \"active\": true}, "
+                       "\"message\": \"user logged in from \\\"10.0.0.1\\\"\", \"tags\": [");
+  for (i = 0; i < 16; i++)
+    g_string_append_printf(doc, "%s{\"key\": \"tag-%d\", \"value\": \"some value of tag number %d\", \"seq\": %d}",
+                           i ? ", " : "", i, i, i);
+  g_string_append(doc, "], \"extra\": null}");
+  return doc;
+}
+
+static void
+walk_json_object(struct json_object *jso, GString *key, GString *value)
+{
+  struct json_object_iter itr;
+  gsize key_len = key->len;
+
+  json_object_object_foreachC(jso, itr)
+    {
+      g_string_truncate(key, key_len);
+      g_string_append(key, itr.key);
+      switch (json_object_get_type(itr.val))
+        {
+        case json_type_object:
+          g_string_append_c(key, '.');
+          walk_json_object(itr.val, key, value);
+          break;
+        case json_type_null:
+        case json_type_array:
+          break;
+        default:
+          g_string_assign(value, json_object_get_string(itr.val));
+          break;
+        }
+    }
+  g_string_truncate(key, key_len);
+}
+
+/* what json-parser() used to do: tokenize into a DOM, then walk it */
+static void
+testcase_json_c(const GString *doc)
+{
+  struct json_tokener *tok;
+  struct json_object *jso;
+  GString *key = g_string_sized_new(64);
+  GString *value = g_string_sized_new(64);
+  GTimeVal start, end;
+  gint i;
+
+  g_get_current_time(&start);
+  for (i = 0; i < BENCHMARK_COUNT; i++)
+    {
+      tok = json_tokener_new();
+      jso = json_tokener_parse_ex(tok, doc->str, doc->len);
+      json_tokener_free(tok);
+      walk_json_object(jso, key, value);
+      json_object_put(jso);
+    }
+  g_get_current_time(&end);
+  printf("      %-40s speed: %12.3f msg/sec\n", "json-c tokenizer + DOM walk",
+         i * 1e6 / g_time_val_diff(&end, &start));
+
+  g_string_free(key, TRUE);
+  g_string_free(value, TRUE);
+}
+
+static void
+testcase_json_parser(const GString *doc, const gchar *prefix)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogParser *parser;
+  LogMessage *msg;
+  const gchar *value;
+  gssize value_len;
+  GTimeVal start, end;
+  gint i;
+
+  parser = json_parser_new(configuration);
+  json_parser_set_prefix(parser, prefix);
+
+  g_get_current_time(&start);
+  for (i = 0; i < BENCHMARK_COUNT; i++)
+    {
+      msg = log_msg_new_empty();
+      log_msg_set_value(msg, LM_V_MESSAGE, doc->str, doc->len);
+      value = log_msg_get_value(msg, LM_V_MESSAGE, &value_len);
+      if (!log_parser_process(parser, &msg, &path_options, value, value_len))
+        {
+          fprintf(stderr, "json-parser() failed to parse the benchmark document\n");
+          exit(1);
+        }
+      log_msg_unref(msg);
+    }
+  g_get_current_time(&end);
+  printf("      %-40s speed: %12.3f msg/sec\n", "json-parser() into LogMessage",
+         i * 1e6 / g_time_val_diff(&end, &start));
+
+  log_pipe_unref(&parser->super);
+}
+
+int
+main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
+{
+  GString *doc;
+
+  app_startup();
+  configuration = cfg_new(0x0300);
+
+  doc = build_document();
+  testcase_json_c(doc);
+  testcase_json_parser(doc, ".json.");
+
+  g_string_free(doc, TRUE);
+  app_shutdown();
+  return 0;
+}
@@ -45,15 +45,21 @@ typedef struct
 
   GString *command;
   LogTemplate *key;
-  GString *key_str;
   LogTemplate *param1;
-  GString *param1_str;
   LogTemplate *param2;
+} RedisDriver;
+
+typedef struct
+{
+  LogThrDestWorker super;
+
+  GString *key_str;
+  GString *param1_str;
   GString *param2_str;
 
   gint32 seq_num;
   redisContext *c;
-} RedisDriver;
+} RedisWorker;
 
 /*
  * Configuration
@@ -130,8 +136,10 @@ redis_dd_format_persist_name(LogThrDestDriver *d)
 }
 
 static gboolean
-redis_dd_connect(RedisDriver *self, gboolean reconnect)
+redis_worker_connect(RedisWorker *self, gboolean reconnect)
 {
+  RedisDriver *owner = (RedisDriver *)self->super.owner;
+
   if (reconnect && (self->c != NULL))
     {
       redisCommand(self->c, "ping");
@@ -139,31 +147,31 @@ redis_dd_connect(RedisDriver *self, gboolean reconnect)
       if (!self->c->err)
         return TRUE;
       else
-        self->c = redisConnect(self->host, self->port);
+        self->c = redisConnect(owner->host, owner->port);
     }
   else
-    self->c = redisConnect(self->host, self->port);
+    self->c = redisConnect(owner->host, owner->port);
 
   if (self->c->err)
     {
       msg_error("REDIS server error, suspending",
-                evt_tag_str("driver", self->super.super.super.id),
+                evt_tag_str("driver", owner->super.super.super.id),
                 evt_tag_str("error", self->c->errstr),
-                evt_tag_int("time_reopen", self->super.time_reopen),
+                evt_tag_int("time_reopen", owner->super.time_reopen),
                 NULL);
       return FALSE;
     }
   else
     msg_debug("Connecting to REDIS succeeded",
-              evt_tag_str("driver", self->super.super.super.id), NULL);
+              evt_tag_str("driver", owner->super.super.super.id), NULL);
 
   return TRUE;
 }
 
 static void
-redis_dd_disconnect(LogThrDestDriver *s)
+redis_worker_disconnect(LogThrDestWorker *s)
 {
-  RedisDriver *self = (RedisDriver *)s;
+  RedisWorker *self = (RedisWorker *)s;
 
   if (self->c)
     redisFree(self->c);
@@ -174,114 +182,157 @@ redis_dd_disconnect(LogThrDestDriver *s)
  * Worker thread
  */
 
-static gboolean
-redis_worker_insert(LogThrDestDriver *s)
+static void
+redis_worker_append_command(RedisWorker *self, LogMessage *msg)
 {
-  RedisDriver *self = (RedisDriver *)s;
-  gboolean success;
-  LogMessage *msg;
-  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
-  redisReply *reply;
+  RedisDriver *owner = (RedisDriver *)self->super.owner;
   const char *argv[5];
   size_t argvlen[5];
   int argc = 2;
 
-  redis_dd_connect(self, TRUE);
-
-  if (self->c->err)
-    return FALSE;
-
-  success = log_queue_pop_head(self->super.queue, &msg, &path_options, FALSE, FALSE);
-  if (!success)
-    return TRUE;
-
-  msg_set_context(msg);
-
-  log_template_format(self->key, msg, &self->template_options, LTZ_SEND,
+  log_template_format(owner->key, msg, &owner->template_options, LTZ_SEND,
                       self->seq_num, NULL, self->key_str);
 
-  if (self->param1)
-    log_template_format(self->param1, msg, &self->template_options, LTZ_SEND,
+  if (owner->param1)
+    log_template_format(owner->param1, msg, &owner->template_options, LTZ_SEND,
                         self->seq_num, NULL, self->param1_str);
-  if (self->param2)
-    log_template_format(self->param2, msg, &self->template_options, LTZ_SEND,
+  if (owner->param2)
+    log_template_format(owner->param2, msg, &owner->template_options, LTZ_SEND,
                         self->seq_num, NULL, self->param2_str);
 
-  argv[0] = self->command->str;
-  argvlen[0] = self->command->len;
+  argv[0] = owner->command->str;
+  argvlen[0] = owner->command->len;
   argv[1] = self->key_str->str;
   argvlen[1] = self->key_str->len;
 
-  if (self->param1)
+  if (owner->param1)
     {
       argv[2] = self->param1_str->str;
       argvlen[2] = self->param1_str->len;
       argc++;
     }
 
-  if (self->param2)
+  if (owner->param2)
     {
       argv[3] = self->param2_str->str;
       argvlen[3] = self->param2_str->len;
       argc++;
     }
 
-  reply = redisCommandArgv(self->c, argc, argv, argvlen);
+  /* hiredis formats the command into its output buffer right away, so
+   * the key/param strings can be reused for the next message */
+  redisAppendCommandArgv(self->c, argc, argv, argvlen);
 
-  msg_debug("REDIS command sent",
-            evt_tag_str("driver", self->super.super.super.id),
-            evt_tag_str("command", self->command->str),
+  msg_debug("REDIS command queued",
+            evt_tag_str("driver", owner->super.super.super.id),
+            evt_tag_str("command", owner->command->str),
             evt_tag_str("key", self->key_str->str),
             evt_tag_str("param1", self->param1_str->str),
             evt_tag_str("param2", self->param2_str->str),
             NULL);
-  success = TRUE;
+}
+
+/*
+ * The whole batch is pipelined: all commands are appended to the output
+ * buffer and sent in one go, then the replies are collected.
+ */
+static gboolean
+redis_worker_insert_batch(LogThrDestWorker *s, LogMessage **msgs, gint msgs_len)
+{
+  RedisWorker *self = (RedisWorker *)s;
+  RedisDriver *owner = (RedisDriver *)s->owner;
+  redisReply *reply;
+  gint i;
 
-  freeReplyObject(reply);
+  redis_worker_connect(self, TRUE);
 
-  msg_set_context(NULL);
+  if (self->c->err)
+    return FALSE;
 
-  if (success)
+  for (i = 0; i < msgs_len; i++)
     {
-      stats_counter_inc(self->super.stored_messages);
+      msg_set_context(msgs[i]);
+      redis_worker_append_command(self, msgs[i]);
       step_sequence_number(&self->seq_num);
-      log_msg_ack(msg, &path_options);
-      log_msg_unref(msg);
     }
-  else
+  msg_set_context(NULL);
+
+  for (i = 0; i < msgs_len; i++)
     {
-      log_queue_push_head(self->super.queue, msg, &path_options);
+      if (redisGetReply(self->c, (void **) &reply) != REDIS_OK)
+        {
+          msg_error("REDIS server error, suspending",
+                    evt_tag_str("driver", owner->super.super.super.id),
+                    evt_tag_str("error", self->c->errstr),
+                    evt_tag_int("time_reopen", owner->super.time_reopen),
+                    NULL);
+          return FALSE;
+        }
+
+      if (reply->type == REDIS_REPLY_ERROR)
+        msg_debug("REDIS command returned an error",
+                  evt_tag_str("driver", owner->super.super.super.id),
+                  evt_tag_str("error", reply->str),
+                  NULL);
+      freeReplyObject(reply);
     }
 
-  return success;
+  stats_counter_add(s->stored_messages, msgs_len);
+  return TRUE;
 }
 
 static void
-redis_worker_thread_init(LogThrDestDriver *d)
+redis_worker_thread_init(LogThrDestWorker *s)
 {
-  RedisDriver *self = (RedisDriver *)d;
+  RedisWorker *self = (RedisWorker *)s;
 
   msg_debug("Worker thread started",
-            evt_tag_str("driver", self->super.super.super.id),
+            evt_tag_str("driver", s->owner->super.super.id),
+            evt_tag_int("worker", s->worker_index),
             NULL);
 
   self->key_str = g_string_sized_new(1024);
   self->param1_str = g_string_sized_new(1024);
   self->param2_str = g_string_sized_new(1024);
 
-  redis_dd_connect(self, FALSE);
+  redis_worker_connect(self, FALSE);
 }
 
 static void
-redis_worker_thread_deinit(LogThrDestDriver *d)
+redis_worker_thread_deinit(LogThrDestWorker *s)
 {
-  RedisDriver *self = (RedisDriver *)d;
+  RedisWorker *self = (RedisWorker *)s;
 
   g_string_free(self->key_str, TRUE);
   g_string_free(self->param1_str, TRUE);
   g_string_free(self->param2_str, TRUE);
 }
 
+static void
+redis_worker_free(LogThrDestWorker *s)
+{
+  RedisWorker *self = (RedisWorker *)s;
+
+  if (self->c)
+    redisFree(self->c);
+}
+
+static LogThrDestWorker *
+redis_worker_new(LogThrDestDriver *owner, gint worker_index)
+{
+  RedisWorker *self = g_new0(RedisWorker, 1);
+
+  log_threaded_dest_worker_init_instance(&self->super, owner, worker_index);
+  self->super.thread_init = redis_worker_thread_init;
+  self->super.thread_deinit = redis_worker_thread_deinit;
+  self->super.disconnect = redis_worker_disconnect;
+  self->super.insert_batch = redis_worker_insert_batch;
+  self->super.free_fn = redis_worker_free;
+
+  init_sequence_number(&self->seq_num);
+  return &self->super;
+}
+
 /*
  * Main thread
  */
@@ -318,8 +369,6 @@ redis_dd_free(LogPipe *d)
   log_template_unref(self->key);
   log_template_unref(self->param1);
   log_template_unref(self->param2);
-  if (self->c)
-    redisFree(self->c);
 
   log_threaded_dest_driver_free(d);
 }
@@ -337,10 +386,7 @@ redis_dd_new(GlobalConfig *cfg)
   self->super.super.super.super.init = redis_dd_init;
   self->super.super.super.super.free_fn = redis_dd_free;
 
-  self->super.worker.thread_init = redis_worker_thread_init;
-  self->super.worker.thread_deinit = redis_worker_thread_deinit;
-  self->super.worker.disconnect = redis_dd_disconnect;
-  self->super.worker.insert = redis_worker_insert;
+  self->super.worker.construct = redis_worker_new;
 
   self->super.format.stats_instance = redis_dd_format_stats_instance;
   self->super.format.persist_name = redis_dd_format_persist_name;
@@ -351,7 +397,6 @@ redis_dd_new(GlobalConfig *cfg)
 
   self->command = g_string_sized_new(32);
 
-  init_sequence_number(&self->seq_num);
   log_template_options_defaults(&self->template_options);
 
   return (LogDriver *)self;
@@ -47,6 +47,7 @@ static const char aix_fwd_string[] = "Message forwarded from ";
 static const char repeat_msg_string[] = "last message repeated";
 static NVHandle is_synced;
 static NVHandle cisco_seqid;
+static NVHandle raw_message_handle;
 
 static gboolean
 log_msg_parse_pri(LogMessage *self, const guchar **data, gint *length, guint flags, guint16 default_pri)
@@ -849,6 +850,36 @@ log_msg_parse_sd(LogMessage *self, const guchar **data, gint *length, const MsgF
 }
 
 
+/*
+ * Store $MSG. With LP_STORE_RAW_MESSAGE the raw line is already in
+ * $RAWMSG and $MSG is its suffix, so it is stored as an indirect
+ * reference instead of a second copy.  As it extends to the end of
+ * $RAWMSG, the referenced value is still NUL terminated.
+ *
+ * The header fields ($HOST, $PROGRAM, $PID, $MSGID) are copied even
+ * then: built-in values are used as NUL terminated strings all over the
+ * tree, and an indirect value is only terminated if it runs to the end of
+ * the value it references.  They are short, so the net saving is about
+ * the size of $MSG.
+ */
+static void
+log_msg_parse_set_message(LogMessage *self, const MsgFormatOptions *parse_options,
+                          const guchar *data, gint length,
+                          const guchar *src, gint left)
+{
+  if ((parse_options->flags & LP_STORE_RAW_MESSAGE) &&
+      length <= G_MAXUINT16 &&
+      src + left == data + length &&
+      !((parse_options->flags & LP_NO_MULTI_LINE) && find_cr_or_lf((gchar *) src, left)))
+    {
+      log_msg_set_value_indirect(self, LM_V_MESSAGE, raw_message_handle, 0, src - data, left);
+    }
+  else
+    {
+      log_msg_set_value(self, LM_V_MESSAGE, (gchar *) src, left);
+    }
+}
+
 /**
  * log_msg_parse_legacy:
  * @self: LogMessage instance to store parsed information into
@@ -947,7 +978,7 @@ log_msg_parse_legacy(const MsgFormatOptions *parse_options,
       self->timestamps[LM_TS_STAMP] = self->timestamps[LM_TS_RECVD];
     }
 
-  log_msg_set_value(self, LM_V_MESSAGE, (gchar *) src, left);
+  log_msg_parse_set_message(self, parse_options, data, length, src, left);
   if ((parse_options->flags & LP_VALIDATE_UTF8) && g_utf8_validate((gchar *) src, left, NULL))
     self->flags |= LF_UTF8;
 
@@ -1053,7 +1084,7 @@ log_msg_parse_syslog_proto(const MsgFormatOptions *parse_options, const guchar *
     {
       self->flags |= LF_UTF8;
     }
-  log_msg_set_value(self, LM_V_MESSAGE, (gchar *) src, left);
+  log_msg_parse_set_message(self, parse_options, data, length, src, left);
   return TRUE;
 }
 
@@ -1069,9 +1100,12 @@ syslog_format_handler(const MsgFormatOptions *parse_options,
   while (length > 0 && (data[length - 1] == '\n' || data[length - 1] == '\0'))
     length--;
 
+  if (parse_options->flags & LP_STORE_RAW_MESSAGE)
+    log_msg_set_value(self, raw_message_handle, (gchar *) data, length);
+
   if (parse_options->flags & LP_NOPARSE)
     {
-      log_msg_set_value(self, LM_V_MESSAGE, (gchar *) data, length);
+      log_msg_parse_set_message(self, parse_options, data, length, data, length);
       self->pri = parse_options->default_pri;
       return;
     }
@@ -1119,6 +1153,7 @@ syslog_format_init(void)
     {
       is_synced = log_msg_get_value_handle(".SDATA.timeQuality.isSynced");
       cisco_seqid = log_msg_get_value_handle(".SDATA.meta.sequenceId");
+      raw_message_handle = log_msg_get_value_handle("RAWMSG");
       handles_initialized = TRUE;
     }
 }
@@ -107,6 +107,21 @@ slng_stats(int argc, char *argv[], const gchar *mode)
   return 0;
 }
 
+static gint
+slng_metrics(int argc, char *argv[], const gchar *mode)
+{
+  GString *rsp = NULL;
+
+  if (!(slng_send_cmd("METRICS\n") && ((rsp = control_client_read_reply(control_client)) != NULL)))
+    return 1;
+
+  printf("%s\n", rsp->str);
+
+  g_string_free(rsp, TRUE);
+
+  return 0;
+}
+
 static gint
 slng_stop(int argc, char *argv[], const gchar *mode)
 {
@@ -177,6 +192,7 @@ static struct
 } modes[] =
 {
   { "stats", no_options, "Dump syslog-ng statistics", slng_stats },
+  { "metrics", no_options, "Dump syslog-ng statistics in OpenMetrics format", slng_metrics },
   { "verbose", verbose_options, "Enable/query verbose messages", slng_verbose },
   { "debug", verbose_options, "Enable/query debug messages", slng_verbose },
   { "trace", verbose_options, "Enable/query trace messages", slng_verbose },
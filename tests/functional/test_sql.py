@@ -22,7 +22,32 @@ destination d_sql {
         flush-lines(25) flush_timeout(100));
 };
 
-log { source(s_tcp); destination(d_sql); };
+destination d_sql_multi_row {
+    sql(type(sqlite3) database("%(current_dir)s/test-sql-multi-row.db") host(dummy) port(1234) username(dummy) password(dummy)
+        table("logs")
+        null("@NULL@")
+        columns("date datetime", "host", "program", "pid", "msg")
+        values("$DATE", "$HOST", "$PROGRAM", "${PID:-@NULL@}", "$MSG")
+        flags(explicit-commits multi-row-inserts)
+        flush-lines(25) flush_timeout(100));
+};
+
+# the CHECK constraint rejects the sql_bad row, failing the multi-row
+# INSERT it is part of, the rest of the batch is inserted row-by-row
+destination d_sql_bad_row {
+    sql(type(sqlite3) database("%(current_dir)s/test-sql-bad-row.db") host(dummy) port(1234) username(dummy) password(dummy)
+        table("logs")
+        null("@NULL@")
+        columns("date datetime", "host", "program", "pid", "msg text CHECK (msg NOT LIKE 'sql_bad%%')")
+        values("$DATE", "$HOST", "$PROGRAM", "${PID:-@NULL@}", "$MSG")
+        flags(explicit-commits multi-row-inserts)
+        flush-lines(25) flush_timeout(100));
+};
+
+filter f_good { not message("sql_bad"); };
+
+log { source(s_tcp); filter(f_good); destination(d_sql); destination(d_sql_multi_row); };
+log { source(s_tcp); destination(d_sql_bad_row); };
 
 """ % locals()
 
@@ -69,8 +94,15 @@ def test_sql():
     expected = []
     for msg in messages:
         expected.extend(s.sendMessages(msg, pri=7))
+    # a single message that cannot be inserted into d_sql_bad_row, sent
+    # between the good ones so it lands in the middle of a batch
+    SocketSender(AF_INET, ('localhost', port_number), dgram=0, repeat=2).sendMessages('sql_bad', pri=7)
+    expected.extend(s.sendMessages('sql3', pri=7))
     print_user("Waiting for 10 seconds until syslog-ng writes all records to the SQL table")
     time.sleep(10)
     stopped = stop_syslogng()
     time.sleep(5)
-    return stopped and check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
+    return stopped and \
+           check_sql_expected("%s/test-sql.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345") and \
+           check_sql_expected("%s/test-sql-multi-row.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345") and \
+           check_sql_expected("%s/test-sql-bad-row.db" % current_dir, "logs", expected, settle_time=5, syslog_prefix="Sep  7 10:43:21 bzorp prog 12345")
@@ -1,4 +1,5 @@
 #include "dnscache.h"
+#include "persist-state.h"
 #include "apphook.h"
 #include "timeutils.h"
 
@@ -108,6 +109,62 @@ test_expiration(void)
     }
 }
 
+void
+test_persistence(void)
+{
+  PersistState *state;
+  const gchar *hn = NULL;
+  gsize hn_len;
+  gboolean positive;
+  gint i;
+
+  unlink("test_dnscache.persist");
+  dns_cache_set_params(50000, 600, 300, NULL);
+
+  for (i = 0; i < 100; i++)
+    {
+      guint32 ni = htonl(100000 + i);
+
+      dns_cache_store_dynamic(AF_INET, (void *) &ni, i < 50 ? "hostname" : "negative", i < 50);
+    }
+
+  state = persist_state_new("test_dnscache.persist");
+  persist_state_start(state);
+  dns_cache_save(state);
+  persist_state_commit(state);
+  persist_state_free(state);
+
+  /* start over with an empty cache, as if syslog-ng was restarted */
+  dns_cache_global_deinit();
+  dns_cache_global_init();
+  dns_cache_set_params(50000, 600, 300, NULL);
+
+  state = persist_state_new("test_dnscache.persist");
+  persist_state_start(state);
+  dns_cache_restore(state);
+  persist_state_cancel(state);
+  persist_state_free(state);
+  unlink("test_dnscache.persist");
+
+  for (i = 0; i < 100; i++)
+    {
+      guint32 ni = htonl(100000 + i);
+
+      hn = NULL;
+      positive = FALSE;
+      if (!dns_cache_lookup(AF_INET, (void *) &ni, &hn, &hn_len, &positive))
+        {
+          fprintf(stderr, "hmmm cache entry was not restored from the persist file, i=%d\n", i);
+          exit(1);
+        }
+      if (positive != (i < 50) || strcmp(hn, i < 50 ? "hostname" : "negative") != 0 || hn_len != strlen(hn))
+        {
+          fprintf(stderr, "hmm, restored cache entry differs from the saved one, i=%d, hn=%s\n", i, hn);
+          exit(1);
+        }
+    }
+}
+
 void
 test_dns_cache_benchmark(void)
 {
@@ -148,6 +205,7 @@ main()
   app_startup();
 
   test_expiration();
+  test_persistence();
   test_dns_cache_benchmark();
 
   app_shutdown();
@@ -1,6 +1,13 @@
 #include "misc.h"
+#include "logproto/logproto-server.h"
+#include "testutils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#define BENCHMARK_BUFFER_SIZE (64 * 1024)
+#define BENCHMARK_LINE_LENGTH 80
+#define BENCHMARK_ITERATIONS 1000
 
 static void
 testcase(gchar *msg, gsize msg_len, gsize eom_ofs)
@@ -24,6 +31,144 @@ testcase(gchar *msg, gsize msg_len, gsize eom_ofs)
     }
 }
 
+static void
+fill_buffer_with_lines(guchar *buffer, gsize buffer_len, gsize line_len)
+{
+  gsize i;
+
+  for (i = 0; i < buffer_len; i++)
+    buffer[i] = (i % line_len == line_len - 1) ? '\n' : 'a' + (i % 26);
+}
+
+static void
+test_find_eom_implementations_agree(void)
+{
+  const FindEOMImplementation *impl;
+  guchar buffer[1024];
+  guint32 expected[G_N_ELEMENTS(buffer)];
+  guint32 eoms[G_N_ELEMENTS(buffer)];
+  gsize expected_count;
+  gsize i, ofs;
+
+  /* lines of varying length with embedded NULs, every alignment */
+  for (i = 0; i < sizeof(buffer); i++)
+    buffer[i] = (i * 7) % 61 == 0 ? '\n' : ((i * 13) % 97 == 0 ? '\0' : 'a' + (i % 26));
+
+  for (ofs = 0; ofs < 64; ofs++)
+    {
+      expected_count = 0;
+      for (i = ofs; i < sizeof(buffer); i++)
+        {
+          if (buffer[i] == '\n' || buffer[i] == '\0')
+            expected[expected_count++] = i - ofs;
+        }
+
+      for (impl = find_eom_get_implementation(); impl->name; impl++)
+        {
+          const guchar *eom = impl->find_eom(buffer + ofs, sizeof(buffer) - ofs);
+          gsize count = impl->find_all_eom(buffer + ofs, sizeof(buffer) - ofs, eoms, G_N_ELEMENTS(eoms));
+
+          if (eom - (buffer + ofs) != expected[0])
+            {
+              fprintf(stderr, "find_eom() returned a wrong location. impl=%s, ofs=%d\n", impl->name, (gint) ofs);
+              exit(1);
+            }
+          if (count != expected_count || memcmp(eoms, expected, count * sizeof(eoms[0])) != 0)
+            {
+              fprintf(stderr, "find_all_eom() returned wrong locations. impl=%s, ofs=%d\n", impl->name, (gint) ofs);
+              exit(1);
+            }
+          if (impl->find_all_eom(buffer + ofs, sizeof(buffer) - ofs, eoms, 3) != 3 ||
+              memcmp(eoms, expected, 3 * sizeof(eoms[0])) != 0)
+            {
+              fprintf(stderr, "find_all_eom() does not stop at max_eoms. impl=%s, ofs=%d\n", impl->name, (gint) ofs);
+              exit(1);
+            }
+        }
+    }
+}
+
+static void
+test_find_cr_or_lf_speed(guchar *buffer, gsize buffer_len)
+{
+  gchar *p, *eol;
+  gsize lines = 0;
+  gint i;
+
+  start_stopwatch();
+  for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+      p = (gchar *) buffer;
+      while ((eol = find_cr_or_lf(p, (gchar *) buffer + buffer_len - p)))
+        {
+          lines++;
+          p = eol + 1;
+        }
+    }
+  stop_stopwatch_and_display_result("find_cr_or_lf() speed, buffer_size=%d, lines=%d",
+                                    (gint) buffer_len, (gint) lines);
+}
+
+static void
+test_find_eom_speed(const FindEOMImplementation *impl, guchar *buffer, gsize buffer_len)
+{
+  const guchar *p, *eom;
+  gsize lines = 0;
+  gint i;
+
+  start_stopwatch();
+  for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+      p = buffer;
+      while ((eom = impl->find_eom(p, buffer + buffer_len - p)))
+        {
+          lines++;
+          p = eom + 1;
+        }
+    }
+  stop_stopwatch_and_display_result("find_eom() speed, impl=%s, buffer_size=%d, lines=%d",
+                                    impl->name, (gint) buffer_len, (gint) lines);
+}
+
+static void
+test_find_all_eom_speed(const FindEOMImplementation *impl, guchar *buffer, gsize buffer_len)
+{
+  guint32 eoms[256];
+  gsize count, pos;
+  gsize lines = 0;
+  gint i;
+
+  start_stopwatch();
+  for (i = 0; i < BENCHMARK_ITERATIONS; i++)
+    {
+      pos = 0;
+      while ((count = impl->find_all_eom(buffer + pos, buffer_len - pos, eoms, G_N_ELEMENTS(eoms))))
+        {
+          lines += count;
+          pos += eoms[count - 1] + 1;
+        }
+    }
+  stop_stopwatch_and_display_result("find_all_eom() speed, impl=%s, buffer_size=%d, lines=%d",
+                                    impl->name, (gint) buffer_len, (gint) lines);
+}
+
+static void
+test_eol_search_speed(void)
+{
+  const FindEOMImplementation *impl;
+  guchar *buffer = g_malloc(BENCHMARK_BUFFER_SIZE);
+
+  fill_buffer_with_lines(buffer, BENCHMARK_BUFFER_SIZE, BENCHMARK_LINE_LENGTH);
+
+  test_find_cr_or_lf_speed(buffer, BENCHMARK_BUFFER_SIZE);
+  for (impl = find_eom_get_implementation(); impl->name; impl++)
+    {
+      test_find_eom_speed(impl, buffer, BENCHMARK_BUFFER_SIZE);
+      test_find_all_eom_speed(impl, buffer, BENCHMARK_BUFFER_SIZE);
+    }
+  g_free(buffer);
+}
+
 int
 main()
 {
@@ -108,5 +253,7 @@ main()
   testcase("abcdefghijklmnopqrstuvwxy", 25, -1);
   testcase("abcdefghijklmnopqrstuvwxyz", 26, -1);
 
+  test_find_eom_implementations_agree();
+  test_eol_search_speed();
   return 0;
 }
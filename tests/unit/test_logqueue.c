@@ -1,14 +1,18 @@
 #include "logqueue.h"
 #include "logqueue-fifo.h"
+#include "logqueue-disk.h"
+#include "logqueue-ring.h"
 #include "logpipe.h"
 #include "apphook.h"
 #include "plugin.h"
 #include "mainloop.h"
 #include "tls-support.h"
 #include "mainloop-io-worker.h"
+#include "libtest/persist_lib.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <iv.h>
 #include <iv_list.h>
 #include <iv_thread.h>
@@ -123,6 +127,134 @@ testcase_zero_diskbuf_alternating_send_acks()
   log_queue_unref(q);
 }
 
+static void
+assert_latency_histograms_recorded(LogQueue *q)
+{
+  StatsHistogram queue_latency = { 0 }, delivery_latency = { 0 }, latency = { 0 };
+
+  log_queue_set_latency_histograms(q, &queue_latency, &delivery_latency, &latency);
+  fed_messages = 0;
+  acked_messages = 0;
+  feed_some_messages(&q, 10, TRUE);
+  g_usleep(2000);
+  send_some_messages(q, fed_messages, TRUE);
+  g_usleep(1000);
+  app_ack_some_messages(q, fed_messages);
+  log_queue_set_latency_histograms(q, NULL, NULL, NULL);
+
+  if (queue_latency.count != 10 || delivery_latency.count != 10 || latency.count != 10)
+    {
+      fprintf(stderr, "latency histograms were not recorded for every message: queue=%" G_GINT64_FORMAT ", delivery=%" G_GINT64_FORMAT ", latency=%" G_GINT64_FORMAT "\n",
+              queue_latency.count, delivery_latency.count, latency.count);
+      exit(1);
+    }
+  /* bucket upper bounds are within 25% of the actual value */
+  if (stats_histogram_get_percentile(&queue_latency, 50) < 1500 ||
+      stats_histogram_get_percentile(&delivery_latency, 50) < 750)
+    {
+      fprintf(stderr, "latency histograms recorded unexpected values: queue_p50=%" G_GUINT64_FORMAT ", delivery_p50=%" G_GUINT64_FORMAT "\n",
+              stats_histogram_get_percentile(&queue_latency, 50), stats_histogram_get_percentile(&delivery_latency, 50));
+      exit(1);
+    }
+}
+
+/* the way LogWriter consumes messages: no backlog, pushed back once */
+static void
+assert_latency_histograms_recorded_without_backlog(LogQueue *q)
+{
+  StatsHistogram queue_latency = { 0 }, delivery_latency = { 0 }, latency = { 0 };
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg;
+  guint64 delivery_start;
+  gint i;
+
+  log_queue_set_latency_histograms(q, &queue_latency, &delivery_latency, &latency);
+  fed_messages = 0;
+  acked_messages = 0;
+  feed_some_messages(&q, 10, TRUE);
+  g_usleep(2000);
+  for (i = 0; i < 10; i++)
+    {
+      log_queue_pop_head(q, &msg, &path_options, FALSE, FALSE);
+      log_queue_push_head(q, msg, &path_options);
+      log_queue_pop_head(q, &msg, &path_options, FALSE, FALSE);
+      delivery_start = log_queue_get_delivery_start(q);
+      g_usleep(1000);
+      log_queue_message_delivered(q, msg, delivery_start);
+      log_msg_ack(msg, &path_options);
+      log_msg_unref(msg);
+    }
+  log_queue_set_latency_histograms(q, NULL, NULL, NULL);
+
+  /* the queue latency of a message pushed back is not recorded twice */
+  if (acked_messages != 10 || queue_latency.count != 10 || delivery_latency.count != 10 || latency.count != 10)
+    {
+      fprintf(stderr, "latency histograms were not recorded without backlog: acked=%d, queue=%" G_GINT64_FORMAT ", delivery=%" G_GINT64_FORMAT ", latency=%" G_GINT64_FORMAT "\n",
+              acked_messages, queue_latency.count, delivery_latency.count, latency.count);
+      exit(1);
+    }
+  /* every recorded queue latency covers the initial sleep */
+  if (stats_histogram_get_percentile(&queue_latency, 0) < 1500 ||
+      stats_histogram_get_percentile(&delivery_latency, 50) < 750)
+    {
+      fprintf(stderr, "latency histograms recorded unexpected values without backlog: queue_min=%" G_GUINT64_FORMAT ", delivery_p50=%" G_GUINT64_FORMAT "\n",
+              stats_histogram_get_percentile(&queue_latency, 0), stats_histogram_get_percentile(&delivery_latency, 50));
+      exit(1);
+    }
+}
+
+/* messages rewound from the backlog were already accounted for */
+static void
+assert_queue_latency_recorded_once_after_rewind(LogQueue *q)
+{
+  StatsHistogram queue_latency = { 0 };
+
+  log_queue_set_latency_histograms(q, &queue_latency, NULL, NULL);
+  feed_some_messages(&q, 10, TRUE);
+  send_some_messages(q, 10, TRUE);
+  rewind_messages(q);
+  send_some_messages(q, 10, TRUE);
+  app_ack_some_messages(q, 10);
+  log_queue_set_latency_histograms(q, NULL, NULL, NULL);
+
+  if (queue_latency.count != 10)
+    {
+      fprintf(stderr, "queue latency was recorded again for rewound messages: queue=%" G_GINT64_FORMAT "\n",
+              queue_latency.count);
+      exit(1);
+    }
+}
+
+void
+testcase_latency_histograms()
+{
+  LogQueue *q;
+
+  q = log_queue_fifo_new(OVERFLOW_SIZE, NULL);
+  assert_latency_histograms_recorded(q);
+  log_queue_unref(q);
+
+  q = log_queue_ring_new(OVERFLOW_SIZE, NULL);
+  assert_latency_histograms_recorded(q);
+  log_queue_unref(q);
+
+  q = log_queue_fifo_new(OVERFLOW_SIZE, NULL);
+  assert_latency_histograms_recorded_without_backlog(q);
+  log_queue_unref(q);
+
+  q = log_queue_ring_new(OVERFLOW_SIZE, NULL);
+  assert_latency_histograms_recorded_without_backlog(q);
+  log_queue_unref(q);
+
+  q = log_queue_fifo_new(OVERFLOW_SIZE, NULL);
+  assert_queue_latency_recorded_once_after_rewind(q);
+  log_queue_unref(q);
+
+  q = log_queue_ring_new(OVERFLOW_SIZE, NULL);
+  assert_queue_latency_recorded_once_after_rewind(q);
+  log_queue_unref(q);
+}
+
 #define FEEDERS 1
 #define MESSAGES_PER_FEEDER 50000
 #define MESSAGES_SUM (FEEDERS * MESSAGES_PER_FEEDER)
@@ -280,6 +412,406 @@ testcase_with_threads()
   fprintf(stderr, "Feed speed: %.2lf\n", (double) TEST_RUNS * MESSAGES_SUM * 1000000 / sum_time);
 }
 
+#define DISKQ_PERSIST_FILE "test_logqueue_disk.persist"
+#define DISKQ_FILE "./syslog-ng-00000.qf"
+#define DISKQ_PERSIST_NAME "test_logqueue_disk"
+
+PersistState *
+diskq_create_persist_state(void)
+{
+  unlink(DISKQ_FILE);
+  return clean_and_create_persist_state_for_test(DISKQ_PERSIST_FILE);
+}
+
+void
+diskq_destroy_persist_state(PersistState *state)
+{
+  cancel_and_destroy_persist_state(state);
+  unlink(DISKQ_FILE);
+}
+
+LogQueue *
+diskq_new(PersistState *state, gint64 disk_buf_size, gint mem_buf_length)
+{
+  LogQueue *q;
+
+  q = log_queue_disk_new(disk_buf_size, mem_buf_length, DISKQ_PERSIST_NAME, state);
+  if (!q)
+    {
+      fprintf(stderr, "error creating disk-buffer\n");
+      exit(1);
+    }
+  return q;
+}
+
+void
+check_queue_length(LogQueue *q, gint64 expected, const gchar *testcase)
+{
+  if (log_queue_get_length(q) != expected)
+    {
+      fprintf(stderr, "%s: unexpected queue length: length=%d, expected=%d\n", testcase, (gint) log_queue_get_length(q), (gint) expected);
+      exit(1);
+    }
+}
+
+void
+check_popped_messages(LogQueue *q, gint n, const gchar *testcase)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg;
+  const gchar *value;
+  gint i;
+
+  for (i = 0; i < n; i++)
+    {
+      if (!log_queue_pop_head(q, &msg, &path_options, FALSE, FALSE))
+        {
+          fprintf(stderr, "%s: queue returned less messages than expected: popped=%d, expected=%d\n", testcase, i, n);
+          exit(1);
+        }
+      value = log_msg_get_value(msg, LM_V_HOST, NULL);
+      if (strcmp(value, "bzorp") != 0 || !msg->saddr || g_sockaddr_get_port(msg->saddr) != 1010)
+        {
+          fprintf(stderr, "%s: message read back from the queue differs: host=%s\n", testcase, value);
+          exit(1);
+        }
+      log_msg_ack(msg, &path_options);
+      log_msg_unref(msg);
+    }
+}
+
+void
+testcase_diskq_and_normal_acks()
+{
+  PersistState *state;
+  LogQueue *q;
+
+  state = diskq_create_persist_state();
+  q = diskq_new(state, 1024 * 1024, 10);
+  fed_messages = 0;
+  acked_messages = 0;
+  feed_some_messages(&q, 100, TRUE);
+
+  /* messages are acked as soon as they are written to disk */
+  if (fed_messages != acked_messages)
+    {
+      fprintf(stderr, "did not receive enough acknowledgements: fed_messages=%d, acked_messages=%d\n", fed_messages, acked_messages);
+      exit(1);
+    }
+  check_queue_length(q, 100, __FUNCTION__);
+
+  send_some_messages(q, 50, TRUE);
+  check_queue_length(q, 50, __FUNCTION__);
+  rewind_messages(q);
+  check_queue_length(q, 100, __FUNCTION__);
+
+  send_some_messages(q, 100, TRUE);
+  app_ack_some_messages(q, 100);
+  check_queue_length(q, 0, __FUNCTION__);
+
+  log_queue_unref(q);
+  diskq_destroy_persist_state(state);
+}
+
+void
+testcase_diskq_survives_restart()
+{
+  PersistState *state;
+  LogQueue *q;
+
+  state = diskq_create_persist_state();
+  q = diskq_new(state, 1024 * 1024, 10);
+  feed_some_messages(&q, 100, TRUE);
+
+  /* 20 delivered, 10 delivered but unacked, these latter are resent */
+  send_some_messages(q, 30, TRUE);
+  app_ack_some_messages(q, 20);
+  log_queue_unref(q);
+
+  state = restart_persist_state(state);
+  q = diskq_new(state, 1024 * 1024, 10);
+  check_queue_length(q, 80, __FUNCTION__);
+  check_popped_messages(q, 80, __FUNCTION__);
+  check_queue_length(q, 0, __FUNCTION__);
+
+  log_queue_unref(q);
+  diskq_destroy_persist_state(state);
+}
+
+void
+testcase_diskq_wraps_around()
+{
+  PersistState *state;
+  LogQueue *q;
+  gint i;
+
+  state = diskq_create_persist_state();
+
+  /* room for roughly 30 messages */
+  q = diskq_new(state, 8192, 5);
+  for (i = 0; i < 100; i++)
+    {
+      feed_some_messages(&q, 7, TRUE);
+      send_some_messages(q, 7, TRUE);
+      app_ack_some_messages(q, 7);
+
+      feed_some_messages(&q, 3, TRUE);
+      check_popped_messages(q, 3, __FUNCTION__);
+    }
+  check_queue_length(q, 0, __FUNCTION__);
+
+  /* fill it up, the excess is dropped */
+  feed_some_messages(&q, 100, TRUE);
+  if (log_queue_get_length(q) >= 100 || log_queue_get_length(q) == 0)
+    {
+      fprintf(stderr, "disk-buffer did not drop messages when full: length=%d\n", (gint) log_queue_get_length(q));
+      exit(1);
+    }
+  check_popped_messages(q, log_queue_get_length(q), __FUNCTION__);
+
+  log_queue_unref(q);
+  diskq_destroy_persist_state(state);
+}
+
+#define THROUGHPUT_MESSAGES 100000
+
+glong
+measure_queue_throughput(LogQueue *q)
+{
+  char *msg_str = "<155>2006-02-11T10:34:56+01:00 bzorp syslog-ng[23323]: árvíztűrőtükörfúrógép";
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  LogMessage *msg, *tmpl;
+  GTimeVal start, end;
+  GSockAddr *sa;
+  gint i;
+
+  sa = g_sockaddr_inet_new("10.10.10.10", 1010);
+  tmpl = log_msg_new(msg_str, strlen(msg_str), sa, &parse_options);
+  g_sockaddr_unref(sa);
+
+  g_get_current_time(&start);
+  for (i = 0; i < THROUGHPUT_MESSAGES; i++)
+    {
+      log_queue_push_tail(q, log_msg_clone_cow(tmpl, &path_options), &path_options);
+      if ((i & 0xFF) == 0xFF)
+        {
+          send_some_messages(q, 0x100, TRUE);
+          app_ack_some_messages(q, 0x100);
+        }
+    }
+  send_some_messages(q, log_queue_get_length(q), TRUE);
+  app_ack_some_messages(q, THROUGHPUT_MESSAGES);
+  g_get_current_time(&end);
+
+  log_msg_unref(tmpl);
+  return g_time_val_diff(&end, &start);
+}
+
+void
+testcase_diskq_latency_histograms()
+{
+  PersistState *state;
+  LogQueue *q;
+
+  state = diskq_create_persist_state();
+  q = diskq_new(state, 1024 * 1024, 10);
+  assert_latency_histograms_recorded(q);
+  assert_latency_histograms_recorded_without_backlog(q);
+  assert_queue_latency_recorded_once_after_rewind(q);
+  log_queue_unref(q);
+  diskq_destroy_persist_state(state);
+}
+
+void
+testcase_fifo_vs_diskq_throughput()
+{
+  PersistState *state;
+  LogQueue *q;
+  glong fifo_time, diskq_time;
+
+  q = log_queue_fifo_new(THROUGHPUT_MESSAGES, NULL);
+  fifo_time = measure_queue_throughput(q);
+  log_queue_unref(q);
+
+  state = diskq_create_persist_state();
+  q = diskq_new(state, 64 * 1024 * 1024, 1000);
+  diskq_time = measure_queue_throughput(q);
+  log_queue_unref(q);
+  diskq_destroy_persist_state(state);
+
+  fprintf(stderr, "Throughput: fifo=%.2lf msg/s, disk-buffer=%.2lf msg/s\n",
+          (double) THROUGHPUT_MESSAGES * 1000000 / fifo_time,
+          (double) THROUGHPUT_MESSAGES * 1000000 / diskq_time);
+}
+
+void
+testcase_ring_and_normal_acks()
+{
+  LogQueue *q;
+
+  q = log_queue_ring_new(OVERFLOW_SIZE, NULL);
+  fed_messages = 0;
+  acked_messages = 0;
+  feed_some_messages(&q, 100, TRUE);
+  check_queue_length(q, 100, __FUNCTION__);
+
+  send_some_messages(q, 50, TRUE);
+  check_queue_length(q, 50, __FUNCTION__);
+  rewind_messages(q);
+  check_queue_length(q, 100, __FUNCTION__);
+
+  check_popped_messages(q, 10, __FUNCTION__);
+  send_some_messages(q, 90, TRUE);
+  app_ack_some_messages(q, 90);
+  check_queue_length(q, 0, __FUNCTION__);
+  if (fed_messages != acked_messages)
+    {
+      fprintf(stderr, "did not receive enough acknowledgements: fed_messages=%d, acked_messages=%d\n", fed_messages, acked_messages);
+      exit(1);
+    }
+
+  log_queue_unref(q);
+}
+
+void
+testcase_ring_drops_messages_above_log_fifo_size()
+{
+  LogQueue *q;
+
+  /* the ring itself is rounded up to 128 slots, the limit is still 100 */
+  q = log_queue_ring_new(100, NULL);
+  fed_messages = 0;
+  acked_messages = 0;
+  feed_some_messages(&q, 150, TRUE);
+  check_queue_length(q, 100, __FUNCTION__);
+  if (acked_messages != 50)
+    {
+      fprintf(stderr, "dropped messages were not acknowledged: acked_messages=%d\n", acked_messages);
+      exit(1);
+    }
+
+  /* wraps around the ring a couple of times */
+  check_popped_messages(q, 100, __FUNCTION__);
+  feed_some_messages(&q, 100, TRUE);
+  check_popped_messages(q, 60, __FUNCTION__);
+  feed_some_messages(&q, 100, TRUE);
+  check_queue_length(q, 100, __FUNCTION__);
+  check_popped_messages(q, 100, __FUNCTION__);
+  check_queue_length(q, 0, __FUNCTION__);
+
+  log_queue_unref(q);
+}
+
+#define CONTENTION_MAX_PRODUCERS 64
+#define CONTENTION_MESSAGES_PER_PRODUCER 20000
+
+typedef struct
+{
+  LogQueue *q;
+  gint thread_id;
+  LogMessage *tmpl;
+} ContentionProducer;
+
+gpointer
+contention_produce(gpointer args)
+{
+  ContentionProducer *producer = (ContentionProducer *) args;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  gint i;
+
+  iv_init();
+  main_loop_worker_thread_start();
+  main_loop_worker_set_thread_id(producer->thread_id);
+
+  for (i = 0; i < CONTENTION_MESSAGES_PER_PRODUCER; i++)
+    {
+      log_queue_push_tail(producer->q, log_msg_clone_cow(producer->tmpl, &path_options), &path_options);
+      if ((i & 0xFF) == 0xFF)
+        main_loop_worker_invoke_batch_callbacks();
+    }
+  main_loop_worker_invoke_batch_callbacks();
+
+  main_loop_worker_thread_stop();
+  iv_deinit();
+  return NULL;
+}
+
+glong
+measure_queue_contention(LogQueue *q, gint producers)
+{
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+  char *msg_str = "<155>2006-02-11T10:34:56+01:00 bzorp syslog-ng[23323]: árvíztűrőtükörfúrógép";
+  ContentionProducer args[CONTENTION_MAX_PRODUCERS];
+  GThread *threads[CONTENTION_MAX_PRODUCERS];
+  gint expected = producers * CONTENTION_MESSAGES_PER_PRODUCER;
+  gint consumed = 0;
+  GTimeVal start, end;
+  LogMessage *tmpl, *msg;
+  GSockAddr *sa;
+  gint i;
+
+  sa = g_sockaddr_inet_new("10.10.10.10", 1010);
+  tmpl = log_msg_new(msg_str, strlen(msg_str), sa, &parse_options);
+  g_sockaddr_unref(sa);
+
+  g_get_current_time(&start);
+  for (i = 0; i < producers; i++)
+    {
+      args[i].q = q;
+      args[i].thread_id = i;
+      args[i].tmpl = tmpl;
+      threads[i] = g_thread_create(contention_produce, &args[i], TRUE, NULL);
+    }
+
+  /* the main thread is the single consumer */
+  while (consumed < expected)
+    {
+      if (log_queue_pop_head(q, &msg, &path_options, TRUE, FALSE))
+        {
+          log_msg_unref(msg);
+          consumed++;
+          if ((consumed & 0xFF) == 0)
+            log_queue_ack_backlog(q, 0x100);
+        }
+    }
+  log_queue_ack_backlog(q, expected);
+
+  for (i = 0; i < producers; i++)
+    g_thread_join(threads[i]);
+  g_get_current_time(&end);
+
+  log_msg_unref(tmpl);
+  return g_time_val_diff(&end, &start);
+}
+
+void
+testcase_fifo_vs_ring_contention()
+{
+  LogQueue *q;
+  glong fifo_time, ring_time;
+  gint producers, size;
+
+  log_queue_set_max_threads(CONTENTION_MAX_PRODUCERS);
+  for (producers = 1; producers <= CONTENTION_MAX_PRODUCERS; producers *= 2)
+    {
+      /* large enough not to drop anything */
+      size = producers * CONTENTION_MESSAGES_PER_PRODUCER;
+
+      q = log_queue_fifo_new(size, NULL);
+      fifo_time = measure_queue_contention(q, producers);
+      log_queue_unref(q);
+
+      q = log_queue_ring_new(size, NULL);
+      ring_time = measure_queue_contention(q, producers);
+      log_queue_unref(q);
+
+      fprintf(stderr, "Contention: producers=%d, fifo=%.2lf msg/s, ring=%.2lf msg/s\n",
+              producers,
+              (double) size * 1000000 / MAX(fifo_time, 1),
+              (double) size * 1000000 / MAX(ring_time, 1));
+    }
+}
+
 int
 main()
 {
@@ -301,5 +833,26 @@ main()
   fprintf(stderr,"Start testcase_zero_diskbuf_and_normal_acks\n");
   testcase_zero_diskbuf_and_normal_acks();
 #endif
+
+  fprintf(stderr,"Start testcase_latency_histograms\n");
+  testcase_latency_histograms();
+
+  fprintf(stderr,"Start testcase_diskq_and_normal_acks\n");
+  testcase_diskq_and_normal_acks();
+  fprintf(stderr,"Start testcase_diskq_survives_restart\n");
+  testcase_diskq_survives_restart();
+  fprintf(stderr,"Start testcase_diskq_wraps_around\n");
+  testcase_diskq_wraps_around();
+  fprintf(stderr,"Start testcase_diskq_latency_histograms\n");
+  testcase_diskq_latency_histograms();
+  fprintf(stderr,"Start testcase_fifo_vs_diskq_throughput\n");
+  testcase_fifo_vs_diskq_throughput();
+
+  fprintf(stderr,"Start testcase_ring_and_normal_acks\n");
+  testcase_ring_and_normal_acks();
+  fprintf(stderr,"Start testcase_ring_drops_messages_above_log_fifo_size\n");
+  testcase_ring_drops_messages_above_log_fifo_size();
+  fprintf(stderr,"Start testcase_fifo_vs_ring_contention\n");
+  testcase_fifo_vs_ring_contention();
   return 0;
 }
@@ -8,6 +8,9 @@
 #include "timeutils.h"
 #include "plugin.h"
 #include "logqueue-fifo.h"
+#include "mainloop.h"
+#include "logproto/logproto-text-client.h"
+#include "libtest/mock-transport.h"
 
 #include <time.h>
 #include <stdlib.h>
@@ -86,6 +89,91 @@ testcase(gchar *msg_string, gboolean input_is_rfc5424, gchar *template, guint wr
   g_string_free(res, TRUE);
 }
 
+static guint acked_messages;
+
+static void
+test_ack(LogMessage *msg, gpointer user_data)
+{
+  acked_messages |= GPOINTER_TO_UINT(user_data);
+}
+
+static void
+push_acked_message(LogQueue *queue, const gchar *text, guint id)
+{
+  LogMessage *msg = log_msg_new_empty();
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  log_msg_set_value(msg, LM_V_MESSAGE, text, -1);
+  path_options.ack_needed = TRUE;
+  log_msg_add_ack(msg, &path_options);
+  msg->ack_func = test_ack;
+  msg->ack_userdata = GUINT_TO_POINTER(id);
+  log_queue_push_tail(queue, msg, &path_options);
+}
+
+/* a message skipped because of its empty template output must not shift
+ * the count of pending messages onto one still waiting in the proto */
+void
+test_skipped_message_does_not_ack_a_pending_one(void)
+{
+  static LogProtoClientOptionsStorage proto_options;
+  LogTemplate *templ;
+  LogWriterOptions opt = {0};
+  LogWriter *writer;
+  LogQueue *queue;
+  LogTransport *transport;
+  LogMessage *msg;
+  LogPathOptions path_options = LOG_PATH_OPTIONS_INIT;
+
+  main_thread_handle = get_thread_id();
+  acked_messages = 0;
+
+  templ = log_template_new(configuration, "dummy");
+  log_template_compile(templ, "$MSG", NULL);
+  opt.options = LWO_NO_MULTI_LINE | LWO_NO_STATS | LWO_SHARE_STATS;
+  opt.template = templ;
+
+  queue = log_queue_fifo_new(1000, NULL);
+  push_acked_message(queue, "a message longer than a single partial write", 1);
+  push_acked_message(queue, "", 2);
+
+  writer = log_writer_new(LW_FORMAT_FILE, configuration);
+  log_writer_set_options(writer, NULL, &opt, 0, 0, NULL, NULL);
+  log_writer_set_queue(writer, log_queue_ref(queue));
+
+  /* a regular file is not polled, the mock transport does the writing */
+  transport = log_transport_mock_writer_new(4);
+  transport->fd = fileno(tmpfile());
+
+  log_pipe_init((LogPipe *) writer);
+  log_writer_reopen(writer, log_proto_text_client_new(transport, &proto_options.super));
+  log_pipe_deinit((LogPipe *) writer);
+
+  if (acked_messages != 2)
+    {
+      fprintf(stderr, "Testcase failed; acked messages: %x, expected: 2\n", acked_messages);
+      exit(1);
+    }
+
+  /* the partially written message is rewound into the queue */
+  log_pipe_unref((LogPipe *) writer);
+  if (log_queue_get_length(queue) != 1 || !log_queue_pop_head(queue, &msg, &path_options, FALSE, TRUE))
+    {
+      fprintf(stderr, "Testcase failed; the unwritten message was not rewound into the queue\n");
+      exit(1);
+    }
+  log_msg_ack(msg, &path_options);
+  log_msg_unref(msg);
+  if (acked_messages != 3)
+    {
+      fprintf(stderr, "Testcase failed; acked messages: %x, expected: 3\n", acked_messages);
+      exit(1);
+    }
+
+  log_queue_unref(queue);
+  log_template_unref(templ);
+}
+
 int
 main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
 {
@@ -145,6 +233,8 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   testcase(msg_zero_pri, FALSE, NULL,   LW_FORMAT_PROTO, expected_msg_zero_pri_str);
   testcase(msg_zero_pri, FALSE, "$PRI", LW_FORMAT_PROTO, expected_msg_zero_pri_str_t);
 
+  test_skipped_message_does_not_ack_a_pending_one();
+
   app_shutdown();
   return 0;
 }
@@ -1,4 +1,5 @@
 #include "logmatcher.h"
+#include "logmatcher-pcre.h"
 #include "apphook.h"
 #include "plugin.h"
 #include "cfg.h"
@@ -107,6 +108,113 @@ testcase_replace(const gchar *log, const gchar *re, gchar *replacement, const gc
   return 0;
 }
 
+void
+testcase_required_literal(const gchar *pattern, gint matcher_flags, const gchar *expected_literal)
+{
+  LogMatcher *m = construct_matcher(matcher_flags, log_matcher_pcre_re_new);
+
+  log_matcher_compile(m, pattern, NULL);
+  if ((m->required_literal == NULL) != (expected_literal == NULL) ||
+      (expected_literal && strcmp(m->required_literal, expected_literal) != 0))
+    {
+      fprintf(stderr, "Testcase required literal failure. pattern=%s, literal=%s, expected=%s\n",
+              pattern, m->required_literal ? : "NULL", expected_literal ? : "NULL");
+      exit(1);
+    }
+  log_matcher_unref(m);
+}
+
+/* matchers attached to a prefilter have to return the same results as the ones without */
+void
+testcase_prefilter(void)
+{
+  const gchar *patterns[] = { "disk (full|quota)", "^error: .* failed$", "connection (reset|refused)", "timeout", "user \\w+ logged in" };
+  gint pattern_flags[] = { 0, 0, 0, LMF_ICASE, 0 };
+  const gchar *values[] = { "error: mount of /home failed", "connection refused by peer", "Disk full", "disk quota exceeded",
+                            "TIMEOUT while waiting", "user bob logged in", "nothing interesting", "" };
+  LogMatcher *prefiltered[G_N_ELEMENTS(patterns)], *plain[G_N_ELEMENTS(patterns)];
+  LogMatcherPrefilter *prefilter = log_matcher_prefilter_new();
+  LogMessage *msg = log_msg_new_empty();
+  gint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS(patterns); i++)
+    {
+      prefiltered[i] = construct_matcher(pattern_flags[i], log_matcher_pcre_re_new);
+      log_matcher_compile(prefiltered[i], patterns[i], NULL);
+      log_matcher_attach_prefilter(prefiltered[i], prefilter);
+
+      plain[i] = construct_matcher(pattern_flags[i], log_matcher_pcre_re_new);
+      log_matcher_compile(plain[i], patterns[i], NULL);
+    }
+  log_matcher_prefilter_compile(prefilter);
+
+  for (j = 0; j < G_N_ELEMENTS(values); j++)
+    {
+      for (i = 0; i < G_N_ELEMENTS(patterns); i++)
+        {
+          gboolean expected = log_matcher_match(plain[i], msg, LM_V_NONE, values[j], -1);
+          gboolean result = log_matcher_match(prefiltered[i], msg, LM_V_NONE, values[j], -1);
+
+          if (result != expected)
+            {
+              fprintf(stderr, "Testcase prefilter failure. pattern=%s, value=%s, result=%d, expected=%d\n", patterns[i], values[j], result, expected);
+              exit(1);
+            }
+        }
+    }
+
+  for (i = 0; i < G_N_ELEMENTS(patterns); i++)
+    {
+      log_matcher_unref(prefiltered[i]);
+      log_matcher_unref(plain[i]);
+    }
+  log_matcher_prefilter_unref(prefilter);
+  log_msg_unref(msg);
+}
+
+/* JIT compiled expressions have to return the same results and store the same named substrings as interpreted ones */
+void
+testcase_jit(void)
+{
+  const gchar *patterns[] = { "(?<user>\\w+) logged in", "^(a|b)+c$", "(wiki)\\1", "[0-9]{3}-[0-9]{4}" };
+  const gchar *values[] = { "bob logged in", "ababbac", "wikiwiki", "call 555-1234 now", "" };
+  NVHandle user = log_msg_get_value_handle("user");
+  gint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS(patterns); i++)
+    {
+      LogMatcher *jit, *interpreted;
+
+      log_matcher_pcre_set_jit(TRUE);
+      jit = construct_matcher(LMF_STORE_MATCHES, log_matcher_pcre_re_new);
+      log_matcher_compile(jit, patterns[i], NULL);
+
+      /* compiled with JIT, as options{} might come after it, the owner turns it off */
+      interpreted = construct_matcher(LMF_STORE_MATCHES, log_matcher_pcre_re_new);
+      log_matcher_compile(interpreted, patterns[i], NULL);
+      log_matcher_set_jit(interpreted, FALSE);
+
+      for (j = 0; j < G_N_ELEMENTS(values); j++)
+        {
+          LogMessage *jit_msg = log_msg_new_empty();
+          LogMessage *interpreted_msg = log_msg_new_empty();
+          gboolean expected = log_matcher_match(interpreted, interpreted_msg, LM_V_NONE, values[j], -1);
+          gboolean result = log_matcher_match(jit, jit_msg, LM_V_NONE, values[j], -1);
+
+          if (result != expected ||
+              strcmp(log_msg_get_value(jit_msg, user, NULL), log_msg_get_value(interpreted_msg, user, NULL)) != 0)
+            {
+              fprintf(stderr, "Testcase jit failure. pattern=%s, value=%s, result=%d, expected=%d\n", patterns[i], values[j], result, expected);
+              exit(1);
+            }
+          log_msg_unref(jit_msg);
+          log_msg_unref(interpreted_msg);
+        }
+      log_matcher_unref(jit);
+      log_matcher_unref(interpreted);
+    }
+}
+
 int
 main()
 {
@@ -187,5 +295,23 @@ main()
 
   testcase_replace("<155>2006-02-11T10:34:56+01:00 bzorp syslog-ng[23323]: wikiwiki", "([[:digit:]]{1,3}\\.){3}[[:digit:]]{1,3}", "foo", "wikiwiki", construct_matcher(LMF_GLOBAL, log_matcher_pcre_re_new));
 
+  /* literals required by PCRE patterns, used for prefiltering */
+  testcase_required_literal("disk full", 0, "disk full");
+  testcase_required_literal("^error: (\\d+) disk full$", 0, " disk full");
+  testcase_required_literal("(abc|def)xyz", 0, "xyz");
+  testcase_required_literal("abc|def", 0, NULL);
+  testcase_required_literal("colou?r", 0, "colo");
+  testcase_required_literal("\\bERROR\\b", 0, "ERROR");
+  testcase_required_literal("\\x41bcd", 0, "bcd");
+  testcase_required_literal("foo\\.bar", 0, "foo.bar");
+  testcase_required_literal("abcd{2,3}", 0, "abc");
+  testcase_required_literal("(?i)abcdef", 0, NULL);
+  testcase_required_literal("(?P<pid>\\d+) sshd", 0, " sshd");
+  testcase_required_literal("sshd", LMF_ICASE | LMF_UTF8, NULL);
+  testcase_required_literal("a.b", 0, NULL);
+
+  testcase_prefilter();
+  testcase_jit();
+
   return 0;
 }
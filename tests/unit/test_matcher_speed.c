@@ -0,0 +1,123 @@
+#include "logmatcher.h"
+#include "apphook.h"
+#include "cfg.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/* a configuration with lots of match() filters on $MESSAGE */
+#define BENCHMARK_PATTERNS 1000
+#define BENCHMARK_MESSAGES 200
+
+static LogMatcher *
+create_matcher(const gchar *pattern, LogMatcherPrefilter *prefilter)
+{
+  LogMatcherOptions matcher_options;
+  LogMatcher *m;
+
+  log_matcher_options_defaults(&matcher_options);
+  log_matcher_options_set_type(&matcher_options, "pcre");
+  matcher_options.flags = LMF_MATCH_ONLY;
+  m = log_matcher_new(&matcher_options);
+  log_matcher_options_destroy(&matcher_options);
+
+  if (!log_matcher_compile(m, pattern, NULL))
+    {
+      fprintf(stderr, "Error compiling benchmark pattern; pattern='%s'\n", pattern);
+      exit(1);
+    }
+  if (prefilter)
+    log_matcher_attach_prefilter(m, prefilter);
+  return m;
+}
+
+static gint
+match_all(LogMatcher **matchers, LogMessage *msg, gchar **values, gboolean *results)
+{
+  gint i, j, matched = 0;
+
+  for (j = 0; j < BENCHMARK_MESSAGES; j++)
+    {
+      for (i = 0; i < BENCHMARK_PATTERNS; i++)
+        {
+          results[j * BENCHMARK_PATTERNS + i] = log_matcher_match(matchers[i], msg, LM_V_NONE, values[j], -1);
+          matched += results[j * BENCHMARK_PATTERNS + i];
+        }
+    }
+  return matched;
+}
+
+int
+main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
+{
+  LogMatcher *plain[BENCHMARK_PATTERNS], *prefiltered[BENCHMARK_PATTERNS];
+  gboolean *plain_results, *prefiltered_results;
+  gchar *values[BENCHMARK_MESSAGES];
+  LogMatcherPrefilter *prefilter;
+  LogMessage *msg;
+  GTimeVal start, end;
+  glong plain_time, prefiltered_time;
+  gint i, matched;
+
+  app_startup();
+  configuration = cfg_new(0x0302);
+
+  prefilter = log_matcher_prefilter_new();
+  for (i = 0; i < BENCHMARK_PATTERNS; i++)
+    {
+      gchar *pattern;
+
+      /* every tenth pattern has no usable literal, those are always executed */
+      if (i % 10 == 0)
+        pattern = g_strdup_printf("^\\S+ \\d+ [0-9:]{%d} ", i + 1);
+      else
+        pattern = g_strdup_printf("service%d: .* (failed|timed out)$", i);
+
+      plain[i] = create_matcher(pattern, NULL);
+      prefiltered[i] = create_matcher(pattern, prefilter);
+      g_free(pattern);
+    }
+  log_matcher_prefilter_compile(prefilter);
+
+  for (i = 0; i < BENCHMARK_MESSAGES; i++)
+    values[i] = g_strdup_printf("Oct 11 22:14:15 host service%d: connection to upstream %d timed out", i * 7, i);
+
+  msg = log_msg_new_empty();
+  plain_results = g_new0(gboolean, BENCHMARK_PATTERNS * BENCHMARK_MESSAGES);
+  prefiltered_results = g_new0(gboolean, BENCHMARK_PATTERNS * BENCHMARK_MESSAGES);
+
+  g_get_current_time(&start);
+  matched = match_all(plain, msg, values, plain_results);
+  g_get_current_time(&end);
+  plain_time = g_time_val_diff(&end, &start);
+
+  g_get_current_time(&start);
+  match_all(prefiltered, msg, values, prefiltered_results);
+  g_get_current_time(&end);
+  prefiltered_time = g_time_val_diff(&end, &start);
+
+  printf("      %d patterns, %d messages, %d matches\n", BENCHMARK_PATTERNS, BENCHMARK_MESSAGES, matched);
+  printf("      %-30s speed: %12.3f msg/sec\n", "one regexp per pattern", BENCHMARK_MESSAGES * 1e6 / MAX(plain_time, 1));
+  printf("      %-30s speed: %12.3f msg/sec\n", "literal prefilter", BENCHMARK_MESSAGES * 1e6 / MAX(prefiltered_time, 1));
+
+  if (memcmp(plain_results, prefiltered_results, BENCHMARK_PATTERNS * BENCHMARK_MESSAGES * sizeof(gboolean)) != 0)
+    {
+      fprintf(stderr, "Prefiltered matchers returned different results than plain ones\n");
+      return 1;
+    }
+
+  for (i = 0; i < BENCHMARK_PATTERNS; i++)
+    {
+      log_matcher_unref(plain[i]);
+      log_matcher_unref(prefiltered[i]);
+    }
+  for (i = 0; i < BENCHMARK_MESSAGES; i++)
+    g_free(values[i]);
+  g_free(plain_results);
+  g_free(prefiltered_results);
+  log_matcher_prefilter_unref(prefilter);
+  log_msg_unref(msg);
+  app_shutdown();
+  return 0;
+}
@@ -870,6 +870,120 @@ testcase("<132>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog - - [a i=\"]ok
 /*############################*/
 }
 
+void
+test_raw_message_is_stored_and_referenced_by_msg()
+{
+  const gchar *raw = "<7>2006-10-29T01:59:59.156+01:00 mymachine evntslog[1234]: An application event log entry...";
+  LogMessage *message;
+  gssize len;
+
+  testcase_begin("Testing store-raw-message; msg='%s'", raw);
+  message = parse_log_message((gchar *) raw, LP_EXPECT_HOSTNAME | LP_STORE_RAW_MESSAGE, NULL);
+  assert_log_message_value(message, log_msg_get_value_handle("RAWMSG"), raw);
+  assert_log_message_value(message, LM_V_HOST, "mymachine");
+  assert_log_message_value(message, LM_V_PROGRAM, "evntslog");
+  assert_log_message_value(message, LM_V_PID, "1234");
+  assert_log_message_value(message, LM_V_MESSAGE, "An application event log entry...");
+  log_msg_get_value(message, LM_V_MESSAGE, &len);
+  assert_gint(len, strlen("An application event log entry..."), "Unexpected $MSG length");
+  log_msg_unref(message);
+  testcase_end();
+
+  raw = "<7>1 2006-10-29T01:59:59.156+01:00 mymachine evntslog 1234 ID47 [exampleSDID@0 iut=\"3\"] An application event log entry...";
+  testcase_begin("Testing store-raw-message; msg='%s'", raw);
+  message = parse_log_message((gchar *) raw, LP_SYSLOG_PROTOCOL | LP_STORE_RAW_MESSAGE, NULL);
+  assert_log_message_value(message, log_msg_get_value_handle("RAWMSG"), raw);
+  assert_log_message_value(message, LM_V_MSGID, "ID47");
+  assert_log_message_value(message, LM_V_MESSAGE, "An application event log entry...");
+  log_msg_unref(message);
+  testcase_end();
+
+  /* no-multi-line rewrites $MSG, $RAWMSG has to stay intact */
+  raw = "<7>2006-10-29T01:59:59.156+01:00 mymachine evntslog: multi\nline";
+  testcase_begin("Testing store-raw-message; msg='%s'", raw);
+  message = parse_log_message((gchar *) raw, LP_EXPECT_HOSTNAME | LP_STORE_RAW_MESSAGE | LP_NO_MULTI_LINE, NULL);
+  assert_log_message_value(message, log_msg_get_value_handle("RAWMSG"), raw);
+  assert_log_message_value(message, LM_V_MESSAGE, "multi line");
+  log_msg_unref(message);
+  testcase_end();
+}
+
+/* compared to keeping a copy of the raw message, only the header fields
+ * are stored twice */
+void
+test_raw_message_saves_the_size_of_msg()
+{
+  gchar *raw = "<7>2006-10-29T01:59:59.156+01:00 mymachine evntslog[1234]: An application event log entry, "
+               "long enough to be dominated by the message body rather than the header fields";
+  gsize msg_len = strlen(strstr(raw, ": ") + 2);
+  LogMessage *copied, *referenced;
+  guint32 saving;
+
+  testcase_begin("Testing store-raw-message payload size; msg='%s'", raw);
+  copied = parse_log_message(raw, LP_EXPECT_HOSTNAME, NULL);
+  log_msg_set_value(copied, log_msg_get_value_handle("RAWMSG"), raw, -1);
+  referenced = parse_log_message(raw, LP_EXPECT_HOSTNAME | LP_STORE_RAW_MESSAGE, NULL);
+
+  assert_true(referenced->payload->used < copied->payload->used,
+              "store-raw-message uses more payload space than a copy of the raw message; copied=%d, referenced=%d",
+              copied->payload->used, referenced->payload->used);
+  saving = copied->payload->used - referenced->payload->used;
+  /* the indirect entry of $MSG takes a few bytes of what its copy did */
+  assert_true(saving >= msg_len / 2,
+              "store-raw-message saves less than expected; saving=%d, msg_len=%d",
+              saving, (gint) msg_len);
+
+  log_msg_unref(copied);
+  log_msg_unref(referenced);
+  testcase_end();
+}
+
+#define PARSE_BENCHMARK_ITERATIONS 100000
+
+/* with @copy_raw the raw message is stored as a separate copy next to
+ * the parsed fields, which is what store-raw-message replaces */
+static glong
+measure_parse_speed(gint parse_flags, gboolean copy_raw)
+{
+  gchar *raw = "<7>2006-10-29T01:59:59.156+01:00 mymachine evntslog[1234]: An application event log entry, "
+               "long enough to be dominated by the message body rather than the header fields";
+  GSockAddr *addr = g_sockaddr_inet_new("10.10.10.10", 1010);
+  NVHandle raw_handle = log_msg_get_value_handle("RAWMSG");
+  gint raw_len = strlen(raw);
+  LogMessage *message;
+  GTimeVal start, end;
+  gint i;
+
+  parse_options.flags = parse_flags;
+  g_get_current_time(&start);
+  for (i = 0; i < PARSE_BENCHMARK_ITERATIONS; i++)
+    {
+      message = log_msg_new(raw, raw_len, addr, &parse_options);
+      if (copy_raw)
+        log_msg_set_value(message, raw_handle, raw, raw_len);
+      log_msg_unref(message);
+    }
+  g_get_current_time(&end);
+  g_sockaddr_unref(addr);
+
+  return g_time_val_diff(&end, &start);
+}
+
+void
+test_raw_message_parse_speed()
+{
+  glong plain_time, copy_time, indirect_time;
+
+  plain_time = measure_parse_speed(LP_EXPECT_HOSTNAME, FALSE);
+  copy_time = measure_parse_speed(LP_EXPECT_HOSTNAME, TRUE);
+  indirect_time = measure_parse_speed(LP_EXPECT_HOSTNAME | LP_STORE_RAW_MESSAGE, FALSE);
+
+  fprintf(stderr, "Parse speed: plain=%.2lf msg/s, raw message copied=%.2lf msg/s, store-raw-message=%.2lf msg/s\n",
+          (double) PARSE_BENCHMARK_ITERATIONS * 1000000 / MAX(plain_time, 1),
+          (double) PARSE_BENCHMARK_ITERATIONS * 1000000 / MAX(copy_time, 1),
+          (double) PARSE_BENCHMARK_ITERATIONS * 1000000 / MAX(indirect_time, 1));
+}
+
 int
 main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
 {
@@ -879,6 +993,9 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   init_and_load_syslogformat_module();
 
   test_log_messages_can_be_parsed();
+  test_raw_message_is_stored_and_referenced_by_msg();
+  test_raw_message_saves_the_size_of_msg();
+  test_raw_message_parse_speed();
 
   deinit_syslogformat_module();
   app_shutdown();
@@ -0,0 +1,105 @@
+#include "slab-alloc.h"
+#include "apphook.h"
+
+#include <string.h>
+
+#define TEST_ASSERT(x)  \
+  do { \
+   if (!(x)) \
+     { \
+       fprintf(stderr, "test assertion failed: " #x " line: %d\n", __LINE__); \
+       exit(1); \
+     } \
+  } while (0)
+
+#define BLOCKS 1000
+
+static void
+test_freed_blocks_are_reused()
+{
+  gpointer block, again;
+
+  block = slab_alloc(300);
+  slab_free(block);
+  again = slab_alloc(400);
+  TEST_ASSERT(block == again);
+  slab_free(again);
+}
+
+static void
+test_realloc_keeps_content()
+{
+  gchar *block;
+  gint i;
+
+  block = slab_alloc(100);
+  for (i = 0; i < 100; i++)
+    block[i] = i;
+
+  /* within the same size class, across classes and into g_malloc() */
+  block = slab_realloc(block, 200);
+  block = slab_realloc(block, 4000);
+  block = slab_realloc(block, 1024 * 1024);
+  block = slab_realloc(block, 2 * 1024 * 1024);
+  for (i = 0; i < 100; i++)
+    TEST_ASSERT(block[i] == i);
+  slab_free(block);
+}
+
+static gpointer
+free_blocks(gpointer user_data)
+{
+  gpointer *blocks = (gpointer *) user_data;
+  gint i;
+
+  for (i = 0; i < BLOCKS; i++)
+    slab_free(blocks[i]);
+  slab_alloc_thread_deinit();
+  return NULL;
+}
+
+static void
+test_blocks_freed_by_another_thread_are_reused()
+{
+  gpointer blocks[BLOCKS];
+  GThread *thread;
+  gint i, reused = 0;
+
+  for (i = 0; i < BLOCKS; i++)
+    blocks[i] = slab_alloc(1000);
+
+  /* the freeing thread hands its freelists over to the depot */
+  thread = g_thread_create(free_blocks, blocks, TRUE, NULL);
+  g_thread_join(thread);
+
+  for (i = 0; i < BLOCKS; i++)
+    {
+      gpointer block = slab_alloc(1000);
+      gint j;
+
+      for (j = 0; j < BLOCKS; j++)
+        if (block == blocks[j])
+          {
+            reused++;
+            break;
+          }
+      blocks[i] = block;
+    }
+  TEST_ASSERT(reused > 0);
+
+  for (i = 0; i < BLOCKS; i++)
+    slab_free(blocks[i]);
+}
+
+int
+main()
+{
+  app_startup();
+
+  test_freed_blocks_are_reused();
+  test_realloc_keeps_content();
+  test_blocks_freed_by_another_thread_are_reused();
+
+  app_shutdown();
+  return 0;
+}
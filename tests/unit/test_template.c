@@ -120,6 +120,7 @@ test_macros(void)
   assert_template_format("$R_FULLDATE", "2006 Feb 11 19:58:35.639");
   assert_template_format("$R_ISODATE", "2006-02-11T19:58:35.639+01:00");
   assert_template_format("$R_STAMP", "Feb 11 19:58:35.639");
+  assert_template_format("$ISODATE $R_ISODATE $DATE $R_DATE $ISODATE", "2006-02-11T10:34:56.000+01:00 2006-02-11T19:58:35.639+01:00 Feb 11 10:34:56.000 Feb 11 19:58:35.639 2006-02-11T10:34:56.000+01:00");
   assert_template_format("$R_YEAR", "2006");
   assert_template_format("$R_YEAR_DAY", "042");
   assert_template_format("$R_MONTH", "02");
@@ -186,6 +187,7 @@ test_nvpairs(void)
   assert_template_format("${1}", "first-match");
   assert_template_format("$1", "first-match");
   assert_template_format("$$$1$$", "$first-match$");
+  assert_template_format("x$$y${QQQQQ}z$$", "x$yz$");
 }
 
 static void
@@ -197,6 +199,8 @@ test_template_functions(void)
   assert_template_format("$(echo \"$(echo '$(echo $HOST)')\" $PID)", "bzorp 23323");
   assert_template_format("$(echo \"$(echo '$(echo $HOST)')\" $PID)", "bzorp 23323");
   assert_template_format("$(echo '\"$(echo $(echo $HOST))\"' $PID)", "\"bzorp\" 23323");
+  assert_template_format("$(echo foo bar)$$ $(echo \"$(echo baz)\")", "foo bar$ baz");
+  assert_template_format("$(echo $(echo $(echo $HOST)) $(echo $PID))", "bzorp 23323");
 }
 
 static void
@@ -20,10 +20,73 @@ MsgFormatOptions parse_options;
 #define BOM "\xEF\xBB\xBF"
 
 #define BENCHMARK_COUNT 10000
+#define BENCHMARK_THREADS 4
+
+/* regression gate: every template has to be formatted at least this fast,
+ * can be overridden using the TEMPLATE_SPEED_MIN_RATE environment variable */
+#define DEFAULT_MIN_RATE 10000.0
+
+static gdouble min_rate = DEFAULT_MIN_RATE;
+
+static void
+check_rate(const gchar *template, gdouble rate)
+{
+  if (rate < min_rate)
+    {
+      fprintf(stderr, "Template formatting is slower than the regression gate; template='%s', rate='%.3f', min_rate='%.3f'\n",
+              template, rate, min_rate);
+      success = FALSE;
+    }
+}
+
+typedef struct
+{
+  LogTemplate *templ;
+  LogMessage *msg;
+} FormatThreadArgs;
+
+static gpointer
+format_template_thread(gpointer s)
+{
+  FormatThreadArgs *args = (FormatThreadArgs *) s;
+  GString *res = g_string_sized_new(1024);
+  gint i;
+
+  for (i = 0; i < BENCHMARK_COUNT; i++)
+    log_template_format(args->templ, args->msg, NULL, LTZ_LOCAL, 0, NULL, res);
+
+  log_template_thread_deinit();
+  g_string_free(res, TRUE);
+  return NULL;
+}
+
+/* the same template is formatted concurrently, which used to be
+ * serialized on a per-template lock when template functions were used */
+static void
+testcase_threaded(LogTemplate *templ, LogMessage *msg, const gchar *template)
+{
+  GThread *threads[BENCHMARK_THREADS];
+  FormatThreadArgs args = { templ, msg };
+  GTimeVal start, end;
+  gdouble rate;
+  gint i;
+
+  g_get_current_time(&start);
+  for (i = 0; i < BENCHMARK_THREADS; i++)
+    threads[i] = g_thread_create(format_template_thread, &args, TRUE, NULL);
+  for (i = 0; i < BENCHMARK_THREADS; i++)
+    g_thread_join(threads[i]);
+  g_get_current_time(&end);
+
+  rate = BENCHMARK_THREADS * BENCHMARK_COUNT * 1e6 / g_time_val_diff(&end, &start);
+  printf("      %-79.*s %d threads speed: %12.3f msg/sec\n", (int) strlen(template) - 1, template, BENCHMARK_THREADS, rate);
+  check_rate(template, rate);
+}
 
 void
 testcase(const gchar *msg_str, gboolean syslog_proto, gchar *template)
 {
+  gdouble rate;
   LogTemplate *templ;
   LogMessage *msg;
   GString *res = g_string_sized_new(1024);
@@ -68,7 +131,12 @@ testcase(const gchar *msg_str, gboolean syslog_proto, gchar *template)
       log_template_format(templ, msg, NULL, LTZ_LOCAL, 0, NULL, res);
     }
   g_get_current_time(&end);
-  printf("      %-90.*s speed: %12.3f msg/sec\n", (int) strlen(template) - 1, template, i * 1e6 / g_time_val_diff(&end, &start));
+  rate = i * 1e6 / g_time_val_diff(&end, &start);
+  printf("      %-90.*s speed: %12.3f msg/sec\n", (int) strlen(template) - 1, template, rate);
+  check_rate(template, rate);
+
+  if (strstr(template, "$("))
+    testcase_threaded(templ, msg, template);
 
   log_template_unref(templ);
   g_string_free(res, TRUE);
@@ -81,6 +149,9 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   if (argc > 1)
     verbose = TRUE;
 
+  if (getenv("TEMPLATE_SPEED_MIN_RATE"))
+    min_rate = g_ascii_strtod(getenv("TEMPLATE_SPEED_MIN_RATE"), NULL);
+
   configuration = cfg_new(0x0300);
 
   app_startup();
@@ -101,6 +172,21 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
            "$DATE\n");
 
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$ISODATE\n");
+
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$FULLDATE\n");
+
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$UNIXTIME\n");
+
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$ISODATE $R_ISODATE $DATE $R_DATE\n");
+
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$ISODATE $HOST $MSGHDR$MSG\n");
+
   testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
            "$DATE $HOST\n");
 
@@ -128,6 +214,15 @@ main(int argc G_GNUC_UNUSED, char *argv[] G_GNUC_UNUSED)
   testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
            "$(+ $FACILITY $FACILITY)\n");
 
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$(echo $(echo $HOST) $(echo $MSG))\n");
+
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "$(substr $MSG 0 5)\n");
+
+  testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
+           "literal $$text ${QQQQQ}with an $$escaped dollar sign $MSG\n");
+
   testcase("<155>2006-02-11T10:34:56.156+01:00 bzorp syslog-ng[23323]:árvíztűrőtükörfúrógép", FALSE,
            "$DATE $FACILITY.$PRIORITY $HOST $MSGHDR$MSG $SEQNO\n");
 